@@ -1,19 +1,23 @@
 #ifndef ROCKET_AVIONICS_TEMPLATE_USERCONFIG_H
 #define ROCKET_AVIONICS_TEMPLATE_USERCONFIG_H
 
+#include "UserState.h"
 #include <cstdint>
 #include <cstdlib>
 
 // File Name
 constexpr const char *RA_FILE_NAME = "MFC_LOGGER_";
 
+// Log Format (true: binary records, false: CSV text), columns are listed in LogRecord.h
+constexpr bool RA_LOG_BINARY = false;
+
 // File Extension
-constexpr const char *RA_FILE_EXT = "CSV";
+constexpr const char *RA_FILE_EXT = RA_LOG_BINARY ? "BIN" : "CSV";
 
-// Number of IMU sensors
+// Number of IMU sensors, more than one vote on each reading (median)
 constexpr size_t RA_NUM_IMU = 1;
 
-// Number of Altimeter sensors
+// Number of Altimeter sensors, voted like the IMUs
 constexpr size_t RA_NUM_ALTIMETER = 1;
 
 // Number of GNSS sensors
@@ -39,8 +43,11 @@ constexpr uint32_t RA_INTERVAL_IMU_READING = 5ul;  // ms
 // Altimeter Reading
 constexpr uint32_t RA_INTERVAL_ALTIMETER_READING = 100ul;  // ms
 
-// GNSS Reading
-constexpr uint32_t RA_INTERVAL_GNSS_READING = 500ul;  // ms
+// GNSS Reading: the receiver's navigation period (10-25 Hz: 100-40 ms), the task wakes on each NAV-PVT
+constexpr uint32_t RA_INTERVAL_GNSS_READING = 100ul;  // ms
+
+// GNSS UART baud rate, set on the receiver at startup
+constexpr uint32_t RA_GNSS_BAUD = 115200ul;
 
 // FSM Evaluation
 constexpr uint32_t RA_INTERVAL_FSM_EVAL = 5ul;  // ms
@@ -54,6 +61,53 @@ constexpr uint32_t RA_INTERVAL_CONSTRUCT = 50ul;  // ms
 // Altitude Auto-Zero
 constexpr uint32_t RA_INTERVAL_AUTOZERO = 50ul;  // ms
 
+// IMU and altimeter read on their data-ready interrupts (ADXL372 FIFO watermark, BMP581 DRDY), the intervals above
+// only being the expected period; false polls on the intervals
+constexpr bool RA_SENSOR_DRDY_ENABLED = true;
+
+// Intervals without a data-ready interrupt before the task reads anyway, a dead line falls back to polling
+constexpr uint32_t RA_SENSOR_DRDY_TIMEOUT = 2;
+
+// A sensor leaves the vote (SENSOR_ERR) after this many failed reads in a row...
+constexpr uint32_t RA_SENSOR_MAX_READ_FAILURES = 20;
+
+// ...or this many readings out of range in a row...
+constexpr uint32_t RA_SENSOR_MAX_RANGE_FAULTS = 5;
+
+// ...or the same reading for this long
+constexpr uint32_t RA_SENSOR_STUCK_TIMEOUT = 1000ul;  // ms
+
+// A demoted sensor is restarted this often, off the reading tasks
+constexpr uint32_t RA_SENSOR_RETRY_INTERVAL = 500ul;  // ms
+
+// Good reads of a restarted sensor before it votes again
+constexpr uint32_t RA_SENSOR_PROBATION = 10;
+
+// Plausible readings: accelerometer axes within the ADXL372's range, pressure within the BMP581's
+constexpr double RA_IMU_RANGE_G       = 205.0;   // g
+constexpr double RA_ALTIMETER_MIN_HPA = 300.0;   // hPa
+constexpr double RA_ALTIMETER_MAX_HPA = 1250.0;  // hPa
+
+/* ESTIMATOR SETTINGS */
+// Single-precision estimator (Kalman.h, runs on the M7 FPU) instead of the double xcore filters
+constexpr bool RA_ESTIMATOR_FLOAT = false;
+
+// Precomputed (steady-state) gain at the nominal FSM interval, full filter on jitter or unexpected innovations
+constexpr bool RA_ESTIMATOR_STEADY_STATE = false;
+
+// One estimator task fusing timestamped accelerometer and barometer samples as they arrive, instead of
+// filter_acc and filter_alt predicted by the FSM tick
+constexpr bool RA_ESTIMATOR_FUSED = false;
+
+// IMU axis along the rocket, reading +1 g on the pad (fused estimator's vertical acceleration)
+constexpr size_t RA_IMU_UP_AXIS = 2;
+
+// ADXL372 FIFO samples (6400 Hz) per decimated sample to the estimator: 32 -> 200 Hz, 16 -> 400 Hz, 8 -> 800 Hz
+constexpr uint32_t RA_IMU_DECIMATION = 16;
+
+// Raw FIFO samples kept for high-rate consumers of imu_raw_ring, power of two (about 40 ms at 6400 Hz)
+constexpr size_t RA_IMU_RAW_BACKLOG = 256;
+
 /* BOARD FEATURES */
 
 // Start-up Countdown (for time-based arming)
@@ -165,6 +219,57 @@ constexpr uint32_t RA_SDLOGGER_INTERVAL_SLOW     = 200ul;   // 5 Hz
 constexpr uint32_t RA_SDLOGGER_INTERVAL_FAST     = 100ul;   // 10 Hz
 constexpr uint32_t RA_SDLOGGER_INTERVAL_REALTIME = 50ul;    // 20 Hz
 
+// SD write cache, whole 512-byte sectors per f_write
+constexpr size_t RA_SDLOGGER_CACHE_SECTORS = 8;  // 4 KiB
+
+// Preallocated log file size, keeps FAT updates out of flight (0 disables)
+constexpr uint32_t RA_SDLOGGER_PREALLOCATE_SIZE = 64ul * 1024ul * 1024ul;  // bytes
+
+/* PROFILER SETTINGS */
+// Per-task CPU load and stack high-water marks, written to the log and CDC as #PROF lines
+constexpr bool     RA_PROFILER_ENABLED  = true;
+constexpr uint32_t RA_PROFILER_INTERVAL = 1000ul;  // ms
+
+// Period/execution histograms of the interval loops, sensor bus statistics and sensor sample age, written as #LOOP, #SPI
+// and #AGE lines on every state change
+constexpr bool RA_LOOP_STATS_ENABLED = true;
+
+/* EVENT TRACE SETTINGS */
+// In-RAM event trace, dumped to TRACE<n>.BIN on landing or on 'T' over CDC
+constexpr bool RA_TRACE_ENABLED = true;
+
+// Ring size in events (8 bytes each, power of two)
+constexpr size_t RA_TRACE_CAPACITY = 2048;
+
+// Entering this state freezes the ring after RA_TRACE_POST_TRIGGER more events
+constexpr UserState RA_TRACE_TRIGGER_STATE = UserState::DROGUE_DEPLOY;
+constexpr uint32_t  RA_TRACE_POST_TRIGGER  = RA_TRACE_CAPACITY / 2;
+
+/* LOG RING SETTINGS */
+
+// Number of encoded records kept in RAM, shared by every sink (power of two)
+constexpr size_t RA_LOG_RING_CAPACITY = 64;
+
+// Maximum encoded size of one record
+constexpr size_t RA_LOG_FRAME_SIZE = 256;  // bytes
+
+// Records each sink may lag behind before its oldest are dropped
+constexpr uint32_t RA_LOG_BACKLOG_SD  = RA_LOG_RING_CAPACITY - 1;
+constexpr uint32_t RA_LOG_BACKLOG_CDC = 4;
+constexpr uint32_t RA_LOG_BACKLOG_RAW = RA_LOG_RING_CAPACITY - 1;
+
+/* RAW LOG SETTINGS */
+
+// Raw block log: every record goes to a reserved card region outside the FAT partition
+// A region overlapping a partition is refused (#RAWLOG,<ms>,REFUSED,... in the log): partition the card short of it
+constexpr bool RA_RAW_LOG_ENABLED = false;
+
+// First block of the region (0: the last RA_RAW_LOG_BLOCKS blocks of the card)
+constexpr uint32_t RA_RAW_LOG_START_LBA = 0ul;
+
+// Region size
+constexpr uint32_t RA_RAW_LOG_BLOCKS = 262144ul;  // 512-byte blocks, 128 MiB
+
 // Static assertions validate settings
 namespace details::assertions {
   static_assert(RA_TIME_TO_BURNOUT_MAX >= RA_TIME_TO_BURNOUT_MIN, "Motor burnout is configured incorrectly!");
@@ -4,6 +4,9 @@
 #include <Arduino.h>
 #include <Arduino_Extended.h>
 #include <STM32SD.h>
+#include "hal_trace.h"
+#include <cstdio>
+#include <cstdlib>
 
 enum class FsMode : uint8_t {
   READ = 0,
@@ -11,14 +14,88 @@ enum class FsMode : uint8_t {
   APPEND
 };
 
+/**
+ * SD card file helper with a sector-aligned append cache.
+ *
+ * append() collects bytes into a RAM cache of CacheSectors * 512 bytes and only
+ * hands whole caches to FatFs at sector-aligned file offsets, so FatFs writes
+ * straight to the card with multi-block transfers instead of doing
+ * read-modify-write through its single sector buffer.
+ *
+ * A file may also be preallocated at open time, so appends during flight only
+ * touch data sectors and never the FAT (allocated ahead, not necessarily
+ * contiguous). Its first sector then holds a text header with the logical
+ * length, kept current on every flush_one(), which is used to truncate the
+ * file on landing or on the next boot after a power loss. Once truncated the header reads #PREALLOC,DONE: the file then grows the
+ * normal way and recover() leaves it alone.
+ *
+ * @tparam CacheSectors Number of 512-byte sectors per write
+ */
+template<size_t CacheSectors = 1>
 class FsUtil {
+public:
+  static constexpr size_t sector_size = 512;
+  static constexpr size_t cache_size  = sector_size * CacheSectors;
+
+  static_assert(CacheSectors > 0, "Cache must hold at least one sector");
+
 protected:
-  uint32_t m_sector_count = {};
-  uint8_t  m_buf[512]     = {};
+  uint32_t m_sector_count             = {};  // Whole sectors handed to FatFs since open
+  uint32_t m_base_pos                 = {};  // File position at open
+  alignas(32) uint8_t m_buf[cache_size] = {};
+  size_t   m_buf_len                  = {};
+  bool     m_preallocated             = {};
+  bool     m_short_write              = {};  // The last cache write stopped part way
+  bool     m_traced                   = {};
+  uint8_t  m_trace_id                 = {};
 
   File   m_file     = {};
   String m_filename = {};
 
+  // FatFs has moved the position past what a short write got out: back to the cache's first sector
+  void seek_cache() {
+    if (m_short_write)
+      m_file.seek(m_base_pos + bytes_written());
+    m_short_write = false;
+  }
+
+  bool write_cache() {
+    seek_cache();
+    if (m_traced)
+      hal::trace::record(hal::trace::Event::STORAGE_BEGIN, m_trace_id, CacheSectors);
+    const size_t written = m_file.write(m_buf, cache_size);
+    if (m_traced)
+      hal::trace::record(hal::trace::Event::STORAGE_END, m_trace_id);
+    m_short_write = written != cache_size;
+    if (m_short_write)
+      return false;
+    m_sector_count += CacheSectors;
+    m_buf_len = 0;
+    return true;
+  }
+
+  static constexpr char   prealloc_magic[] = "#PREALLOC,LEN=";
+  static constexpr size_t prealloc_magic_len = sizeof(prealloc_magic) - 1;
+  static constexpr char   prealloc_done[]    = "#PREALLOC,DONE,";
+
+  static void make_header(uint8_t (&sector)[sector_size], const uint32_t length, const bool done) {
+    memset(sector, ' ', sector_size);
+    const int n = done ? snprintf(reinterpret_cast<char *>(sector), sector_size, "%s", prealloc_done)
+                       : snprintf(reinterpret_cast<char *>(sector), sector_size, "%s%010lu,", prealloc_magic,
+                                  static_cast<unsigned long>(length));
+    sector[n]               = ' ';  // Overwrite snprintf's NUL
+    sector[sector_size - 1] = '\n';
+  }
+
+  void write_header(const bool done = false) {
+    uint8_t header[sector_size];
+    make_header(header, logical_size(), done);
+    const uint32_t pos = m_file.position();
+    m_file.seek(0);
+    m_file.write(header, sector_size);
+    m_file.seek(pos);
+  }
+
 public:
   FsUtil() {
     m_filename.reserve(64);
@@ -30,15 +107,227 @@ public:
 
   template<FsMode Mode>
   void open_one() {
-    m_file = open<Mode>(m_filename);
+    m_file         = open<Mode>(m_filename);
+    m_buf_len      = 0;
+    m_sector_count = 0;
+    m_short_write  = false;
+    m_base_pos     = m_file.position();
   }
 
   void close_one() {
+    if (m_preallocated) {
+      truncate_one();
+    } else if (m_buf_len) {
+      seek_cache();
+      m_file.write(m_buf, m_buf_len);
+    }
+    m_buf_len = 0;
     m_file.close();
   }
 
-  void flush_one() {
+  /**
+   * Preallocate the freshly opened file to a fixed size.
+   * Uses a contiguous f_expand when FatFs is built with FF_USE_EXPAND,
+   * otherwise allocates the cluster chain by seeking past the end. The
+   * stm32duino FatFs configuration leaves FF_USE_EXPAND at 0, so a default
+   * build gets an ordinary chain, wherever the free clusters are: the FAT is
+   * still only written here, but the file is not guaranteed contiguous.
+   * The first sector is reserved for the length header.
+   *
+   * @param size Bytes to allocate, including the header sector
+   * @return True if the space was allocated
+   */
+  bool preallocate(const uint32_t size) {
+    FIL *fil = m_file._fil;
+    if (!fil || f_size(fil) != 0 || size <= sector_size)
+      return false;
+
+    bool ok = false;
+#if defined(FF_USE_EXPAND) && FF_USE_EXPAND
+    ok = f_expand(fil, size, 1) == FR_OK;
+#endif
+    if (!ok)
+      ok = f_lseek(fil, size) == FR_OK && f_tell(fil) == size;
+    if (!ok || f_lseek(fil, 0) != FR_OK)
+      return false;
+
+    m_preallocated = true;
+    m_base_pos     = sector_size;
+    m_sector_count = 0;
+    m_buf_len      = 0;
+
+    write_header();
+    m_file.seek(m_base_pos);
+    m_file.flush();
+    return true;
+  }
+
+  /**
+   * Write out everything and cut a preallocated file down to its real length.
+   * Appends after this grow the file the normal way.
+   */
+  void truncate_one() {
+    if (!m_preallocated)
+      return;
+
+    seek_cache();
+    if (m_buf_len)
+      m_file.write(m_buf, m_buf_len);
+    // Logging goes on past this length: a later recover() must not cut back to it
+    write_header(/*done*/ true);
+    m_file.seek(logical_size());
+    f_truncate(m_file._fil);
     m_file.flush();
+
+    m_preallocated = false;
+    m_base_pos     = logical_size();
+    m_sector_count = 0;
+    m_buf_len      = 0;
+  }
+
+  /**
+   * Truncate a preallocated file left behind by a power loss.
+   *
+   * @param filename File to check
+   * @return True if the file was truncated
+   */
+  static bool recover(const char *filename) {
+    FIL fil;
+    if (f_open(&fil, filename, FA_READ | FA_WRITE) != FR_OK)
+      return false;
+
+    char header[prealloc_magic_len + 11] = {};
+    UINT read                            = 0;
+    bool truncated                       = false;
+
+    if (f_read(&fil, header, sizeof(header) - 1, &read) == FR_OK &&
+        read == sizeof(header) - 1 &&
+        strncmp(header, prealloc_magic, prealloc_magic_len) == 0) {
+      const uint32_t length = strtoul(header + prealloc_magic_len, nullptr, 10);
+      if (length >= sector_size && length < f_size(&fil) &&
+          f_lseek(&fil, length) == FR_OK &&
+          f_truncate(&fil) == FR_OK)
+        truncated = true;
+    }
+
+    f_close(&fil);
+    return truncated;
+  }
+
+  /**
+   * Recover the last existing file of a numbered series, see find_file_name().
+   *
+   * @return True if a file was truncated
+   */
+  bool recover_last(const char *prefix, const char *extension = "csv") {
+    String   name;
+    String   last;
+    uint32_t file_idx = 1;
+    for (;;) {
+      name = "";
+      name << prefix << file_idx++ << "." << extension;
+      if (!SD.exists(name.c_str()))
+        break;
+      last = name;
+    }
+    return last.length() && recover(last.c_str());
+  }
+
+  /**
+   * Commit everything appended so far to the card.
+   *
+   * A partial tail sector is written and synced, then the file position is
+   * moved back to the sector boundary and the tail stays cached, so the next
+   * write rewrites that sector whole and every write stays aligned.
+   */
+  void flush_one() {
+    if (m_traced)
+      hal::trace::record(hal::trace::Event::STORAGE_BEGIN, m_trace_id, 0);
+
+    if (m_buf_len) {
+      const uint32_t aligned_pos = m_base_pos + bytes_written();
+      seek_cache();
+      m_file.write(m_buf, m_buf_len);
+      if (m_preallocated)
+        write_header();
+      m_file.flush();
+      m_file.seek(aligned_pos);
+    } else {
+      if (m_preallocated)
+        write_header();
+      m_file.flush();
+    }
+
+    if (m_traced)
+      hal::trace::record(hal::trace::Event::STORAGE_END, m_trace_id);
+  }
+
+  /**
+   * Record card writes (cache flushes and syncs) in the event trace.
+   *
+   * @param name Name in the trace dump
+   */
+  void trace_as(const char *name) {
+    m_trace_id = hal::trace::add_name(hal::trace::Kind::STORAGE, name);
+    m_traced   = true;
+  }
+
+  /**
+   * Append bytes to the open file through the sector cache.
+   *
+   * @param data Bytes to append
+   * @param len Number of bytes
+   * @return Number of bytes accepted (less than len only if a card write failed)
+   */
+  size_t append(const void *data, const size_t len) {
+    const auto *src  = static_cast<const uint8_t *>(data);
+    size_t      left = len;
+
+    while (left) {
+      const size_t room = cache_size - m_buf_len;
+      const size_t n    = left < room ? left : room;
+      memcpy(m_buf + m_buf_len, src, n);
+      m_buf_len += n;
+      src += n;
+      left -= n;
+
+      if (m_buf_len == cache_size && !write_cache())
+        return len - left;  // Cache kept, rewritten whole on the next call
+    }
+
+    return len;
+  }
+
+  /**
+   * @return Bytes handed to FatFs in whole sectors since open
+   */
+  [[nodiscard]] uint32_t bytes_written() const {
+    return m_sector_count * sector_size;
+  }
+
+  /**
+   * @return Logical file length, including cached bytes
+   */
+  [[nodiscard]] uint32_t logical_size() const {
+    return m_base_pos + bytes_written() + m_buf_len;
+  }
+
+  [[nodiscard]] bool preallocated() const {
+    return m_preallocated;
+  }
+
+  /**
+   * @return Bytes waiting in the cache
+   */
+  [[nodiscard]] size_t buffered() const {
+    return m_buf_len;
+  }
+
+  /**
+   * @return Cache fill level in percent
+   */
+  [[nodiscard]] uint8_t fill_percent() const {
+    return static_cast<uint8_t>(m_buf_len * 100u / cache_size);
   }
 
   template<FsMode Mode>
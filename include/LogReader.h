@@ -0,0 +1,320 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_LOGREADER_H
+#define ROCKET_AVIONICS_TEMPLATE_LOGREADER_H
+
+#include <LogRecord.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Host-side flight log reader, shared by log_decode and replay.
+ *
+ * Turns any log into CSV records under a column name line:
+ *   - #SCHEMA header matching LogRecord.h: decoded by the schema's own
+ *     generated decoder.
+ *   - #SCHEMA header of another schema: decoded from the header descriptors.
+ *   - No header (logs from before the schema): CSV recognized by its column
+ *     count against the known legacy layouts.
+ *
+ * Preallocated files are cut at their logical length, annotation lines
+ * ("#PROF,..." and the like) are counted and skipped.
+ */
+namespace log_reader {
+  struct column_t {
+    std::string      name;
+    log_schema::Type type;
+    double           scale;
+    uint8_t          decimals;
+  };
+
+  struct layout_t {
+    std::string           tag;
+    uint16_t              magic       = 0;
+    uint32_t              hash        = 0;
+    size_t                record_size = 0;
+    std::vector<column_t> columns;
+
+    [[nodiscard]] uint32_t compute_hash() const {
+      uint32_t h = log_schema::hash::add_str(log_schema::hash::basis, tag.c_str());
+      h          = log_schema::hash::add_u32(h, magic);
+      for (const auto &c : columns)
+        h = log_schema::hash::field(h, c.name.c_str(), c.type, c.scale, c.decimals);
+      return h;
+    }
+
+    [[nodiscard]] std::string column_line() const {
+      std::string line = "tag";
+      for (const auto &c : columns)
+        line += "," + c.name;
+      return line;
+    }
+  };
+
+  // Headerless CSV written before the schema existed, told apart by column count
+  struct legacy_t {
+    size_t      count;
+    const char *names;
+  };
+
+  inline constexpr legacy_t legacy_layouts[] = {
+    {12, "tag,seq_no,timestamp_ms,state,acc_x,acc_y,acc_z,acc,altitude_m,pressure_hpa,servo_a,cpu_temp"},
+    {17, "tag,seq_no,timestamp_ms,state,acc_x,acc_y,acc_z,acc,vel_filt,pos_filt,altitude_m,pressure_hpa,"
+         "alt_agl,alt_ref,apogee,servo_a,cpu_temp"},
+    {18, "tag,seq_no,timestamp_ms,state,acc_x,acc_y,acc_z,acc,acc_filt,vel_filt,pos_filt,altitude_m,"
+         "pressure_hpa,alt_agl,alt_ref,apogee,servo_a,cpu_temp"},
+  };
+
+  enum class Format : uint8_t {
+    SCHEMA_CSV,
+    SCHEMA_BINARY,
+    LEGACY_CSV
+  };
+
+  struct info_t {
+    Format      format{};
+    layout_t    layout;        // Empty for legacy CSV
+    bool        current{};     // Schema is the compiled-in LogRecord.h
+    bool        hash_ok{};     // Header hash matches its descriptors
+    std::string column_line;  // "tag,..." without line break
+  };
+
+  struct stats_t {
+    size_t records = 0;
+    size_t notes   = 0;  // "#..." annotation lines, e.g. #PROF reports
+    size_t errors  = 0;  // Bytes (binary) or lines (CSV) skipped
+  };
+
+  inline std::vector<std::string> split(const std::string &s, const char sep) {
+    std::vector<std::string> out;
+    size_t                   begin = 0;
+    for (;;) {
+      const size_t end = s.find(sep, begin);
+      out.push_back(s.substr(begin, end - begin));
+      if (end == std::string::npos)
+        return out;
+      begin = end + 1;
+    }
+  }
+
+  inline bool parse_type(const std::string &s, log_schema::Type &out) {
+    for (uint8_t i = 0; i <= static_cast<uint8_t>(log_schema::Type::E8); ++i) {
+      const auto t = static_cast<log_schema::Type>(i);
+      if (s == log_schema::type_name(t)) {
+        out = t;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  inline bool parse_schema_line(const std::string &line, layout_t &layout) {
+    const auto parts = split(line, ',');
+    if (parts.size() < 6 || parts[0] != "#SCHEMA")
+      return false;
+
+    layout.tag         = parts[1];
+    layout.magic       = static_cast<uint16_t>(strtoul(parts[2].c_str(), nullptr, 16));
+    layout.hash        = static_cast<uint32_t>(strtoul(parts[3].c_str(), nullptr, 16));
+    layout.record_size = strtoul(parts[4].c_str(), nullptr, 10);
+
+    size_t payload = 0;
+    for (size_t i = 5; i < parts.size(); ++i) {
+      const auto desc = split(parts[i], ':');
+      column_t   col;
+      if (desc.size() != 4 || !parse_type(desc[1], col.type))
+        return false;
+      col.name     = desc[0];
+      col.scale    = strtod(desc[2].c_str(), nullptr);
+      col.decimals = static_cast<uint8_t>(strtoul(desc[3].c_str(), nullptr, 10));
+      payload += log_schema::type_size(col.type);
+      layout.columns.push_back(col);
+    }
+    return layout.record_size == 2 + payload + 2;
+  }
+
+  // Descriptor-driven decode for schemas other than the compiled-in one
+  inline size_t decode_generic(const layout_t &layout, const uint8_t *rec, char *out, const size_t cap) {
+    fast_fmt::csv_writer_t csv(out, cap);
+    csv << layout.tag.c_str();
+
+    const uint8_t *p = rec + 2;
+    for (const auto &c : layout.columns) {
+      double   v = 0;
+      uint32_t u = 0;
+      switch (c.type) {
+        // clang-format off
+        case log_schema::Type::U8:  { uint8_t  x; memcpy(&x, p, 1); v = x; break; }
+        case log_schema::Type::I8:  { int8_t   x; memcpy(&x, p, 1); v = x; break; }
+        case log_schema::Type::U16: { uint16_t x; memcpy(&x, p, 2); v = x; break; }
+        case log_schema::Type::I16: { int16_t  x; memcpy(&x, p, 2); v = x; break; }
+        case log_schema::Type::U32: { uint32_t x; memcpy(&x, p, 4); v = x; break; }
+        case log_schema::Type::I32: { int32_t  x; memcpy(&x, p, 4); v = x; break; }
+        case log_schema::Type::F32: { float    x; memcpy(&x, p, 4); v = x; break; }
+        case log_schema::Type::E8:  { uint8_t  x; memcpy(&x, p, 1); u = x; break; }
+          // clang-format on
+      }
+      p += log_schema::type_size(c.type);
+
+      if (c.type == log_schema::Type::E8)
+        csv << log_state_label(u);
+      else if (c.type == log_schema::Type::F32 || c.scale != 1.0)
+        csv << fast_fmt::fixed(v * c.scale, c.decimals);
+      else
+        csv << static_cast<int64_t>(v);
+    }
+    return csv.finish(/*newline*/ false);
+  }
+
+  inline bool read_file(const char *path, std::vector<uint8_t> &data) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+      return false;
+    uint8_t buf[65536];
+    size_t  n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+      data.insert(data.end(), buf, buf + n);
+    fclose(fp);
+    return true;
+  }
+
+  inline std::string next_line(const std::vector<uint8_t> &data, size_t &pos, const size_t end) {
+    const size_t begin = pos;
+    while (pos < end && data[pos] != '\n')
+      ++pos;
+    std::string line(reinterpret_cast<const char *>(data.data()) + begin, pos - begin);
+    if (pos < end)
+      ++pos;
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    return line;
+  }
+
+  /**
+   * Decode a whole log.
+   *
+   * @param on_header Called once with the info_t before any record
+   * @param on_record Called with each record as one CSV line, no line break
+   * @return False with error set if the format is not recognized
+   */
+  template<typename OnHeader, typename OnRecord>
+  bool decode(const std::vector<uint8_t> &data,
+              OnHeader                  &&on_header,
+              OnRecord                  &&on_record,
+              stats_t                    &stats,
+              std::string                &error) {
+    size_t pos = 0;
+    size_t end = data.size();
+
+    // Preallocated file: skip the header sector, stop at the logical length while it has one (not yet DONE)
+    constexpr char prealloc[]     = "#PREALLOC,";
+    constexpr char prealloc_len[] = "#PREALLOC,LEN=";
+    if (end >= 512 && memcmp(data.data(), prealloc, sizeof(prealloc) - 1) == 0) {
+      pos = 512;
+      if (memcmp(data.data(), prealloc_len, sizeof(prealloc_len) - 1) == 0) {
+        const size_t len = strtoul(reinterpret_cast<const char *>(data.data()) + sizeof(prealloc_len) - 1, nullptr, 10);
+        end              = len >= 512 && len < end ? len : end;
+      }
+    }
+
+    info_t info;
+
+    if (end - pos > 8 && memcmp(data.data() + pos, "#SCHEMA,", 8) == 0) {
+      if (!parse_schema_line(next_line(data, pos, end), info.layout)) {
+        error = "Malformed #SCHEMA line";
+        return false;
+      }
+
+      const layout_t &layout = info.layout;
+      info.hash_ok           = layout.compute_hash() == layout.hash;
+      info.current           = layout.hash == LogSchema.hash();
+      info.format            = end - pos >= 4 && memcmp(data.data() + pos, "tag,", 4) == 0
+                                 ? Format::SCHEMA_CSV
+                                 : Format::SCHEMA_BINARY;
+      info.column_line       = layout.column_line();
+      on_header(static_cast<const info_t &>(info));
+
+      if (info.format == Format::SCHEMA_CSV) {
+        next_line(data, pos, end);  // Column names
+        while (pos < end) {
+          const std::string line = next_line(data, pos, end);
+          if (line.empty())
+            continue;
+          if (line[0] == '#') {
+            ++stats.notes;
+            continue;
+          }
+          on_record(line.c_str(), line.size());
+          ++stats.records;
+        }
+      } else {
+        char text[1024];
+        while (pos + layout.record_size <= end) {
+          if (data[pos] == '#') {
+            next_line(data, pos, end);  // Annotation line between records
+            ++stats.notes;
+            continue;
+          }
+
+          const uint8_t *rec = data.data() + pos;
+          uint16_t       magic, crc;
+          memcpy(&magic, rec, 2);
+          memcpy(&crc, rec + layout.record_size - 2, 2);
+          if (magic != layout.magic || crc != checksum::crc16_ccitt(rec, layout.record_size - 2)) {
+            ++pos;  // Resync on the next magic
+            ++stats.errors;
+            continue;
+          }
+
+          size_t n;
+          if (info.current) {
+            LogRecord record{};
+            LogSchema.decode_binary(rec, record);
+            n = LogSchema.encode_csv(record, text, sizeof(text));
+            if (n && text[n - 1] == '\n')
+              text[--n] = '\0';
+          } else {
+            n = decode_generic(layout, rec, text, sizeof(text));
+          }
+          on_record(static_cast<const char *>(text), n);
+          pos += layout.record_size;
+          ++stats.records;
+        }
+      }
+      return true;
+    }
+
+    size_t            peek  = pos;
+    const std::string first = next_line(data, peek, end);
+    const size_t      count = split(first, ',').size();
+
+    const legacy_t *legacy = nullptr;
+    for (const auto &l : legacy_layouts)
+      if (l.count == count)
+        legacy = &l;
+    if (!legacy) {
+      error = "No #SCHEMA header and no legacy layout with " + std::to_string(count) + " columns";
+      return false;
+    }
+
+    info.format      = Format::LEGACY_CSV;
+    info.column_line = legacy->names;
+    on_header(static_cast<const info_t &>(info));
+
+    while (pos < end) {
+      const std::string line = next_line(data, pos, end);
+      if (line.empty())
+        continue;
+      if (split(line, ',').size() != count) {
+        ++stats.errors;
+        continue;
+      }
+      on_record(line.c_str(), line.size());
+      ++stats.records;
+    }
+    return true;
+  }
+}  // namespace log_reader
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_LOGREADER_H
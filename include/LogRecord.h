@@ -0,0 +1,83 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_LOGRECORD_H
+#define ROCKET_AVIONICS_TEMPLATE_LOGRECORD_H
+
+#include <LogSchema.h>
+#include "UserState.h"
+#include <cstdint>
+
+/**
+ * One log sample, filled by CB_ConstructData and encoded through LogSchema.
+ * Plain aligned struct, the wire layout comes from the schema only.
+ */
+struct LogRecord {
+  uint32_t seq_no;
+  uint32_t timestamp_ms;
+  uint8_t  state;
+
+  // Raw
+  double acc_x;
+  double acc_y;
+  double acc_z;
+  double acc;
+
+  // Filtered
+  double acc_filt;
+  double vel_filt;
+  double pos_filt;
+
+  // Altimeter
+  double altitude_m;
+  double pressure_hpa;
+
+  // Derived
+  double alt_agl;
+  double alt_ref;
+  double apogee;
+
+  // Outputs
+  float servo_a;
+
+  int32_t cpu_temp;
+};
+
+inline const char *log_state_label(const uint32_t state) {
+  if (state > static_cast<uint32_t>(UserState::RECOVERED_SAFE))
+    return "UNKNOWN";
+  return state_string(static_cast<UserState>(state));
+}
+
+/**
+ * Log columns, in file order. Add, remove or reorder fields here only;
+ * the encoders, headers and the host decoder follow.
+ */
+inline constexpr auto LogSchema = [] {
+  using log_schema::field;
+  using log_schema::enum_field;
+  using log_schema::Type;
+  using R = LogRecord;
+
+  return log_schema::make_schema<R>(
+    "MFC", 0x464Du,  // "MF" on disk
+    field<Type::U32>("seq_no", &R::seq_no),
+    field<Type::U32>("timestamp_ms", &R::timestamp_ms),
+    enum_field("state", &R::state, log_state_label),
+
+    field<Type::F32>("acc_x", &R::acc_x),
+    field<Type::F32>("acc_y", &R::acc_y),
+    field<Type::F32>("acc_z", &R::acc_z),
+    field<Type::F32>("acc", &R::acc),
+    field<Type::F32>("acc_filt", &R::acc_filt),
+
+    field<Type::F32>("vel_filt", &R::vel_filt),
+    field<Type::F32>("pos_filt", &R::pos_filt),
+    field<Type::F32>("altitude_m", &R::altitude_m),
+    field<Type::F32>("pressure_hpa", &R::pressure_hpa),
+    field<Type::F32>("alt_agl", &R::alt_agl),
+    field<Type::F32>("alt_ref", &R::alt_ref),
+    field<Type::F32>("apogee", &R::apogee),
+
+    field<Type::F32>("servo_a", &R::servo_a),
+    field<Type::I8>("cpu_temp", &R::cpu_temp));
+}();
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_LOGRECORD_H
@@ -0,0 +1,23 @@
+#ifndef STM32FREERTOSCONFIG_H
+#define STM32FREERTOSCONFIG_H
+
+/*
+ * Picked up by STM32FreeRTOS instead of its default configuration.
+ * Keeps every default and only adds the profiler trace hook.
+ */
+#include "FreeRTOSConfig_Default.h"
+
+#ifndef __ASSEMBLER__
+#  ifdef __cplusplus
+extern "C" {
+#  endif
+void ra_trace_task_switched_in(void *tcb);
+#  ifdef __cplusplus
+}
+#  endif
+#endif
+
+/* Per-task CPU time, see hal_profiler.h */
+#define traceTASK_SWITCHED_IN() ra_trace_task_switched_in((void *) pxCurrentTCB)
+
+#endif /* STM32FREERTOSCONFIG_H */
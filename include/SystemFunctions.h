@@ -9,6 +9,42 @@ extern void ReadAltimeter();
 
 extern void ReadGNSS();
 
+/**
+ * Fuse the last IMU reading into filter_acc, or queue it for the fused
+ * estimator
+ */
+extern void ProcessIMU();
+
+/**
+ * Fuse the last altimeter reading into filter_alt (or queue it for the fused
+ * estimator), track AGL and apogee
+ */
+extern void ProcessAltimeter();
+
+/**
+ * Predict both filters by one FSM tick, on F for the measured interval (ms)
+ * if it drifts out of the jitter tolerance and for the nominal one otherwise
+ */
+extern void PredictFilters(uint32_t true_interval);
+
+/**
+ * Load F for an interval (ms) into both filters: from the precomputed table,
+ * generated past its end
+ */
+extern void SetFilterInterval(uint32_t interval);
+
+/**
+ * Fuse the queued IMU and altimeter samples in timestamp order into
+ * filter_fused and publish the estimate (RA_ESTIMATOR_FUSED)
+ */
+extern void RunEstimator();
+
+extern void UserSetupActuator();
+
+extern void UserSetupFilters();
+
+extern void UserSetupSensors();
+
 extern void ActivateDeployment(size_t index);
 
 /**
@@ -16,6 +52,11 @@ extern void ActivateDeployment(size_t index);
  */
 extern void RetainDeployment();
 
+/**
+ * Restart the sensors demoted at least a retry interval ago
+ */
+extern void RecoverSensors();
+
 extern void AutoZeroAlt();
 
 namespace internal {
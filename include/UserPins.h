@@ -25,4 +25,7 @@ constexpr uint32_t USER_GPIO_ADXL372_INT1 = PB2;
 constexpr uint32_t USER_GPIO_ADXL372_INT2 = PB1;
 constexpr uint32_t USER_GPIO_ADXL372_NSS  = PB0;
 
+constexpr uint32_t USER_GPIO_GNSS_TX = PA2;  // MCU TX, receiver RX
+constexpr uint32_t USER_GPIO_GNSS_RX = PA3;
+
 #endif  //ROCKET_AVIONICS_TEMPLATE_USERPINS_H
@@ -0,0 +1,486 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_USERSENSORREGS_H
+#define ROCKET_AVIONICS_TEMPLATE_USERSENSORREGS_H
+
+/**
+ * Register maps of the flight sensors and their data bursts on hal_spi.h:
+ * one pre-built transaction per sample, decoded here rather than in the
+ * vendor libraries, which only configure the devices. Shared by the drivers
+ * in UserSensors.h and the host mock devices of spi_check.
+ *
+ * The GNSS receiver's UBX stream on hal_uart.h likewise, shared with the
+ * simulated receiver.
+ */
+#include <Decimator.h>
+#include <FastFormat.h>
+#include <Sensors.h>
+#include <UBX.h>
+#include <cstdint>
+#include "./hal_spi.h"
+#include "./hal_uart.h"
+
+namespace adxl372 {
+  constexpr hal::spi::ReadCmd CMD              = hal::spi::ReadCmd::SHIFT_LSB;
+  constexpr uint8_t           REG_DEVID_AD     = 0x00;
+  constexpr uint8_t           REG_STATUS       = 0x04;  // STATUS, STATUS2, FIFO_ENTRIES_2, FIFO_ENTRIES_1
+  constexpr uint8_t           REG_XDATA_H      = 0x08;  // X, Y, Z; high byte first
+  constexpr uint8_t           REG_FIFO_SAMPLES = 0x39;
+  constexpr uint8_t           REG_FIFO_CTL     = 0x3A;
+  constexpr uint8_t           REG_INT1_MAP     = 0x3B;
+  constexpr uint8_t           REG_POWER_CTL    = 0x3F;
+  constexpr uint8_t           REG_FIFO_DATA    = 0x42;  // Data port, does not increment
+  constexpr size_t            DATA_LEN         = 6;
+  constexpr double            G_PER_LSB        = 0.1;  // 100 mg, 12 bit left justified
+
+  // FIFO_SAMPLES .. POWER_CTL: FIFO, interrupt maps, TIMING, MEASURE, then the mode
+  constexpr uint8_t REG_CONFIG = REG_FIFO_SAMPLES;
+  constexpr size_t  CONFIG_LEN = REG_POWER_CTL - REG_FIFO_SAMPLES + 1;
+
+  constexpr uint8_t  DEVID_AD          = 0xAD;
+  constexpr uint8_t  STATUS_FIFO_RDY   = 0x02;
+  constexpr uint8_t  STATUS_FIFO_OVR   = 0x08;
+  constexpr uint8_t  FIFO_CTL_STREAM   = 0x02;  // Stream mode, X Y Z entries
+  constexpr uint8_t  INT1_MAP_FIFO_RDY = 0x02;
+  constexpr uint8_t  POWER_CTL_STANDBY = 0x00;
+  constexpr size_t   FIFO_ENTRIES      = 512;  // 16 bit entries, one axis each
+  constexpr size_t   FIFO_SETS         = FIFO_ENTRIES / 3;
+  constexpr uint32_t ODR_HZ            = 6400;
+  constexpr int64_t  SAMPLE_NS         = 1'000'000'000 / ODR_HZ;
+
+  // One X Y Z set of raw codes
+  struct code_t {
+    int16_t x, y, z;
+  };
+
+  struct sample_t {
+    double x, y, z;  // g
+  };
+
+  constexpr double decode_axis(const uint8_t hi, const uint8_t lo) {
+    return (static_cast<int16_t>(static_cast<uint16_t>(hi << 8 | lo)) >> 4) * G_PER_LSB;
+  }
+
+  inline sample_t decode(const uint8_t *buf) {
+    return {decode_axis(buf[0], buf[1]), decode_axis(buf[2], buf[3]), decode_axis(buf[4], buf[5])};
+  }
+
+  // Nearest code of an acceleration, saturated like the 12 bit output
+  inline int16_t code_of(const double g) {
+    double lsb = g / G_PER_LSB;
+    lsb        = lsb < -2048. ? -2048. : lsb > 2047. ? 2047. : lsb;
+    return static_cast<int16_t>(lsb < 0 ? lsb - 0.5 : lsb + 0.5);
+  }
+
+  // Inverse of decode, rounded to the nearest LSB and saturated (mock devices)
+  inline void encode(const sample_t &s, uint8_t *buf) {
+    const double axes[3] = {s.x, s.y, s.z};
+    for (size_t i = 0; i < 3; ++i) {
+      const auto raw = static_cast<uint16_t>(code_of(axes[i]) * 16);
+      buf[2 * i]     = static_cast<uint8_t>(raw >> 8);
+      buf[2 * i + 1] = static_cast<uint8_t>(raw);
+    }
+  }
+
+  struct reader_t {
+    hal::spi::burst_t<DATA_LEN> burst;
+
+    explicit reader_t(const uint32_t cs) : burst(cs, CMD, REG_XDATA_H) {}
+
+    bool read(hal::spi::bus_t &bus, sample_t &out) {
+      if (!bus.transfer(burst))
+        return false;
+      out = decode(burst.data());
+      return true;
+    }
+  };
+
+  /**
+   * FIFO entry: code in bits 15..4, bit 0 marks the X entry that starts a set
+   */
+  constexpr uint16_t fifo_entry(const int16_t code, const bool first) {
+    return static_cast<uint16_t>(static_cast<uint16_t>(code) << 4 | (first ? 1u : 0u));
+  }
+
+  /**
+   * Drains the FIFO in two bursts, status with entry count then every entry
+   * in one read of the data port. A set split across two reads is carried
+   * over; entries before a set start (after an overrun tore a set) are
+   * dropped, so the reader realigns by itself.
+   */
+  class fifo_reader_t {
+    static constexpr size_t MAX_ENTRIES = FIFO_SETS * 3;
+
+    hal::spi::burst_t<4>               status_;
+    hal::spi::burst_t<MAX_ENTRIES * 2> fifo_;
+    int16_t                            part_[3]  = {};
+    size_t                             num_part_ = 0;
+
+  public:
+    explicit fifo_reader_t(const uint32_t cs) : status_(cs, CMD, REG_STATUS), fifo_(cs, CMD, REG_FIFO_DATA) {}
+
+    /**
+     * @param out At least FIFO_SETS sets
+     * @param overrun Set when the FIFO filled up and samples were lost
+     * @return Number of sets read into out; 0 on a transfer error too
+     */
+    size_t read(hal::spi::bus_t &bus, code_t *out, bool &overrun) {
+      overrun = false;
+      if (!bus.transfer(status_))
+        return 0;
+
+      const uint8_t *st      = status_.data();
+      size_t         entries = (st[2] & 0x03u) << 8 | st[3];
+      entries                = entries < MAX_ENTRIES ? entries : MAX_ENTRIES;
+      overrun                = st[0] & STATUS_FIFO_OVR;
+      if (overrun)
+        num_part_ = 0;  // Its remaining entries were the oldest, overwritten
+      if (entries == 0)
+        return 0;
+
+      fifo_.resize(entries * 2);
+      if (!bus.transfer(fifo_))
+        return 0;
+
+      const uint8_t *d = fifo_.data();
+      size_t         n = 0;
+      for (size_t e = 0; e < entries; ++e) {
+        const auto entry = static_cast<uint16_t>(d[2 * e] << 8 | d[2 * e + 1]);
+        // Arithmetic shift, so the flag bit cannot round a negative code toward zero
+        const auto code = static_cast<int16_t>(static_cast<int16_t>(entry) >> 4);
+
+        if (entry & 0x01u)
+          num_part_ = 0;  // X starts a set
+        else if (num_part_ == 0)
+          continue;  // Mid-set, wait for the next X
+
+        part_[num_part_++] = code;
+        if (num_part_ == 3) {
+          out[n++]  = {part_[0], part_[1], part_[2]};
+          num_part_ = 0;
+        }
+      }
+      return n;
+    }
+  };
+
+  /**
+   * Timestamps and decimates the sets drained from the FIFO.
+   *
+   * Samples are spaced by the sample period and the newest is put half a
+   * period before the read. A second order loop on the difference to the
+   * read clock slews the origin and trims the period, so the ODR tolerance
+   * leaves no standing lag; after an overrun the origin snaps. The decimated
+   * stream (ODR / ratio) is timestamped at the centre of each CIC window.
+   */
+  template<size_t Order = 2>
+  class stream_t {
+    static constexpr int64_t RESYNC_NS = 2'000'000;  // Snap instead of slewing past this
+    static constexpr int64_t NOMINAL_Q = SAMPLE_NS << 16;
+    static constexpr int64_t TRIM_Q    = NOMINAL_Q / 50;  // Period within 2% of nominal
+
+    dsp::cic_decimator_t<3, Order> cic_;
+    float                          scale_;  // g per decimator output
+    int64_t                        delay_ns_;
+
+    SensorIMU::Sample raw_[FIFO_SETS] = {};
+    SensorIMU::Sample out_[FIFO_SETS] = {};
+    size_t            num_raw_        = 0;
+    size_t            num_out_        = 0;
+
+    bool     started_  = false;
+    bool     primed_   = false;  // Decimator has produced a sample
+    uint32_t last_us_  = 0;
+    int64_t  clock_ns_ = 0;  // Read time, unwrapped
+    int64_t  next_ns_  = 0;  // Time of the next set out of the FIFO
+    int64_t  period_q_ = NOMINAL_Q;  // ns, 16 fraction bits
+
+    [[nodiscard]] int64_t span_ns(const size_t samples) const {
+      return static_cast<int64_t>(samples) * period_q_ >> 16;
+    }
+
+  public:
+    explicit stream_t(const uint32_t ratio)
+        : cic_(ratio),
+          scale_(static_cast<float>(G_PER_LSB / cic_.gain())),
+          delay_ns_(static_cast<int64_t>(cic_.delay() * SAMPLE_NS)) {}
+
+    [[nodiscard]] uint32_t ratio() const {
+      return cic_.ratio();
+    }
+
+    /**
+     * Take the n sets of one read, made at t_read_us.
+     *
+     * @param gap Samples were lost before these (FIFO overrun)
+     */
+    void push(const code_t *sets, const size_t n, const uint32_t t_read_us, const bool gap) {
+      clock_ns_ += started_ ? static_cast<int64_t>(static_cast<uint32_t>(t_read_us - last_us_)) * 1000
+                            : static_cast<int64_t>(t_read_us) * 1000;
+      last_us_ = t_read_us;
+      num_raw_ = num_out_ = 0;
+      if (n == 0)
+        return;
+
+      const int64_t newest = clock_ns_ - SAMPLE_NS / 2;
+      const int64_t error  = newest - (next_ns_ + span_ns(n - 1));
+      if (!started_ || gap || error > RESYNC_NS || error < -RESYNC_NS) {
+        next_ns_ = newest - span_ns(n - 1);
+        if (gap)
+          cic_.reset();
+        started_ = true;
+      } else {
+        next_ns_ += error / 8;
+        period_q_ += (error << 16) / static_cast<int64_t>(32 * n);
+        period_q_ = period_q_ < NOMINAL_Q - TRIM_Q ? NOMINAL_Q - TRIM_Q
+                    : period_q_ > NOMINAL_Q + TRIM_Q ? NOMINAL_Q + TRIM_Q
+                                                     : period_q_;
+      }
+
+      for (size_t i = 0; i < n && i < FIFO_SETS; ++i) {
+        const int64_t t_ns = next_ns_ + span_ns(i);
+        const code_t &c    = sets[i];
+        raw_[num_raw_++]   = {static_cast<uint32_t>(t_ns / 1000), static_cast<float>(c.x * G_PER_LSB),
+                              static_cast<float>(c.y * G_PER_LSB), static_cast<float>(c.z * G_PER_LSB)};
+
+        const int32_t in[3] = {c.x, c.y, c.z};
+        int32_t       dec[3];
+        if (cic_.push(in, dec))
+          out_[num_out_++] = {static_cast<uint32_t>((t_ns - delay_ns_) / 1000), dec[0] * scale_, dec[1] * scale_,
+                              dec[2] * scale_};
+      }
+      next_ns_ += span_ns(n);
+      primed_ |= num_out_ > 0;
+    }
+
+    size_t raw(const SensorIMU::Sample *&first) const {
+      first = raw_;
+      return num_raw_;
+    }
+
+    size_t decimated(const SensorIMU::Sample *&first) const {
+      first = out_;
+      return num_out_;
+    }
+
+    /**
+     * Newest decimated sample of the last push(), or the newest raw one
+     * until the decimator has filled
+     *
+     * @return False if the last push() had neither
+     */
+    bool newest(SensorIMU::Sample &out) const {
+      if (num_out_)
+        out = out_[num_out_ - 1];
+      else if (!primed_ && num_raw_)
+        out = raw_[num_raw_ - 1];
+      else
+        return false;
+      return true;
+    }
+  };
+}  // namespace adxl372
+
+namespace bmp581 {
+  constexpr hal::spi::ReadCmd CMD                = hal::spi::ReadCmd::MSB_SET;
+  constexpr uint8_t           REG_CHIP_ID        = 0x01;
+  constexpr uint8_t           REG_INT_CONFIG     = 0x14;
+  constexpr uint8_t           REG_INT_SOURCE     = 0x15;
+  constexpr uint8_t           REG_TEMP_DATA_XLSB = 0x1D;  // Temperature then pressure; 24 bit, low byte first
+  constexpr uint8_t           REG_OSR_CONFIG     = 0x36;  // Then ODR_CONFIG, which holds the power mode
+  constexpr size_t            DATA_LEN           = 6;
+
+  constexpr uint8_t  INT_CONFIG_PULSED_HIGH = 0x0A;  // int_en, push-pull, active high, pulsed
+  constexpr uint8_t  INT_SOURCE_DRDY        = 0x01;
+  constexpr uint32_t ODR_HZ                 = 10;  // BMP5_ODR_10_HZ, as Altimeter_BMP581 sets it
+
+  struct sample_t {
+    double temperature_c;
+    double pressure_pa;
+  };
+
+  inline sample_t decode(const uint8_t *buf) {
+    const uint32_t t = buf[0] | buf[1] << 8 | static_cast<uint32_t>(buf[2]) << 16;
+    const uint32_t p = buf[3] | buf[4] << 8 | static_cast<uint32_t>(buf[5]) << 16;
+    // Sign-extend the 24 bit temperature
+    const int32_t t_signed = static_cast<int32_t>(t << 8) / 256;
+    return {t_signed / 65536., p / 64.};
+  }
+
+  // Inverse of decode, rounded to the nearest LSB (mock devices)
+  inline void encode(const sample_t &s, uint8_t *buf) {
+    const auto t = static_cast<uint32_t>(static_cast<int32_t>(s.temperature_c * 65536. + (s.temperature_c < 0 ? -0.5 : 0.5)));
+    const auto p = static_cast<uint32_t>(s.pressure_pa * 64. + 0.5);
+    for (size_t i = 0; i < 3; ++i) {
+      buf[i]     = static_cast<uint8_t>(t >> (8 * i));
+      buf[3 + i] = static_cast<uint8_t>(p >> (8 * i));
+    }
+  }
+
+  struct reader_t {
+    hal::spi::burst_t<DATA_LEN> burst;
+
+    explicit reader_t(const uint32_t cs) : burst(cs, CMD, REG_TEMP_DATA_XLSB) {}
+
+    bool read(hal::spi::bus_t &bus, sample_t &out) {
+      if (!bus.transfer(burst))
+        return false;
+      out = decode(burst.data());
+      return true;
+    }
+  };
+}  // namespace bmp581
+
+namespace ubx {
+  /**
+   * Receive side of a GNSS receiver on a hal::uart ring: parses what arrived
+   * since the last read() where it lies, and publishes the newest NAV-PVT.
+   *
+   * Latency runs from the receive event that completed a NAV-PVT (the idle
+   * line after its burst, the first the CPU hears of it) to its publication.
+   */
+  class receiver_t {
+  public:
+    // Upper bucket edges in us, as loop_stats_t
+    static constexpr const uint32_t *edges_us    = hal::rtos::loop_stats_t::edges_us;
+    static constexpr size_t          num_buckets = hal::rtos::loop_stats_t::num_buckets;
+
+  private:
+    hal::uart::rx_t  &uart_;
+    parser_t          parser_;
+    std::atomic<bool> reset_req_{false};
+
+    // Reader side, only touched by the reading task
+    uint32_t nav_pvt_        = 0;
+    uint32_t fixes_          = 0;
+    uint32_t superseded_     = 0;  // NAV-PVTs a newer one replaced before publication
+    uint32_t overruns_       = 0;  // Bytes lost before they were parsed
+    uint32_t published_      = 0;
+    uint32_t itow_ms_        = UINT32_MAX;  // Of the last NAV-PVT published
+    uint64_t latency_sum_us_ = 0;
+    uint32_t latency_max_us_ = 0;
+    uint32_t latency_[num_buckets] = {};
+
+    void clear() {
+      parser_.reset_stats();
+      nav_pvt_        = 0;
+      published_      = 0;
+      fixes_          = 0;
+      superseded_     = 0;
+      overruns_       = 0;
+      latency_sum_us_ = 0;
+      latency_max_us_ = 0;
+      for (uint32_t &b : latency_)
+        b = 0;
+    }
+
+    void published(const uint32_t latency_us) {
+      ++published_;
+      latency_sum_us_ += latency_us;
+      if (latency_us > latency_max_us_)
+        latency_max_us_ = latency_us;
+      size_t i = 0;
+      while (i < num_buckets - 1 && latency_us > edges_us[i])
+        ++i;
+      ++latency_[i];
+    }
+
+  public:
+    explicit receiver_t(hal::uart::rx_t &uart) : uart_(uart) {}
+
+    receiver_t(const receiver_t &) = delete;
+
+    [[nodiscard]] hal::uart::rx_t &uart() {
+      return uart_;
+    }
+
+    /**
+     * Parse what arrived, the newest NAV-PVT into out: satellites, the time
+     * once valid, the position only with a fix (otherwise out keeps the
+     * last one).
+     *
+     * @return Whether a new solution arrived since the last call: a
+     *         receiver repeating its last NAV-PVT reads as failing
+     */
+    bool read(SensorGNSS::Data &out) {
+      if (reset_req_.exchange(false, std::memory_order_acq_rel))
+        clear();
+
+      // Bytes lost to a restart of reception, or overwritten before they were parsed
+      const uint32_t head = uart_.head();
+      const uint32_t from = uart_.valid_from();
+      const uint32_t need = parser_.need();
+      if (static_cast<int32_t>(from - need) > 0) {
+        ++overruns_;
+        parser_.restart(from);
+      } else if (head - need > hal::uart::ring_t::SIZE) {
+        ++overruns_;
+        parser_.restart(head);
+      }
+
+      // Decoded straight from the ring; the UART cannot come round in the time this takes
+      nav_pvt_t pvt{};
+      uint32_t  end = 0;
+      bool      got = false;
+      parser_.parse(uart_.data(), head, [&](const frame_t &frame) -> void {
+        if (!pvt.decode(frame))
+          return;
+        ++nav_pvt_;
+        superseded_ += got;
+        got = true;
+        end = frame.end;
+      });
+      if (!got || pvt.itow_ms == itow_ms_)
+        return false;
+      itow_ms_ = pvt.itow_ms;
+
+      out.siv = pvt.num_sv;
+      if (pvt.time_ok())
+        out.timestamp_epoch = pvt.unix_time();
+      if (pvt.fix_ok()) {
+        ++fixes_;
+        out.latitude     = pvt.lat * 1e-7;
+        out.longitude    = pvt.lon * 1e-7;
+        out.altitude_msl = pvt.h_msl_mm * 1e-3;
+      }
+
+      published(hal::micros() - uart_.received_us(end));
+      return true;
+    }
+
+    /**
+     * Clear the counters, applied by the reading task on its next read().
+     */
+    void reset() {
+      reset_req_.store(true, std::memory_order_release);
+    }
+
+    // clang-format off
+    [[nodiscard]] uint32_t nav_pvt() const { return nav_pvt_; }
+    [[nodiscard]] uint32_t fixes() const { return fixes_; }
+    [[nodiscard]] uint32_t overruns() const { return overruns_; }
+    [[nodiscard]] uint32_t latency_max_us() const { return latency_max_us_; }
+    [[nodiscard]] uint32_t latency_mean_us() const { return published_ ? static_cast<uint32_t>(latency_sum_us_ / published_) : 0; }
+    [[nodiscard]] const parser_stats_t &parser_stats() const { return parser_.stats(); }
+    // clang-format on
+
+    /**
+     * One report line:
+     *   #GNSS,<ms>,<name>,<frames>,<checksum errors>,<skipped>,<overruns>,<nav pvt>,<fixes>,<superseded>,
+     *   <latency mean>,<latency max>,L,<latency buckets>
+     * Times in us, buckets follow edges_us.
+     *
+     * @return Line length including LF (no NUL)
+     */
+    size_t write(char *dst, const size_t cap, const char *name, const uint32_t now_ms) const {
+      const parser_stats_t  &p = parser_.stats();
+      fast_fmt::csv_writer_t csv(dst, cap);
+      csv << "#GNSS" << now_ms << name << p.frames << p.checksum_errors << p.skipped << overruns_ << nav_pvt_ << fixes_
+          << superseded_ << latency_mean_us() << latency_max_us_;
+      csv << "L";
+      for (const uint32_t b : latency_)
+        csv << b;
+      return csv.finish();
+    }
+  };
+}  // namespace ubx
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_USERSENSORREGS_H
@@ -5,19 +5,75 @@
 #include <SPI.h>
 #include <ADXL372.h>
 #include <SparkFun_BMP581_Arduino_Library.h>
+#include "./UserSensorRegs.h"
 
+/**
+ * Configured by the vendor library on SPIClass, sampled by DMA bursts on
+ * bus once bus.begin() has taken the peripheral over.
+ *
+ * The FIFO buffers every sample of the 6400 Hz ODR; read() drains it and
+ * stream timestamps and decimates them. FIFO_RDY on INT1 rises at the
+ * watermark, one read interval of sets, and falls once read() drains the
+ * FIFO below it.
+ */
 class IMU_ADXL372 final : public SensorIMU {
 protected:
-  ADXL372class acc;
-  float        axf{}, ayf{}, azf{};
-  double       ax{}, ay{}, az{};
+  ADXL372class           acc;
+  SPIClass              &spi;
+  hal::spi::bus_t       &bus;
+  adxl372::fifo_reader_t reader;
+  adxl372::stream_t<>    stream;
+  adxl372::code_t        sets[adxl372::FIFO_SETS]{};
+  uint16_t               watermark_sets;
+  int                    cs;
+
+  // restart() on the DMA bus: ID check, standby, then the configuration begin() left
+  hal::spi::burst_t<1>                   devid;
+  hal::spi::write_t<1>                   standby;
+  hal::spi::write_t<adxl372::CONFIG_LEN> config;
+
+  // Plain register access, only before the DMA bus takes over
+  void write_reg(const uint8_t reg, const uint8_t value) {
+    spi.beginTransaction(SPISettings(10'000'000, MSBFIRST, SPI_MODE0));
+    digitalWrite(cs, LOW);
+    spi.transfer(static_cast<uint8_t>(reg << 1));
+    spi.transfer(value);
+    digitalWrite(cs, HIGH);
+    spi.endTransaction();
+  }
+
+  uint8_t read_reg(const uint8_t reg) {
+    spi.beginTransaction(SPISettings(10'000'000, MSBFIRST, SPI_MODE0));
+    digitalWrite(cs, LOW);
+    spi.transfer(hal::spi::read_cmd(adxl372::CMD, reg));
+    const uint8_t value = spi.transfer(0);
+    digitalWrite(cs, HIGH);
+    spi.endTransaction();
+    return value;
+  }
 
 public:
-  IMU_ADXL372(SPIClass &spi, const int cs) : SensorIMU(), acc(spi, cs) {
+  /**
+   * @param decimation ODR to decimated stream ratio
+   * @param watermark_sets FIFO_RDY threshold in X Y Z sets
+   */
+  IMU_ADXL372(SPIClass &spi, hal::spi::bus_t &bus, const int cs, const uint32_t decimation,
+              const uint16_t watermark_sets = 32)
+      : SensorIMU(), acc(spi, cs), spi(spi), bus(bus), reader(cs), stream(decimation),
+        watermark_sets(watermark_sets), cs(cs), devid(cs, adxl372::CMD, adxl372::REG_DEVID_AD),
+        standby(cs, adxl372::CMD, adxl372::REG_POWER_CTL), config(cs, adxl372::CMD, adxl372::REG_CONFIG) {
+    standby.data()[0] = adxl372::POWER_CTL_STANDBY;
   }
 
   bool begin() override {
     acc.begin();
+
+    // FIFO in stream mode while still in standby
+    const uint16_t watermark = watermark_sets * 3;
+    write_reg(adxl372::REG_FIFO_SAMPLES, static_cast<uint8_t>(watermark));
+    write_reg(adxl372::REG_FIFO_CTL, adxl372::FIFO_CTL_STREAM | (watermark >> 8 & 0x01u));
+    write_reg(adxl372::REG_INT1_MAP, adxl372::INT1_MAP_FIFO_RDY);
+
     acc.setOperatingMode(FULL_BANDWIDTH);
     acc.setOdr(ODR_6400Hz);
     acc.setBandwidth(BW_3200Hz);
@@ -25,40 +81,48 @@ public:
     acc.enableLowNoiseOperation(true);
     acc.disableLowPassFilter(true);
     acc.disableHighPassFilter(true);
-    return true;
-  }
 
-  bool read() override {
-    acc.readAcceleration(axf, ayf, azf);
-    ax = axf, ay = ayf, az = azf;
+    for (size_t i = 0; i < adxl372::CONFIG_LEN; ++i)
+      config.data()[i] = read_reg(static_cast<uint8_t>(adxl372::REG_CONFIG + i));
     return true;
   }
 
-  double acc_x() override {
-    return ax;
-  }
-
-  double acc_y() override {
-    return ay;
+  /**
+   * begin() again on the DMA bus, which owns SPI1 by now: the device must
+   * still answer with its ID, and gets back the registers begin() left,
+   * written in standby with the mode last. The reader realigns itself.
+   */
+  bool restart() override {
+    return bus.transfer(devid) && devid.data()[0] == adxl372::DEVID_AD &&
+           bus.transfer(standby) && bus.transfer(config);
   }
 
-  double acc_z() override {
-    return az;
-  }
+  bool read(Data &out) override {
+    bool         overrun = false;
+    const size_t n       = reader.read(bus, sets, overrun);
+    stream.push(sets, n, micros(), overrun);
+    if (n == 0)
+      return false;
 
-  double gyr_x() override {
-    return 0.;
+    // out keeps the last decimated sample until the decimator yields the next
+    if (Sample latest; stream.newest(latest))
+      out = {latest.acc_x, latest.acc_y, latest.acc_z, 0., 0., 0.};
+    return true;
   }
 
-  double gyr_y() override {
-    return 0.;
+  size_t raw_samples(const Sample *&first) override {
+    return stream.raw(first);
   }
 
-  double gyr_z() override {
-    return 0.;
+  size_t decimated_samples(const Sample *&first) override {
+    return stream.decimated(first);
   }
 };
 
+/**
+ * Configured by the vendor library, sampled like IMU_ADXL372. INT pulses
+ * once per conversion (ODR_HZ), when the data registers are updated.
+ */
 class Altimeter_BMP581 final : public SensorAltimeter {
 protected:
   BMP581                    bmp;
@@ -69,59 +133,128 @@ protected:
       .press_en = 0,                       // UNUSED
       .odr      = 0                        // UNUSED
     };
-  bmp5_sensor_data data{};
+  SPIClass        &spi;
+  hal::spi::bus_t &bus;
+  bmp581::reader_t reader;
+  bmp581::sample_t sample{};
   uint8_t          cs;
 
-public:
-  explicit Altimeter_BMP581(const uint8_t cs) : SensorAltimeter(), cs(cs) {
-  }
-
-  bool begin() override {
-    return bmp.beginSPI(PC1, 10'000'000) == BMP5_OK &&
-           bmp.setOSRMultipliers(&bmp_osr) == BMP5_OK &&
-           bmp.setODRFrequency(BMP5_ODR_10_HZ) == BMP5_OK;
-  }
+  // restart() on the DMA bus: ID check, then the configuration begin() left
+  hal::spi::burst_t<1> chip_id;
+  hal::spi::write_t<2> int_config;  // INT_CONFIG, INT_SOURCE
+  hal::spi::write_t<2> osr_odr;     // OSR_CONFIG, ODR_CONFIG
+  uint8_t              chip_id_value = 0;
 
-  bool read() override {
-    return bmp.getSensorData(&data) == BMP5_OK;
+  // Plain register access, only before the DMA bus takes over
+  void write_reg(const uint8_t reg, const uint8_t value) {
+    spi.beginTransaction(SPISettings(10'000'000, MSBFIRST, SPI_MODE0));
+    digitalWrite(cs, LOW);
+    spi.transfer(reg);
+    spi.transfer(value);
+    digitalWrite(cs, HIGH);
+    spi.endTransaction();
   }
 
-  double pressure_hpa() override {
-    return data.pressure * 0.01;  // Pa -> hPa
+  uint8_t read_reg(const uint8_t reg) {
+    spi.beginTransaction(SPISettings(10'000'000, MSBFIRST, SPI_MODE0));
+    digitalWrite(cs, LOW);
+    spi.transfer(hal::spi::read_cmd(bmp581::CMD, reg));
+    const uint8_t value = spi.transfer(0);
+    digitalWrite(cs, HIGH);
+    spi.endTransaction();
+    return value;
   }
-};
 
-class GNSS1 final : public SensorGNSS {
 public:
-  GNSS1() : SensorGNSS() {
+  Altimeter_BMP581(SPIClass &spi, hal::spi::bus_t &bus, const uint8_t cs)
+      : SensorAltimeter(), spi(spi), bus(bus), reader(cs), cs(cs), chip_id(cs, bmp581::CMD, bmp581::REG_CHIP_ID),
+        int_config(cs, bmp581::CMD, bmp581::REG_INT_CONFIG), osr_odr(cs, bmp581::CMD, bmp581::REG_OSR_CONFIG) {
   }
 
   bool begin() override {
-    return false;
+    if (bmp.beginSPI(cs, 10'000'000) != BMP5_OK ||
+        bmp.setOSRMultipliers(&bmp_osr) != BMP5_OK ||
+        bmp.setODRFrequency(BMP5_ODR_10_HZ) != BMP5_OK)
+      return false;
+
+    write_reg(bmp581::REG_INT_SOURCE, bmp581::INT_SOURCE_DRDY);
+    write_reg(bmp581::REG_INT_CONFIG, bmp581::INT_CONFIG_PULSED_HIGH);
+
+    chip_id_value = read_reg(bmp581::REG_CHIP_ID);
+    for (size_t i = 0; i < 2; ++i) {
+      int_config.data()[i] = read_reg(static_cast<uint8_t>(bmp581::REG_INT_CONFIG + i));
+      osr_odr.data()[i]    = read_reg(static_cast<uint8_t>(bmp581::REG_OSR_CONFIG + i));
+    }
+    return true;
   }
 
-  bool read() override {
-    return false;
+  /**
+   * begin() again on the DMA bus, as IMU_ADXL372::restart(). The ID read
+   * also puts a device back from power-on reset into SPI mode, so that
+   * case passes on the next retry. One that never began stays down.
+   */
+  bool restart() override {
+    return chip_id_value != 0 && bus.transfer(chip_id) && chip_id.data()[0] == chip_id_value &&
+           bus.transfer(int_config) && bus.transfer(osr_odr);
   }
 
-  uint32_t timestamp_epoch() override {
-    return 0ul;
+  bool read(Data &out) override {
+    if (!reader.read(bus, sample))
+      return false;
+
+    out.pressure_hpa = sample.pressure_pa * 0.01;  // Pa -> hPa
+    out.altitude_m   = altitude_m(out.pressure_hpa);
+    return true;
   }
+};
+
+/**
+ * u-blox receiver (M9/M10 configuration interface) on a hal::uart UART,
+ * which must be up before begin(). begin(), and restart() with it, set the
+ * receiver up over UBX: NAV-PVT alone every nav_ms, the airborne <4 g
+ * dynamic model, the link at baud. read() parses what the DMA took in since
+ * the last call, see ubx::receiver_t.
+ */
+class GNSS_UBX final : public SensorGNSS {
+protected:
+  ubx::receiver_t rx;
+  uint32_t        baud;
+  uint16_t        nav_ms;
 
-  uint8_t siv() override {
-    return 0;
+public:
+  GNSS_UBX(hal::uart::rx_t &uart, const uint32_t baud, const uint16_t nav_ms)
+      : SensorGNSS(), rx(uart), baud(baud), nav_ms(nav_ms) {
   }
 
-  double latitude() override {
-    return 0.;
+  /**
+   * The settings at the receiver's factory rate, then again at baud for one
+   * that is there already (the MCU reset, the receiver did not). Nothing
+   * waits for the ACK: NAV-PVTs arriving is what counts.
+   */
+  bool begin() override {
+    uint8_t       frame[64];
+    ubx::writer_t valset(frame, sizeof(frame), ubx::CLASS_CFG, ubx::ID_CFG_VALSET);
+    valset.u1(0).u1(ubx::cfg::LAYER_RAM).u2(0);
+    valset.item(ubx::cfg::UART1_BAUDRATE, baud)
+      .item(ubx::cfg::UART1OUTPROT_UBX, 1)
+      .item(ubx::cfg::UART1OUTPROT_NMEA, 0)
+      .item(ubx::cfg::MSGOUT_UBX_NAV_PVT_UART1, 1)
+      .item(ubx::cfg::RATE_MEAS, nav_ms)
+      .item(ubx::cfg::RATE_NAV, 1)
+      .item(ubx::cfg::NAVSPG_DYNMODEL, ubx::cfg::DYNMODEL_AIRBORNE_4G);
+    const size_t len = valset.finish();
+
+    hal::uart::rx_t &uart = rx.uart();
+    return len && uart.set_baud(ubx::BAUD_DEFAULT) && uart.write(frame, len) && uart.set_baud(baud) &&
+           uart.write(frame, len);
   }
 
-  double longitude() override {
-    return 0.;
+  bool read(Data &out) override {
+    return rx.read(out);
   }
 
-  double altitude_msl() override {
-    return 0.;
+  [[nodiscard]] ubx::receiver_t &receiver() {
+    return rx;
   }
 };
 
@@ -0,0 +1,52 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_USERSTATE_H
+#define ROCKET_AVIONICS_TEMPLATE_USERSTATE_H
+
+#include <cstdint>
+
+enum class UserState : uint8_t {
+  STARTUP = 0,
+  IDLE_SAFE,
+  ARMED,
+  PAD_PREOP,
+  POWERED,
+  COASTING,
+  DROGUE_DEPLOY,
+  DROGUE_DESCEND,
+  MAIN_DEPLOY,
+  MAIN_DESCEND,
+  LANDED,
+  RECOVERED_SAFE
+};
+
+inline const char *state_string(const UserState state) {
+  switch (state) {
+    case UserState::STARTUP:
+      return "STARTUP";
+    case UserState::IDLE_SAFE:
+      return "IDLE_SAFE";
+    case UserState::ARMED:
+      return "ARMED";
+    case UserState::PAD_PREOP:
+      return "PAD_PREOP";
+    case UserState::POWERED:
+      return "POWERED";
+    case UserState::COASTING:
+      return "COASTING";
+    case UserState::DROGUE_DEPLOY:
+      return "DROG_DEPL";
+    case UserState::DROGUE_DESCEND:
+      return "DROG_DESC";
+    case UserState::MAIN_DEPLOY:
+      return "MAIN_DEPL";
+    case UserState::MAIN_DESCEND:
+      return "MAIN_DESC";
+    case UserState::LANDED:
+      return "LANDED";
+    case UserState::RECOVERED_SAFE:
+      return "REC_SAFE";
+    default:
+      __builtin_unreachable();
+  }
+}
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_USERSTATE_H
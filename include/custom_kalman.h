@@ -3,6 +3,7 @@
 
 #include <lib_xcore>
 #include <xcore/math_module>
+#include <Kalman.h>
 
 // Kalman Filters
 constexpr size_t FILTER_ORDER = 3;
@@ -49,4 +50,226 @@ struct Filter2T {
   // xcore::kalman_filter_t<FILTER_ORDER, 2, 1> kf{F, B, H, Q, R, x0, P0};
 };
 
+// Same filters on Kalman.h, templated on the scalar type
+template<typename T>
+struct Filter1S {
+  static constexpr kalman::matrix_t<T, 1, FILTER_ORDER> H  = {{
+    {1, 0, 0},
+  }};
+  static constexpr kalman::vector_t<T, FILTER_ORDER>    x0 = {};
+  static constexpr kalman::matrix_t<T, FILTER_ORDER>    P0 = kalman::matrix_t<T, FILTER_ORDER>::diagonals(1000.);
+
+  kalman::matrix_t<T, FILTER_ORDER> F = {};
+  kalman::matrix_t<T, FILTER_ORDER> Q = kalman::matrix_t<T, FILTER_ORDER>::diagonals(BASE_NOISE);
+  kalman::matrix_t<T, 1>            R = kalman::matrix_t<T, 1>::diagonals(BASE_NOISE);
+
+  kalman::r_iae_filter_t<T, FILTER_ORDER, 1> kf{F, H, Q, R, x0, P0,
+                                                /*alpha*/ 0.20,  // Enable Adaptive R, a > 0
+                                                /*beta*/ 0.00,   // Disable Adaptive Q, b = 0
+                                                /*tau*/ 4.0,
+                                                /*eps*/ 1.e-12};
+};
+
+template<typename T>
+struct Filter2S {
+  static constexpr kalman::matrix_t<T, 2, FILTER_ORDER> H  = {{
+    {1, 0, 0},
+    {0, 1, 0}
+  }};
+  static constexpr kalman::vector_t<T, FILTER_ORDER>    x0 = {};
+  static constexpr kalman::matrix_t<T, FILTER_ORDER>    P0 = kalman::matrix_t<T, FILTER_ORDER>::diagonals(1000.);
+
+  kalman::matrix_t<T, FILTER_ORDER> F = {};
+  kalman::matrix_t<T, FILTER_ORDER> Q = kalman::matrix_t<T, FILTER_ORDER>::diagonals(BASE_NOISE);
+  kalman::matrix_t<T, 2>            R = kalman::matrix_t<T, 2>::diagonals(BASE_NOISE);
+
+  kalman::r_iae_filter_t<T, FILTER_ORDER, 2> kf{F, H, Q, R, x0, P0,
+                                                /*alpha*/ 0.20,  // Enable Adaptive R, a > 0
+                                                /*beta*/ 0.00,   // Disable Adaptive Q, b = 0
+                                                /*tau*/ 4.0,
+                                                /*eps*/ 1.e-12};
+};
+
+// Filter1S/Filter2S on packed P and scalar (sequential) updates, H selects the measured states
+template<typename T>
+struct Filter1P {
+  static constexpr kalman::vector_t<T, FILTER_ORDER> x0 = {};
+  static constexpr kalman::matrix_t<T, FILTER_ORDER> P0 = kalman::matrix_t<T, FILTER_ORDER>::diagonals(1000.);
+
+  kalman::matrix_t<T, FILTER_ORDER> F = {};
+  kalman::matrix_t<T, FILTER_ORDER> Q = kalman::matrix_t<T, FILTER_ORDER>::diagonals(BASE_NOISE);
+  kalman::matrix_t<T, 1>            R = kalman::matrix_t<T, 1>::diagonals(BASE_NOISE);
+
+  kalman::r_iae_packed_filter_t<T, FILTER_ORDER, 1> kf{F, Q, R, x0, P0,
+                                                       /*alpha*/ 0.20,  // Enable Adaptive R, a > 0
+                                                       /*beta*/ 0.00,   // Disable Adaptive Q, b = 0
+                                                       /*tau*/ 4.0,
+                                                       /*eps*/ 1.e-12};
+};
+
+template<typename T>
+struct Filter2P {
+  static constexpr kalman::vector_t<T, FILTER_ORDER> x0 = {};
+  static constexpr kalman::matrix_t<T, FILTER_ORDER> P0 = kalman::matrix_t<T, FILTER_ORDER>::diagonals(1000.);
+
+  kalman::matrix_t<T, FILTER_ORDER> F = {};
+  kalman::matrix_t<T, FILTER_ORDER> Q = kalman::matrix_t<T, FILTER_ORDER>::diagonals(BASE_NOISE);
+  kalman::matrix_t<T, 2>            R = kalman::matrix_t<T, 2>::diagonals(BASE_NOISE);
+
+  kalman::r_iae_packed_filter_t<T, FILTER_ORDER, 2> kf{F, Q, R, x0, P0,
+                                                       /*alpha*/ 0.20,  // Enable Adaptive R, a > 0
+                                                       /*beta*/ 0.00,   // Disable Adaptive Q, b = 0
+                                                       /*tau*/ 4.0,
+                                                       /*eps*/ 1.e-12};
+};
+
+// Filter1S with a precomputed gain, falling back to the full filter (see kalman::steady_state_filter_t)
+template<typename T>
+struct Filter1SS {
+  static constexpr kalman::matrix_t<T, 1, FILTER_ORDER> H  = {{
+    {1, 0, 0},
+  }};
+  static constexpr kalman::vector_t<T, FILTER_ORDER>    x0 = {};
+  static constexpr kalman::matrix_t<T, FILTER_ORDER>    P0 = kalman::matrix_t<T, FILTER_ORDER>::diagonals(1000.);
+
+  kalman::matrix_t<T, FILTER_ORDER> F = {};
+  kalman::matrix_t<T, FILTER_ORDER> Q = kalman::matrix_t<T, FILTER_ORDER>::diagonals(BASE_NOISE);
+  kalman::matrix_t<T, 1>            R = kalman::matrix_t<T, 1>::diagonals(BASE_NOISE);
+
+  kalman::steady_state_filter_t<T, FILTER_ORDER, 1> kf{F, H, Q, R, x0, P0,
+                                                       /*alpha*/ 0.20,  // Enable Adaptive R, a > 0
+                                                       /*beta*/ 0.00,   // Disable Adaptive Q, b = 0
+                                                       /*tau*/ 4.0,
+                                                       /*eps*/ 1.e-12,
+                                                       /*nis_limit*/ 4.0,  // Mean normalized innovation, 1 nominal
+                                                       /*hold*/ 20};       // Updates in bounds to leave fallback
+};
+
+// Solve a Filter1SS's gains at its current F for nominal_steps predicts per update; other filters have none
+template<typename Filter>
+bool solve_gains(Filter &filter, const uint32_t nominal_steps) {
+  if constexpr (requires { filter.kf.solve(nominal_steps); })
+    return filter.kf.solve(nominal_steps);
+  else
+    return true;
+}
+
+/**
+ * Altitude, vertical velocity and acceleration (SI) from the barometer and
+ * the accelerometer in one filter. Each measurement is fused as it arrives:
+ * the state is predicted to its timestamp, then a scalar update of the state
+ * it measures. Process noise is white jerk; F and Q come from a table in
+ * 100 us steps (dt rounded, under 1% at the 5 ms IMU interval) and are only
+ * generated for steps past its end.
+ */
+template<typename T>
+struct FilterFused {
+  static constexpr double JERK_PSD = 100.;  // (m/s^3)^2/Hz
+  static constexpr double R_ALT    = 1.0;   // m^2
+  static constexpr double R_ACC    = 8.0;   // (m/s^2)^2
+  static constexpr size_t CH_ALT   = 0;
+  static constexpr size_t CH_ACC   = 1;
+
+  static constexpr uint32_t STEP_US = 100;
+
+  static constexpr kalman::discretization_table_t<T, FILTER_ORDER - 1, 101> TABLE{STEP_US * 1e-6, JERK_PSD};  // 0 .. 10 ms
+
+  static constexpr kalman::vector_t<T, FILTER_ORDER> x0 = {};
+  static constexpr kalman::matrix_t<T, FILTER_ORDER> P0 = kalman::matrix_t<T, FILTER_ORDER>::diagonals(1000.);
+
+  kalman::vdt_t<T, FILTER_ORDER - 1> vdt{0.};
+  kalman::matrix_t<T, FILTER_ORDER>  F = kalman::matrix_t<T, FILTER_ORDER>::diagonals(1.);
+  kalman::matrix_t<T, FILTER_ORDER>  Q = {};
+  kalman::matrix_t<T, 2>             R = {{
+    {R_ALT, 0},
+    {0, R_ACC}
+  }};
+
+  // Fixed R: with the accelerometer carrying the state, an adapted R_ALT runs away and the baro is ignored
+  kalman::r_iae_packed_filter_t<T, FILTER_ORDER, 2> kf{F, Q, R, x0, P0,
+                                                       /*alpha*/ 0.00,  // Disable Adaptive R, a = 0
+                                                       /*beta*/ 0.00,   // Disable Adaptive Q, b = 0
+                                                       /*tau*/ 4.0,
+                                                       /*eps*/ 1.e-12};
+
+  uint32_t t_us    = 0;  // Time of the state
+  uint32_t dt_us   = 0;  // Step F and Q are for, rounded to STEP_US within the table
+  bool     started = false;
+
+  /**
+   * Predict to t (micros()), wrap-safe. A measurement stamped before the
+   * state's time is fused at the state's time.
+   */
+  void predict_to(const uint32_t t) {
+    const int32_t dt = static_cast<int32_t>(t - t_us);
+    if (!started) {
+      started = true;
+      t_us    = t;
+      return;
+    }
+    if (dt <= 0)
+      return;
+
+    const uint32_t step = (static_cast<uint32_t>(dt) + STEP_US / 2) / STEP_US;
+    if (step < TABLE.size) {
+      if (step * STEP_US != dt_us) {
+        dt_us = step * STEP_US;
+        F     = TABLE[step].F;
+        Q     = TABLE[step].Q;
+      }
+    } else if (static_cast<uint32_t>(dt) != dt_us) {
+      dt_us = static_cast<uint32_t>(dt);
+      vdt.update_dt(static_cast<double>(dt) * 1e-6);
+      F = vdt.generate_F();
+      Q = vdt.generate_Q(JERK_PSD);
+    }
+
+    kf.predict();
+    t_us = t;
+  }
+
+  void update_altitude(const T alt) {
+    kf.update_state(0, CH_ALT, alt);
+  }
+
+  void update_acceleration(const T acc) {
+    kf.update_state(2, CH_ACC, acc);
+  }
+};
+
+// Timestamped measurement for FilterFused
+template<typename T>
+struct timed_sample_t {
+  uint32_t t_us;
+  T        value;
+};
+
+// Estimator output as read by the FSM and the logger
+template<typename T>
+struct estimate_t {
+  uint32_t t_us;
+  T        alt;  // m
+  T        vel;  // m/s
+  T        acc;  // g, gravity removed
+};
+
+/**
+ * Estimator types for UserConfig.h's RA_ESTIMATOR_FLOAT and
+ * RA_ESTIMATOR_STEADY_STATE: the double xcore filters, Filter1P or
+ * Filter1SS. scalar is what the FSM samplers compare in.
+ */
+template<bool Float, bool SteadyState>
+struct estimator_t {
+  using scalar  = std::conditional_t<Float, float, double>;
+  using filter1 = std::conditional_t<SteadyState, Filter1SS<scalar>, Filter1P<scalar>>;
+  using vdt     = kalman::vdt_t<scalar, FILTER_ORDER - 1>;
+};
+
+template<>
+struct estimator_t<false, false> {
+  using scalar  = double;
+  using filter1 = Filter1T;
+  using vdt     = xcore::vdt<FILTER_ORDER - 1>;
+};
+
 #endif  //MINI_FC_FIRMWARE_KALMAN_H
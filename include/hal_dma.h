@@ -0,0 +1,92 @@
+#ifndef HAL_DMA_HPP
+#define HAL_DMA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+/**
+ * Memory the DMA controllers can reach.
+ *
+ * The linker script puts .data, .bss and the heap in DTCM, which only the
+ * CPU reaches: a DMA buffer that is a member of a global ends up there. The
+ * drivers take their DMA buffers from pool() instead, storage in the
+ * .dma_buffer section the linker script places in AXI SRAM.
+ */
+#if RA_SIM
+#  define HAL_DMA_SECTION
+#else
+#  define HAL_DMA_SECTION __attribute__((section(".dma_buffer")))
+#endif
+
+namespace hal::dma {
+  constexpr size_t POOL_SIZE = 16 * 1024;
+
+  // Whole cache lines, so invalidating a buffer never touches a neighbour
+  constexpr size_t padded(const size_t n) {
+    return (n + 31u) & ~size_t{31u};
+  }
+
+  inline bool reachable(const void *p) {
+#if RA_SIM
+    return p != nullptr;
+#else
+    const auto a = reinterpret_cast<uintptr_t>(p);
+    return p != nullptr && (a < 0x20000000u || a >= 0x20020000u);  // DTCM is CPU-only
+#endif
+  }
+
+  /**
+   * Cache-line aligned buffers carved from static storage, never freed. Take
+   * them at construction, before the scheduler starts.
+   */
+  class pool_t {
+    uint8_t *buf_;
+    size_t   size_;
+    size_t   used_      = 0;
+    size_t   exhausted_ = 0;  // Allocations that fell back to the heap
+
+  public:
+    template<size_t N>
+    constexpr explicit pool_t(uint8_t (&buf)[N]) : buf_(buf), size_(N) {}
+
+    pool_t(const pool_t &) = delete;
+
+    /**
+     * n bytes, zeroed. Past the pool's end from the heap, which DMA cannot
+     * reach on the target: the transfers that use it fail rather than the
+     * caller.
+     */
+    uint8_t *alloc(const size_t n) {
+      const size_t len = padded(n);
+      if (used_ + len > size_) {
+        ++exhausted_;
+        return new (std::align_val_t{32}) uint8_t[len]();
+      }
+      uint8_t *p = buf_ + used_;
+      used_ += len;
+      memset(p, 0, len);  // .dma_buffer is not cleared at startup
+      return p;
+    }
+
+    [[nodiscard]] size_t used() const {
+      return used_;
+    }
+
+    [[nodiscard]] size_t exhausted() const {
+      return exhausted_;
+    }
+  };
+
+  /**
+   * The pool of the SPI bursts and UART rings.
+   */
+  inline pool_t &pool() {
+    alignas(32) static uint8_t storage[POOL_SIZE] HAL_DMA_SECTION;
+    static pool_t              pool(storage);
+    return pool;
+  }
+}  // namespace hal::dma
+
+#endif  //HAL_DMA_HPP
@@ -0,0 +1,156 @@
+#ifndef HAL_DRDY_HPP
+#define HAL_DRDY_HPP
+
+#include <Arduino.h>
+#include <FastFormat.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "./hal_rtos.h"
+
+/**
+ * Sensor data-ready interrupts.
+ *
+ * A sensor's data-ready pin (ADXL372 FIFO watermark on INT1, BMP581 DRDY)
+ * raises an EXTI interrupt. The handler stamps the edge and wakes the task
+ * that claimed the line, so the read follows the conversion instead of the
+ * next tick of a free-running period. STM32duino runs EXTI handlers below
+ * configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, where thread flags may be set.
+ *
+ * Edges are stamped whether or not a task waits on them, so polled reads
+ * report their sample age the same way.
+ */
+namespace hal::drdy {
+  class line_t {
+  public:
+    // Upper bucket edges in us, as loop_stats_t
+    static constexpr const uint32_t *edges_us    = rtos::loop_stats_t::edges_us;
+    static constexpr size_t          num_buckets = rtos::loop_stats_t::num_buckets;
+
+  private:
+    const char               *name_;
+    std::atomic<osThreadId_t> task_{nullptr};
+    std::atomic<uint32_t>     edges_{0};
+    std::atomic<uint32_t>     edge_us_{0};
+    std::atomic<bool>         reset_req_{false};
+
+    // Reader side, only touched by the owning task
+    uint32_t last_edges_ = 0;
+    uint32_t reads_      = 0;
+    uint32_t polls_      = 0;
+    uint32_t stale_      = 0;
+    uint64_t age_sum_us_ = 0;
+    uint32_t age_max_us_ = 0;
+    uint32_t age_[num_buckets] = {};
+
+    void clear() {
+      reads_      = 0;
+      polls_      = 0;
+      stale_      = 0;
+      age_sum_us_ = 0;
+      age_max_us_ = 0;
+      for (uint32_t &b : age_)
+        b = 0;
+    }
+
+  public:
+    explicit line_t(const char *name) : name_(name) {}
+
+    line_t(const line_t &) = delete;
+
+    /**
+     * Attach the EXTI handler to pin.
+     *
+     * @param mode Edge of the device's active level, RISING for active high
+     */
+    void attach(const uint32_t pin, const uint32_t mode = RISING) {
+      pinMode(pin, INPUT);
+      attachInterrupt(digitalPinToInterrupt(pin), [this]() -> void { isr(); }, mode);
+    }
+
+    /**
+     * Make the calling task the one each edge wakes.
+     */
+    void claim() {
+      task_.store(osThreadGetId(), std::memory_order_release);
+    }
+
+    // EXTI handler
+    void isr() {
+      edge_us_.store(hal::micros(), std::memory_order_relaxed);
+      edges_.fetch_add(1, std::memory_order_release);
+      rtos::isr_notify(task_.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Record a read whose data is in hand at now_us: its age is the time
+     * since the last edge. A read with no edge since the previous one got
+     * nothing new and counts as stale.
+     *
+     * @param polled The read ran on a period or timeout, not on an edge
+     */
+    void sampled(const uint32_t now_us, const bool polled) {
+      if (reset_req_.exchange(false, std::memory_order_acq_rel))
+        clear();
+
+      // The edge count brackets the stamp, retry if an edge landed in between
+      uint32_t edges, edge_us;
+      do {
+        edges   = edges_.load(std::memory_order_acquire);
+        edge_us = edge_us_.load(std::memory_order_relaxed);
+      } while (edges != edges_.load(std::memory_order_acquire));
+
+      ++reads_;
+      polls_ += polled;
+      if (edges == last_edges_) {
+        ++stale_;
+        return;
+      }
+      last_edges_ = edges;
+
+      const uint32_t age = now_us - edge_us;
+      age_sum_us_ += age;
+      if (age > age_max_us_)
+        age_max_us_ = age;
+      size_t i = 0;
+      while (i < num_buckets - 1 && age > edges_us[i])
+        ++i;
+      ++age_[i];
+    }
+
+    /**
+     * Clear the counters, applied by the owning task on its next read.
+     */
+    void reset() {
+      reset_req_.store(true, std::memory_order_release);
+    }
+
+    // clang-format off
+    [[nodiscard]] const char *name() const { return name_; }
+    [[nodiscard]] uint32_t edges() const { return edges_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint32_t reads() const { return reads_; }
+    [[nodiscard]] uint32_t polls() const { return polls_; }
+    [[nodiscard]] uint32_t stale() const { return stale_; }
+    [[nodiscard]] uint32_t age_max_us() const { return age_max_us_; }
+    [[nodiscard]] uint32_t age_mean_us() const { return reads_ > stale_ ? static_cast<uint32_t>(age_sum_us_ / (reads_ - stale_)) : 0; }
+    // clang-format on
+
+    /**
+     * One report line:
+     *   #AGE,<ms>,<name>,<reads>,<polls>,<stale>,<age mean>,<age max>,A,<age buckets>
+     * Times in us, buckets follow edges_us.
+     *
+     * @return Line length including LF (no NUL)
+     */
+    size_t write(char *dst, const size_t cap, const uint32_t now_ms) const {
+      fast_fmt::csv_writer_t csv(dst, cap);
+      csv << "#AGE" << now_ms << name_ << reads_ << polls_ << stale_ << age_mean_us() << age_max_us_;
+      csv << "A";
+      for (const uint32_t b : age_)
+        csv << b;
+      return csv.finish();
+    }
+  };
+}  // namespace hal::drdy
+
+#endif  //HAL_DRDY_HPP
@@ -0,0 +1,162 @@
+#ifndef HAL_LOOP_STATS_HPP
+#define HAL_LOOP_STATS_HPP
+
+#include <FastFormat.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace hal::rtos {
+  /**
+   * Timing statistics of one periodic loop, filled by interval_loop.
+   *
+   * Period jitter (|period - nominal|) and execution time are counted in
+   * fixed 1-2-5 buckets at microsecond resolution; a body that runs longer
+   * than the nominal period counts as an overrun. No allocation, every
+   * instance registers itself in loops::table for querying.
+   */
+  class loop_stats_t {
+  public:
+    // Upper bucket edges in us, the last bucket holds everything above
+    static constexpr uint32_t edges_us[]  = {10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000};
+    static constexpr size_t   num_buckets = sizeof(edges_us) / sizeof(edges_us[0]) + 1;
+
+  private:
+    const char       *name_;
+    uint32_t          nominal_us_    = 0;
+    uint32_t          last_start_us_ = 0;
+    uint32_t          last_period_   = 0;
+    bool              has_last_      = false;
+    std::atomic<bool> reset_req_{false};
+
+    uint32_t count_         = 0;
+    uint32_t overruns_      = 0;
+    uint32_t period_min_us_ = UINT32_MAX;
+    uint32_t period_max_us_ = 0;
+    uint32_t exec_max_us_   = 0;
+    uint32_t jitter_[num_buckets] = {};
+    uint32_t exec_[num_buckets]   = {};
+
+    static size_t bucket(const uint32_t us) {
+      size_t i = 0;
+      while (i < num_buckets - 1 && us > edges_us[i])
+        ++i;
+      return i;
+    }
+
+    void clear() {
+      count_         = 0;
+      overruns_      = 0;
+      period_min_us_ = UINT32_MAX;
+      period_max_us_ = 0;
+      exec_max_us_   = 0;
+      for (size_t i = 0; i < num_buckets; ++i)
+        jitter_[i] = exec_[i] = 0;
+    }
+
+  public:
+    explicit loop_stats_t(const char *name);
+
+    loop_stats_t(const loop_stats_t &) = delete;
+
+    void set_nominal_ms(const uint32_t interval_ms) {
+      nominal_us_ = interval_ms * 1000u;
+    }
+
+    /**
+     * Mark the start of an iteration, called by the loop before its body.
+     * last_period_us() is current from here on.
+     */
+    void begin(const uint32_t start_us) {
+      if (reset_req_.exchange(false, std::memory_order_acq_rel))
+        clear();
+
+      if (has_last_) {
+        const uint32_t period = start_us - last_start_us_;
+        last_period_          = period;
+        ++jitter_[bucket(period > nominal_us_ ? period - nominal_us_ : nominal_us_ - period)];
+        if (period < period_min_us_)
+          period_min_us_ = period;
+        if (period > period_max_us_)
+          period_max_us_ = period;
+      }
+
+      last_start_us_ = start_us;
+      has_last_      = true;
+    }
+
+    /**
+     * Mark the end of the iteration started by begin().
+     */
+    void end(const uint32_t end_us) {
+      const uint32_t exec = end_us - last_start_us_;
+      ++exec_[bucket(exec)];
+      if (exec > exec_max_us_)
+        exec_max_us_ = exec;
+      if (exec > nominal_us_)
+        ++overruns_;
+      ++count_;
+    }
+
+    /**
+     * Clear the counters, applied by the loop on its next iteration.
+     */
+    void reset() {
+      reset_req_.store(true, std::memory_order_release);
+    }
+
+    // clang-format off
+    [[nodiscard]] const char *name() const { return name_; }
+    [[nodiscard]] uint32_t nominal_us() const { return nominal_us_; }
+    [[nodiscard]] uint32_t last_period_us() const { return last_period_; }
+    [[nodiscard]] uint32_t count() const { return count_; }
+    [[nodiscard]] uint32_t overruns() const { return overruns_; }
+    [[nodiscard]] uint32_t period_min_us() const { return period_min_us_ == UINT32_MAX ? 0 : period_min_us_; }
+    [[nodiscard]] uint32_t period_max_us() const { return period_max_us_; }
+    [[nodiscard]] uint32_t exec_max_us() const { return exec_max_us_; }
+    [[nodiscard]] uint32_t jitter_bucket(const size_t i) const { return jitter_[i]; }
+    [[nodiscard]] uint32_t exec_bucket(const size_t i) const { return exec_[i]; }
+    // clang-format on
+
+    /**
+     * One report line:
+     *   #LOOP,<ms>,<name>,<nominal>,<count>,<overruns>,<period min>,<period max>,<exec max>,J,<jitter buckets>,E,<exec buckets>
+     * Times in us, buckets follow edges_us.
+     *
+     * @return Line length including LF (no NUL)
+     */
+    size_t write(char *dst, const size_t cap, const uint32_t now_ms) const {
+      fast_fmt::csv_writer_t csv(dst, cap);
+      csv << "#LOOP" << now_ms << name_ << nominal_us_ << count_ << overruns_
+          << period_min_us() << period_max_us_ << exec_max_us_;
+      csv << "J";
+      for (const uint32_t b : jitter_)
+        csv << b;
+      csv << "E";
+      for (const uint32_t b : exec_)
+        csv << b;
+      return csv.finish();
+    }
+  };
+
+  namespace loops {
+    constexpr size_t     MAX_LOOPS = 16;
+    inline loop_stats_t *table[MAX_LOOPS];
+    inline size_t        num_loops = 0;
+
+    inline loop_stats_t *find(const char *name) {
+      for (size_t i = 0; i < num_loops; ++i)
+        if (strcmp(table[i]->name(), name) == 0)
+          return table[i];
+      return nullptr;
+    }
+  }  // namespace loops
+
+  inline loop_stats_t::loop_stats_t(const char *name) : name_(name) {
+    if (loops::num_loops < loops::MAX_LOOPS)
+      loops::table[loops::num_loops++] = this;
+  }
+}  // namespace hal::rtos
+
+#endif  //HAL_LOOP_STATS_HPP
@@ -0,0 +1,154 @@
+#ifndef HAL_PROFILER_HPP
+#define HAL_PROFILER_HPP
+
+#include "./hal_rtos.h"
+#include <FastFormat.h>
+#include <atomic>
+
+/**
+ * Per-task CPU time and stack usage.
+ *
+ * Every task created through hal::rtos (scheduler.create, static_task_t) is
+ * registered in hal::rtos::mon. A FreeRTOS traceTASK_SWITCHED_IN hook
+ * (include/STM32FreeRTOSConfig.h, src/rtos_profiler.cpp) charges the DWT cycles
+ * since the previous switch to the task that was running; time spent in ISRs
+ * is charged to the interrupted task. Idle, the timer task and unregistered
+ * tasks share the IDLE bucket.
+ */
+namespace hal::rtos::prof {
+  constexpr size_t IDLE = mon::MAX_MON;
+
+  // Accumulated cycles per mon slot, plus IDLE, written by the switch hook
+  extern volatile uint32_t cycles[mon::MAX_MON + 1];
+
+  /**
+   * Builds the periodic report and hands it to a single consumer.
+   *
+   * Report lines, each at most max_line bytes including LF:
+   *   #PROF,<ms>,idle=<%>[,<task>:<cpu %>:<stack used>/<stack size>]...
+   * Long reports continue on further #PROF lines with the same timestamp.
+   * Stack figures are bytes, used is the high-water mark.
+   *
+   * @tparam Capacity Report buffer size in bytes
+   */
+  template<size_t Capacity = 1024>
+  class profiler_t {
+    uint32_t            prev_cycles_[mon::MAX_MON + 1] = {};
+    uint32_t            prev_total_                    = 0;
+    char                report_[Capacity]              = {};
+    std::atomic<size_t> ready_len_{0};
+
+    static size_t write_pct(char *dst, const uint32_t part, const uint32_t total) {
+      const double pct = total ? 100.0 * static_cast<double>(part) / static_cast<double>(total) : 0.0;
+      return fast_fmt::write_fixed(dst, pct, 1);
+    }
+
+  public:
+    /**
+     * Sample all tasks and build a new report, unless the last one was not drained yet.
+     *
+     * @param now_ms Report timestamp
+     * @param max_line Maximum line length, e.g. the log frame size
+     * @return True if a report was built
+     */
+    bool update(const uint32_t now_ms, const size_t max_line) {
+      if (ready_len_.load(std::memory_order_acquire))
+        return false;
+
+      const uint32_t now   = hal::cycles();
+      const uint32_t total = now - prev_total_;
+      prev_total_          = now;
+
+      uint32_t delta[mon::MAX_MON + 1];
+      for (size_t i = 0; i <= mon::MAX_MON; ++i) {
+        const uint32_t c = cycles[i];
+        delta[i]         = c - prev_cycles_[i];
+        prev_cycles_[i]  = c;
+      }
+
+      char head[fast_fmt::max_chars + 8];
+      memcpy(head, "#PROF,", 6);
+      const size_t head_len = 6 + fast_fmt::write_u32(head + 6, now_ms);
+
+      size_t len        = 0;
+      size_t line_start = 0;
+
+      const auto begin_line = [&]() -> bool {
+        if (len + head_len >= Capacity)
+          return false;
+        line_start = len;
+        memcpy(report_ + len, head, head_len);
+        len += head_len;
+        return true;
+      };
+
+      // Append one entry, wrapping onto a new line when it would exceed max_line
+      const auto put_entry = [&](const char *entry, const size_t n) -> bool {
+        if (len - line_start + n + 1 > max_line) {
+          report_[len++] = '\n';
+          if (!begin_line())
+            return false;
+        }
+        if (len + n + 1 >= Capacity)
+          return false;
+        memcpy(report_ + len, entry, n);
+        len += n;
+        return true;
+      };
+
+      char   entry[96];
+      size_t n = 0;
+
+      begin_line();
+      memcpy(entry, ",idle=", 6);
+      n = 6 + write_pct(entry + 6, delta[IDLE], total);
+      put_entry(entry, n);
+
+      for (size_t i = 0; i < mon::num_handles; ++i) {
+        const char  *name       = osThreadGetName(mon::handles[i]);
+        const size_t stack_size = mon::stacks[i] * sizeof(uint32_t);
+        const size_t stack_free = osThreadGetStackSpace(mon::handles[i]);
+        const size_t name_len   = name ? strnlen(name, 32) : 0;
+
+        n          = 0;
+        entry[n++] = ',';
+        memcpy(entry + n, name, name_len);
+        n += name_len;
+        entry[n++] = ':';
+        n += write_pct(entry + n, delta[i], total);
+        entry[n++] = ':';
+        n += fast_fmt::write_u32(entry + n, stack_size > stack_free ? stack_size - stack_free : 0);
+        entry[n++] = '/';
+        n += fast_fmt::write_u32(entry + n, stack_size);
+
+        if (!put_entry(entry, n))
+          break;
+      }
+
+      report_[len++] = '\n';
+      ready_len_.store(len, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * Hand the pending report to func(line, len) line by line, then release it.
+     */
+    template<typename Func>
+    void drain(Func &&func) {
+      const size_t len = ready_len_.load(std::memory_order_acquire);
+      if (!len)
+        return;
+
+      size_t begin = 0;
+      for (size_t i = 0; i < len; ++i) {
+        if (report_[i] == '\n') {
+          func(report_ + begin, i + 1 - begin);
+          begin = i + 1;
+        }
+      }
+      ready_len_.store(0, std::memory_order_release);
+    }
+  };
+}  // namespace hal::rtos::prof
+
+#endif  //HAL_PROFILER_HPP
@@ -3,6 +3,8 @@
 
 #include <STM32FreeRTOS.h>
 #include "./hal_timing.h"
+#include "./hal_loop_stats.h"
+#include "./hal_trace.h"
 
 #ifndef pdTICKS_TO_MS
 #  define pdTICKS_TO_MS(xTicks) ((TickType_t) ((uint64_t) (xTicks) * 1000 / configTICK_RATE_HZ))
@@ -20,8 +22,24 @@ namespace hal::rtos {
   namespace mon {
     constexpr size_t    MAX_MON = 32;
     inline osThreadId_t handles[MAX_MON];
-    inline size_t       stacks[MAX_MON];
+    inline size_t       stacks[MAX_MON];  // Stack size in words
     inline size_t       num_handles = 0;
+
+    /**
+     * Register a task for monitoring.
+     *
+     * @param handle Task handle
+     * @param stack_words Stack size in 32-bit words
+     * @return Slot index, or MAX_MON if the table is full
+     */
+    inline size_t add(const osThreadId_t handle, const size_t stack_words) {
+      if (!handle || num_handles >= MAX_MON)
+        return MAX_MON;
+      stacks[num_handles]  = stack_words;
+      handles[num_handles] = handle;
+      hal::trace::set_name(hal::trace::Kind::TASK, static_cast<uint8_t>(num_handles), osThreadGetName(handle));
+      return num_handles++;
+    }
   }  // namespace mon
 
   // --- Tick/Time helpers -----------------------------------------------------
@@ -91,15 +109,32 @@ namespace hal::rtos {
   }
 
   struct mutex_t {
-    mutable osMutexId_t handle = nullptr;
+    mutable osMutexId_t handle   = nullptr;
+    uint8_t             trace_id = 0;
+    bool                traced   = false;
 
     mutex_t() {
       handle = osMutexNew(nullptr);
     }
 
+    /**
+     * Mutex whose wait, lock and unlock are recorded in the event trace.
+     *
+     * @param name Name in the trace dump
+     */
+    explicit mutex_t(const char *name) : mutex_t() {
+      trace_id = hal::trace::add_name(hal::trace::Kind::MUTEX, name);
+      traced   = true;
+    }
+
     bool acquire(const uint32_t wait_ms = max_delay_ms) const {
       const uint32_t timeout = (wait_ms == max_delay_ms) ? osWaitForever : wait_ms;
-      return osMutexAcquire(handle, timeout) == osOK;
+      if (traced)
+        hal::trace::record(hal::trace::Event::MUTEX_WAIT, trace_id);
+      const bool ok = osMutexAcquire(handle, timeout) == osOK;
+      if (traced && ok)
+        hal::trace::record(hal::trace::Event::MUTEX_LOCK, trace_id);
+      return ok;
     }
 
     void vAcquire(const uint32_t wait_ms = max_delay_ms) const {
@@ -107,6 +142,8 @@ namespace hal::rtos {
     }
 
     bool release() const {
+      if (traced)
+        hal::trace::record(hal::trace::Event::MUTEX_UNLOCK, trace_id);
       return osMutexRelease(handle) == osOK;
     }
 
@@ -208,11 +245,7 @@ namespace hal::rtos {
       handle = osThreadNew(func, arg, &attr);
       if (handle) {
         created = true;
-        if (mon::num_handles < mon::MAX_MON) {
-          mon::stacks[mon::num_handles]  = StackSizeWords;
-          mon::handles[mon::num_handles] = handle;
-          ++mon::num_handles;
-        }
+        mon::add(handle, StackSizeWords);
       }
     }
 
@@ -250,6 +283,14 @@ namespace hal::rtos {
     return (flags & 0x1u) ? 1u : 0u;  // emulate count==1 on success
   }
 
+  __attribute__((always_inline)) inline void notify(const osThreadId_t thread) {
+    if (thread) { osThreadFlagsSet(thread, 0x1u); }
+  }
+
+  __attribute__((always_inline)) inline void isr_notify(const osThreadId_t thread) {
+    if (thread) { osThreadFlagsSet(thread, 0x1u); }  // ISR-safe per CMSIS-RTOS2
+  }
+
   struct notify_counter {
     osSemaphoreId_t sem = nullptr;
     notify_counter() { sem = osSemaphoreNew(0x7FFFFFFFu, 0, nullptr); }
@@ -368,6 +409,26 @@ namespace hal::rtos {
     }
   }
 
+  /**
+   * Periodic loop that also records its period, execution time and overruns.
+   *
+   * @param interval_ms The interval in milliseconds between consecutive executions of the function.
+   * @param stats Timing statistics of this loop
+   * @param func The callable object (e.g., lambda, function, functor) to be executed periodically.
+   */
+  template<typename Func>
+  [[noreturn]] void interval_loop(const TickType_t interval_ms, loop_stats_t &stats, Func &&func) {
+    const interval_delay delay_until(interval_ms);
+    stats.set_nominal_ms(interval_ms);
+    for (;;) {
+      delay_until([&]() -> void {
+        stats.begin(hal::micros());
+        func();
+        stats.end(hal::micros());
+      });
+    }
+  }
+
   /**
    * Infinite loop that repeatedly executes a given function at specified intervals.
    *
@@ -400,6 +461,30 @@ namespace hal::rtos {
     }
   }
 
+  /**
+   * Variable interval loop that also records its timing, the nominal period follows the interval.
+   *
+   * @param interval_ms The interval duration in milliseconds.
+   * @param next_interval_func Next interval function
+   * @param stats Timing statistics of this loop
+   * @param func The callable object (e.g., lambda, function, functor) to be executed periodically.
+   */
+  template<typename Func, typename RngFunc>
+  [[noreturn]] void interval_loop(const TickType_t interval_ms, RngFunc &&next_interval_func, loop_stats_t &stats, Func &&func) {
+    interval_delay delay_until(interval_ms);
+    stats.set_nominal_ms(interval_ms);
+    for (;;) {
+      delay_until([&]() -> void {
+        stats.begin(hal::micros());
+        func();
+        stats.end(hal::micros());
+      });
+      const uint32_t next_ms = next_interval_func();
+      delay_until.set_interval(next_ms);
+      stats.set_nominal_ms(next_ms);
+    }
+  }
+
   /**
    * Infinite loop that repeatedly executes a given function at specified intervals.
    *
@@ -417,6 +502,26 @@ namespace hal::rtos {
     }
   }
 
+  /**
+   * Loop woken by notifications, e.g. isr_notify() from a data-ready
+   * interrupt, that runs anyway once none came for timeout_ms.
+   *
+   * @param interval_ms Expected period between notifications, the nominal period of stats.
+   * @param timeout_ms Wait before running without a notification.
+   * @param stats Timing statistics of this loop
+   * @param func Called as func(notified), notified is false after a timeout.
+   */
+  template<typename Func>
+  [[noreturn]] void event_loop(const TickType_t interval_ms, const TickType_t timeout_ms, loop_stats_t &stats, Func &&func) {
+    stats.set_nominal_ms(interval_ms);
+    for (;;) {
+      const bool notified = wait_notification(timeout_ms) != 0;
+      stats.begin(hal::micros());
+      func(notified);
+      stats.end(hal::micros());
+    }
+  }
+
   /**
    * Executes a given section of code in a critical region, ensuring that the code
    * is executed with FreeRTOS spinlock and preventing interrupts.
@@ -455,7 +560,9 @@ namespace hal::rtos {
     }
 
     osThreadId_t create(const osThreadFunc_t func, const osThreadAttr_t &attr) {
-      return osThreadNew(func, nullptr, &attr);
+      const osThreadId_t handle = osThreadNew(func, nullptr, &attr);
+      mon::add(handle, attr.stack_size / sizeof(uint32_t));
+      return handle;
     }
   } scheduler;
 }  // namespace hal::rtos
@@ -0,0 +1,461 @@
+#ifndef HAL_SPI_HPP
+#define HAL_SPI_HPP
+
+#include <Arduino.h>
+#include <FastFormat.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "./hal_dma.h"
+#include "./hal_rtos.h"
+
+/**
+ * Asynchronous SPI transactions.
+ *
+ * A sensor read is a pre-built register burst (transaction_t, the command
+ * byte written once at construction). The calling task queues it on the bus
+ * and blocks on a thread flag. The bus runs queued bursts back to back: on
+ * the target by DMA, chip select and the next burst handled from the
+ * completion interrupt. The CPU never spins on the bus and no task lock is
+ * held across a transfer, so the bus is held for one burst at a time.
+ *
+ * On the host (RA_SIM) the same bus completes each burst at once against
+ * mock_device_t register maps, so the drivers' register decoding runs
+ * without hardware.
+ */
+namespace hal::spi {
+  // Thread flag of a finished transaction, apart from hal::rtos::notify()'s 0x1
+  constexpr uint32_t FLAG_DONE = 0x2u;
+
+  enum class ReadCmd : uint8_t {
+    MSB_SET,    // reg | 0x80 (BMP581 and most devices)
+    SHIFT_LSB,  // reg << 1 | 1 (ADXL372)
+  };
+
+  constexpr uint8_t read_cmd(const ReadCmd cmd, const uint8_t reg) {
+    return cmd == ReadCmd::MSB_SET ? static_cast<uint8_t>(reg | 0x80u) : static_cast<uint8_t>((reg << 1) | 0x01u);
+  }
+
+  constexpr uint8_t write_cmd(const ReadCmd cmd, const uint8_t reg) {
+    return cmd == ReadCmd::MSB_SET ? static_cast<uint8_t>(reg & 0x7Fu) : static_cast<uint8_t>(reg << 1);
+  }
+
+  using dma::padded;
+
+  /**
+   * One queued transfer. The buffers belong to the derived burst_t, taken
+   * from hal::dma::pool(): a member array would sit in DTCM with its
+   * object, where DMA cannot reach.
+   */
+  struct transaction_t {
+    uint32_t       cs;
+    const uint8_t *tx;
+    uint8_t       *rx;
+    uint16_t       len;
+
+    osThreadId_t      waiter  = nullptr;
+    transaction_t    *next    = nullptr;
+    uint32_t          t_start = 0;  // us, bus hold
+    std::atomic<bool> pending{false};
+    bool              ok = false;
+
+    transaction_t(const uint32_t cs, const uint8_t *tx, uint8_t *rx, const uint16_t len)
+        : cs(cs), tx(tx), rx(rx), len(len) {}
+
+    transaction_t(const transaction_t &) = delete;
+  };
+
+  /**
+   * Burst read of N registers from reg, the command byte built once.
+   */
+  template<size_t N>
+  struct burst_t : transaction_t {
+    burst_t(const uint32_t cs, const ReadCmd cmd, const uint8_t reg)
+        : transaction_t(cs, dma::pool().alloc(N + 1), dma::pool().alloc(N + 1), static_cast<uint16_t>(N + 1)) {
+      const_cast<uint8_t *>(tx)[0] = read_cmd(cmd, reg);
+    }
+
+    [[nodiscard]] const uint8_t *data() const {
+      return rx + 1;
+    }
+
+    // Clock n bytes after the command from the next transfer on, at most N
+    void resize(const size_t n) {
+      len = static_cast<uint16_t>((n < N ? n : N) + 1);
+    }
+  };
+
+  /**
+   * Burst write of N registers from reg, data() filled before the transfer.
+   */
+  template<size_t N>
+  struct write_t : transaction_t {
+    write_t(const uint32_t cs, const ReadCmd cmd, const uint8_t reg)
+        : transaction_t(cs, dma::pool().alloc(N + 1), dma::pool().alloc(N + 1), static_cast<uint16_t>(N + 1)) {
+      const_cast<uint8_t *>(tx)[0] = write_cmd(cmd, reg);
+    }
+
+    [[nodiscard]] uint8_t *data() {
+      return const_cast<uint8_t *>(tx) + 1;
+    }
+  };
+
+  struct bus_stats_t {
+    uint32_t transfers   = 0;
+    uint32_t bytes       = 0;  // Clocked, command bytes included
+    uint32_t errors      = 0;  // Transfer errors and timeouts
+    uint32_t max_hold_us = 0;  // Chip select low to completion, one burst
+    uint32_t max_wait_us = 0;  // Submit to wake-up, queueing behind other bursts included
+
+    /**
+     * One report line:
+     *   #SPI,<ms>,<name>,<transfers>,<bytes>,<errors>,<max hold>,<max wait>
+     *
+     * @return Line length including LF (no NUL)
+     */
+    size_t write(char *dst, const size_t cap, const char *name, const uint32_t now_ms) const {
+      fast_fmt::csv_writer_t csv(dst, cap);
+      csv << "#SPI" << now_ms << name << transfers << bytes << errors << max_hold_us << max_wait_us;
+      return csv.finish();
+    }
+  };
+
+#if RA_SIM
+  /**
+   * Register map standing in for a device on the host bus. A read burst
+   * copies regs from the start register on (auto-increment), a write burst
+   * stores into it. on_read, if set, refreshes the map first, e.g. with the
+   * next frame of a replay. A burst from fifo_reg does not increment: every
+   * byte comes from fifo_pop, like a device FIFO data port.
+   */
+  struct mock_device_t {
+    uint32_t cs;
+    ReadCmd  cmd;
+    uint8_t  regs[256] = {};
+    void (*on_read)(mock_device_t &dev, uint8_t reg, void *ctx) = nullptr;
+    uint8_t (*fifo_pop)(mock_device_t &dev, void *ctx)          = nullptr;
+    int   fifo_reg                                              = -1;
+    void *ctx                                                   = nullptr;
+
+    mock_device_t(const uint32_t cs, const ReadCmd cmd) : cs(cs), cmd(cmd) {}
+  };
+
+  class bus_t {
+    static constexpr size_t MAX_DEVICES = 8;
+
+    mock_device_t *devices_[MAX_DEVICES] = {};
+    size_t         num_devices_          = 0;
+    bus_stats_t    stats_;
+
+  public:
+    bool begin() {
+      return true;
+    }
+
+    void attach(mock_device_t &dev) {
+      if (num_devices_ < MAX_DEVICES)
+        devices_[num_devices_++] = &dev;
+    }
+
+    /**
+     * Clock t against the attached device with its chip select. Nothing
+     * attached reads back 0xFF like an empty bus.
+     */
+    bool transfer(transaction_t &t, uint32_t /*timeout_ms*/ = 2) {
+      ++stats_.transfers;
+      stats_.bytes += t.len;
+
+      mock_device_t *dev = nullptr;
+      for (size_t i = 0; i < num_devices_; ++i)
+        if (devices_[i]->cs == t.cs)
+          dev = devices_[i];
+
+      if (!dev) {
+        memset(t.rx, 0xFF, t.len);
+        t.ok = true;
+        return true;
+      }
+
+      const uint8_t b    = t.tx[0];
+      const bool    read = dev->cmd == ReadCmd::MSB_SET ? (b & 0x80u) : (b & 0x01u);
+      const uint8_t reg  = dev->cmd == ReadCmd::MSB_SET ? (b & 0x7Fu) : (b >> 1);
+
+      t.rx[0] = 0xFF;
+      if (read && dev->on_read)
+        dev->on_read(*dev, reg, dev->ctx);
+      for (uint16_t i = 1; i < t.len; ++i) {
+        const uint8_t r = static_cast<uint8_t>(reg + i - 1);
+        if (read && reg == dev->fifo_reg && dev->fifo_pop)
+          t.rx[i] = dev->fifo_pop(*dev, dev->ctx);
+        else if (read)
+          t.rx[i] = dev->regs[r];
+        else
+          dev->regs[r] = t.tx[i];
+      }
+
+      t.ok = true;
+      return true;
+    }
+
+    [[nodiscard]] const bus_stats_t &stats() const {
+      return stats_;
+    }
+
+    void reset_stats() {
+      stats_ = {};
+    }
+  };
+#else
+  /**
+   * SPI master on HAL DMA: RX and TX streams through DMAMUX, completion
+   * callback from the DMA interrupts. One mode and clock for every device on
+   * the bus (mode 0; ADXL372 up to 10 MHz, BMP581 up to 12 MHz).
+   */
+  class bus_t {
+  public:
+    struct config_t {
+      SPI_TypeDef        *instance;
+      DMA_Stream_TypeDef *rx_stream;
+      DMA_Stream_TypeDef *tx_stream;
+      uint32_t            rx_request;
+      uint32_t            tx_request;
+      IRQn_Type           rx_irq;
+      IRQn_Type           tx_irq;
+      IRQn_Type           spi_irq;
+      uint32_t            prescaler;
+    };
+
+    SPI_HandleTypeDef spi{};
+    DMA_HandleTypeDef dma_rx{};
+    DMA_HandleTypeDef dma_tx{};
+
+  private:
+    transaction_t *active_ = nullptr;
+    transaction_t *head_   = nullptr;  // Queued behind active_
+    transaction_t *tail_   = nullptr;
+    bus_stats_t    stats_;
+
+    static void clean(const void *p, const size_t n) {
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+      if (SCB->CCR & SCB_CCR_DC_Msk)
+        SCB_CleanDCache_by_Addr(reinterpret_cast<uint32_t *>(const_cast<void *>(p)), static_cast<int32_t>(padded(n)));
+#endif
+    }
+
+    static void invalidate(void *p, const size_t n) {
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+      if (SCB->CCR & SCB_CCR_DC_Msk)
+        SCB_InvalidateDCache_by_Addr(reinterpret_cast<uint32_t *>(p), static_cast<int32_t>(padded(n)));
+#endif
+    }
+
+    // In a critical section or the completion interrupt
+    void start(transaction_t &t) {
+      active_   = &t;
+      t.t_start = micros();
+      clean(t.tx, t.len);
+      invalidate(t.rx, t.len);
+      digitalWrite(t.cs, LOW);
+      if (HAL_SPI_TransmitReceive_DMA(&spi, const_cast<uint8_t *>(t.tx), t.rx, t.len) != HAL_OK)
+        finish(/*ok*/ false);
+    }
+
+    // In a critical section: stop the active burst, raise its chip select and start the next
+    void abort_active() {
+      HAL_SPI_Abort(&spi);
+      digitalWrite(active_->cs, HIGH);
+      active_ = nullptr;
+      start_next();
+    }
+
+    // In a critical section: take t out of the queue behind active_
+    void unlink(transaction_t &t) {
+      transaction_t *prev = nullptr;
+      for (transaction_t *q = head_; q; prev = q, q = q->next) {
+        if (q != &t)
+          continue;
+        (prev ? prev->next : head_) = q->next;
+        if (tail_ == q)
+          tail_ = prev;
+        return;
+      }
+    }
+
+    // In a critical section or the completion interrupt
+    void start_next() {
+      if (transaction_t *next = head_) {
+        head_ = next->next;
+        if (!head_)
+          tail_ = nullptr;
+        start(*next);
+      }
+    }
+
+  public:
+    bool begin(const config_t &cfg) {
+      __HAL_RCC_DMA1_CLK_ENABLE();
+      __HAL_RCC_DMA2_CLK_ENABLE();
+
+      dma_rx.Instance                 = cfg.rx_stream;
+      dma_rx.Init.Request             = cfg.rx_request;
+      dma_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+      dma_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+      dma_rx.Init.MemInc              = DMA_MINC_ENABLE;
+      dma_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+      dma_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+      dma_rx.Init.Mode                = DMA_NORMAL;
+      dma_rx.Init.Priority            = DMA_PRIORITY_HIGH;
+      dma_rx.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+
+      dma_tx                = dma_rx;
+      dma_tx.Instance       = cfg.tx_stream;
+      dma_tx.Init.Request   = cfg.tx_request;
+      dma_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+
+      if (HAL_DMA_Init(&dma_rx) != HAL_OK || HAL_DMA_Init(&dma_tx) != HAL_OK)
+        return false;
+
+      // Takes SPI over from SPIClass once the drivers' begin() are done, pins stay as it set them
+      spi.Instance                      = cfg.instance;
+      spi.Init.Mode                    = SPI_MODE_MASTER;
+      spi.Init.Direction               = SPI_DIRECTION_2LINES;
+      spi.Init.DataSize                = SPI_DATASIZE_8BIT;
+      spi.Init.CLKPolarity             = SPI_POLARITY_LOW;
+      spi.Init.CLKPhase                = SPI_PHASE_1EDGE;
+      spi.Init.NSS                     = SPI_NSS_SOFT;
+      spi.Init.BaudRatePrescaler       = cfg.prescaler;
+      spi.Init.FirstBit                = SPI_FIRSTBIT_MSB;
+      spi.Init.TIMode                  = SPI_TIMODE_DISABLE;
+      spi.Init.CRCCalculation          = SPI_CRCCALCULATION_DISABLE;
+      spi.Init.NSSPMode                = SPI_NSS_PULSE_DISABLE;
+      spi.Init.FifoThreshold           = SPI_FIFO_THRESHOLD_01DATA;
+      spi.Init.MasterKeepIOState       = SPI_MASTER_KEEP_IO_STATE_ENABLE;
+      spi.Init.MasterInterDataIdleness = SPI_MASTER_INTERDATA_IDLENESS_00CYCLE;
+      spi.Init.MasterSSIdleness        = SPI_MASTER_SS_IDLENESS_00CYCLE;
+      if (HAL_SPI_Init(&spi) != HAL_OK)
+        return false;
+
+      __HAL_LINKDMA(&spi, hdmarx, dma_rx);
+      __HAL_LINKDMA(&spi, hdmatx, dma_tx);
+
+      // Below the kernel's syscall priority, the completion interrupt sets thread flags
+      constexpr uint32_t prio = configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 1;
+      for (const IRQn_Type irq : {cfg.rx_irq, cfg.tx_irq, cfg.spi_irq}) {
+        HAL_NVIC_SetPriority(irq, prio, 0);
+        HAL_NVIC_EnableIRQ(irq);
+      }
+      return true;
+    }
+
+    /**
+     * Queue t and block until it has been clocked. On a timeout t is taken
+     * off the bus, aborted if it was being clocked, so a lost completion
+     * costs one burst and the queue behind it goes on.
+     *
+     * @return False on a transfer error, a timeout or buffers DMA cannot reach
+     */
+    bool transfer(transaction_t &t, const uint32_t timeout_ms = 2) {
+      if (t.pending.load(std::memory_order_acquire) || !dma::reachable(t.tx) || !dma::reachable(t.rx)) {
+        ++stats_.errors;
+        return false;
+      }
+
+      const uint32_t t_submit = micros();
+      t.waiter                = osThreadGetId();
+      t.next                  = nullptr;
+      t.ok                    = false;
+      t.pending.store(true, std::memory_order_release);
+      osThreadFlagsClear(FLAG_DONE);
+
+      // Masks the completion interrupt, which pops the queue
+      hal::rtos::critical([&]() -> void {
+        if (!active_)
+          start(t);
+        else if (tail_)
+          tail_ = tail_->next = &t;
+        else
+          head_ = tail_ = &t;
+      });
+
+      const uint32_t flags = osThreadFlagsWait(FLAG_DONE, osFlagsWaitAny, timeout_ms);
+      if ((flags & osFlagsError) || t.pending.load(std::memory_order_acquire)) {
+        bool timed_out = false;
+        hal::rtos::critical([&]() -> void {
+          if (!t.pending.load(std::memory_order_acquire))
+            return;  // Completed since the wait gave up
+          timed_out = true;
+          if (active_ == &t)
+            abort_active();
+          else
+            unlink(t);
+          t.pending.store(false, std::memory_order_release);
+        });
+        if (timed_out) {
+          ++stats_.errors;
+          return false;
+        }
+      }
+
+      const uint32_t wait = micros() - t_submit;
+      if (wait > stats_.max_wait_us)
+        stats_.max_wait_us = wait;
+      return t.ok;
+    }
+
+    /**
+     * End the active burst and start the next queued one, from the HAL
+     * completion and error callbacks.
+     */
+    void finish(const bool ok) {
+      transaction_t *t = active_;
+      if (!t)
+        return;
+
+      digitalWrite(t->cs, HIGH);
+      invalidate(t->rx, t->len);
+
+      const uint32_t hold = micros() - t->t_start;
+      if (hold > stats_.max_hold_us)
+        stats_.max_hold_us = hold;
+      ++stats_.transfers;
+      stats_.bytes += t->len;
+      if (!ok)
+        ++stats_.errors;
+
+      t->ok = ok;
+      t->pending.store(false, std::memory_order_release);
+      if (t->waiter)
+        osThreadFlagsSet(t->waiter, FLAG_DONE);
+
+      active_ = nullptr;
+      start_next();
+    }
+
+    [[nodiscard]] const bus_stats_t &stats() const {
+      return stats_;
+    }
+
+    void reset_stats() {
+      stats_ = {};
+    }
+  };
+#endif
+
+  // Bus of both flight sensors
+  inline bus_t spi1;
+
+#if RA_SIM
+  inline bool begin_spi1() {
+    return spi1.begin();
+  }
+#else
+  /**
+   * Take SPI1 over from SPIClass, after the drivers' begin() (DMA streams and
+   * interrupts in src/spi_dma.cpp)
+   */
+  bool begin_spi1();
+#endif
+}  // namespace hal::spi
+
+#endif  //HAL_SPI_HPP
@@ -19,6 +19,23 @@ namespace hal {
   inline void delay_us(const uint32_t n) {
     delayMicroseconds(n);
   }
+
+  /**
+   * Start the DWT cycle counter (CPU clock, wraps every 2^32 cycles).
+   */
+  inline void enable_cycle_counter() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(DWT_LAR_UNLOCK)
+    DWT->LAR = DWT_LAR_UNLOCK;
+#else
+    DWT->LAR = 0xC5ACCE55u;  // Cortex-M7 DWT write unlock
+#endif
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+
+  __attribute__((always_inline)) inline uint32_t cycles() {
+    return DWT->CYCCNT;
+  }
 }  // namespace hal
 
 #endif  //HAL_TIMING_HPP
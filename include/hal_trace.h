@@ -0,0 +1,175 @@
+#ifndef HAL_TRACE_HPP
+#define HAL_TRACE_HPP
+
+#include "./hal_timing.h"
+#include <TraceEvent.h>
+#include <cstring>
+
+/**
+ * In-RAM event trace (flight recorder).
+ *
+ * record() stores an 8-byte timestamped event into a static ring with
+ * interrupts masked for a handful of instructions, so it is safe from tasks,
+ * ISRs and the kernel switch hook. The ring lives in .bss, which this board's
+ * linker script places in DTCM.
+ *
+ * The ring overwrites the oldest events until trigger() is called; after that
+ * it records a fixed number of further events and freezes, keeping the window
+ * around the trigger for a post-flight dump().
+ */
+namespace hal::trace {
+  using ::trace::Event;
+  using ::trace::Kind;
+
+  constexpr size_t MAX_NAMES = 64;
+
+  namespace detail {
+    inline ::trace::event_t *buf        = nullptr;
+    inline uint32_t          mask       = 0;
+    inline uint32_t          head       = 0;  // Events recorded so far
+    inline uint32_t          stop_at    = UINT32_MAX;
+    inline uint32_t          trigger_at = UINT32_MAX;
+    inline bool              paused     = false;
+
+    inline ::trace::name_t names[MAX_NAMES];
+    inline size_t          num_names = 0;
+    inline uint8_t         next_id[static_cast<size_t>(Kind::MARK) + 1] = {};
+  }  // namespace detail
+
+  /**
+   * Start tracing into a static buffer.
+   *
+   * @tparam N Number of events (power of two)
+   */
+  template<size_t N>
+  void init(::trace::event_t (&storage)[N]) {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Trace capacity must be a power of two");
+    detail::mask       = N - 1;
+    detail::head       = 0;
+    detail::stop_at    = UINT32_MAX;
+    detail::trigger_at = UINT32_MAX;
+    detail::buf        = storage;
+    hal::enable_cycle_counter();
+  }
+
+  __attribute__((always_inline)) inline void record(const Event type, const uint8_t id = 0, const uint16_t arg = 0) {
+    if (!detail::buf)
+      return;
+
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint32_t idx = detail::head;
+    if (idx != detail::stop_at && !detail::paused) {
+      ::trace::event_t &e = detail::buf[idx & detail::mask];
+      e.cycles            = hal::cycles();
+      e.type              = type;
+      e.id                = id;
+      e.arg               = arg;
+      detail::head        = idx + 1;
+    }
+    __set_PRIMASK(primask);
+  }
+
+  /**
+   * Freeze the ring after `post_events` more events. Only the first call counts.
+   */
+  inline void trigger(const uint32_t post_events) {
+    if (!detail::buf || detail::trigger_at != UINT32_MAX)
+      return;
+    record(Event::TRIGGER);
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    detail::trigger_at = detail::head - 1;
+    detail::stop_at    = detail::head + post_events;
+    __set_PRIMASK(primask);
+  }
+
+  [[nodiscard]] inline bool frozen() {
+    return detail::head == detail::stop_at;
+  }
+
+  /**
+   * Give an id a name for the dump.
+   */
+  inline void set_name(const Kind kind, const uint8_t id, const char *name) {
+    if (detail::num_names >= MAX_NAMES || !name)
+      return;
+    ::trace::name_t &n = detail::names[detail::num_names++];
+    n.kind             = kind;
+    n.id               = id;
+    strncpy(n.name, name, sizeof(n.name) - 1);
+    n.name[sizeof(n.name) - 1] = '\0';
+  }
+
+  /**
+   * Allocate the next id of a kind and name it.
+   *
+   * @return Id to pass to record()
+   */
+  inline uint8_t add_name(const Kind kind, const char *name) {
+    const uint8_t id = detail::next_id[static_cast<uint8_t>(kind)]++;
+    set_name(kind, id, name);
+    return id;
+  }
+
+  /**
+   * Records BEGIN on construction and END (BEGIN + 1) on destruction.
+   */
+  struct scope_t {
+    Event   begin;
+    uint8_t id;
+
+    scope_t(const Event begin, const uint8_t id, const uint16_t arg = 0) : begin(begin), id(id) {
+      record(begin, id, arg);
+    }
+
+    ~scope_t() {
+      record(static_cast<Event>(static_cast<uint8_t>(begin) + 1), id);
+    }
+  };
+
+  /**
+   * Write the trace: header, names, then events oldest first.
+   * Recording is paused meanwhile.
+   *
+   * @param write Callable write(const void *data, size_t len)
+   */
+  template<typename Write>
+  void dump(Write &&write) {
+    if (!detail::buf)
+      return;
+
+    detail::paused = true;
+
+    const uint32_t capacity = detail::mask + 1;
+    const uint32_t head     = detail::head;
+    const uint32_t count    = head < capacity ? head : capacity;
+    const uint32_t first    = head - count;
+
+    ::trace::dump_header_t header{};
+    memcpy(header.magic, ::trace::dump_header_t::MAGIC, sizeof(header.magic));
+    header.version       = ::trace::dump_header_t::VERSION;
+    header.cpu_hz        = SystemCoreClock;
+    header.num_events    = count;
+    header.num_names     = detail::num_names;
+    header.total_events  = head;
+    header.trigger_index = detail::trigger_at >= first && detail::trigger_at < head
+                             ? detail::trigger_at - first
+                             : UINT32_MAX;
+    header.dump_ms       = millis();
+
+    write(&header, sizeof(header));
+    write(detail::names, detail::num_names * sizeof(::trace::name_t));
+
+    // At most two contiguous runs
+    const uint32_t start = first & detail::mask;
+    const uint32_t run   = start + count <= capacity ? count : capacity - start;
+    write(detail::buf + start, run * sizeof(::trace::event_t));
+    if (run < count)
+      write(detail::buf, (count - run) * sizeof(::trace::event_t));
+
+    detail::paused = false;
+  }
+}  // namespace hal::trace
+
+#endif  //HAL_TRACE_HPP
@@ -0,0 +1,329 @@
+#ifndef HAL_UART_HPP
+#define HAL_UART_HPP
+
+#include <Arduino.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "./hal_dma.h"
+#include "./hal_rtos.h"
+
+/**
+ * UART reception into a ring, without an interrupt per byte.
+ *
+ * Circular DMA writes the received bytes into a static ring on its own.
+ * Interrupts only come at the ring's half and end and on the idle line
+ * after each burst: each publishes how far the DMA got, stamps it and
+ * wakes the task that claimed the ring. The task reads the bytes where they
+ * lie, up to the last published position. Positions run free and wrap at
+ * 2^32, a byte's index in the ring is its position mod SIZE.
+ *
+ * On the host (RA_SIM) feed() stands in for the DMA and the idle line, for
+ * the simulated devices.
+ */
+namespace hal::uart {
+  /**
+   * The ring, and what the interrupts published about it.
+   */
+  class ring_t {
+  public:
+    static constexpr size_t SIZE = 4096;
+
+  protected:
+    // A published position and when
+    struct mark_t {
+      uint32_t pos;
+      uint32_t t_us;
+    };
+
+    static constexpr uint32_t NUM_MARKS = 8;
+
+    // From the DMA pool like hal::spi buffers: a member array would be in DTCM
+    uint8_t *buf_ = dma::pool().alloc(SIZE);
+
+    std::atomic<osThreadId_t> task_{nullptr};
+    std::atomic<uint32_t>     head_{0};
+    std::atomic<uint32_t>     valid_from_{0};
+    std::atomic<uint32_t>     seq_{0};
+    mark_t                    marks_[NUM_MARKS] = {};
+
+    // Receive event: the bytes up to pos are in the ring
+    void publish(const uint32_t pos) {
+      const uint32_t seq      = seq_.load(std::memory_order_relaxed);
+      marks_[seq % NUM_MARKS] = {pos, hal::micros()};
+      seq_.store(seq + 1, std::memory_order_release);
+      head_.store(pos, std::memory_order_release);
+      rtos::isr_notify(task_.load(std::memory_order_acquire));
+    }
+
+    // Reception starts over: what the ring holds before pos is stale
+    void resync(const uint32_t pos) {
+      valid_from_.store(pos, std::memory_order_release);
+      publish(pos);
+    }
+
+  public:
+    ring_t() = default;
+
+    ring_t(const ring_t &) = delete;
+
+    /**
+     * Make the calling task the one each receive event wakes.
+     */
+    void claim() {
+      task_.store(osThreadGetId(), std::memory_order_release);
+    }
+
+    [[nodiscard]] const uint8_t (&data() const)[SIZE] {
+      return *reinterpret_cast<const uint8_t(*)[SIZE]>(buf_);
+    }
+
+    /**
+     * Bytes before this position are not the ones received: reception
+     * restarted after an error or a baud rate change.
+     */
+    [[nodiscard]] uint32_t valid_from() const {
+      return valid_from_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * When the byte before end was first published: the receive event the
+     * reader could first have seen it at. Events older than the last
+     * NUM_MARKS give the oldest kept.
+     */
+    [[nodiscard]] uint32_t received_us(const uint32_t end) const {
+      uint32_t seq, t_us;
+      do {
+        seq  = seq_.load(std::memory_order_acquire);
+        t_us = 0;
+        for (uint32_t k = 1; k <= NUM_MARKS && k <= seq; ++k) {
+          const mark_t &m = marks_[(seq - k) % NUM_MARKS];
+          if (static_cast<int32_t>(m.pos - end) < 0)
+            break;
+          t_us = m.t_us;
+        }
+      } while (seq != seq_.load(std::memory_order_acquire));
+      return t_us;
+    }
+  };
+
+#if RA_SIM
+  /**
+   * Host UART: what the device writes arrives through feed(), what is
+   * written to the device is dropped.
+   */
+  class rx_t : public ring_t {
+    uint32_t baud_ = 0;
+
+  public:
+    bool begin(const uint32_t baud) {
+      baud_ = baud;
+      resync(head_.load(std::memory_order_relaxed));
+      return true;
+    }
+
+    bool set_baud(const uint32_t baud) {
+      return begin(baud);
+    }
+
+    bool write(const uint8_t *, size_t, uint32_t /*timeout_ms*/ = 100) {
+      return baud_ != 0;
+    }
+
+    // Bytes stay visible to the CPU, nothing to do
+    [[nodiscard]] uint32_t head() {
+      return head_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * The device sent n bytes: into the ring as the DMA would, then the
+     * idle line's event. Call from an interrupt, e.g. a sim::gpio_edge_at()
+     * handler.
+     */
+    void feed(const uint8_t *data, const size_t n) {
+      uint32_t pos = head_.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < n; ++i)
+        buf_[pos++ % SIZE] = data[i];
+      publish(pos);
+    }
+  };
+#else
+  /**
+   * UART on HAL with its RX on a circular DMA stream (ReceiveToIdle), the
+   * event callbacks publish. TX, for configuring the device, is blocking.
+   */
+  class rx_t : public ring_t {
+  public:
+    struct config_t {
+      USART_TypeDef      *instance;
+      DMA_Stream_TypeDef *rx_stream;
+      uint32_t            rx_request;
+      IRQn_Type           dma_irq;
+      IRQn_Type           uart_irq;
+      uint32_t            tx_pin;
+      uint32_t            rx_pin;
+    };
+
+    UART_HandleTypeDef uart{};
+    DMA_HandleTypeDef  dma_rx{};
+
+  private:
+    uint32_t index_  = 0;  // DMA's index at the last event, interrupt side
+    uint32_t pos_    = 0;  // Its position
+    uint32_t seen_   = 0;  // Reader side, bytes made visible to the CPU
+    uint32_t errors_ = 0;  // Line errors
+    bool     begun_  = false;
+
+    static void invalidate(const void *p, const size_t n) {
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+      if (SCB->CCR & SCB_CCR_DC_Msk) {
+        const auto a = reinterpret_cast<uintptr_t>(p) & ~uintptr_t{31u};
+        const auto e = reinterpret_cast<uintptr_t>(p) + n;
+        SCB_InvalidateDCache_by_Addr(reinterpret_cast<uint32_t *>(a), static_cast<int32_t>(e - a));
+      }
+#endif
+    }
+
+    // The DMA starts over from index 0, at the next position that maps there
+    bool start() {
+      index_ = 0;
+      pos_   = (head_.load(std::memory_order_relaxed) + SIZE - 1) & ~static_cast<uint32_t>(SIZE - 1);
+      resync(pos_);
+      return HAL_UARTEx_ReceiveToIdle_DMA(&uart, buf_, SIZE) == HAL_OK;
+    }
+
+  public:
+    bool begin(const config_t &cfg, const uint32_t baud) {
+      if (!dma::reachable(buf_))
+        return false;  // DMA would end in a transfer error, and restart into it forever
+
+      __HAL_RCC_DMA1_CLK_ENABLE();
+
+      // Pins to the UART's alternate function, the caller enabled its clock
+      pinmap_pinout(digitalPinToPinName(cfg.tx_pin), PinMap_UART_TX);
+      pinmap_pinout(digitalPinToPinName(cfg.rx_pin), PinMap_UART_RX);
+
+      dma_rx.Instance                 = cfg.rx_stream;
+      dma_rx.Init.Request             = cfg.rx_request;
+      dma_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+      dma_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+      dma_rx.Init.MemInc              = DMA_MINC_ENABLE;
+      dma_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+      dma_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+      dma_rx.Init.Mode                = DMA_CIRCULAR;
+      dma_rx.Init.Priority            = DMA_PRIORITY_MEDIUM;
+      dma_rx.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+      if (HAL_DMA_Init(&dma_rx) != HAL_OK)
+        return false;
+
+      uart.Instance                    = cfg.instance;
+      uart.Init.BaudRate               = baud;
+      uart.Init.WordLength             = UART_WORDLENGTH_8B;
+      uart.Init.StopBits               = UART_STOPBITS_1;
+      uart.Init.Parity                 = UART_PARITY_NONE;
+      uart.Init.Mode                   = UART_MODE_TX_RX;
+      uart.Init.HwFlowCtl              = UART_HWCONTROL_NONE;
+      uart.Init.OverSampling           = UART_OVERSAMPLING_16;
+      uart.Init.OneBitSampling         = UART_ONE_BIT_SAMPLE_DISABLE;
+      uart.Init.ClockPrescaler         = UART_PRESCALER_DIV1;
+      uart.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+      if (HAL_UART_Init(&uart) != HAL_OK)
+        return false;
+      __HAL_LINKDMA(&uart, hdmarx, dma_rx);
+
+      // Below the kernel's syscall priority, the event callback wakes the reader
+      constexpr uint32_t prio = configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 2;
+      for (const IRQn_Type irq : {cfg.dma_irq, cfg.uart_irq}) {
+        HAL_NVIC_SetPriority(irq, prio, 0);
+        HAL_NVIC_EnableIRQ(irq);
+      }
+      begun_ = true;
+      return start();
+    }
+
+    /**
+     * Switch the baud rate, reception restarts.
+     */
+    bool set_baud(const uint32_t baud) {
+      if (!begun_)
+        return false;
+      HAL_UART_Abort(&uart);
+      uart.Init.BaudRate = baud;
+      return HAL_UART_Init(&uart) == HAL_OK && start();
+    }
+
+    /**
+     * Blocking write to the device, from a task.
+     */
+    bool write(const uint8_t *data, const size_t n, const uint32_t timeout_ms = 100) {
+      return begun_ && HAL_UART_Transmit(&uart, const_cast<uint8_t *>(data), static_cast<uint16_t>(n), timeout_ms) == HAL_OK;
+    }
+
+    /**
+     * End of the bytes published so far, made visible to the CPU: the DMA
+     * wrote them behind the data cache.
+     */
+    [[nodiscard]] uint32_t head() {
+      const uint32_t head = head_.load(std::memory_order_acquire);
+      uint32_t       n    = head - seen_;
+      if (n > SIZE)
+        n = SIZE;
+
+      const size_t i     = (head - n) % SIZE;
+      const size_t first = SIZE - i < n ? SIZE - i : n;
+      invalidate(buf_ + i, first);
+      if (n > first)
+        invalidate(buf_, n - first);
+      seen_ = head;
+      return head;
+    }
+
+    /**
+     * Receive event from HAL_UARTEx_RxEventCallback: the DMA is at index
+     * (SIZE at the end of the ring). Events come at least every half ring,
+     * so the distance from the last one is unambiguous.
+     */
+    void event(const uint16_t index) {
+      const uint32_t i = index % SIZE;
+      pos_ += (i - index_) % SIZE;
+      index_ = i;
+      publish(pos_);
+    }
+
+    /**
+     * From HAL_UART_ErrorCallback. Framing, noise and parity errors leave
+     * the circular DMA running and are only counted. An overrun or a DMA
+     * error stops reception (RxState back to READY) and it starts over,
+     * aborted first if HAL refuses. Should that fail too, the GNSS stops
+     * reading and its restart sets the baud again.
+     */
+    void error() {
+      ++errors_;
+      if (uart.RxState != HAL_UART_STATE_READY)
+        return;
+      if (!start() && HAL_UART_AbortReceive(&uart) == HAL_OK)
+        start();
+    }
+
+    [[nodiscard]] uint32_t errors() const {
+      return errors_;
+    }
+  };
+#endif
+
+  // GNSS receiver
+  inline rx_t usart2;
+
+#if RA_SIM
+  inline bool begin_usart2(const uint32_t baud) {
+    return usart2.begin(baud);
+  }
+#else
+  /**
+   * USART2 on its pins and DMA (src/uart_dma.cpp)
+   */
+  bool begin_usart2(uint32_t baud);
+#endif
+}  // namespace hal::uart
+
+#endif  //HAL_UART_HPP
@@ -18,6 +18,7 @@
 // ---------------------------------------------------------
 
 #include "lib_xcore"
+#include "FastFormat.h"
 #include <Arduino.h>
 #include <SPI.h>
 #include <Wire.h>
@@ -216,7 +217,15 @@ namespace detail {
 
     template<typename T>
     csv_stream &operator<<(T &&value) {
-      m_string += xcore::forward<T>(value);
+      using U = std::remove_cv_t<std::remove_reference_t<T>>;
+      if constexpr (std::is_arithmetic_v<U> || std::is_same_v<U, fast_fmt::fixed_t>) {
+        // Numbers skip String's printf-based conversion
+        char buf[fast_fmt::max_chars];
+        buf[fast_fmt::write(buf, value)] = '\0';
+        m_string += buf;
+      } else {
+        m_string += xcore::forward<T>(value);
+      }
       m_string += ",";
       return *this;
     }
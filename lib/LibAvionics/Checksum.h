@@ -0,0 +1,44 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_CHECKSUM_H
+#define ROCKET_AVIONICS_TEMPLATE_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace checksum {
+  namespace detail {
+    struct crc16_table_t {
+      uint16_t v[256];
+
+      constexpr crc16_table_t() : v() {
+        for (uint32_t i = 0; i < 256; ++i) {
+          uint16_t crc = static_cast<uint16_t>(i << 8);
+          for (int b = 0; b < 8; ++b)
+            crc = (crc & 0x8000u) ? static_cast<uint16_t>((crc << 1) ^ 0x1021u) : static_cast<uint16_t>(crc << 1);
+          v[i] = crc;
+        }
+      }
+    };
+
+    inline constexpr crc16_table_t crc16_table{};
+  }  // namespace detail
+
+  /**
+   * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection, no xor-out).
+   *
+   * @param data Pointer to the bytes
+   * @param len Number of bytes
+   * @param crc Running CRC value, used to continue a previous computation
+   * @return CRC value
+   */
+  constexpr uint16_t crc16_ccitt(const uint8_t *data, const size_t len, uint16_t crc = 0xFFFFu) {
+    for (size_t i = 0; i < len; ++i)
+      crc = static_cast<uint16_t>((crc << 8) ^ detail::crc16_table.v[((crc >> 8) ^ data[i]) & 0xFFu]);
+    return crc;
+  }
+
+  inline uint16_t crc16_ccitt(const void *data, const size_t len, const uint16_t crc = 0xFFFFu) {
+    return crc16_ccitt(static_cast<const uint8_t *>(data), len, crc);
+  }
+}  // namespace checksum
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_CHECKSUM_H
@@ -0,0 +1,88 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_DECIMATOR_H
+#define ROCKET_AVIONICS_TEMPLATE_DECIMATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Integer decimation of raw sensor codes, no multiplies: a CIC
+ * (cascaded integrator-comb) filter, Order moving sums of Ratio samples in
+ * one. Its sinc^Order response nulls every multiple of the output rate, so
+ * what would alias onto low frequencies is suppressed before downsampling.
+ *
+ * The sums run in wrapping unsigned arithmetic, exact as long as the output
+ * (input bits + Order * log2(Ratio)) fits in 32 bits.
+ */
+namespace dsp {
+  template<size_t Channels, size_t Order = 2>
+  class cic_decimator_t {
+    uint32_t ratio_;
+    uint32_t phase_                  = 0;
+    uint32_t filled_                 = 0;  // Outputs since reset, up to Order
+    uint32_t integ_[Order][Channels] = {};
+    uint32_t comb_[Order][Channels]  = {};
+
+  public:
+    explicit constexpr cic_decimator_t(const uint32_t ratio) : ratio_(ratio ? ratio : 1) {}
+
+    [[nodiscard]] constexpr uint32_t ratio() const {
+      return ratio_;
+    }
+
+    // Output per unit input, out / gain() is in input units
+    [[nodiscard]] constexpr uint32_t gain() const {
+      uint32_t g = 1;
+      for (size_t i = 0; i < Order; ++i)
+        g *= ratio_;
+      return g;
+    }
+
+    // Group delay in input samples, from the newest input to the output's centre
+    [[nodiscard]] constexpr float delay() const {
+      return static_cast<float>(Order * (ratio_ - 1)) * 0.5f;
+    }
+
+    void reset() {
+      phase_  = 0;
+      filled_ = 0;
+      for (size_t i = 0; i < Order; ++i)
+        for (size_t c = 0; c < Channels; ++c)
+          integ_[i][c] = comb_[i][c] = 0;
+    }
+
+    /**
+     * Take one input sample.
+     *
+     * @return True with out set on every Ratio-th sample, from the first
+     * whose window lies entirely after reset()
+     */
+    bool push(const int32_t (&in)[Channels], int32_t (&out)[Channels]) {
+      for (size_t c = 0; c < Channels; ++c) {
+        uint32_t v = static_cast<uint32_t>(in[c]);
+        for (size_t i = 0; i < Order; ++i)
+          v = integ_[i][c] += v;
+      }
+
+      if (++phase_ < ratio_)
+        return false;
+      phase_ = 0;
+
+      for (size_t c = 0; c < Channels; ++c) {
+        uint32_t v = integ_[Order - 1][c];
+        for (size_t i = 0; i < Order; ++i) {
+          const uint32_t prev = comb_[i][c];
+          comb_[i][c]         = v;
+          v -= prev;
+        }
+        out[c] = static_cast<int32_t>(v);
+      }
+
+      // Outputs before the Order-th average in the zeros before the first input
+      if (filled_ < Order)
+        ++filled_;
+      return filled_ == Order;
+    }
+  };
+}  // namespace dsp
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_DECIMATOR_H
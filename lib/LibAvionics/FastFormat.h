@@ -0,0 +1,317 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_FASTFORMAT_H
+#define ROCKET_AVIONICS_TEMPLATE_FASTFORMAT_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Allocation-free number formatting into caller-provided buffers.
+ *
+ * Floats are printed in fixed point with a given number of decimals, rounded
+ * half away from zero. Values that fit 32 bits once scaled (e.g. |v| < 4.2e7
+ * at 2 decimals) take a pure 32-bit integer path, larger ones a 64-bit path.
+ * Nothing goes through printf. Output matches "%.*f" except on exact ties,
+ * for negative zero ("0.00", not "-0.00") and in the last digit once
+ * |v| * 10^decimals exceeds about 1e14.
+ */
+namespace fast_fmt {
+  constexpr uint8_t max_decimals = 9;
+
+  // Longest output of any writer below, including sign and NUL
+  constexpr size_t max_chars = 32;
+
+  namespace detail {
+    constexpr uint32_t pow10_u32[max_decimals + 1] = {
+      1ul, 10ul, 100ul, 1000ul, 10000ul, 100000ul, 1000000ul, 10000000ul, 100000000ul, 1000000000ul};
+
+    constexpr double pow10_f64[max_decimals + 1] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+    constexpr char digit_pairs[201] =
+      "00010203040506070809"
+      "10111213141516171819"
+      "20212223242526272829"
+      "30313233343536373839"
+      "40414243444546474849"
+      "50515253545556575859"
+      "60616263646566676869"
+      "70717273747576777879"
+      "80818283848586878889"
+      "90919293949596979899";
+
+    // Write v right-aligned ending at `end`, returns start pointer
+    inline char *write_backwards(char *end, uint32_t v) {
+      while (v >= 100) {
+        const uint32_t r = v % 100;
+        v /= 100;
+        end -= 2;
+        memcpy(end, digit_pairs + 2 * r, 2);
+      }
+      if (v >= 10) {
+        end -= 2;
+        memcpy(end, digit_pairs + 2 * v, 2);
+      } else {
+        *--end = static_cast<char>('0' + v);
+      }
+      return end;
+    }
+
+    // Exactly n digits of v (zero-padded), right-aligned ending at `end`
+    inline char *write_padded(char *end, uint32_t v, uint8_t n) {
+      while (n >= 2) {
+        const uint32_t r = v % 100;
+        v /= 100;
+        end -= 2;
+        memcpy(end, digit_pairs + 2 * r, 2);
+        n -= 2;
+      }
+      if (n)
+        *--end = static_cast<char>('0' + v % 10);
+      return end;
+    }
+
+    inline size_t copy_out(char *dst, const char *begin, const char *end) {
+      const size_t n = static_cast<size_t>(end - begin);
+      memcpy(dst, begin, n);
+      return n;
+    }
+  }  // namespace detail
+
+  /**
+   * @return Number of chars written (no NUL), at most 10
+   */
+  inline size_t write_u32(char *dst, const uint32_t v) {
+    char  tmp[12];
+    char *end = tmp + sizeof(tmp);
+    return detail::copy_out(dst, detail::write_backwards(end, v), end);
+  }
+
+  /**
+   * @return Number of chars written (no NUL), at most 11
+   */
+  inline size_t write_i32(char *dst, const int32_t v) {
+    if (v < 0) {
+      *dst = '-';
+      return 1 + write_u32(dst + 1, 0u - static_cast<uint32_t>(v));
+    }
+    return write_u32(dst, static_cast<uint32_t>(v));
+  }
+
+  /**
+   * @return Number of chars written (no NUL), at most 20
+   */
+  inline size_t write_u64(char *dst, uint64_t v) {
+    if (v <= UINT32_MAX)
+      return write_u32(dst, static_cast<uint32_t>(v));
+
+    // Split into 32-bit chunks of 9 digits, only two 64-bit divisions
+    char  tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *p   = end;
+    p         = detail::write_padded(p, static_cast<uint32_t>(v % 1000000000ull), 9);
+    v /= 1000000000ull;
+    if (v > UINT32_MAX) {
+      p = detail::write_padded(p, static_cast<uint32_t>(v % 1000000000ull), 9);
+      v /= 1000000000ull;
+    }
+    p = detail::write_backwards(p, static_cast<uint32_t>(v));
+    return detail::copy_out(dst, p, end);
+  }
+
+  inline size_t write_i64(char *dst, const int64_t v) {
+    if (v < 0) {
+      *dst = '-';
+      return 1 + write_u64(dst + 1, 0ull - static_cast<uint64_t>(v));
+    }
+    return write_u64(dst, static_cast<uint64_t>(v));
+  }
+
+  /**
+   * Fixed-point float, e.g. write_fixed(buf, -3.14159, 2) -> "-3.14".
+   * NaN and infinities print as "nan", "inf", "-inf"; magnitudes beyond
+   * 1.8e19 / 10^decimals print as "ovf".
+   *
+   * @param dst At least max_chars bytes
+   * @param v Value
+   * @param decimals Digits after the point, clamped to max_decimals
+   * @return Number of chars written (no NUL)
+   */
+  inline size_t write_fixed(char *dst, const double v, uint8_t decimals) {
+    if (decimals > max_decimals)
+      decimals = max_decimals;
+
+    if (std::isnan(v)) {
+      memcpy(dst, "nan", 3);
+      return 3;
+    }
+
+    const bool   neg = std::signbit(v);
+    const double a   = neg ? -v : v;
+    if (std::isinf(a)) {
+      const char  *s = neg ? "-inf" : "inf";
+      const size_t n = neg ? 4 : 3;
+      memcpy(dst, s, n);
+      return n;
+    }
+
+    const double scaled = a * detail::pow10_f64[decimals] + 0.5;
+    char         tmp[max_chars];
+    char *const  end = tmp + sizeof(tmp);
+    char        *p;
+
+    if (scaled < 4294967296.0) {
+      const uint32_t u    = static_cast<uint32_t>(scaled);
+      const uint32_t div  = detail::pow10_u32[decimals];
+      const uint32_t ip   = u / div;
+      const uint32_t frac = u - ip * div;
+      p                   = end;
+      if (decimals) {
+        p    = detail::write_padded(p, frac, decimals);
+        *--p = '.';
+      }
+      p = detail::write_backwards(p, ip);
+      if (neg && u)
+        *--p = '-';
+    } else if (scaled < 18446744073709551616.0) {
+      const uint64_t u    = static_cast<uint64_t>(scaled);
+      const uint64_t div  = detail::pow10_u32[decimals];
+      const uint64_t ip   = u / div;
+      const uint32_t frac = static_cast<uint32_t>(u - ip * div);
+      p                   = end;
+      if (decimals) {
+        p    = detail::write_padded(p, frac, decimals);
+        *--p = '.';
+      }
+      char         ibuf[24];
+      const size_t n = write_u64(ibuf, ip);
+      p -= n;
+      memcpy(p, ibuf, n);
+      if (neg)
+        *--p = '-';
+    } else {
+      memcpy(dst, "ovf", 3);
+      return 3;
+    }
+
+    return detail::copy_out(dst, p, end);
+  }
+
+  /**
+   * Value tagged with its decimal places, for stream-style writers.
+   */
+  struct fixed_t {
+    double  value;
+    uint8_t decimals;
+  };
+
+  constexpr fixed_t fixed(const double value, const uint8_t decimals) {
+    return {value, decimals};
+  }
+
+  /**
+   * Write any supported value, floats use `decimals`.
+   *
+   * @param dst At least max_chars bytes
+   * @return Number of chars written (no NUL)
+   */
+  template<typename T>
+  size_t write(char *dst, const T &v, const uint8_t decimals = 2) {
+    using U = std::remove_cv_t<std::remove_reference_t<T>>;
+    if constexpr (std::is_same_v<U, fixed_t>) {
+      return write_fixed(dst, v.value, v.decimals);
+    } else if constexpr (std::is_same_v<U, bool>) {
+      *dst = v ? '1' : '0';
+      return 1;
+    } else if constexpr (std::is_same_v<U, char>) {
+      *dst = v;
+      return 1;
+    } else if constexpr (std::is_floating_point_v<U>) {
+      return write_fixed(dst, static_cast<double>(v), decimals);
+    } else if constexpr (std::is_enum_v<U>) {
+      return write(dst, static_cast<std::underlying_type_t<U>>(v), decimals);
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+      return sizeof(U) <= 4 ? write_i32(dst, static_cast<int32_t>(v)) : write_i64(dst, static_cast<int64_t>(v));
+    } else if constexpr (std::is_integral_v<U>) {
+      return sizeof(U) <= 4 ? write_u32(dst, static_cast<uint32_t>(v)) : write_u64(dst, static_cast<uint64_t>(v));
+    } else {
+      static_assert(!sizeof(U), "Unsupported type");
+      return 0;
+    }
+  }
+
+  /**
+   * CSV record writer over a caller-provided buffer, no allocation.
+   *
+   * Fields are comma separated; finish() drops the trailing comma, adds the
+   * optional LF and NUL-terminates. Output that does not fit is cut at the
+   * last whole field and overflow() is set.
+   */
+  class csv_writer_t {
+    char   *buf_;
+    size_t  cap_;
+    size_t  len_      = 0;
+    uint8_t decimals_ = 2;
+    bool    overflow_ = false;
+
+    void put(const char *src, const size_t n) {
+      if (overflow_ || len_ + n + 1 >= cap_) {  // Keep room for the separator/NUL
+        overflow_ = true;
+        return;
+      }
+      memcpy(buf_ + len_, src, n);
+      len_ += n;
+      buf_[len_++] = ',';
+    }
+
+  public:
+    /**
+     * @param buf Destination
+     * @param cap Destination size in bytes
+     * @param decimals Default decimal places for floats
+     */
+    csv_writer_t(char *buf, const size_t cap, const uint8_t decimals = 2)
+        : buf_(buf), cap_(cap), decimals_(decimals) {}
+
+    csv_writer_t &operator<<(const char *str) {
+      put(str, strlen(str));
+      return *this;
+    }
+
+    template<typename T>
+    csv_writer_t &operator<<(const T &v) {
+      char         tmp[max_chars];
+      const size_t n = write(tmp, v, decimals_);
+      put(tmp, n);
+      return *this;
+    }
+
+    /**
+     * Terminate the record.
+     *
+     * @param newline Append LF
+     * @return Record length in bytes (no NUL)
+     */
+    size_t finish(const bool newline = true) {
+      if (len_ && buf_[len_ - 1] == ',')
+        --len_;
+      if (newline && len_ + 1 < cap_)
+        buf_[len_++] = '\n';
+      if (cap_)
+        buf_[len_ < cap_ ? len_ : cap_ - 1] = '\0';
+      return len_;
+    }
+
+    [[nodiscard]] size_t size() const {
+      return len_;
+    }
+
+    [[nodiscard]] bool overflow() const {
+      return overflow_;
+    }
+  };
+}  // namespace fast_fmt
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_FASTFORMAT_H
@@ -24,11 +24,24 @@ namespace isa76 {
     return (Re * H) / (Re - H);
   }
 
-  inline double geopotential_from_pressure(double p_Pa, double qnh_Pa) {
-    // Scale all base pressures so sea-level matches QNH
-    double       Pb[N];
-    const double k = qnh_Pa / 101325.0;
-    for (int i = 0; i < N; ++i) Pb[i] = Pb_std[i] * k;
+  /**
+   * Layer base pressures scaled so sea level matches QNH, computed once per
+   * QNH instead of on every sample.
+   */
+  struct qnh_t {
+    double Pb[N] = {};
+    double qnh_Pa;
+    float  inv_qnh_Pa;
+
+    explicit constexpr qnh_t(const double qnh = 101325.0)
+        : qnh_Pa(qnh), inv_qnh_Pa(static_cast<float>(1.0 / qnh)) {
+      const double k = qnh / 101325.0;
+      for (int i = 0; i < N; ++i) Pb[i] = Pb_std[i] * k;
+    }
+  };
+
+  inline double geopotential_from_pressure(double p_Pa, const qnh_t &qnh) {
+    const double *Pb = qnh.Pb;
 
     // Below/above sea level handling:
     if (p_Pa > Pb[0]) {
@@ -58,6 +71,85 @@ namespace isa76 {
       return H;
     }
   }
+
+  inline double geopotential_from_pressure(double p_Pa, double qnh_Pa) {
+    return geopotential_from_pressure(p_Pa, qnh_t(qnh_Pa));
+  }
+
+  /**
+   * Float troposphere kernel: H = T0/L ((p/QNH)^e - 1), e = -Rd L/g0, from a
+   * cubic per 1/64 of p/QNH in [0.25, 1.25), fitted to the value and slope
+   * of the exact curve at both ends (Hermite) at compile time. Covers
+   * 300-1100 hPa for QNH 950-1050 hPa; max error against the double formula
+   * is MAX_ERROR_M (checked over every float pressure by isa76_check).
+   */
+  namespace fast {
+    constexpr double X_MIN       = 0.25;
+    constexpr double X_MAX       = 1.25;
+    constexpr int    SEGMENTS    = 64;
+    constexpr float  MAX_ERROR_M = 0.005f;
+
+    constexpr double E       = -(Rd * Lb[0]) / g0;
+    constexpr double H_SCALE = Tb[0] / Lb[0];
+
+    namespace detail {
+      // ln x = 2 atanh((x - 1)/(x + 1)), x in the table range
+      constexpr double ln(const double x) {
+        const double z = (x - 1.0) / (x + 1.0), z2 = z * z;
+        double       term = z, sum = 0.0;
+        for (int k = 1; k < 200; k += 2) {
+          sum += term / k;
+          term *= z2;
+        }
+        return 2.0 * sum;
+      }
+
+      constexpr double exp(const double y) {
+        double term = 1.0, sum = 1.0;
+        for (int k = 1; k < 40; ++k) {
+          term *= y / k;
+          sum += term;
+        }
+        return sum;
+      }
+
+      // x^E - 1 and its slope
+      constexpr double f(const double x) {
+        return exp(E * ln(x)) - 1.0;
+      }
+
+      constexpr double df(const double x) {
+        return E * exp(E * ln(x)) / x;
+      }
+
+      struct table_t {
+        float c[SEGMENTS][4] = {};
+
+        constexpr table_t() {
+          constexpr double h = (X_MAX - X_MIN) / SEGMENTS;
+          for (int i = 0; i < SEGMENTS; ++i) {
+            const double x0 = X_MIN + h * i, x1 = x0 + h;
+            const double f0 = f(x0), f1 = f(x1), d0 = h * df(x0), d1 = h * df(x1);
+            c[i][0] = static_cast<float>(f0);
+            c[i][1] = static_cast<float>(d0);
+            c[i][2] = static_cast<float>(3.0 * (f1 - f0) - 2.0 * d0 - d1);
+            c[i][3] = static_cast<float>(2.0 * (f0 - f1) + d0 + d1);
+          }
+        }
+      };
+
+      constexpr table_t table;
+    }  // namespace detail
+
+    // x = p/QNH in [X_MIN, X_MAX)
+    inline float geopotential_troposphere(const float x) {
+      const float  t = (x - static_cast<float>(X_MIN)) * static_cast<float>(SEGMENTS / (X_MAX - X_MIN));
+      const int    i = static_cast<int>(t);
+      const float  u = t - static_cast<float>(i);
+      const float *c = detail::table.c[i];
+      return static_cast<float>(H_SCALE) * (c[0] + u * (c[1] + u * (c[2] + u * c[3])));
+    }
+  }  // namespace fast
 }  // namespace isa76
 
 // Altitude above Mean Sea Level (meters) from static pressure (hPa) and QNH (hPa).
@@ -70,4 +162,17 @@ inline double altitude_msl_from_pressure(const double p_hpa,
   return isa76::geo_from_geopot(H);
 }
 
+// Same in float for a precomputed QNH: the table kernel in the troposphere, the exact formula elsewhere.
+inline float altitude_msl_from_pressure_fast(const float p_hpa, const isa76::qnh_t &qnh) noexcept {
+  const float p = std::max(0.1f, p_hpa) * 100.0f;
+  const float x = p * qnh.inv_qnh_Pa;
+
+  if (x >= static_cast<float>(isa76::fast::X_MIN) && x < static_cast<float>(isa76::fast::X_MAX)) {
+    constexpr float Re = static_cast<float>(isa76::Re);
+    const float     H  = isa76::fast::geopotential_troposphere(x);
+    return (Re * H) / (Re - H);
+  }
+  return static_cast<float>(isa76::geo_from_geopot(isa76::geopotential_from_pressure(p, qnh)));
+}
+
 #endif  //ROCKET_AVIONICS_TEMPLATE_ISA76_H
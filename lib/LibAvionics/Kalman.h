@@ -0,0 +1,826 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_KALMAN_H
+#define ROCKET_AVIONICS_TEMPLATE_KALMAN_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Fixed-size Kalman filter templated on the scalar type, so the estimator
+ * can run in float on the Cortex-M7 single-precision FPU.
+ *
+ * Same shape and constructor order as the xcore filters it stands in for:
+ * it keeps references to F, H, Q and R, so the owner regenerates F (and
+ * adapts R) in place. No heap, no exceptions, header only.
+ */
+namespace kalman {
+  template<typename T, size_t Rows, size_t Cols = Rows>
+  struct matrix_t {
+    T m[Rows][Cols]{};
+
+    constexpr T *operator[](const size_t r) {
+      return m[r];
+    }
+
+    constexpr const T *operator[](const size_t r) const {
+      return m[r];
+    }
+
+    static constexpr matrix_t diagonals(const T v) {
+      matrix_t out{};
+      for (size_t i = 0; i < Rows && i < Cols; ++i)
+        out.m[i][i] = v;
+      return out;
+    }
+  };
+
+  template<typename T, size_t N>
+  struct vector_t {
+    T v[N]{};
+
+    constexpr vector_t() = default;
+
+    // Converting, so {acc} works whatever the caller's precision
+    template<typename... U, std::enable_if_t<sizeof...(U) == N && (std::is_arithmetic_v<U> && ...), int> = 0>
+    constexpr vector_t(const U... u) : v{static_cast<T>(u)...} {}
+
+    constexpr T &operator[](const size_t i) {
+      return v[i];
+    }
+
+    constexpr const T &operator[](const size_t i) const {
+      return v[i];
+    }
+  };
+
+  namespace detail {
+    // C = A B^T when TransB, else C = A B
+    template<bool TransB, typename T, size_t R, size_t K, size_t C, size_t BR, size_t BC>
+    constexpr matrix_t<T, R, C> mul(const matrix_t<T, R, K> &a, const matrix_t<T, BR, BC> &b) {
+      matrix_t<T, R, C> out{};
+      for (size_t i = 0; i < R; ++i)
+        for (size_t j = 0; j < C; ++j) {
+          T s{};
+          for (size_t k = 0; k < K; ++k)
+            s += a.m[i][k] * (TransB ? b.m[j][k] : b.m[k][j]);
+          out.m[i][j] = s;
+        }
+      return out;
+    }
+
+    template<typename T, size_t R, size_t K, size_t C>
+    constexpr matrix_t<T, R, C> mul(const matrix_t<T, R, K> &a, const matrix_t<T, K, C> &b) {
+      return mul<false, T, R, K, C>(a, b);
+    }
+
+    template<typename T, size_t R, size_t K, size_t C>
+    constexpr matrix_t<T, R, C> mul_t(const matrix_t<T, R, K> &a, const matrix_t<T, C, K> &b) {
+      return mul<true, T, R, K, C>(a, b);
+    }
+
+    template<typename T, size_t R, size_t C>
+    constexpr vector_t<T, R> mul(const matrix_t<T, R, C> &a, const vector_t<T, C> &x) {
+      vector_t<T, R> out{};
+      for (size_t i = 0; i < R; ++i) {
+        T s{};
+        for (size_t k = 0; k < C; ++k)
+          s += a.m[i][k] * x.v[k];
+        out.v[i] = s;
+      }
+      return out;
+    }
+
+    template<typename U, typename T, size_t R, size_t C>
+    constexpr matrix_t<U, R, C> cast(const matrix_t<T, R, C> &a) {
+      matrix_t<U, R, C> out{};
+      for (size_t i = 0; i < R; ++i)
+        for (size_t j = 0; j < C; ++j)
+          out.m[i][j] = static_cast<U>(a.m[i][j]);
+      return out;
+    }
+
+    /**
+     * Inverse of a small SPD matrix, Gauss-Jordan with partial pivoting.
+     *
+     * @return False if singular (out untouched)
+     */
+    template<typename T, size_t N>
+    constexpr bool invert(const matrix_t<T, N> &a, matrix_t<T, N> &out) {
+      if constexpr (N == 1) {
+        if (a.m[0][0] == T{})
+          return false;
+        out.m[0][0] = T{1} / a.m[0][0];
+        return true;
+      } else {
+        matrix_t<T, N> l = a;
+        matrix_t<T, N> r = matrix_t<T, N>::diagonals(T{1});
+        for (size_t c = 0; c < N; ++c) {
+          size_t p = c;
+          for (size_t i = c + 1; i < N; ++i)
+            if (std::abs(l.m[i][c]) > std::abs(l.m[p][c]))
+              p = i;
+          if (l.m[p][c] == T{})
+            return false;
+          for (size_t j = 0; j < N; ++j) {
+            std::swap(l.m[c][j], l.m[p][j]);
+            std::swap(r.m[c][j], r.m[p][j]);
+          }
+          const T d = T{1} / l.m[c][c];
+          for (size_t j = 0; j < N; ++j) {
+            l.m[c][j] *= d;
+            r.m[c][j] *= d;
+          }
+          for (size_t i = 0; i < N; ++i) {
+            if (i == c)
+              continue;
+            const T f = l.m[i][c];
+            for (size_t j = 0; j < N; ++j) {
+              l.m[i][j] -= f * l.m[c][j];
+              r.m[i][j] -= f * r.m[c][j];
+            }
+          }
+        }
+        out = r;
+        return true;
+      }
+    }
+  }  // namespace detail
+
+  /**
+   * Transition matrix of an Order-th order kinematic chain (position,
+   * velocity, acceleration, ...) over a variable dt: F[i][j] = dt^(j-i)/(j-i)!.
+   */
+  template<typename T, size_t Order>
+  class vdt_t {
+    T dt_;
+
+  public:
+    explicit constexpr vdt_t(const double dt) : dt_(static_cast<T>(dt)) {}
+
+    constexpr void update_dt(const double dt) {
+      dt_ = static_cast<T>(dt);
+    }
+
+    [[nodiscard]] constexpr T dt() const {
+      return dt_;
+    }
+
+    [[nodiscard]] constexpr matrix_t<T, Order + 1> generate_F() const {
+      matrix_t<T, Order + 1> f{};
+      for (size_t i = 0; i <= Order; ++i) {
+        T term = T{1};
+        for (size_t j = i; j <= Order; ++j) {
+          f.m[i][j] = term;
+          term      = term * dt_ / static_cast<T>(j - i + 1);
+        }
+      }
+      return f;
+    }
+
+    /**
+     * Process noise of white noise with spectral density q on the highest
+     * derivative over dt: Q[i][j] = q dt^k / ((O-i)! (O-j)! k), k = 2 O + 1 - i - j.
+     */
+    [[nodiscard]] constexpr matrix_t<T, Order + 1> generate_Q(const double q) const {
+      const auto fact = [](size_t n) -> double {
+        double f = 1.;
+        for (; n > 1; --n)
+          f *= static_cast<double>(n);
+        return f;
+      };
+
+      matrix_t<T, Order + 1> out{};
+      for (size_t i = 0; i <= Order; ++i)
+        for (size_t j = 0; j <= Order; ++j) {
+          const size_t k   = 2 * Order + 1 - i - j;
+          double       dtk = 1.;
+          for (size_t n = 0; n < k; ++n)
+            dtk *= static_cast<double>(dt_);
+          out.m[i][j] = static_cast<T>(q * dtk / (fact(Order - i) * fact(Order - j) * static_cast<double>(k)));
+        }
+      return out;
+    }
+  };
+
+  /**
+   * vdt_t's F and white-jerk Q for dt = i * step, i < Count, built at compile
+   * time so a changing step is a lookup instead of a discretization.
+   */
+  template<typename T, size_t Order, size_t Count>
+  struct discretization_table_t {
+    struct entry_t {
+      matrix_t<T, Order + 1> F;
+      matrix_t<T, Order + 1> Q;
+    };
+
+    static constexpr size_t size = Count;
+
+    entry_t entries[Count] = {};
+
+    constexpr discretization_table_t(const double step, const double q) {
+      for (size_t i = 0; i < Count; ++i) {
+        const vdt_t<T, Order> vdt(static_cast<double>(i) * step);
+        entries[i] = {vdt.generate_F(), vdt.generate_Q(q)};
+      }
+    }
+
+    [[nodiscard]] constexpr const entry_t &operator[](const size_t i) const {
+      return entries[i];
+    }
+  };
+
+  /**
+   * Kalman filter with robust innovation-adaptive noise (R-IAE).
+   *
+   * After each update the post-fit residual e = z - H x+ and the innovation
+   * y, both clipped to tau standard deviations, adapt
+   *   R <- (1 - alpha) R + alpha (e e^T + H P+ H^T)   (alpha > 0)
+   *   Q <- (1 - beta)  Q + beta  (K y y^T K^T)        (beta > 0)
+   * with the diagonals kept at or above eps; both terms are positive
+   * semi-definite, so R and Q cannot collapse. alpha = beta = 0 is the plain
+   * filter. P is symmetrized every update so it stays positive definite in
+   * float.
+   */
+  template<typename T, size_t N, size_t M>
+  class r_iae_filter_t {
+  public:
+    using state_t       = vector_t<T, N>;
+    using measurement_t = vector_t<T, M>;
+
+  private:
+    const matrix_t<T, N>    &F_;
+    const matrix_t<T, M, N> &H_;
+    matrix_t<T, N>          &Q_;
+    matrix_t<T, M>          &R_;
+
+    state_t        x_;
+    matrix_t<T, N> P_;
+
+    T alpha_, beta_, tau_, eps_;
+
+    static constexpr T clip(const T v, const T lim) {
+      return v > lim ? lim : (v < -lim ? -lim : v);
+    }
+
+  public:
+    r_iae_filter_t(const matrix_t<T, N>    &F,
+                   const matrix_t<T, M, N> &H,
+                   matrix_t<T, N>          &Q,
+                   matrix_t<T, M>          &R,
+                   const state_t           &x0,
+                   const matrix_t<T, N>    &P0,
+                   const double             alpha,
+                   const double             beta,
+                   const double             tau,
+                   const double             eps)
+      : F_(F), H_(H), Q_(Q), R_(R), x_(x0), P_(P0),
+        alpha_(static_cast<T>(alpha)), beta_(static_cast<T>(beta)),
+        tau_(static_cast<T>(tau)), eps_(static_cast<T>(eps)) {}
+
+    void predict() {
+      x_ = detail::mul(F_, x_);
+
+      matrix_t<T, N> p = detail::mul_t(detail::mul(F_, P_), F_);
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+          P_.m[i][j] = p.m[i][j] + Q_.m[i][j];
+    }
+
+    void update(const measurement_t &z) {
+      using detail::mul;
+      using detail::mul_t;
+
+      // Innovation y and its covariance S = H P H^T + R
+      measurement_t y  = z;
+      const auto    hx = mul(H_, x_);
+      for (size_t i = 0; i < M; ++i)
+        y.v[i] -= hx.v[i];
+
+      const matrix_t<T, N, M> pht = mul_t(P_, H_);
+      matrix_t<T, M>          s   = mul(H_, pht);
+      for (size_t i = 0; i < M; ++i)
+        for (size_t j = 0; j < M; ++j)
+          s.m[i][j] += R_.m[i][j];
+
+      matrix_t<T, M> s_inv{};
+      if (!detail::invert(s, s_inv))
+        return;
+
+      const matrix_t<T, N, M> k = mul(pht, s_inv);
+
+      if (beta_ > T{}) {
+        measurement_t yc = y;
+        for (size_t i = 0; i < M; ++i)
+          yc.v[i] = clip(yc.v[i], tau_ * std::sqrt(s.m[i][i]));
+        const auto ky = mul(k, yc);
+        for (size_t i = 0; i < N; ++i)
+          for (size_t j = 0; j < N; ++j)
+            Q_.m[i][j] = (T{1} - beta_) * Q_.m[i][j] + beta_ * ky.v[i] * ky.v[j];
+        for (size_t i = 0; i < N; ++i)
+          Q_.m[i][i] = Q_.m[i][i] < eps_ ? eps_ : Q_.m[i][i];
+      }
+
+      // x += K y, P -= K H P (= K pht^T), symmetrized
+      const auto dx = mul(k, y);
+      for (size_t i = 0; i < N; ++i)
+        x_.v[i] += dx.v[i];
+
+      const matrix_t<T, N> khp = mul_t(k, pht);
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = i; j < N; ++j) {
+          const T v  = T{0.5} * ((P_.m[i][j] - khp.m[i][j]) + (P_.m[j][i] - khp.m[j][i]));
+          P_.m[i][j] = v;
+          P_.m[j][i] = v;
+        }
+
+      if (alpha_ > T{}) {
+        measurement_t e   = z;
+        const auto    hx1 = mul(H_, x_);
+        const auto    hph = mul(H_, mul_t(P_, H_));
+        for (size_t i = 0; i < M; ++i)
+          e.v[i] = clip(e.v[i] - hx1.v[i], tau_ * std::sqrt(R_.m[i][i]));
+        for (size_t i = 0; i < M; ++i)
+          for (size_t j = 0; j < M; ++j)
+            R_.m[i][j] = (T{1} - alpha_) * R_.m[i][j] + alpha_ * (e.v[i] * e.v[j] + hph.m[i][j]);
+        for (size_t i = 0; i < M; ++i)
+          R_.m[i][i] = R_.m[i][i] < eps_ ? eps_ : R_.m[i][i];
+      }
+    }
+
+    /**
+     * Restart from a known state and covariance, e.g. a steady-state
+     * filter handing over
+     */
+    void reset(const state_t &x, const matrix_t<T, N> &P) {
+      x_ = x;
+      P_ = P;
+    }
+
+    [[nodiscard]] T state() const {
+      return x_.v[0];
+    }
+
+    [[nodiscard]] const state_t &state_vector() const {
+      return x_;
+    }
+
+    [[nodiscard]] const matrix_t<T, N> &covariance() const {
+      return P_;
+    }
+  };
+
+  /**
+   * R-IAE filter for a selection measurement H = [I 0] (measurement i is
+   * state i), with P in packed symmetric storage: N(N+1)/2 values instead
+   * of N^2.
+   *
+   * Measurements are fused one at a time (sequential update), so each is a
+   * scalar innovation and a division, no inversion; with one measurement this
+   * is the same filter as r_iae_filter_t. With more, R is taken as diagonal
+   * and each R[i][i] (and Q) adapts on its own measurement's residual.
+   * update_state() fuses one measurement of any state on its own, for
+   * sensors arriving at different rates.
+   */
+  template<typename T, size_t N, size_t M>
+  class r_iae_packed_filter_t {
+    static_assert(M <= N, "Selection H measures the first M states");
+
+  public:
+    using state_t       = vector_t<T, N>;
+    using measurement_t = vector_t<T, M>;
+
+    static constexpr size_t PACKED = N * (N + 1) / 2;
+
+  private:
+    const matrix_t<T, N> &F_;
+    matrix_t<T, N>       &Q_;
+    matrix_t<T, M>       &R_;
+
+    state_t x_;
+    T       P_[PACKED];  // Upper triangle, row by row
+
+    T alpha_, beta_, tau_, eps_;
+
+    // Index of P[i][j] in P_, i <= j
+    static constexpr size_t at(const size_t i, const size_t j) {
+      return i * (2 * N - i + 1) / 2 + (j - i);
+    }
+
+    static constexpr size_t sym(const size_t i, const size_t j) {
+      return i <= j ? at(i, j) : at(j, i);
+    }
+
+    static constexpr T clip(const T v, const T lim) {
+      return v > lim ? lim : (v < -lim ? -lim : v);
+    }
+
+  public:
+    r_iae_packed_filter_t(const matrix_t<T, N> &F,
+                          matrix_t<T, N>       &Q,
+                          matrix_t<T, M>       &R,
+                          const state_t        &x0,
+                          const matrix_t<T, N> &P0,
+                          const double          alpha,
+                          const double          beta,
+                          const double          tau,
+                          const double          eps)
+      : F_(F), Q_(Q), R_(R), x_(x0),
+        alpha_(static_cast<T>(alpha)), beta_(static_cast<T>(beta)),
+        tau_(static_cast<T>(tau)), eps_(static_cast<T>(eps)) {
+      reset(x0, P0);
+    }
+
+    void predict() {
+      x_ = detail::mul(F_, x_);
+
+      // P = F P F^T + Q, upper triangle only
+      T p[N][N];
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = i; j < N; ++j)
+          p[i][j] = p[j][i] = P_[at(i, j)];
+
+      T fp[N][N];
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j) {
+          T acc{};
+          for (size_t k = 0; k < N; ++k)
+            acc += F_.m[i][k] * p[k][j];
+          fp[i][j] = acc;
+        }
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = i; j < N; ++j) {
+          T acc = Q_.m[i][j];
+          for (size_t k = 0; k < N; ++k)
+            acc += fp[i][k] * F_.m[j][k];
+          P_[at(i, j)] = acc;
+        }
+    }
+
+    void update(const measurement_t &z) {
+      for (size_t m = 0; m < M; ++m)
+        update_state(m, m, z.v[m]);
+    }
+
+    /**
+     * Scalar update measuring one state, with the noise R[channel][channel].
+     * Lets measurements that arrive on their own (or measure any state, not
+     * only the first M) be fused as they come.
+     */
+    void update_state(const size_t state, const size_t channel, const T z) {
+      // Innovation and its variance, P H^T is column state of P
+      const T y = z - x_.v[state];
+      const T s = P_[sym(state, state)] + R_.m[channel][channel];
+      if (s == T{})
+        return;
+
+      T c[N], k[N];
+      for (size_t i = 0; i < N; ++i) {
+        c[i] = P_[sym(i, state)];
+        k[i] = c[i] / s;
+      }
+
+      if (beta_ > T{}) {
+        const T yc = clip(y, tau_ * std::sqrt(s));
+        for (size_t i = 0; i < N; ++i)
+          for (size_t j = 0; j < N; ++j)
+            Q_.m[i][j] = (T{1} - beta_) * Q_.m[i][j] + beta_ * (k[i] * yc) * (k[j] * yc);
+        for (size_t i = 0; i < N; ++i)
+          Q_.m[i][i] = Q_.m[i][i] < eps_ ? eps_ : Q_.m[i][i];
+      }
+
+      // x += k y, P -= k c^T
+      for (size_t i = 0; i < N; ++i)
+        x_.v[i] += k[i] * y;
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = i; j < N; ++j)
+          P_[at(i, j)] -= k[i] * c[j];
+
+      if (alpha_ > T{}) {
+        T      &r_ii = R_.m[channel][channel];
+        const T e    = clip(z - x_.v[state], tau_ * std::sqrt(r_ii));
+        const T r    = (T{1} - alpha_) * r_ii + alpha_ * (e * e + P_[sym(state, state)]);
+        r_ii         = r < eps_ ? eps_ : r;
+      }
+    }
+
+    void reset(const state_t &x, const matrix_t<T, N> &P) {
+      x_ = x;
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = i; j < N; ++j)
+          P_[at(i, j)] = T{0.5} * (P.m[i][j] + P.m[j][i]);
+    }
+
+    [[nodiscard]] T state() const {
+      return x_.v[0];
+    }
+
+    [[nodiscard]] const state_t &state_vector() const {
+      return x_;
+    }
+
+    [[nodiscard]] matrix_t<T, N> covariance() const {
+      matrix_t<T, N> out{};
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+          out.m[i][j] = P_[sym(i, j)];
+      return out;
+    }
+  };
+
+  template<typename T, size_t N, size_t M>
+  struct steady_state_t {
+    matrix_t<T, N, M> K;      // Gain
+    matrix_t<T, N>    P;      // Covariance after an update
+    matrix_t<T, M>    S_inv;  // Inverse innovation covariance
+    size_t            iterations = 0;
+    bool              converged  = false;
+  };
+
+  /**
+   * Iterate the discrete Riccati equation from P0 until the gain settles,
+   * for steps predicts per update (F^steps, Q summed over the steps).
+   * Always solved in double and rounded to T once; constexpr, so fixed F, Q
+   * and R can be solved at compile time.
+   */
+  template<typename T, size_t N, size_t M>
+  constexpr steady_state_t<T, N, M> solve_steady_state(const matrix_t<T, N>    &F,
+                                                       const matrix_t<T, M, N> &H,
+                                                       const matrix_t<T, N>    &Q,
+                                                       const matrix_t<T, M>    &R,
+                                                       const matrix_t<T, N>    &P0,
+                                                       const size_t             steps          = 1,
+                                                       const size_t             max_iterations = 100000) {
+    using detail::mul;
+    using detail::mul_t;
+
+    const matrix_t<double, N>    f1 = detail::cast<double>(F);
+    const matrix_t<double, M, N> h  = detail::cast<double>(H);
+    const matrix_t<double, M>    r  = detail::cast<double>(R);
+
+    // F^steps and Q accumulated the way that many predicts add it
+    matrix_t<double, N> f = matrix_t<double, N>::diagonals(1.);
+    matrix_t<double, N> q{};
+    for (size_t i = 0; i < steps; ++i) {
+      f = mul(f1, f);
+      q = mul_t(mul(f1, q), f1);
+      for (size_t a = 0; a < N; ++a)
+        for (size_t b = 0; b < N; ++b)
+          q.m[a][b] += static_cast<double>(Q.m[a][b]);
+    }
+
+    matrix_t<double, N>    p = detail::cast<double>(P0);
+    matrix_t<double, N, M> k{}, k_last{};
+    matrix_t<double, M>    s_inv{};
+
+    steady_state_t<T, N, M> out{};
+    for (size_t it = 1; it <= max_iterations; ++it) {
+      matrix_t<double, N> pp = mul_t(mul(f, p), f);
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+          pp.m[i][j] += q.m[i][j];
+
+      const matrix_t<double, N, M> pht = mul_t(pp, h);
+      matrix_t<double, M>          s   = mul(h, pht);
+      for (size_t i = 0; i < M; ++i)
+        for (size_t j = 0; j < M; ++j)
+          s.m[i][j] += r.m[i][j];
+      if (!detail::invert(s, s_inv))
+        return out;
+
+      k_last = k;
+      k      = mul(pht, s_inv);
+
+      const matrix_t<double, N> khp = mul_t(k, pht);
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+          p.m[i][j] = pp.m[i][j] - khp.m[i][j];
+
+      double delta = 0;
+      for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < M; ++j) {
+          const double d  = k.m[i][j] - k_last.m[i][j];
+          const double ad = d < 0 ? -d : d;
+          const double ak = k.m[i][j] < 0 ? -k.m[i][j] : k.m[i][j];
+          delta           = ad / (1. + ak) > delta ? ad / (1. + ak) : delta;
+        }
+
+      out.iterations = it;
+      if (it > 1 && delta < 1e-12) {
+        out.converged = true;
+        break;
+      }
+    }
+
+    out.K     = detail::cast<T>(k);
+    out.P     = detail::cast<T>(p);
+    out.S_inv = detail::cast<T>(s_inv);
+    return out;
+  }
+
+  /**
+   * Steady-state (constant gain) filter with fallback to the full R-IAE
+   * filter.
+   *
+   * solve() precomputes the gains at setup, for the nominal predicts per
+   * update and one either side, at the F, Q and R of the time: the solve
+   * costs thousands of Riccati iterations, too many for a sensor loop.
+   * Starts on the full filter. Once its normalized innovation y^T S^-1 y
+   * (running mean, 1 when the model holds) has stayed under nis_limit for
+   * hold updates, it switches to the gain for the predicts seen since the
+   * last update. From then on a predict is x = F x and an update x += K y.
+   * It falls back to the full filter, started from the steady state and
+   * covariance, when
+   *   - F no longer has the dt the gains were solved for (loop jitter),
+   *   - an update comes after a count of predicts no gain was solved for, or
+   *   - the mean normalized innovation exceeds nis_limit (e.g. at ignition,
+   *     or once R-IAE has moved R far from the R solved for),
+   * and comes back the same way. Without solve() it stays on the full
+   * filter.
+   */
+  template<typename T, size_t N, size_t M>
+  class steady_state_filter_t {
+  public:
+    using state_t       = vector_t<T, N>;
+    using measurement_t = vector_t<T, M>;
+
+  private:
+    static constexpr T      NIS_WEIGHT = T{1} / T{16};
+    static constexpr size_t GAINS      = 3;  // Nominal predicts per update and one either side
+
+    const matrix_t<T, N>    &F_;
+    const matrix_t<T, M, N> &H_;
+    const matrix_t<T, N>    &Q_;
+    const matrix_t<T, M>    &R_;
+
+    r_iae_filter_t<T, N, M> full_;
+    steady_state_t<T, N, M> gains_[GAINS]{};
+
+    state_t  x_;
+    T        dt_  = T{};  // F[0][1] the gains were solved for
+    T        nis_ = T{1};  // Running mean
+    T        nis_limit_;
+    uint32_t hold_;
+    uint32_t first_steps_ = 1;  // Predicts per update of gains_[0]
+    size_t   ss_          = 0;  // Gain in use
+    uint32_t predicts_    = 0;  // Since the last update
+    uint32_t in_bounds_ = 0;
+    uint32_t fallbacks_ = 0;
+    bool     fallback_  = true;
+
+    /**
+     * Hand over to the full filter at x_, with the last update's covariance
+     * taken through the predicts made since (F P F^T + Q each, at the current
+     * F), so the next update weighs its measurement against that.
+     */
+    void enter_fallback(const uint32_t predicts) {
+      matrix_t<T, N> p = gains_[ss_].P;
+      for (uint32_t k = 0; k < predicts; ++k) {
+        p = detail::mul_t(detail::mul(F_, p), F_);
+        for (size_t i = 0; i < N; ++i)
+          for (size_t j = 0; j < N; ++j)
+            p.m[i][j] += Q_.m[i][j];
+      }
+
+      fallback_  = true;
+      in_bounds_ = 0;
+      ++fallbacks_;
+      full_.reset(x_, p);
+    }
+
+    // Index in gains_ of the converged gain for steps predicts per update at the current F, or GAINS
+    [[nodiscard]] size_t gain(const uint32_t steps) const {
+      if (F_.m[0][1] != dt_ || steps < first_steps_ || steps - first_steps_ >= GAINS)
+        return GAINS;
+      const size_t i = steps - first_steps_;
+      return gains_[i].converged ? i : GAINS;
+    }
+
+    measurement_t innovation(const measurement_t &z, const state_t &x) const {
+      measurement_t y  = z;
+      const auto    hx = detail::mul(H_, x);
+      for (size_t i = 0; i < M; ++i)
+        y.v[i] -= hx.v[i];
+      return y;
+    }
+
+    static T nis(const measurement_t &y, const matrix_t<T, M> &s_inv) {
+      T out{};
+      for (size_t i = 0; i < M; ++i)
+        for (size_t j = 0; j < M; ++j)
+          out += y.v[i] * s_inv.m[i][j] * y.v[j];
+      return out;
+    }
+
+    void update_full(const measurement_t &z, const uint32_t steps) {
+      // NIS against the full filter's own S = H P H^T + R
+      matrix_t<T, M> s = detail::mul_t(detail::mul(H_, full_.covariance()), H_);
+      for (size_t i = 0; i < M; ++i)
+        for (size_t j = 0; j < M; ++j)
+          s.m[i][j] += R_.m[i][j];
+      matrix_t<T, M> s_inv{};
+      const T        nis_now = detail::invert(s, s_inv) ? nis(innovation(z, full_.state_vector()), s_inv) : nis_limit_;
+
+      full_.update(z);
+
+      nis_       = (T{1} - NIS_WEIGHT) * nis_ + NIS_WEIGHT * nis_now;
+      in_bounds_ = nis_ < nis_limit_ ? in_bounds_ + 1 : 0;
+      if (in_bounds_ < hold_)
+        return;
+
+      if (const size_t i = gain(steps); i < GAINS) {
+        ss_       = i;
+        fallback_ = false;
+        x_        = full_.state_vector();
+      }
+    }
+
+  public:
+    steady_state_filter_t(const matrix_t<T, N>    &F,
+                          const matrix_t<T, M, N> &H,
+                          matrix_t<T, N>          &Q,
+                          matrix_t<T, M>          &R,
+                          const state_t           &x0,
+                          const matrix_t<T, N>    &P0,
+                          const double             alpha,
+                          const double             beta,
+                          const double             tau,
+                          const double             eps,
+                          const double             nis_limit,
+                          const uint32_t           hold)
+      : F_(F), H_(H), Q_(Q), R_(R),
+        full_(F, H, Q, R, x0, P0, alpha, beta, tau, eps),
+        x_(x0), nis_limit_(static_cast<T>(nis_limit)), hold_(hold) {}
+
+    /**
+     * Solve the gains for nominal_steps predicts per update and one either
+     * side, at the current F, Q and R, from the full filter's covariance.
+     * At setup, after F is set. Returns whether the nominal gain converged
+     * within max_iterations.
+     */
+    bool solve(const uint32_t nominal_steps, const size_t max_iterations = 4096) {
+      first_steps_ = nominal_steps > 1 ? nominal_steps - 1 : 1;
+      dt_          = F_.m[0][1];
+      for (size_t i = 0; i < GAINS; ++i)
+        gains_[i] = solve_steady_state(F_, H_, Q_, R_, full_.covariance(), first_steps_ + i, max_iterations);
+      return gain(nominal_steps) < GAINS;
+    }
+
+    void predict() {
+      if (!fallback_ && F_.m[0][1] != dt_)
+        enter_fallback(predicts_);
+
+      ++predicts_;
+      if (fallback_)
+        full_.predict();
+      else
+        x_ = detail::mul(F_, x_);
+    }
+
+    void update(const measurement_t &z) {
+      const uint32_t steps = predicts_;
+      predicts_            = 0;
+
+      if (!fallback_) {
+        if (const size_t i = gain(steps); i < GAINS) {
+          ss_ = i;
+
+          const measurement_t y  = innovation(z, x_);
+          const auto          dx = detail::mul(gains_[i].K, y);
+          for (size_t j = 0; j < N; ++j)
+            x_.v[j] += dx.v[j];
+
+          nis_ = (T{1} - NIS_WEIGHT) * nis_ + NIS_WEIGHT * nis(y, gains_[i].S_inv);
+          if (nis_ > nis_limit_)
+            enter_fallback(0);
+          return;
+        }
+        enter_fallback(steps);  // No gain for this many predicts, e.g. a late sample
+      }
+      update_full(z, steps);
+    }
+
+    [[nodiscard]] T state() const {
+      return state_vector().v[0];
+    }
+
+    [[nodiscard]] const state_t &state_vector() const {
+      return fallback_ ? full_.state_vector() : x_;
+    }
+
+    [[nodiscard]] bool steady() const {
+      return !fallback_;
+    }
+
+    [[nodiscard]] uint32_t fallbacks() const {
+      return fallbacks_;
+    }
+
+    [[nodiscard]] const steady_state_t<T, N, M> &solution() const {
+      return gains_[ss_];
+    }
+  };
+}  // namespace kalman
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_KALMAN_H
@@ -5,6 +5,8 @@
 
 #include <./UserWeak.h>
 
+#include <./Checksum.h>
+
 #include <./ISA76.h>
 
 #include <./Sensors.h>
@@ -0,0 +1,324 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_LOGSCHEMA_H
+#define ROCKET_AVIONICS_TEMPLATE_LOGSCHEMA_H
+
+#include <./Checksum.h>
+#include <./FastFormat.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+
+/**
+ * Compile-time log schema.
+ *
+ * One constexpr list of fields (name, wire type, scale, decimals, source
+ * member) generates the binary and CSV encoders, the file header and the
+ * decoder. Every field access is a constant member offset, nothing is looked
+ * up at runtime.
+ *
+ * Binary record: u16 magic, fields packed little-endian in list order,
+ * CRC-16/CCITT over everything before the CRC.
+ *
+ * File header, first line of both formats:
+ *   #SCHEMA,<tag>,<magic>,<hash>,<record size>,<name>:<type>:<scale>:<decimals>,...
+ * CSV files follow it with a plain column name line. The descriptors make a
+ * file self-describing, so logs written by older schemas stay decodable.
+ *
+ * Integer wire types hold round(value / scale); wire type e8 is an enum
+ * printed through the field's label function.
+ *
+ * No Arduino dependencies, shared with the host-side decoder.
+ */
+namespace log_schema {
+  enum class Type : uint8_t {
+    U8 = 0,
+    I8,
+    U16,
+    I16,
+    U32,
+    I32,
+    F32,
+    E8
+  };
+
+  template<Type T>
+  struct wire;
+
+  // clang-format off
+  template<> struct wire<Type::U8>  { using type = uint8_t;  };
+  template<> struct wire<Type::I8>  { using type = int8_t;   };
+  template<> struct wire<Type::U16> { using type = uint16_t; };
+  template<> struct wire<Type::I16> { using type = int16_t;  };
+  template<> struct wire<Type::U32> { using type = uint32_t; };
+  template<> struct wire<Type::I32> { using type = int32_t;  };
+  template<> struct wire<Type::F32> { using type = float;    };
+  template<> struct wire<Type::E8>  { using type = uint8_t;  };
+  // clang-format on
+
+  constexpr size_t type_size(const Type t) {
+    switch (t) {
+      case Type::U16:
+      case Type::I16:
+        return 2;
+      case Type::U32:
+      case Type::I32:
+      case Type::F32:
+        return 4;
+      default:
+        return 1;
+    }
+  }
+
+  constexpr const char *type_name(const Type t) {
+    constexpr const char *names[] = {"u8", "i8", "u16", "i16", "u32", "i32", "f32", "e8"};
+    return names[static_cast<uint8_t>(t)];
+  }
+
+  using label_fn = const char *(*) (uint32_t);
+
+  // FNV-1a, also recomputed by the decoder from a parsed #SCHEMA line
+  namespace hash {
+    constexpr uint32_t basis = 2166136261u;
+
+    constexpr uint32_t add_byte(const uint32_t h, const uint8_t byte) {
+      return (h ^ byte) * 16777619u;
+    }
+
+    constexpr uint32_t add_str(uint32_t h, const char *str) {
+      while (*str)
+        h = add_byte(h, static_cast<uint8_t>(*str++));
+      return add_byte(h, 0);
+    }
+
+    constexpr uint32_t add_u32(uint32_t h, const uint32_t v) {
+      for (int i = 0; i < 4; ++i)
+        h = add_byte(h, static_cast<uint8_t>(v >> (8 * i)));
+      return h;
+    }
+
+    constexpr uint32_t scale_units(const double scale) {
+      return static_cast<uint32_t>(scale * 1e6 + 0.5);
+    }
+
+    constexpr uint32_t field(uint32_t h, const char *name, const Type type, const double scale, const uint8_t decimals) {
+      h = add_str(h, name);
+      h = add_byte(h, static_cast<uint8_t>(type));
+      h = add_u32(h, scale_units(scale));
+      return add_byte(h, decimals);
+    }
+  }  // namespace hash
+
+  /**
+   * One column, bound to a member of the sample struct.
+   */
+  template<typename Sample, typename Src, Type Wire>
+  struct field_t {
+    using wire_type                   = typename wire<Wire>::type;
+    static constexpr Type   type      = Wire;
+    static constexpr size_t wire_size = sizeof(wire_type);
+
+    const char *name;
+    Src Sample::*src;
+    double       scale;
+    uint8_t      decimals;
+    label_fn     label;
+
+    [[nodiscard]] wire_type to_wire(const Sample &s) const {
+      const Src v = s.*src;
+      if constexpr (std::is_floating_point_v<wire_type>) {
+        return static_cast<wire_type>(v);
+      } else if constexpr (std::is_floating_point_v<Src>) {
+        constexpr double lo = static_cast<double>(std::numeric_limits<wire_type>::min());
+        constexpr double hi = static_cast<double>(std::numeric_limits<wire_type>::max());
+        double           w  = static_cast<double>(v) / scale;
+        w                   = w < 0 ? w - 0.5 : w + 0.5;
+        return static_cast<wire_type>(w < lo ? lo : (w > hi ? hi : w));
+      } else {
+        return static_cast<wire_type>(v);
+      }
+    }
+
+    void from_wire(const wire_type w, Sample &s) const {
+      if constexpr (std::is_floating_point_v<Src> && !std::is_floating_point_v<wire_type>)
+        s.*src = static_cast<Src>(static_cast<double>(w) * scale);
+      else
+        s.*src = static_cast<Src>(w);
+    }
+
+    void encode(const Sample &s, uint8_t *dst) const {
+      const wire_type w = to_wire(s);
+      memcpy(dst, &w, wire_size);
+    }
+
+    void decode(const uint8_t *src_bytes, Sample &s) const {
+      wire_type w;
+      memcpy(&w, src_bytes, wire_size);
+      from_wire(w, s);
+    }
+
+    void write_csv(const Sample &s, fast_fmt::csv_writer_t &csv) const {
+      if constexpr (Wire == Type::E8) {
+        csv << label(static_cast<uint32_t>(s.*src));
+      } else if constexpr (std::is_floating_point_v<Src>) {
+        csv << fast_fmt::fixed(static_cast<double>(s.*src), decimals);
+      } else {
+        csv << s.*src;
+      }
+    }
+
+    [[nodiscard]] constexpr uint32_t hash(const uint32_t h) const {
+      return hash::field(h, name, Wire, scale, decimals);
+    }
+  };
+
+  template<Type Wire, typename Sample, typename Src>
+  constexpr auto field(const char   *name,
+                       Src Sample::*src,
+                       const uint8_t decimals = std::is_floating_point_v<Src> ? 2 : 0,
+                       const double  scale    = 1.0) {
+    return field_t<Sample, Src, Wire>{name, src, scale, decimals, nullptr};
+  }
+
+  template<typename Sample, typename Src>
+  constexpr auto enum_field(const char *name, Src Sample::*src, const label_fn label) {
+    return field_t<Sample, Src, Type::E8>{name, src, 1.0, 0, label};
+  }
+
+  /**
+   * @tparam Sample Snapshot struct the fields read from
+   * @tparam Fields field_t types, in column order
+   */
+  template<typename Sample, typename... Fields>
+  struct schema_t {
+    static constexpr size_t field_count  = sizeof...(Fields);
+    static constexpr size_t payload_size = (Fields::wire_size + ...);
+    static constexpr size_t record_size  = 2 + payload_size + 2;
+
+    const char           *tag;
+    uint16_t              magic;
+    std::tuple<Fields...> fields;
+
+    [[nodiscard]] constexpr uint32_t hash() const {
+      return std::apply([&](const auto &...f) {
+        uint32_t h = hash::add_str(hash::basis, tag);
+        h          = hash::add_u32(h, magic);
+        ((h = f.hash(h)), ...);
+        return h;
+      },
+                        fields);
+    }
+
+    /**
+     * @param dst At least record_size bytes
+     * @return record_size
+     */
+    size_t encode_binary(const Sample &s, uint8_t *dst) const {
+      memcpy(dst, &magic, 2);
+      uint8_t *p = dst + 2;
+      std::apply([&](const auto &...f) { ((f.encode(s, p), p += f.wire_size), ...); }, fields);
+      const uint16_t crc = checksum::crc16_ccitt(dst, 2 + payload_size);
+      memcpy(p, &crc, 2);
+      return record_size;
+    }
+
+    /**
+     * @return Record length in bytes (no NUL), ends with LF
+     */
+    size_t encode_csv(const Sample &s, char *dst, const size_t cap) const {
+      fast_fmt::csv_writer_t csv(dst, cap);
+      csv << tag;
+      std::apply([&](const auto &...f) { (f.write_csv(s, csv), ...); }, fields);
+      return csv.finish();
+    }
+
+    /**
+     * @param src record_size bytes
+     * @return True if magic and CRC match
+     */
+    bool decode_binary(const uint8_t *src, Sample &s) const {
+      uint16_t m, crc;
+      memcpy(&m, src, 2);
+      memcpy(&crc, src + 2 + payload_size, 2);
+      if (m != magic || crc != checksum::crc16_ccitt(src, 2 + payload_size))
+        return false;
+      const uint8_t *p = src + 2;
+      std::apply([&](const auto &...f) { ((f.decode(p, s), p += f.wire_size), ...); }, fields);
+      return true;
+    }
+
+    /**
+     * Write the file header: the #SCHEMA line, plus the column names for CSV.
+     *
+     * @return Header length in bytes (no NUL), 0 if it does not fit
+     */
+    size_t write_header(char *dst, const size_t cap, const bool csv) const {
+      size_t len = 0;
+      bool   ok  = true;
+
+      const auto put = [&](const char *str, const size_t n) {
+        if (!ok || len + n + 1 > cap) {
+          ok = false;
+          return;
+        }
+        memcpy(dst + len, str, n);
+        len += n;
+      };
+      const auto put_str = [&](const char *str) { put(str, strlen(str)); };
+
+      char num[fast_fmt::max_chars];
+      put_str("#SCHEMA,");
+      put_str(tag);
+      put_str(",");
+      put(num, write_hex(num, magic, 4));
+      put_str(",");
+      put(num, write_hex(num, hash(), 8));
+      put_str(",");
+      put(num, fast_fmt::write_u32(num, record_size));
+
+      std::apply([&](const auto &...f) {
+        ((put_str(","), put_str(f.name), put_str(":"), put_str(type_name(f.type)), put_str(":"),
+          put(num, write_scale(num, f.scale)), put_str(":"), put(num, fast_fmt::write_u32(num, f.decimals))),
+         ...);
+      },
+                 fields);
+      put_str("\n");
+
+      if (csv) {
+        put_str("tag");
+        std::apply([&](const auto &...f) { ((put_str(","), put_str(f.name)), ...); }, fields);
+        put_str("\n");
+      }
+
+      if (!ok)
+        return 0;
+      dst[len] = '\0';
+      return len;
+    }
+
+    static size_t write_hex(char *dst, const uint32_t v, const uint8_t digits) {
+      constexpr char hex[] = "0123456789abcdef";
+      for (uint8_t i = 0; i < digits; ++i)
+        dst[i] = hex[(v >> (4 * (digits - 1 - i))) & 0xFu];
+      return digits;
+    }
+
+    // Shortest of up to 6 decimals, e.g. "1", "0.1", "0.00125"
+    static size_t write_scale(char *dst, const double scale) {
+      size_t n = fast_fmt::write_fixed(dst, scale, 6);
+      while (n > 1 && dst[n - 1] == '0')
+        --n;
+      if (dst[n - 1] == '.')
+        --n;
+      return n;
+    }
+  };
+
+  template<typename Sample, typename... Fields>
+  constexpr auto make_schema(const char *tag, const uint16_t magic, Fields... fields) {
+    return schema_t<Sample, Fields...>{tag, magic, std::tuple<Fields...>(fields...)};
+  }
+}  // namespace log_schema
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_LOGSCHEMA_H
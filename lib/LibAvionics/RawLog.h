@@ -0,0 +1,380 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_RAWLOG_H
+#define ROCKET_AVIONICS_TEMPLATE_RAWLOG_H
+
+#include <./Checksum.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Raw block-device log, no filesystem involved.
+ *
+ * A reserved region of the card holds a chain of flights. Each flight is one
+ * superblock followed by data blocks; the next flight starts right after the
+ * last data block of the previous one.
+ *
+ *   [SB flight n][data 0][data 1]...[SB flight n+1][data 0]...
+ *
+ * Every data block carries its own header (flight number, block sequence and
+ * CRC), so the true end of a flight is found even if the superblock was not
+ * updated before a power loss. This header has no Arduino dependencies and is
+ * shared with the host-side extractor.
+ *
+ * Block devices are duck-typed:
+ *   bool     read(uint32_t lba, uint8_t *dst, uint32_t count);
+ *   bool     write(uint32_t lba, const uint8_t *src, uint32_t count);
+ *   uint32_t block_count();
+ */
+namespace storage::raw {
+  constexpr size_t block_size = 512;
+
+  enum class Format : uint8_t {
+    CSV = 0,
+    BINARY
+  };
+
+  struct __attribute__((packed)) superblock_t {
+    static constexpr char     MAGIC[8] = {'R', 'A', 'L', 'O', 'G', 'S', 'B', '1'};
+    static constexpr uint32_t VERSION  = 1;
+
+    char     magic[8];
+    uint32_t version;
+    uint32_t flight_no;
+    uint32_t lba;            // LBA of this superblock
+    uint32_t data_blocks;    // Data blocks written at the last sync (hint)
+    uint32_t payload_bytes;  // Payload bytes written at the last sync (hint)
+    uint32_t boot_ms;        // millis() when the flight was opened
+    uint32_t sync_count;
+    uint8_t  format;
+    char     name[32];  // File name prefix, used by the extractor
+    uint8_t  reserved[block_size - 8 - 7 * 4 - 1 - 32 - 2];
+    uint16_t crc;
+
+    void seal() {
+      memcpy(magic, MAGIC, sizeof(magic));
+      version = VERSION;
+      crc     = checksum::crc16_ccitt(this, offsetof(superblock_t, crc));
+    }
+
+    [[nodiscard]] bool valid(const uint32_t at_lba) const {
+      return memcmp(magic, MAGIC, sizeof(magic)) == 0 &&
+             version == VERSION &&
+             lba == at_lba &&
+             crc == checksum::crc16_ccitt(this, offsetof(superblock_t, crc));
+    }
+  };
+
+  struct __attribute__((packed)) block_header_t {
+    static constexpr uint16_t MAGIC = 0x4252u;  // "RB" on disk
+
+    uint16_t magic;
+    uint16_t payload_len;
+    uint32_t flight_no;
+    uint32_t seq;  // Data block index within the flight
+    uint16_t crc;  // Over the header (crc = 0) and the full payload area
+    uint16_t reserved;
+  };
+
+  constexpr size_t block_payload = block_size - sizeof(block_header_t);
+
+  static_assert(sizeof(superblock_t) == block_size);
+  static_assert(sizeof(block_header_t) == 16);
+
+  inline uint16_t block_crc(const uint8_t *block) {
+    block_header_t hdr;
+    memcpy(&hdr, block, sizeof(hdr));
+    hdr.crc        = 0;
+    const uint16_t c = checksum::crc16_ccitt(&hdr, sizeof(hdr));
+    return checksum::crc16_ccitt(block + sizeof(hdr), block_payload, c);
+  }
+
+  /**
+   * @return True if the block is data block `seq` of flight `flight_no`
+   */
+  inline bool block_valid(const uint8_t *block, const uint32_t flight_no, const uint32_t seq) {
+    block_header_t hdr;
+    memcpy(&hdr, block, sizeof(hdr));
+    return hdr.magic == block_header_t::MAGIC &&
+           hdr.flight_no == flight_no &&
+           hdr.seq == seq &&
+           hdr.payload_len <= block_payload &&
+           hdr.crc == block_crc(block);
+  }
+
+  /**
+   * Check that a region does not overlap any primary partition of an MBR card.
+   *
+   * @return True if the region is outside every partition (or there is no MBR)
+   */
+  template<typename Device>
+  bool region_is_free(Device &dev, const uint32_t start, const uint32_t blocks) {
+    uint8_t mbr[block_size];
+    if (!dev.read(0, mbr, 1))
+      return false;
+    const uint32_t count = dev.block_count();
+    if (start == 0 || blocks > count || start > count - blocks)
+      return false;
+    if (mbr[510] != 0x55 || mbr[511] != 0xAA)
+      return true;
+
+    for (int i = 0; i < 4; ++i) {
+      const uint8_t *e = mbr + 446 + 16 * i;
+      uint32_t       first, size;
+      memcpy(&first, e + 8, 4);
+      memcpy(&size, e + 12, 4);
+      if (e[4] == 0 || size == 0)
+        continue;
+      if (start < first + size && first < start + blocks)
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * Walks the chain of flights in a region.
+   */
+  template<typename Device>
+  class reader_t {
+    Device  *dev_;
+    uint32_t start_;
+    uint32_t end_;
+    uint8_t  block_[block_size] = {};
+
+  public:
+    struct flight_t {
+      superblock_t sb;
+      uint32_t     data_blocks;  // Verified data blocks
+    };
+
+    reader_t(Device &dev, const uint32_t start, const uint32_t blocks)
+        : dev_(&dev), start_(start), end_(start + blocks) {}
+
+    /**
+     * Read and verify the flight whose superblock is at `lba`.
+     *
+     * @return True if a valid superblock is there
+     */
+    bool flight_at(const uint32_t lba, flight_t &out) {
+      if (lba + 1 > end_ || !dev_->read(lba, block_, 1))
+        return false;
+      memcpy(&out.sb, block_, sizeof(superblock_t));
+      if (!out.sb.valid(lba))
+        return false;
+
+      // Trust the hint, then extend over blocks written after the last sync
+      uint32_t n = out.sb.data_blocks;
+      if (lba + 1 + n > end_)
+        n = end_ - lba - 1;
+      while (lba + 1 + n < end_ &&
+             dev_->read(lba + 1 + n, block_, 1) &&
+             block_valid(block_, out.sb.flight_no, n))
+        ++n;
+      out.data_blocks = n;
+      return true;
+    }
+
+    /**
+     * Call func(const flight_t &) for every flight in chain order.
+     *
+     * @return LBA right after the last flight (where a new one would start)
+     */
+    template<typename Func>
+    uint32_t for_each_flight(Func &&func) {
+      uint32_t lba = start_;
+      flight_t flight;
+      while (flight_at(lba, flight)) {
+        func(flight);
+        lba += 1 + flight.data_blocks;
+      }
+      return lba;
+    }
+
+    /**
+     * Copy out the payload of data block `seq` of a flight.
+     *
+     * @return Payload length, 0 on error
+     */
+    size_t payload(const flight_t &flight, const uint32_t seq, uint8_t *dst) {
+      if (seq >= flight.data_blocks || !dev_->read(flight.sb.lba + 1 + seq, block_, 1))
+        return 0;
+      block_header_t hdr;
+      memcpy(&hdr, block_, sizeof(hdr));
+      memcpy(dst, block_ + sizeof(hdr), hdr.payload_len);
+      return hdr.payload_len;
+    }
+  };
+
+  /**
+   * Sequential writer, collects payload into BatchBlocks blocks and writes
+   * them with one multi-block transfer.
+   *
+   * @tparam Device Block device
+   * @tparam BatchBlocks Blocks per write
+   */
+  template<typename Device, size_t BatchBlocks = 16>
+  class writer_t {
+    static_assert(BatchBlocks > 0);
+
+    Device      *dev_;
+    uint32_t     end_    = 0;
+    uint32_t     next_   = 0;  // LBA of the first block in buf_
+    size_t       cur_    = 0;  // Block being filled in buf_
+    size_t       used_   = 0;  // Payload bytes in the current block
+    uint32_t     blocks_ = 0;  // Complete data blocks written before buf_
+    uint32_t     bytes_  = 0;
+    uint32_t     lost_   = 0;
+    bool         open_   = false;
+    superblock_t sb_     = {};
+    alignas(32) uint8_t buf_[BatchBlocks * block_size] = {};
+
+    void seal_block(const size_t i, const size_t len) {
+      uint8_t       *block = buf_ + i * block_size;
+      block_header_t hdr{};
+      hdr.magic       = block_header_t::MAGIC;
+      hdr.payload_len = static_cast<uint16_t>(len);
+      hdr.flight_no   = sb_.flight_no;
+      hdr.seq         = blocks_ + static_cast<uint32_t>(i);
+      hdr.crc         = 0;
+      memcpy(block, &hdr, sizeof(hdr));
+      if (len < block_payload)
+        memset(block + sizeof(hdr) + len, 0, block_payload - len);
+      hdr.crc = block_crc(block);
+      memcpy(block, &hdr, sizeof(hdr));
+    }
+
+    bool write_superblock() {
+      sb_.data_blocks   = blocks_ + static_cast<uint32_t>(cur_);
+      sb_.payload_bytes = bytes_;
+      ++sb_.sync_count;
+      sb_.seal();
+      return dev_->write(sb_.lba, reinterpret_cast<const uint8_t *>(&sb_), 1);
+    }
+
+    bool write_batch() {
+      if (!dev_->write(next_, buf_, BatchBlocks))
+        return false;
+      next_ += BatchBlocks;
+      blocks_ += BatchBlocks;
+      cur_ = 0;
+      return true;
+    }
+
+  public:
+    explicit writer_t(Device &dev) : dev_(&dev) {}
+
+    /**
+     * Open a new flight after the last one in the region.
+     * If the rest of the region is too small the region wraps and the oldest
+     * flights are overwritten.
+     *
+     * @param start First LBA of the region
+     * @param blocks Region size in blocks
+     * @param format Payload format, recorded for the extractor
+     * @param name File name prefix, recorded for the extractor
+     * @param boot_ms Timestamp recorded in the superblock
+     * @return True if the flight was opened
+     */
+    bool begin(const uint32_t start, const uint32_t blocks,
+               const Format format, const char *name, const uint32_t boot_ms) {
+      if (blocks < 1 + 2 * BatchBlocks)
+        return false;
+
+      reader_t<Device> reader(*dev_, start, blocks);
+      uint32_t         last_no = 0;
+      uint32_t         lba     = reader.for_each_flight([&](const auto &f) {
+        last_no = f.sb.flight_no;
+      });
+
+      end_ = start + blocks;
+      if (end_ - lba < 1 + 2 * BatchBlocks)
+        lba = start;
+
+      sb_            = {};
+      sb_.flight_no  = last_no + 1;
+      sb_.lba        = lba;
+      sb_.boot_ms    = boot_ms;
+      sb_.format     = static_cast<uint8_t>(format);
+      strncpy(sb_.name, name, sizeof(sb_.name) - 1);
+
+      next_   = lba + 1;
+      cur_    = 0;
+      used_   = 0;
+      blocks_ = 0;
+      bytes_  = 0;
+      lost_   = 0;
+      open_   = write_superblock();
+      return open_;
+    }
+
+    /**
+     * Append payload bytes, a full batch is written as soon as it is complete.
+     *
+     * @return Bytes accepted (less than len once the region is full)
+     */
+    size_t append(const void *data, const size_t len) {
+      const auto *src  = static_cast<const uint8_t *>(data);
+      size_t      left = len;
+
+      while (open_ && left) {
+        if (next_ + BatchBlocks > end_) {
+          open_ = false;  // Region full
+          break;
+        }
+
+        const size_t n = left < block_payload - used_ ? left : block_payload - used_;
+        memcpy(buf_ + cur_ * block_size + sizeof(block_header_t) + used_, src, n);
+        used_ += n;
+        bytes_ += n;
+        src += n;
+        left -= n;
+
+        if (used_ == block_payload) {
+          seal_block(cur_++, used_);
+          used_ = 0;
+          if (cur_ == BatchBlocks && !write_batch())
+            open_ = false;
+        }
+      }
+
+      lost_ += static_cast<uint32_t>(left);
+      return len - left;
+    }
+
+    /**
+     * Write the partial batch and refresh the superblock. The partial batch
+     * stays buffered and is rewritten whole once complete.
+     */
+    bool sync() {
+      if (!open_)
+        return false;
+      const size_t count = cur_ + (used_ ? 1 : 0);
+      if (used_)
+        seal_block(cur_, used_);
+      if (count && !dev_->write(next_, buf_, static_cast<uint32_t>(count)))
+        return false;
+      return write_superblock();
+    }
+
+    [[nodiscard]] bool is_open() const {
+      return open_;
+    }
+
+    [[nodiscard]] uint32_t flight_no() const {
+      return sb_.flight_no;
+    }
+
+    [[nodiscard]] uint32_t blocks_written() const {
+      return blocks_;
+    }
+
+    [[nodiscard]] uint32_t bytes_written() const {
+      return bytes_;
+    }
+
+    [[nodiscard]] uint32_t bytes_lost() const {
+      return lost_;
+    }
+  };
+}  // namespace storage::raw
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_RAWLOG_H
@@ -3,6 +3,10 @@
 
 #include <./Arduino_Extended.h>
 #include <./ISA76.h>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
 
 enum class SensorStatus : uint8_t {
   SENSOR_OK = 0,    // Sensor healthy
@@ -25,12 +29,28 @@ constexpr const char *printable_sensor_status(const SensorStatus status) {
   }
 }
 
+/**
+ * Each kind of sensor reads into its Data in one read(Data &) call. Drivers
+ * are final, so calls on the concrete type (sensors::registry_t) are direct
+ * and inline; calls through a base pointer still work.
+ */
 class SensorBase {
 public:
+  // False for the placeholders of Sensors_VariantNone.h, status SENSOR_NO
+  static constexpr bool present = true;
+
   SensorBase() = default;
 
   virtual bool begin() = 0;
-  virtual bool read()  = 0;
+
+  /**
+   * begin() again after a demotion, from a low priority task while the
+   * other sensors read on. Drivers whose begin() needs the bus to
+   * themselves override it.
+   */
+  virtual bool restart() {
+    return begin();
+  }
 
 protected:
   ~SensorBase() = default;
@@ -45,28 +65,43 @@ public:
     double gyr_x;
     double gyr_y;
     double gyr_z;
+
+    bool operator==(const Data &) const = default;
   };
 
-  SensorIMU() = default;
+  // One timestamped acceleration sample, g
+  struct Sample {
+    uint32_t t_us;
+    float    acc_x;
+    float    acc_y;
+    float    acc_z;
+  };
 
-  virtual double acc_x() = 0;
-  virtual double acc_y() = 0;
-  virtual double acc_z() = 0;
+  SensorIMU() = default;
 
-  virtual double gyr_x() = 0;
-  virtual double gyr_y() = 0;
-  virtual double gyr_z() = 0;
+  /**
+   * Read the device, out gets the newest sample.
+   *
+   * @return False if there was nothing new, out is left as it was
+   */
+  virtual bool read(Data &out) = 0;
 
-  auto acc(const bool update = false) -> xcore::tuple<double, double, double> {
-    if (update)
-      this->read();
-    return xcore::make_tuple(this->acc_x(), this->acc_y(), this->acc_z());
+  /**
+   * Every sample the last read() drained from the device FIFO, oldest first.
+   * Drivers without a FIFO have none: read() is one sample at call time.
+   */
+  virtual size_t raw_samples(const Sample *&first) {
+    first = nullptr;
+    return 0;
   }
 
-  auto gyr(const bool update = false) -> xcore::tuple<double, double, double> {
-    if (update)
-      this->read();
-    return xcore::make_tuple(this->gyr_x(), this->gyr_y(), this->gyr_z());
+  /**
+   * The decimated stream of the last read(), oldest first; the Data read()
+   * filled is its newest sample
+   */
+  virtual size_t decimated_samples(const Sample *&first) {
+    first = nullptr;
+    return 0;
   }
 
 protected:
@@ -78,20 +113,45 @@ public:
   struct Data {
     double pressure_hpa;
     double altitude_m;
+
+    bool operator==(const Data &) const = default;
   };
 
   SensorAltimeter() = default;
 
-  virtual double pressure_hpa() = 0;
-
-  double altitude_m(const bool update = false, const double qnh_hpa = 1013.25) {
-    if (update)
-      this->read();
-    return altitude_msl_from_pressure(this->pressure_hpa(), qnh_hpa);
-  }
+  /**
+   * Read the device, out gets its pressure and the altitude_m() of it.
+   *
+   * @return False on a failed read, out is left as it was
+   */
+  virtual bool read(Data &out) = 0;
 
 protected:
   virtual ~SensorAltimeter() = default;
+
+  /**
+   * Altitude of pressure_hpa through the float ISA76 kernel, derived once
+   * per new pressure (layer constants once per QNH)
+   */
+  double altitude_m(const double pressure_hpa, const double qnh_hpa = 1013.25) {
+    if (qnh_hpa != qnh_hpa_) {
+      qnh_hpa_ = qnh_hpa;
+      qnh_     = isa76::qnh_t(qnh_hpa * 100.0);
+      p_hpa_   = -1.0;
+    }
+
+    if (pressure_hpa != p_hpa_) {
+      p_hpa_      = pressure_hpa;
+      altitude_m_ = altitude_msl_from_pressure_fast(static_cast<float>(pressure_hpa), qnh_);
+    }
+    return altitude_m_;
+  }
+
+private:
+  isa76::qnh_t qnh_;
+  double       qnh_hpa_    = 1013.25;
+  double       p_hpa_      = -1.0;  // Pressure altitude_m_ is for
+  double       altitude_m_ = 0.0;
 };
 
 class SensorGNSS : public SensorBase {
@@ -106,14 +166,301 @@ public:
 
   SensorGNSS() = default;
 
-  virtual uint32_t timestamp_epoch() = 0;
-  virtual uint8_t  siv()             = 0;
-  virtual double   latitude()        = 0;
-  virtual double   longitude()       = 0;
-  virtual double   altitude_msl()    = 0;
+  /**
+   * Read the device, out gets the last solution.
+   *
+   * @return False if there was no new solution, out is left as it was
+   */
+  virtual bool read(Data &out) = 0;
 
 protected:
   virtual ~SensorGNSS() = default;
 };
 
+namespace sensors {
+  enum class Fault : uint8_t {
+    NONE = 0,
+    READ,   // Reads failed in a row
+    RANGE,  // Readings out of range in a row
+    STUCK,  // Same reading for too long
+    BEGIN,  // begin() or restart() failed
+  };
+
+  constexpr const char *printable_fault(const Fault fault) {
+    switch (fault) {
+      case Fault::READ:
+        return "READ";
+      case Fault::RANGE:
+        return "RANGE";
+      case Fault::STUCK:
+        return "STUCK";
+      case Fault::BEGIN:
+        return "BEGIN";
+      case Fault::NONE:
+      default:
+        return "NONE";
+    }
+  }
+
+  struct health_policy_t {
+    uint32_t max_read_failures;  // In a row, to demote
+    uint32_t max_range_faults;   // In a row, to demote
+    uint32_t stuck_ms;           // Unchanged readings for this long demote
+    uint32_t retry_ms;           // Demotion or failed restart to the next restart
+    uint32_t probation_reads;    // Good reads of a restarted sensor before it votes again
+  };
+
+  /**
+   * Runtime health of one sensor.
+   *
+   * The reading task reports each read of a SENSOR_OK sensor; too many
+   * failed, out of range or unchanged readings demote it to SENSOR_ERR. A
+   * demoted sensor belongs to the recovery task, which restarts it once
+   * retry_due() and hands it back through begun(). The status is the
+   * handoff: each side only touches the sensor while it owns it.
+   */
+  class health_t {
+    std::atomic<SensorStatus> status_{SensorStatus::SENSOR_UNK};
+    std::atomic<uint32_t>     events_{0};  // Status changes
+
+    const health_policy_t *policy_       = nullptr;
+    Fault                  fault_        = Fault::NONE;
+    bool                   plausible_    = false;
+    uint32_t               failures_     = 0;
+    uint32_t               range_faults_ = 0;
+    uint32_t               probation_    = 0;
+    uint32_t               changed_ms_   = 0;
+    uint32_t               retry_ms_     = 0;
+    uint32_t               demotions_    = 0;
+    uint32_t               restarts_     = 0;
+
+  public:
+    health_t() = default;
+
+    health_t(const health_t &) = delete;
+
+    /**
+     * No sensor in this slot, for good.
+     */
+    void absent() {
+      status_.store(SensorStatus::SENSOR_NO, std::memory_order_release);
+      events_.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * Result of begin(), or of restart() by the recovery task. A sensor that
+     * failed is retried after policy.retry_ms, a restarted one votes again
+     * after its probation.
+     */
+    void begun(const health_policy_t &policy, const bool ok, const uint32_t now_ms) {
+      const bool restarted = status_.load(std::memory_order_relaxed) != SensorStatus::SENSOR_UNK;
+      policy_              = &policy;
+      if (!ok) {
+        demote(Fault::BEGIN, now_ms);
+        return;
+      }
+
+      fault_        = Fault::NONE;
+      plausible_    = false;
+      failures_     = 0;
+      range_faults_ = 0;
+      probation_    = restarted ? policy.probation_reads : 0;
+      changed_ms_   = now_ms;
+      restarts_ += restarted;
+      status_.store(SensorStatus::SENSOR_OK, std::memory_order_release);
+      events_.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * Take the sensor out of the vote, the recovery task restarts it.
+     */
+    void demote(const Fault fault, const uint32_t now_ms) {
+      // Failed retries of a sensor already down are not news
+      const bool news = status_.load(std::memory_order_relaxed) != SensorStatus::SENSOR_ERR || fault != fault_;
+      fault_          = fault;
+      retry_ms_       = now_ms + (policy_ ? policy_->retry_ms : 0);
+      demotions_ += fault != Fault::BEGIN;
+      status_.store(SensorStatus::SENSOR_ERR, std::memory_order_release);
+      if (news)
+        events_.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * Report a read, from the reading task while status() is SENSOR_OK.
+     *
+     * @param ok The read returned data
+     * @param plausible Its values are within the device's range
+     * @param changed They differ from the previous reading
+     */
+    void read(const bool ok, const bool plausible, const bool changed, const uint32_t now_ms) {
+      if (!ok) {
+        if (++failures_ >= policy_->max_read_failures)
+          demote(Fault::READ, now_ms);
+        return;
+      }
+      failures_ = 0;
+
+      plausible_ = plausible;
+      if (!plausible) {
+        if (++range_faults_ >= policy_->max_range_faults)
+          demote(Fault::RANGE, now_ms);
+        return;
+      }
+      range_faults_ = 0;
+
+      if (changed) {
+        changed_ms_ = now_ms;
+      } else if (now_ms - changed_ms_ >= policy_->stuck_ms) {
+        demote(Fault::STUCK, now_ms);
+        return;
+      }
+
+      if (probation_)
+        --probation_;
+    }
+
+    /**
+     * Whether the last reading counts, for the reading task
+     */
+    [[nodiscard]] bool voting() const {
+      return status_.load(std::memory_order_relaxed) == SensorStatus::SENSOR_OK && plausible_ && probation_ == 0;
+    }
+
+    /**
+     * Whether the recovery task should restart the sensor now
+     */
+    [[nodiscard]] bool retry_due(const uint32_t now_ms) const {
+      return status_.load(std::memory_order_acquire) == SensorStatus::SENSOR_ERR &&
+             static_cast<int32_t>(now_ms - retry_ms_) >= 0;
+    }
+
+    // clang-format off
+    [[nodiscard]] SensorStatus status() const { return status_.load(std::memory_order_acquire); }
+    [[nodiscard]] uint32_t events() const { return events_.load(std::memory_order_acquire); }
+    [[nodiscard]] Fault fault() const { return fault_; }
+    [[nodiscard]] uint32_t demotions() const { return demotions_; }
+    [[nodiscard]] uint32_t restarts() const { return restarts_; }
+    // clang-format on
+
+    /**
+     * One report line:
+     *   #HEALTH,<ms>,<kind>,<index>,<status>,<fault>,<demotions>,<restarts>
+     *
+     * @return Line length including LF (no NUL)
+     */
+    size_t write(char *dst, const size_t cap, const char *kind, const size_t index, const uint32_t now_ms) const {
+      fast_fmt::csv_writer_t csv(dst, cap);
+      csv << "#HEALTH" << now_ms << kind << static_cast<uint32_t>(index) << printable_sensor_status(status())
+          << printable_fault(fault_) << demotions_ << restarts_;
+      return csv.finish();
+    }
+  };
+
+  /**
+   * Median of the first n of v, which it sorts; the mean of the middle two
+   * for even n. Insertion sort: n is at most a handful, fixed by N.
+   */
+  template<typename T, size_t N>
+  T median(T (&v)[N], const size_t n) {
+    for (size_t i = 1; i < n && i < N; ++i)
+      for (size_t j = i; j > 0 && v[j] < v[j - 1]; --j) {
+        const T t = v[j];
+        v[j]      = v[j - 1];
+        v[j - 1]  = t;
+      }
+    return n & 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+  }
+
+  template<typename Data, size_t N, typename T>
+  void vote_field(const Data (&in)[N], const size_t (&from)[N], const size_t n, Data &out, T Data::*field) {
+    T v[N] = {};
+    for (size_t k = 0; k < n; ++k)
+      v[k] = in[from[k]].*field;
+    out.*field = median(v, n);
+  }
+
+  /**
+   * Field by field median of the voting sensors' readings into out. The
+   * work is fixed by N and the fields, whatever the sensors' health.
+   *
+   * @return Number of sensors that voted, out is left as it was if none
+   */
+  template<typename Data, size_t N, typename... T>
+  size_t vote(const Data (&in)[N], const health_t (&health)[N], Data &out, T Data::*...fields) {
+    size_t from[N];
+    size_t n = 0;
+    for (size_t i = 0; i < N; ++i)
+      if (health[i].voting())
+        from[n++] = i;
+    if (n == 0)
+      return 0;
+
+    (vote_field(in, from, n, out, fields), ...);
+    return n;
+  }
+
+  template<typename S>
+  concept sensor = std::derived_from<S, SensorBase> && requires(S &s, typename S::Data &out) {
+    { S::present } -> std::convertible_to<bool>;
+    { s.begin() } -> std::same_as<bool>;
+    { s.read(out) } -> std::same_as<bool>;
+  };
+
+  /**
+   * Compile-time list of the sensors of one kind, as references to their
+   * statically allocated drivers. Loops over it unroll into direct calls on
+   * each concrete type: no virtual dispatch, no allocation.
+   *
+   * Indices follow the order given, as the slots of the RA_NUM_* arrays.
+   */
+  template<sensor... Ts>
+  class registry_t {
+    xcore::tuple<Ts &...> sensors_;
+
+  public:
+    static constexpr size_t size = sizeof...(Ts);
+
+    explicit registry_t(Ts &...sensors) : sensors_(sensors...) {}
+
+    template<size_t Index>
+    auto &get() {
+      return xcore::get<Index>(sensors_);
+    }
+
+    /**
+     * func(sensor, index) for each sensor, in order
+     */
+    template<typename Func, size_t Index = 0>
+    void for_each(Func &&func) {
+      if constexpr (Index < size) {
+        func(xcore::get<Index>(sensors_), Index);
+        for_each<Func, Index + 1>(xcore::forward<Func>(func));
+      }
+    }
+
+    /**
+     * begin() each sensor into its health slot, placeholders are SENSOR_NO.
+     */
+    void begin(health_t (&health)[size], const health_policy_t &policy, const uint32_t now_ms) {
+      for_each([&](auto &sensor, const size_t i) -> void {
+        if constexpr (!std::remove_reference_t<decltype(sensor)>::present)
+          health[i].absent();
+        else
+          health[i].begun(policy, sensor.begin(), now_ms);
+      });
+    }
+
+    /**
+     * restart() each demoted sensor whose retry is due, from the recovery
+     * task. Blocks only the caller, the reading tasks skip these sensors.
+     */
+    void restart(health_t (&health)[size], const health_policy_t &policy, const uint32_t now_ms) {
+      for_each([&](auto &sensor, const size_t i) -> void {
+        if (health[i].retry_due(now_ms))
+          health[i].begun(policy, sensor.restart(), now_ms);
+      });
+    }
+  };
+}  // namespace sensors
+
 #endif  //ROCKET_AVIONICS_TEMPLATE_SENSORS_H
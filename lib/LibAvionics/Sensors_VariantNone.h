@@ -5,6 +5,8 @@
 
 class NoIMU final : public SensorIMU {
 public:
+  static constexpr bool present = false;
+
   NoIMU() : SensorIMU() {
   }
 
@@ -12,37 +14,15 @@ public:
     return false;
   }
 
-  bool read() override {
+  bool read(Data &) override {
     return false;
   }
-
-  double acc_x() override {
-    return 0.;
-  }
-
-  double acc_y() override {
-    return 0.;
-  }
-
-  double acc_z() override {
-    return 0.;
-  }
-
-  double gyr_x() override {
-    return 0.;
-  }
-
-  double gyr_y() override {
-    return 0.;
-  }
-
-  double gyr_z() override {
-    return 0.;
-  }
 };
 
 class NoAltimeter final : public SensorAltimeter {
 public:
+  static constexpr bool present = false;
+
   NoAltimeter() : SensorAltimeter() {
   }
 
@@ -50,17 +30,15 @@ public:
     return false;
   }
 
-  bool read() override {
+  bool read(Data &) override {
     return false;
   }
-
-  double pressure_hpa() override {
-    return 0.;
-  }
 };
 
 class NoGNSS final : public SensorGNSS {
 public:
+  static constexpr bool present = false;
+
   NoGNSS() : SensorGNSS() {
   }
 
@@ -68,29 +46,9 @@ public:
     return false;
   }
 
-  bool read() override {
+  bool read(Data &) override {
     return false;
   }
-
-  uint32_t timestamp_epoch() override {
-    return 0ul;
-  }
-
-  uint8_t siv() override {
-    return 0;
-  }
-
-  double latitude() override {
-    return 0.;
-  }
-
-  double longitude() override {
-    return 0.;
-  }
-
-  double altitude_msl() override {
-    return 0.;
-  }
 };
 
 #endif  //ROCKET_AVIONICS_TEMPLATE_SENSORS_VARIANTNONE_H
@@ -2,5 +2,255 @@
 #define ROCKET_AVIONICS_TEMPLATE_STORAGE_H
 
 #include <./Arduino_Extended.h>
+#include <./RawLog.h>
+#include <atomic>
+#include <cstring>
+
+#if __has_include(<diskio.h>)
+#  include <ff.h>
+#  include <diskio.h>
+#  define RA_HAS_DISKIO 1
+#endif
+
+namespace storage {
+  /**
+   * Fixed-capacity byte frame, one encoded log record.
+   *
+   * @tparam MaxSize Maximum encoded size in bytes
+   */
+  template<size_t MaxSize>
+  struct log_frame_t {
+    static constexpr size_t max_size = MaxSize;
+
+    uint16_t size          = 0;
+    bool     annotation    = false;  // Text line (e.g. "#PROF,..."), not a data record
+    uint8_t  data[MaxSize] = {};
+
+    void clear() {
+      size       = 0;
+      annotation = false;
+    }
+
+    bool append(const void *src, const size_t len) {
+      if (size + len > MaxSize)
+        return false;
+      memcpy(data + size, src, len);
+      size += len;
+      return true;
+    }
+
+    [[nodiscard]] size_t remaining() const {
+      return MaxSize - size;
+    }
+  };
+
+  /**
+   * Statically allocated single-producer, multi-consumer record ring.
+   *
+   * The producer never blocks: it always overwrites the oldest slot. Every consumer
+   * owns a cursor_t with its own position, so a slow sink falls behind and
+   * drops records without affecting the producer or the other sinks. Each slot
+   * carries a sequence word (odd while being written), so a reader that races
+   * the producer detects torn or overwritten slots and counts them as dropped.
+   *
+   * @tparam T Record type (trivially copyable)
+   * @tparam Capacity Number of slots (power of two)
+   */
+  template<typename T, size_t Capacity>
+  class log_ring_t {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+    struct slot_t {
+      std::atomic<uint32_t> seq{0};
+      T                     value{};
+    };
+
+    slot_t                slots_[Capacity] = {};
+    std::atomic<uint32_t> head_{0};  // Number of records published so far
+
+    static constexpr uint32_t mask = Capacity - 1;
+
+    static constexpr uint32_t seq_done(const uint32_t index) {
+      return 2u * index + 2u;
+    }
+
+    bool read_at(const uint32_t index, T &out) const {
+      const slot_t  &slot = slots_[index & mask];
+      const uint32_t s0   = slot.seq.load(std::memory_order_acquire);
+      if (s0 != seq_done(index))
+        return false;
+      out = slot.value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return slot.seq.load(std::memory_order_relaxed) == s0;
+    }
+
+  public:
+    static constexpr size_t capacity = Capacity;
+
+    /**
+     * Start writing the next record in place, the slot is marked busy until commit().
+     * Only the single producer may call this.
+     *
+     * @return Slot to encode into
+     */
+    T &begin_write() {
+      const uint32_t idx  = head_.load(std::memory_order_relaxed);
+      slot_t        &slot = slots_[idx & mask];
+      slot.seq.store(2u * idx + 1u, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      return slot.value;
+    }
+
+    /**
+     * Publish the record started by begin_write().
+     */
+    void commit() {
+      const uint32_t idx = head_.load(std::memory_order_relaxed);
+      slots_[idx & mask].seq.store(seq_done(idx), std::memory_order_release);
+      head_.store(idx + 1u, std::memory_order_release);
+    }
+
+    void push(const T &value) {
+      begin_write() = value;
+      commit();
+    }
+
+    [[nodiscard]] uint32_t head() const {
+      return head_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Copy the newest record without a cursor, for readers that only want the
+     * current value (published snapshots).
+     *
+     * @param out Destination
+     * @return False if nothing was published yet
+     */
+    bool latest(T &out) const {
+      for (;;) {
+        const uint32_t head = this->head();
+        if (head == 0)
+          return false;
+        if (read_at(head - 1u, out))
+          return true;
+      }
+    }
+
+    /**
+     * Independent read position of one sink.
+     */
+    class cursor_t {
+      const log_ring_t *ring_;
+      uint32_t          next_;
+      uint32_t          max_backlog_;
+      uint32_t          consumed_ = 0;
+      uint32_t          dropped_  = 0;
+      uint32_t          skipped_  = 0;
+
+    public:
+      /**
+       * @param ring Ring to read from
+       * @param max_backlog Records this sink may lag behind before the oldest are dropped (1 .. Capacity - 1)
+       */
+      explicit cursor_t(const log_ring_t &ring, const uint32_t max_backlog = Capacity - 1)
+          : ring_(&ring),
+            next_(ring.head()),
+            max_backlog_(max_backlog == 0 ? 1 : (max_backlog > Capacity - 1 ? Capacity - 1 : max_backlog)) {}
+
+      /**
+       * Take the oldest record still available to this sink.
+       *
+       * @param out Destination
+       * @return True if a record was copied out
+       */
+      bool pop(T &out) {
+        for (;;) {
+          const uint32_t head = ring_->head();
+          if (next_ == head)
+            return false;
+
+          if (const uint32_t lag = head - next_; lag > max_backlog_) {
+            dropped_ += lag - max_backlog_;
+            next_ = head - max_backlog_;
+          }
+
+          if (ring_->read_at(next_++, out)) {
+            ++consumed_;
+            return true;
+          }
+
+          ++dropped_;  // Overwritten while reading
+        }
+      }
+
+      /**
+       * Take only the newest record, skipping the backlog (decimating sinks).
+       * Skipped records are counted separately from dropped ones.
+       *
+       * @param out Destination
+       * @return True if a record was copied out
+       */
+      bool pop_latest(T &out) {
+        for (;;) {
+          const uint32_t head = ring_->head();
+          if (next_ == head)
+            return false;
+
+          skipped_ += head - 1u - next_;
+          next_ = head;
+
+          if (ring_->read_at(head - 1u, out)) {
+            ++consumed_;
+            return true;
+          }
+
+          ++dropped_;
+        }
+      }
+
+      [[nodiscard]] uint32_t lag() const {
+        return ring_->head() - next_;
+      }
+
+      [[nodiscard]] uint32_t consumed() const {
+        return consumed_;
+      }
+
+      [[nodiscard]] uint32_t dropped() const {
+        return dropped_;
+      }
+
+      [[nodiscard]] uint32_t skipped() const {
+        return skipped_;
+      }
+    };
+  };
+
+#if defined(RA_HAS_DISKIO) && RA_HAS_DISKIO
+  /**
+   * SD card as a raw block device through the FatFs low level driver,
+   * multi-block reads and writes go straight to the SDIO driver.
+   */
+  struct sd_block_device_t {
+    BYTE pdrv = 0;
+
+    bool read(const uint32_t lba, uint8_t *dst, const uint32_t count) const {
+      return disk_read(pdrv, dst, lba, count) == RES_OK;
+    }
+
+    bool write(const uint32_t lba, const uint8_t *src, const uint32_t count) const {
+      return disk_write(pdrv, src, lba, count) == RES_OK;
+    }
+
+    [[nodiscard]] uint32_t block_count() const {
+      LBA_t count = 0;
+      if (disk_ioctl(pdrv, GET_SECTOR_COUNT, &count) != RES_OK)
+        return 0;
+      return static_cast<uint32_t>(count);
+    }
+  };
+#endif
+}  // namespace storage
 
 #endif  //ROCKET_AVIONICS_TEMPLATE_STORAGE_H
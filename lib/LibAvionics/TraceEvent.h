@@ -0,0 +1,75 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_TRACEEVENT_H
+#define ROCKET_AVIONICS_TEMPLATE_TRACEEVENT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Event trace format, shared by the target recorder (include/hal_trace.h)
+ * and the host-side converter (src/trace_convert).
+ *
+ * Dump file layout, little-endian:
+ *   dump_header_t
+ *   name_t x num_names
+ *   event_t x num_events, oldest first
+ */
+namespace trace {
+  enum class Event : uint8_t {
+    NONE = 0,
+    TASK_SWITCH,    // id: task slot in hal::rtos::mon, IDLE_TASK for idle/unregistered
+    MUTEX_WAIT,     // id: mutex
+    MUTEX_LOCK,     // id: mutex
+    MUTEX_UNLOCK,   // id: mutex
+    SENSOR_BEGIN,   // id: sensor
+    SENSOR_END,     // id: sensor
+    STORAGE_BEGIN,  // id: storage sink, arg: sectors/blocks
+    STORAGE_END,    // id: storage sink
+    FSM_STATE,      // arg: new UserState
+    TRIGGER,        // Post-trigger window started
+    MARK            // id, arg: user defined
+  };
+
+  enum class Kind : uint8_t {
+    TASK = 0,
+    MUTEX,
+    SENSOR,
+    STORAGE,
+    MARK
+  };
+
+  constexpr uint8_t IDLE_TASK = 0xFF;
+
+  struct __attribute__((packed)) event_t {
+    uint32_t cycles;  // DWT cycle counter, wraps
+    Event    type;
+    uint8_t  id;
+    uint16_t arg;
+  };
+
+  struct __attribute__((packed)) name_t {
+    Kind    kind;
+    uint8_t id;
+    char    name[22];
+  };
+
+  struct __attribute__((packed)) dump_header_t {
+    static constexpr char     MAGIC[8] = {'R', 'A', 'T', 'R', 'A', 'C', 'E', '1'};
+    static constexpr uint32_t VERSION  = 1;
+
+    char     magic[8];
+    uint32_t version;
+    uint32_t cpu_hz;         // Cycle counter frequency
+    uint32_t num_events;
+    uint32_t num_names;
+    uint32_t total_events;   // Recorded since start, including overwritten ones
+    uint32_t trigger_index;  // Index in the dump of the TRIGGER event, UINT32_MAX if none
+    uint32_t dump_ms;        // millis() at dump time
+    uint32_t reserved;
+  };
+
+  static_assert(sizeof(event_t) == 8);
+  static_assert(sizeof(name_t) == 24);
+  static_assert(sizeof(dump_header_t) == 40);
+}  // namespace trace
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_TRACEEVENT_H
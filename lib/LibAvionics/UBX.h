@@ -0,0 +1,450 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_UBX_H
+#define ROCKET_AVIONICS_TEMPLATE_UBX_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * u-blox UBX protocol: an incremental frame parser, the NAV-PVT solution
+ * and a frame writer for configuration messages.
+ *
+ * The parser works in place on a power-of-two ring of received bytes (a
+ * DMA ring, or a capture on the host), addressed by free-running positions
+ * that wrap at 2^32. It copies nothing: the checksum runs over the bytes as
+ * they arrive, and a frame that passes is handed out as a view into the
+ * ring its fields are read from. A frame that fails is rescanned from the
+ * byte after its sync, so a false sync in garbage never costs a real frame.
+ */
+namespace ubx {
+  constexpr uint8_t SYNC_1      = 0xB5;
+  constexpr uint8_t SYNC_2      = 0x62;
+  constexpr size_t  HEADER_LEN  = 6;               // Sync, class, id, length
+  constexpr size_t  OVERHEAD    = HEADER_LEN + 2;  // And the checksum
+  constexpr size_t  MAX_PAYLOAD = 1024;            // Any longer is a false sync
+
+  constexpr uint8_t CLASS_NAV     = 0x01;
+  constexpr uint8_t CLASS_ACK     = 0x05;
+  constexpr uint8_t CLASS_CFG     = 0x06;
+  constexpr uint8_t ID_NAV_PVT    = 0x07;
+  constexpr uint8_t ID_ACK_NAK    = 0x00;
+  constexpr uint8_t ID_ACK_ACK    = 0x01;
+  constexpr uint8_t ID_CFG_VALSET = 0x8A;
+
+  // Factory baud rate of the UART ports
+  constexpr uint32_t BAUD_DEFAULT = 38400;
+
+  /**
+   * Configuration keys for CFG-VALSET. Bits 28-30 of a key give the size of
+   * its value.
+   */
+  namespace cfg {
+    constexpr uint8_t LAYER_RAM = 0x01;
+
+    constexpr uint32_t RATE_MEAS                = 0x30210001;  // U2, ms between measurements
+    constexpr uint32_t RATE_NAV                 = 0x30210002;  // U2, measurements per solution
+    constexpr uint32_t NAVSPG_DYNMODEL          = 0x20110021;  // E1
+    constexpr uint32_t MSGOUT_UBX_NAV_PVT_UART1 = 0x20910007;  // U1, per solution
+    constexpr uint32_t UART1_BAUDRATE           = 0x40520001;  // U4
+    constexpr uint32_t UART1OUTPROT_UBX         = 0x10740001;  // L
+    constexpr uint32_t UART1OUTPROT_NMEA        = 0x10740002;  // L
+
+    constexpr uint8_t DYNMODEL_AIRBORNE_4G = 8;
+
+    constexpr size_t value_size(const uint32_t key) {
+      switch (key >> 28 & 0x7u) {
+        case 3:
+          return 2;
+        case 4:
+          return 4;
+        case 5:
+          return 8;
+        default:
+          return 1;
+      }
+    }
+  }  // namespace cfg
+
+  // Days since 1970-01-01 of a proleptic Gregorian date
+  constexpr int32_t days_from_civil(int32_t y, const uint32_t m, const uint32_t d) {
+    y -= m <= 2;
+    const int32_t  era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+    const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int32_t>(doe) - 719468;
+  }
+
+  // Inverse of days_from_civil
+  constexpr void civil_from_days(int32_t z, int32_t &y, uint32_t &m, uint32_t &d) {
+    z += 719468;
+    const int32_t  era = (z >= 0 ? z : z - 146096) / 146097;
+    const uint32_t doe = static_cast<uint32_t>(z - era * 146097);
+    const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const uint32_t mp  = (5 * doy + 2) / 153;
+    d                  = doy - (153 * mp + 2) / 5 + 1;
+    m                  = mp < 10 ? mp + 3 : mp - 9;
+    y                  = static_cast<int32_t>(yoe) + era * 400 + (m <= 2);
+  }
+
+  /**
+   * A checked frame where it lies in the ring, valid until the ring's
+   * producer comes round to it again. Fields are little-endian.
+   */
+  class frame_t {
+    const uint8_t *ring_;
+    uint32_t       mask_;
+    uint32_t       payload_;
+
+  public:
+    uint8_t  cls;
+    uint8_t  id;
+    uint16_t len;
+    uint32_t end;  // Position after the checksum
+
+    constexpr frame_t(const uint8_t *ring, const uint32_t mask, const uint32_t payload, const uint8_t cls,
+                      const uint8_t id, const uint16_t len)
+        : ring_(ring), mask_(mask), payload_(payload), cls(cls), id(id), len(len),
+          end(payload + len + 2) {}
+
+    // clang-format off
+    [[nodiscard]] bool is(const uint8_t c, const uint8_t i) const { return cls == c && id == i; }
+    [[nodiscard]] uint8_t u1(const size_t off) const { return ring_[(payload_ + off) & mask_]; }
+    [[nodiscard]] uint16_t u2(const size_t off) const { return static_cast<uint16_t>(u1(off) | u1(off + 1) << 8); }
+    [[nodiscard]] uint32_t u4(const size_t off) const { return u2(off) | static_cast<uint32_t>(u2(off + 2)) << 16; }
+    [[nodiscard]] int32_t i4(const size_t off) const { return static_cast<int32_t>(u4(off)); }
+    // clang-format on
+  };
+
+  struct parser_stats_t {
+    uint32_t frames          = 0;
+    uint32_t checksum_errors = 0;
+    uint32_t skipped         = 0;  // Bytes outside any frame
+  };
+
+  /**
+   * Incremental frame parser. parse() takes whatever arrived since the last
+   * call, a frame may straddle any number of calls and the ring's end.
+   */
+  class parser_t {
+    enum class State : uint8_t {
+      SYNC_1,
+      SYNC_2,
+      CLASS,
+      ID,
+      LEN_1,
+      LEN_2,
+      PAYLOAD,
+      CK_A,
+      CK_B,
+    };
+
+    State          state_     = State::SYNC_1;
+    uint32_t       pos_       = 0;  // Next byte
+    uint32_t       start_     = 0;  // Sync of the frame in progress
+    uint32_t       remaining_ = 0;  // Payload bytes still to come
+    uint8_t        cls_       = 0;
+    uint8_t        id_        = 0;
+    uint16_t       len_       = 0;
+    uint8_t        ck_a_      = 0;
+    uint8_t        ck_b_      = 0;
+    parser_stats_t stats_;
+
+    void add(const uint8_t b) {
+      ck_a_ += b;
+      ck_b_ += ck_a_;
+    }
+
+    // Not a frame after all, look again from the byte after its sync
+    void resync() {
+      ++stats_.skipped;
+      pos_   = start_ + 1;
+      state_ = State::SYNC_1;
+    }
+
+  public:
+    /**
+     * Parse ring up to head, on_frame(const frame_t &) for each frame that
+     * passes its checksum, in order.
+     */
+    template<size_t Size, typename Func>
+    void parse(const uint8_t (&ring)[Size], const uint32_t head, Func &&on_frame) {
+      static_assert(Size && (Size & (Size - 1)) == 0, "The ring is a power of two");
+      constexpr uint32_t mask = Size - 1;
+
+      while (pos_ != head) {
+        // Most bytes are payload: checksum only
+        if (state_ == State::PAYLOAD) {
+          uint32_t n = head - pos_ < remaining_ ? head - pos_ : remaining_;
+          remaining_ -= n;
+          for (; n; --n)
+            add(ring[pos_++ & mask]);
+          if (remaining_ == 0)
+            state_ = State::CK_A;
+          continue;
+        }
+
+        const uint8_t b = ring[pos_++ & mask];
+        switch (state_) {
+          case State::SYNC_1:
+            if (b == SYNC_1) {
+              start_ = pos_ - 1;
+              state_ = State::SYNC_2;
+            } else {
+              ++stats_.skipped;
+            }
+            break;
+          case State::SYNC_2:
+            if (b == SYNC_2)
+              state_ = State::CLASS;
+            else
+              resync();
+            break;
+          case State::CLASS:
+            cls_  = b;
+            ck_a_ = ck_b_ = 0;
+            add(b);
+            state_ = State::ID;
+            break;
+          case State::ID:
+            id_ = b;
+            add(b);
+            state_ = State::LEN_1;
+            break;
+          case State::LEN_1:
+            len_ = b;
+            add(b);
+            state_ = State::LEN_2;
+            break;
+          case State::LEN_2:
+            len_ = static_cast<uint16_t>(len_ | b << 8);
+            add(b);
+            if (len_ > MAX_PAYLOAD) {
+              resync();
+            } else {
+              remaining_ = len_;
+              state_     = len_ ? State::PAYLOAD : State::CK_A;
+            }
+            break;
+          case State::CK_A:
+            if (b == ck_a_) {
+              state_ = State::CK_B;
+            } else {
+              ++stats_.checksum_errors;
+              resync();
+            }
+            break;
+          case State::CK_B:
+            if (b == ck_b_) {
+              ++stats_.frames;
+              state_ = State::SYNC_1;
+              on_frame(frame_t(ring, mask, start_ + HEADER_LEN, cls_, id_, len_));
+            } else {
+              ++stats_.checksum_errors;
+              resync();
+            }
+            break;
+          case State::PAYLOAD:
+          default:
+            break;
+        }
+      }
+    }
+
+    /**
+     * First position the parser may still read: the ring's producer must
+     * not have overwritten it.
+     */
+    [[nodiscard]] uint32_t need() const {
+      return state_ == State::SYNC_1 ? pos_ : start_;
+    }
+
+    /**
+     * Drop any frame in progress and go on from pos, after the bytes
+     * before it were lost.
+     */
+    void restart(const uint32_t pos) {
+      pos_   = pos;
+      state_ = State::SYNC_1;
+    }
+
+    [[nodiscard]] const parser_stats_t &stats() const {
+      return stats_;
+    }
+
+    void reset_stats() {
+      stats_ = {};
+    }
+  };
+
+  /**
+   * Frame writer: the header at construction, then the payload, then
+   * finish() fills in the length and the checksum.
+   */
+  class writer_t {
+    uint8_t *dst_;
+    size_t   cap_;
+    size_t   len_;
+
+    writer_t &put(const uint64_t v, const size_t n) {
+      for (size_t i = 0; i < n; ++i, ++len_)
+        if (len_ < cap_)
+          dst_[len_] = static_cast<uint8_t>(v >> (8 * i));
+      return *this;
+    }
+
+  public:
+    writer_t(uint8_t *dst, const size_t cap, const uint8_t cls, const uint8_t id) : dst_(dst), cap_(cap), len_(0) {
+      put(SYNC_1, 1).put(SYNC_2, 1).put(cls, 1).put(id, 1).put(0, 2);
+    }
+
+    // clang-format off
+    writer_t &u1(const uint8_t v) { return put(v, 1); }
+    writer_t &u2(const uint16_t v) { return put(v, 2); }
+    writer_t &u4(const uint32_t v) { return put(v, 4); }
+    writer_t &i4(const int32_t v) { return put(static_cast<uint32_t>(v), 4); }
+    writer_t &zeros(const size_t n) { return put(0, n); }
+    // clang-format on
+
+    // One CFG-VALSET item, the value as wide as the key says
+    writer_t &item(const uint32_t key, const uint64_t value) {
+      return put(key, 4).put(value, cfg::value_size(key));
+    }
+
+    /**
+     * @return Frame length, 0 if it did not fit in cap
+     */
+    size_t finish() {
+      const size_t total = len_ + 2;
+      if (total > cap_ || len_ - HEADER_LEN > MAX_PAYLOAD)
+        return 0;
+
+      const size_t payload = len_ - HEADER_LEN;
+      dst_[4]              = static_cast<uint8_t>(payload);
+      dst_[5]              = static_cast<uint8_t>(payload >> 8);
+
+      uint8_t a = 0, b = 0;
+      for (size_t i = 2; i < len_; ++i) {
+        a += dst_[i];
+        b += a;
+      }
+      dst_[len_]     = a;
+      dst_[len_ + 1] = b;
+      return total;
+    }
+  };
+
+  /**
+   * NAV-PVT, the navigation solution: the fields in use, decoded from the
+   * frame where it lies.
+   */
+  struct nav_pvt_t {
+    static constexpr uint16_t LEN = 92;
+
+    static constexpr uint8_t VALID_DATE   = 0x01;
+    static constexpr uint8_t VALID_TIME   = 0x02;
+    static constexpr uint8_t FLAGS_FIX_OK = 0x01;
+    static constexpr uint8_t FIX_NONE     = 0;
+    static constexpr uint8_t FIX_2D       = 2;
+    static constexpr uint8_t FIX_3D       = 3;
+    static constexpr uint8_t FIX_GNSS_DR  = 4;
+
+    uint32_t itow_ms;
+    uint16_t year;
+    uint8_t  month, day, hour, min, sec;
+    uint8_t  valid;
+    int32_t  nano_ns;
+    uint8_t  fix_type;
+    uint8_t  flags;
+    uint8_t  num_sv;
+    int32_t  lon, lat;  // 1e-7 deg
+    int32_t  height_mm, h_msl_mm;
+    uint32_t h_acc_mm, v_acc_mm;
+    int32_t  vel_n_mm_s, vel_e_mm_s, vel_d_mm_s;
+
+    /**
+     * @return False if f is not a NAV-PVT, *this is left as it was
+     */
+    bool decode(const frame_t &f) {
+      if (!f.is(CLASS_NAV, ID_NAV_PVT) || f.len < LEN)
+        return false;
+
+      itow_ms    = f.u4(0);
+      year       = f.u2(4);
+      month      = f.u1(6);
+      day        = f.u1(7);
+      hour       = f.u1(8);
+      min        = f.u1(9);
+      sec        = f.u1(10);
+      valid      = f.u1(11);
+      nano_ns    = f.i4(16);
+      fix_type   = f.u1(20);
+      flags      = f.u1(21);
+      num_sv     = f.u1(23);
+      lon        = f.i4(24);
+      lat        = f.i4(28);
+      height_mm  = f.i4(32);
+      h_msl_mm   = f.i4(36);
+      h_acc_mm   = f.u4(40);
+      v_acc_mm   = f.u4(44);
+      vel_n_mm_s = f.i4(48);
+      vel_e_mm_s = f.i4(52);
+      vel_d_mm_s = f.i4(56);
+      return true;
+    }
+
+    /**
+     * Whole frame into dst, the fields not kept here zero (simulated
+     * receivers and test streams).
+     *
+     * @return Frame length, 0 if it did not fit in cap
+     */
+    size_t encode(uint8_t *dst, const size_t cap) const {
+      writer_t w(dst, cap, CLASS_NAV, ID_NAV_PVT);
+      w.u4(itow_ms).u2(year).u1(month).u1(day).u1(hour).u1(min).u1(sec).u1(valid);
+      w.u4(0).i4(nano_ns).u1(fix_type).u1(flags).u1(0).u1(num_sv);
+      w.i4(lon).i4(lat).i4(height_mm).i4(h_msl_mm).u4(h_acc_mm).u4(v_acc_mm);
+      w.i4(vel_n_mm_s).i4(vel_e_mm_s).i4(vel_d_mm_s);
+      w.zeros(LEN - 60);
+      return w.finish();
+    }
+
+    // A position fix the receiver vouches for, with a height in 3D
+    [[nodiscard]] bool fix_ok() const {
+      return (flags & FLAGS_FIX_OK) && fix_type >= FIX_2D && fix_type <= FIX_GNSS_DR;
+    }
+
+    [[nodiscard]] bool time_ok() const {
+      return (valid & (VALID_DATE | VALID_TIME)) == (VALID_DATE | VALID_TIME);
+    }
+
+    // UTC seconds since 1970, rounded down, from the date and time
+    [[nodiscard]] uint32_t unix_time() const {
+      const int32_t days = days_from_civil(year, month, day);
+      int64_t       t    = static_cast<int64_t>(days) * 86400 + hour * 3600 + min * 60 + sec;
+      if (nano_ns < 0)
+        --t;  // The fields are rounded to the nearest second
+      return static_cast<uint32_t>(t);
+    }
+
+    // Date and time fields, itow_ms and valid from UTC seconds since 1970 (GPS leap seconds ignored)
+    void set_time(const uint32_t unix_s, const uint32_t ms) {
+      int32_t  y;
+      uint32_t m, d;
+      civil_from_days(static_cast<int32_t>(unix_s / 86400), y, m, d);
+      year  = static_cast<uint16_t>(y);
+      month = static_cast<uint8_t>(m);
+      day   = static_cast<uint8_t>(d);
+      hour  = static_cast<uint8_t>(unix_s / 3600 % 24);
+      min   = static_cast<uint8_t>(unix_s / 60 % 60);
+      sec   = static_cast<uint8_t>(unix_s % 60);
+
+      // GPS weeks start on Sunday, 1970-01-01 was a Thursday
+      itow_ms = static_cast<uint32_t>((static_cast<uint64_t>(unix_s) + 4 * 86400) % (7 * 86400) * 1000 + ms);
+      nano_ns = static_cast<int32_t>(ms) * 1'000'000;
+      valid   = VALID_DATE | VALID_TIME;
+    }
+  };
+}  // namespace ubx
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_UBX_H
@@ -0,0 +1,386 @@
+/**
+ * Estimator micro-benchmarks: the Kalman filters in custom_kalman.h (xcore,
+ * and Kalman.h in float and double), vdt discretization against a lookup in
+ * a precomputed table, and the ISA76 pressure altitude (double formula and
+ * the float kernel SensorAltimeter uses).
+ *
+ * Same source on both sides:
+ *   - bench_estimator (host): Usage: bench_estimator [rounds], JSON on
+ *     stdout, ns from steady_clock and cycles from the TSC where there is
+ *     one (reference cycles, not core cycles).
+ *   - bench_estimator_m7: runs once the USB CDC port is opened, JSON on
+ *     Serial, cycles from the DWT counter and ns derived from SystemCoreClock.
+ *
+ * Each kernel runs in batches of BATCH calls on a fresh filter so P stays in
+ * the range it has in flight; "ns"/"cycles" are the mean per call over all
+ * batches, "min_ns"/"min_cycles" the fastest batch. "tick_5ms" adds up what
+ * CB_EvalFSM, CB_ReadIMU and CB_ReadAltimeter spend on these kernels per FSM
+ * tick (2 predicts, 1 acc update, 1/20 alt update and fast altitude), also given
+ * as a share of the 5 ms; the other "tick_5ms_*" are the same with the float
+ * dense, steady-state (on the constant gain, warmed up until they leave the
+ * initial fallback) and packed filters. "tick_5ms_fused_f32" is the fused
+ * estimator task instead: one predict and update per sample, none per tick.
+ * "adxl372_fifo_R*" is one 5 ms drain of the ADXL372 FIFO (32 sets at 6400 Hz
+ * through the timestamp loop and the decimator) at each decimation ratio.
+ */
+#include <Arduino.h>
+#include <ISA76.h>
+#include <UserSensorRegs.h>
+#include "custom_kalman.h"
+#include "hal_timing.h"
+#include <cstdio>
+
+#if RA_SIM
+#  include <chrono>
+#  if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#  endif
+#endif
+
+namespace {
+  constexpr size_t BATCH = 256;
+  constexpr size_t INPUTS = 64;  // Power of two
+
+#if RA_SIM
+  constexpr const char *TARGET         = "host";
+  constexpr size_t      DEFAULT_ROUNDS = 2000;
+#  if defined(__x86_64__) || defined(__i386__)
+  constexpr const char *CYCLE_SOURCE = "tsc";  // Reference cycles, not core cycles
+#  else
+  constexpr const char *CYCLE_SOURCE = "none";
+#  endif
+#else
+  constexpr const char *TARGET         = "stm32h725";
+  constexpr size_t      DEFAULT_ROUNDS = 200;
+  constexpr const char *CYCLE_SOURCE   = "dwt";
+#endif
+
+  struct stamp_t {
+    uint64_t ns;
+    uint64_t cycles;
+  };
+
+  stamp_t now() {
+#if RA_SIM
+    const auto t = std::chrono::steady_clock::now().time_since_epoch();
+#  if defined(__x86_64__) || defined(__i386__)
+    const uint64_t c = __rdtsc();
+#  else
+    const uint64_t c = 0;
+#  endif
+    return {static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t).count()), c};
+#else
+    return {0, hal::cycles()};
+#endif
+  }
+
+  struct result_t {
+    const char *name;
+    double      ns, cycles;
+    double      min_ns, min_cycles;
+  };
+
+  struct totals_t {
+    uint64_t ns     = 0;
+    uint64_t cycles = 0;
+    uint64_t min_ns = UINT64_MAX, min_cycles = UINT64_MAX;
+
+    void add(const stamp_t &t0, const stamp_t &t1) {
+      const uint64_t ns = t1.ns - t0.ns;
+#if RA_SIM
+      const uint64_t cycles = t1.cycles - t0.cycles;
+#else
+      const uint64_t cycles = static_cast<uint32_t>(t1.cycles - t0.cycles);  // Wraps at 2^32
+#endif
+      this->ns += ns;
+      this->cycles += cycles;
+      min_ns     = ns < min_ns ? ns : min_ns;
+      min_cycles = cycles < min_cycles ? cycles : min_cycles;
+    }
+
+    [[nodiscard]] result_t result(const char *name, const size_t rounds) const {
+      const double calls = static_cast<double>(rounds * BATCH);
+      result_t     r{name, ns / calls, cycles / calls, min_ns / static_cast<double>(BATCH), min_cycles / static_cast<double>(BATCH)};
+#if !RA_SIM
+      // No wall clock next to the DWT counter, derive ns from the core clock
+      const double ns_per_cycle = 1e9 / static_cast<double>(SystemCoreClock);
+      r.ns                      = r.cycles * ns_per_cycle;
+      r.min_ns                  = r.min_cycles * ns_per_cycle;
+#endif
+      return r;
+    }
+  };
+
+  volatile double sink;
+
+  double inputs[INPUTS];
+
+  void make_inputs() {
+    uint32_t rng = 0x12345678u;
+    for (double &x : inputs) {
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      x = static_cast<double>(rng) / 4294967295.0;  // [0, 1]
+    }
+  }
+
+  // prepare(Filter&) outside the timing, op(Filter&, i) BATCH times inside it
+  template<typename Filter, typename Prepare, typename Op>
+  result_t bench(const char *name, const size_t rounds, Prepare &&prepare, Op &&op) {
+    totals_t totals;
+    for (size_t r = 0; r < rounds; ++r) {
+      Filter filter;
+      prepare(filter);
+      const stamp_t t0 = now();
+      for (size_t i = 0; i < BATCH; ++i)
+        op(filter, i);
+      const stamp_t t1 = now();
+      totals.add(t0, t1);
+      sink = filter.kf.state();
+    }
+    return totals.result(name, rounds);
+  }
+
+  template<typename Op>
+  result_t bench(const char *name, const size_t rounds, Op &&op) {
+    totals_t totals;
+    for (size_t r = 0; r < rounds; ++r) {
+      const stamp_t t0 = now();
+      for (size_t i = 0; i < BATCH; ++i)
+        op(i);
+      const stamp_t t1 = now();
+      totals.add(t0, t1);
+    }
+    return totals.result(name, rounds);
+  }
+
+  constexpr size_t NUM_RESULTS = 28;
+
+  void run(const size_t rounds, result_t (&results)[NUM_RESULTS]) {
+    make_inputs();
+
+    xcore::vdt<FILTER_ORDER - 1> vdt(0.005);
+
+    // Element-wise, so the Kalman.h filters get the same F in their own scalar type
+    const auto init = [&](auto &filter) -> void {
+      const auto F = vdt.generate_F();
+      for (size_t i = 0; i < FILTER_ORDER; ++i)
+        for (size_t j = 0; j < FILTER_ORDER; ++j)
+          filter.F[i][j] = F[i][j];
+    };
+
+    // Warm-up updates so predict runs on a converged P, as in flight
+    const auto converged1 = [&](auto &filter) -> void {
+      init(filter);
+      for (size_t i = 0; i < 64; ++i) {
+        filter.kf.predict();
+        filter.kf.update({inputs[i % INPUTS]});
+      }
+    };
+
+    // Until the steady-state filter has left its initial fallback
+    const auto steady1 = [&](auto &filter) -> void {
+      init(filter);
+      solve_gains(filter, 1);
+      for (size_t i = 0; i < 4096 && !filter.kf.steady(); ++i) {
+        filter.kf.predict();
+        filter.kf.update({inputs[i % INPUTS]});
+      }
+    };
+
+    const auto converged2 = [&](auto &filter) -> void {
+      init(filter);
+      for (size_t i = 0; i < 64; ++i) {
+        filter.kf.predict();
+        filter.kf.update({inputs[i % INPUTS], inputs[(i + 1) % INPUTS]});
+      }
+    };
+
+    // Fused filter on 5 ms accelerometer samples, baro every 100 ms
+    const auto converged_fused = [&](auto &filter) -> void {
+      for (size_t i = 0; i < 64; ++i) {
+        filter.predict_to(filter.t_us + 5000u);
+        filter.update_acceleration(inputs[i % INPUTS]);
+        if (i % 20 == 0)
+          filter.update_altitude(inputs[(i + 1) % INPUTS]);
+      }
+    };
+
+    size_t k = 0;
+
+    results[k++] = bench<Filter1T>("kf_3_1_1_predict", rounds, converged1, [](Filter1T &f, size_t) {
+      f.kf.predict();
+    });
+    results[k++] = bench<Filter1T>("kf_3_1_1_update", rounds, converged1, [](Filter1T &f, const size_t i) {
+      f.kf.update({inputs[i % INPUTS]});
+    });
+    results[k++] = bench<Filter1S<float>>("kf_3_1_1_f32_predict", rounds, converged1, [](Filter1S<float> &f, size_t) {
+      f.kf.predict();
+    });
+    results[k++] = bench<Filter1S<float>>("kf_3_1_1_f32_update", rounds, converged1, [](Filter1S<float> &f, const size_t i) {
+      f.kf.update({inputs[i % INPUTS]});
+    });
+    results[k++] = bench<Filter1S<double>>("kf_3_1_1_f64_predict", rounds, converged1, [](Filter1S<double> &f, size_t) {
+      f.kf.predict();
+    });
+    results[k++] = bench<Filter1S<double>>("kf_3_1_1_f64_update", rounds, converged1, [](Filter1S<double> &f, const size_t i) {
+      f.kf.update({inputs[i % INPUTS]});
+    });
+    results[k++] = bench<Filter1SS<float>>("kf_3_1_1_ss_f32_predict", rounds, steady1, [](Filter1SS<float> &f, size_t) {
+      f.kf.predict();
+    });
+    results[k++] = bench<Filter1SS<float>>("kf_3_1_1_ss_f32_update", rounds, steady1, [](Filter1SS<float> &f, const size_t i) {
+      f.kf.update({inputs[i % INPUTS]});
+    });
+    results[k++] = bench<Filter1P<float>>("kf_3_1_1_packed_f32_predict", rounds, converged1, [](Filter1P<float> &f, size_t) {
+      f.kf.predict();
+    });
+    results[k++] = bench<Filter1P<float>>("kf_3_1_1_packed_f32_update", rounds, converged1, [](Filter1P<float> &f, const size_t i) {
+      f.kf.update({inputs[i % INPUTS]});
+    });
+    results[k++] = bench<Filter2T>("kf_3_2_1_predict", rounds, converged2, [](Filter2T &f, size_t) {
+      f.kf.predict();
+    });
+    results[k++] = bench<Filter2T>("kf_3_2_1_update", rounds, converged2, [](Filter2T &f, const size_t i) {
+      f.kf.update({inputs[i % INPUTS], inputs[(i + 1) % INPUTS]});
+    });
+    results[k++] = bench<Filter2S<float>>("kf_3_2_1_f32_update", rounds, converged2, [](Filter2S<float> &f, const size_t i) {
+      f.kf.update({inputs[i % INPUTS], inputs[(i + 1) % INPUTS]});
+    });
+    results[k++] = bench<Filter2P<float>>("kf_3_2_1_packed_f32_update", rounds, converged2, [](Filter2P<float> &f, const size_t i) {
+      f.kf.update({inputs[i % INPUTS], inputs[(i + 1) % INPUTS]});
+    });
+
+    const size_t fused_index = k;
+    results[k++]             = bench<FilterFused<float>>("kf_fused_f32_sample", rounds, converged_fused, [](FilterFused<float> &f, const size_t i) {
+      f.predict_to(f.t_us + 5000u);
+      f.update_acceleration(inputs[i % INPUTS]);
+    });
+
+    Filter1T target;
+    results[k++] = bench("vdt_generate_F", rounds, [&](const size_t i) {
+      vdt.update_dt(0.004 + 0.002 * inputs[i % INPUTS]);
+      target.F = vdt.generate_F();
+    });
+    sink = target.F[0][1];
+
+    static constexpr kalman::discretization_table_t<double, FILTER_ORDER - 1, 21> table(0.001, 0.);
+    results[k++] = bench("discretization_table_F", rounds, [&](const size_t i) {
+      const auto &F = table[4 + (i & 3)].F;
+      for (size_t r = 0; r < FILTER_ORDER; ++r)
+        for (size_t c = 0; c < FILTER_ORDER; ++c)
+          target.F[r][c] = F[r][c];
+    });
+    sink = target.F[0][1];
+
+    results[k++] = bench("altitude_msl_from_pressure", rounds, [](const size_t i) {
+      sink = altitude_msl_from_pressure(900.0 + 120.0 * inputs[i % INPUTS]);
+    });
+
+    static const isa76::qnh_t qnh;
+    const size_t              alt_index = k;
+    results[k++]                        = bench("altitude_msl_from_pressure_fast", rounds, [](const size_t i) {
+      sink = altitude_msl_from_pressure_fast(static_cast<float>(900.0 + 120.0 * inputs[i % INPUTS]), qnh);
+    });
+
+    // 32 sets per 5 ms read, on a 16-step ramp so the decimator sums change
+    static adxl372::code_t sets[32];
+    for (size_t i = 0; i < 32; ++i)
+      sets[i] = {static_cast<int16_t>(i % 16), 10, static_cast<int16_t>(-static_cast<int16_t>(i % 16))};
+
+    const auto fifo = [&](const char *name, const uint32_t ratio) -> result_t {
+      adxl372::stream_t<> stream(ratio);
+      uint32_t            t_us = 0;
+      SensorIMU::Sample   s{};
+      const result_t      r = bench(name, rounds, [&](size_t) {
+        stream.push(sets, 32, t_us += 5000, false);
+        stream.newest(s);
+      });
+
+      sink = s.acc_z;
+      return r;
+    };
+    results[k++] = fifo("adxl372_fifo_R32", 32);
+    results[k++] = fifo("adxl372_fifo_R16", 16);
+    results[k++] = fifo("adxl372_fifo_R8", 8);
+    results[k++] = fifo("adxl372_fifo_R6", 6);
+
+    // Derived: kernel cost of one 5 ms FSM tick, IMU at 5 ms and altimeter at 100 ms
+    const auto tick = [&](const char *name, const result_t &p1, const result_t &u1) -> result_t {
+      const result_t &alt = results[alt_index];
+      return {name,
+              2 * p1.ns + u1.ns + (u1.ns + alt.ns) / 20,
+              2 * p1.cycles + u1.cycles + (u1.cycles + alt.cycles) / 20,
+              2 * p1.min_ns + u1.min_ns + (u1.min_ns + alt.min_ns) / 20,
+              2 * p1.min_cycles + u1.min_cycles + (u1.min_cycles + alt.min_cycles) / 20};
+    };
+    results[k++] = tick("tick_5ms", results[0], results[1]);
+    results[k++] = tick("tick_5ms_f32", results[2], results[3]);
+    results[k++] = tick("tick_5ms_ss_f32", results[6], results[7]);
+    results[k++] = tick("tick_5ms_packed_f32", results[8], results[9]);
+
+    // Fused: one predict and update per accelerometer sample and per altimeter sample, none on the FSM tick
+    const result_t &fused = results[fused_index];
+    const result_t &alt   = results[alt_index];
+    results[k++]          = {"tick_5ms_fused_f32",
+                             fused.ns + (fused.ns + alt.ns) / 20,
+                             fused.cycles + (fused.cycles + alt.cycles) / 20,
+                             fused.min_ns + (fused.min_ns + alt.min_ns) / 20,
+                             fused.min_cycles + (fused.min_cycles + alt.min_cycles) / 20};
+  }
+
+  template<typename Out>
+  void print_json(Out &&out, const size_t rounds, const result_t (&results)[NUM_RESULTS]) {
+    char line[192];
+    snprintf(line, sizeof(line),
+             "{\"target\":\"%s\",\"clock_hz\":%lu,\"cycle_source\":\"%s\",\"batch\":%u,\"rounds\":%u,\"results\":[\n",
+             TARGET, RA_SIM ? 0ul : static_cast<unsigned long>(SystemCoreClock), CYCLE_SOURCE,
+             static_cast<unsigned>(BATCH), static_cast<unsigned>(rounds));
+    out(line);
+    for (size_t i = 0; i < NUM_RESULTS; ++i) {
+      const result_t &r = results[i];
+      snprintf(line, sizeof(line),
+               "  {\"name\":\"%s\",\"ns\":%.2f,\"cycles\":%.1f,\"min_ns\":%.2f,\"min_cycles\":%.1f}%s\n",
+               r.name, r.ns, r.cycles, r.min_ns, r.min_cycles, i + 1 < NUM_RESULTS ? "," : "");
+      out(line);
+    }
+    out("]");
+    for (const result_t &r : results) {
+      if (strncmp(r.name, "tick_", 5) != 0)
+        continue;
+      snprintf(line, sizeof(line), ",\"%s_cpu_percent\":%.4f", r.name, r.ns / 5e6 * 100);
+      out(line);
+    }
+    out("}\n");
+  }
+}  // namespace
+
+#if RA_SIM
+int main(const int argc, char **argv) {
+  const size_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 0) : DEFAULT_ROUNDS;
+  result_t     results[NUM_RESULTS];
+  run(rounds, results);
+  print_json([](const char *s) { fputs(s, stdout); }, rounds, results);
+  return 0;
+}
+#else
+void setup() {
+  Serial.begin();
+  hal::enable_cycle_counter();
+}
+
+void loop() {
+  // Run again every time the port is opened
+  static bool was_open = false;
+  const bool  open     = static_cast<bool>(Serial);
+  if (open && !was_open) {
+    delay(500);
+    static result_t results[NUM_RESULTS];
+    run(DEFAULT_ROUNDS, results);
+    print_json([](const char *s) { Serial.print(s); }, DEFAULT_ROUNDS, results);
+  }
+  was_open = open;
+  delay(100);
+}
+#endif
@@ -0,0 +1,107 @@
+/**
+ * Host-side benchmark: fast_fmt against the printf-based conversion that
+ * Arduino String and dtostrf use for floats.
+ *
+ * Usage: bench_format [records]
+ *
+ * Formats the same 18-field flight record as CB_ConstructData both ways and
+ * prints ns per record and per float field.
+ */
+#include <FastFormat.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+  struct sample_t {
+    uint32_t seq;
+    uint32_t ms;
+    double   f[13];
+    int      temp;
+  };
+
+  std::vector<sample_t> make_samples(const size_t n) {
+    std::vector<sample_t> v(n);
+    uint32_t              rng = 0x12345678u;
+    for (size_t i = 0; i < n; ++i) {
+      v[i].seq = static_cast<uint32_t>(i);
+      v[i].ms  = static_cast<uint32_t>(i * 10);
+      for (double &x : v[i].f) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        x = (static_cast<double>(rng) / 4294967295.0 - 0.5) * 4000.0;
+      }
+      v[i].temp = 30 + static_cast<int>(i % 20);
+    }
+    return v;
+  }
+
+  // What String += does today: one snprintf and one append per field
+  size_t format_printf(std::string &out, const sample_t &s) {
+    char buf[32];
+    out.clear();
+    out += "MFC,";
+    snprintf(buf, sizeof(buf), "%lu,", static_cast<unsigned long>(s.seq));
+    out += buf;
+    snprintf(buf, sizeof(buf), "%lu,", static_cast<unsigned long>(s.ms));
+    out += buf;
+    out += "COAST,";
+    for (const double x : s.f) {
+      snprintf(buf, sizeof(buf), "%.2f,", x);
+      out += buf;
+    }
+    snprintf(buf, sizeof(buf), "%d\n", s.temp);
+    out += buf;
+    return out.size();
+  }
+
+  size_t format_fast(char *out, const size_t cap, const sample_t &s) {
+    fast_fmt::csv_writer_t csv(out, cap);
+    csv << "MFC" << s.seq << s.ms << "COAST";
+    for (const double x : s.f)
+      csv << x;
+    csv << s.temp;
+    return csv.finish();
+  }
+
+  template<typename F>
+  double time_ns(const size_t n, F &&f) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i)
+      f(i);
+    const auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count();
+  }
+}  // namespace
+
+int main(const int argc, char **argv) {
+  const size_t n       = argc > 1 ? strtoul(argv[1], nullptr, 0) : 200000;
+  const auto   samples = make_samples(n);
+
+  std::string printf_out;
+  printf_out.reserve(256);
+  char   fast_out[256];
+  size_t sink = 0;
+
+  // Sanity: both produce the same text, exact ties may round differently
+  size_t mismatches = 0;
+  for (size_t i = 0; i < n; ++i) {
+    format_printf(printf_out, samples[i]);
+    format_fast(fast_out, sizeof(fast_out), samples[i]);
+    mismatches += printf_out != fast_out;
+  }
+
+  const double t_printf = time_ns(n, [&](const size_t i) { sink += format_printf(printf_out, samples[i]); });
+  const double t_fast   = time_ns(n, [&](const size_t i) { sink += format_fast(fast_out, sizeof(fast_out), samples[i]); });
+
+  constexpr size_t floats = sizeof(sample_t::f) / sizeof(double);
+  printf("records: %zu, mismatches: %zu (sink %zu)\n", n, mismatches, sink);
+  printf("%-10s %10s %12s\n", "", "ns/record", "ns/float");
+  printf("%-10s %10.1f %12.1f\n", "printf", t_printf / n, t_printf / n / floats);
+  printf("%-10s %10.1f %12.1f\n", "fast_fmt", t_fast / n, t_fast / n / floats);
+  printf("speedup: %.2fx\n", t_printf / t_fast);
+  return 0;
+}
@@ -0,0 +1,298 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_ARDUINO_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_ARDUINO_H
+
+/**
+ * Host stand-in for the parts of the STM32duino core the firmware uses.
+ * Time comes from the simulation's virtual clock, see sim.h.
+ */
+#include "./sim.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#define __WEAK __attribute__((weak))
+
+// --- Time --------------------------------------------------------------------
+
+inline uint32_t millis() {
+  return static_cast<uint32_t>(sim::now_us() / 1000u);
+}
+
+inline uint32_t micros() {
+  return static_cast<uint32_t>(sim::now_us());
+}
+
+/**
+ * Blocks the calling thread like the --wrap=delay osDelay on the target,
+ * before the kernel starts it just moves the clock.
+ */
+void delay(uint32_t ms);
+
+inline void delayMicroseconds(const uint32_t us) {
+  sim::advance_us(us);
+}
+
+// --- Core registers ----------------------------------------------------------
+
+inline uint32_t SystemCoreClock = 550000000u;
+
+// DWT->CYCCNT reads the virtual clock in CPU cycles
+struct sim_cycle_counter_t {
+  operator uint32_t() const {
+    return static_cast<uint32_t>(sim::now_us() * (SystemCoreClock / 1000000u));
+  }
+
+  sim_cycle_counter_t &operator=(uint32_t) {
+    return *this;
+  }
+};
+
+struct DWT_Type {
+  uint32_t            CTRL;
+  sim_cycle_counter_t CYCCNT;
+  uint32_t            LAR;
+};
+
+struct CoreDebug_Type {
+  uint32_t DEMCR;
+};
+
+inline DWT_Type       sim_dwt{};
+inline CoreDebug_Type sim_core_debug{};
+
+#define DWT                        (&sim_dwt)
+#define CoreDebug                  (&sim_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk     (1ul << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1ul << 24)
+
+// One thread runs at a time and nothing preempts it, masking is a no-op
+inline uint32_t __get_PRIMASK() { return 0; }
+inline void     __set_PRIMASK(uint32_t) {}
+inline void     __disable_irq() {}
+inline void     __enable_irq() {}
+
+// --- GPIO and ADC ------------------------------------------------------------
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+#define LOW          0x0
+#define HIGH         0x1
+
+#define SIM_PORT_PINS(p) \
+  p##0, p##1, p##2, p##3, p##4, p##5, p##6, p##7, p##8, p##9, p##10, p##11, p##12, p##13, p##14, p##15
+
+enum : uint32_t {
+  SIM_PORT_PINS(PA),
+  SIM_PORT_PINS(PB),
+  SIM_PORT_PINS(PC),
+  SIM_PORT_PINS(PD),
+  SIM_PORT_PINS(PE),
+  SIM_PORT_PINS(PF),
+  SIM_PORT_PINS(PG),
+  SIM_PORT_PINS(PH),
+  SIM_NUM_PINS
+};
+
+#undef SIM_PORT_PINS
+
+// Internal ADC channels
+constexpr uint32_t AVREF = 0x1000;
+constexpr uint32_t ATEMP = 0x1001;
+
+void     pinMode(uint32_t pin, uint32_t mode);
+void     digitalWrite(uint32_t pin, uint32_t value);
+int      digitalRead(uint32_t pin);
+uint32_t analogRead(uint32_t pin);
+
+#define CHANGE  2
+#define FALLING 3
+#define RISING  4
+
+using callback_function_t = std::function<void()>;
+
+// Edges come from the sim sensors, see sim::gpio_edge_at(); every edge runs the handler whatever the mode
+void attachInterrupt(uint32_t pin, callback_function_t callback, uint32_t mode);
+void detachInterrupt(uint32_t pin);
+
+inline uint32_t digitalPinToInterrupt(const uint32_t pin) {
+  return pin;
+}
+
+// analogRead() of AVREF/ATEMP already returns millivolts/degrees C
+#define LL_ADC_RESOLUTION_16B                                0
+#define __LL_ADC_CALC_VREFANALOG_VOLTAGE(raw, resolution)    (static_cast<int32_t>(raw))
+#define __LL_ADC_CALC_TEMPERATURE(vref_mv, raw, resolution) (static_cast<int32_t>(raw))
+
+// Servo timer, only passed through to STM32ServoList
+struct TIM_TypeDef {};
+#define TIMER_SERVO (static_cast<TIM_TypeDef *>(nullptr))
+
+// --- String ------------------------------------------------------------------
+
+class String {
+  std::string s_;
+
+public:
+  String() = default;
+  String(const char *str) : s_(str ? str : "") {}
+  String(const std::string &str) : s_(str) {}
+  explicit String(const char c) : s_(1, c) {}
+
+  template<typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+  explicit String(const T v) {
+    *this += v;
+  }
+
+  String(const double v, const unsigned decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    s_ = buf;
+  }
+
+  void reserve(const size_t n) { s_.reserve(n); }
+  [[nodiscard]] size_t      length() const { return s_.size(); }
+  [[nodiscard]] const char *c_str() const { return s_.c_str(); }
+
+  char &operator[](const size_t i) { return s_[i]; }
+  char  operator[](const size_t i) const { return s_[i]; }
+
+  void remove(const size_t index, const size_t count = std::string::npos) {
+    if (index < s_.size())
+      s_.erase(index, count);
+  }
+
+  String &operator+=(const char *str) {
+    s_ += str ? str : "";
+    return *this;
+  }
+
+  String &operator+=(const String &str) {
+    s_ += str.s_;
+    return *this;
+  }
+
+  String &operator+=(const char c) {
+    s_ += c;
+    return *this;
+  }
+
+  template<typename T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, char>, int> = 0>
+  String &operator+=(const T v) {
+    if constexpr (std::is_floating_point_v<T>) {
+      *this += String(static_cast<double>(v), 2);
+    } else if constexpr (std::is_signed_v<T>) {
+      s_ += std::to_string(static_cast<long long>(v));
+    } else {
+      s_ += std::to_string(static_cast<unsigned long long>(v));
+    }
+    return *this;
+  }
+
+  bool operator==(const char *str) const { return s_ == (str ? str : ""); }
+  bool operator==(const String &str) const { return s_ == str.s_; }
+  bool operator!=(const char *str) const { return !(*this == str); }
+};
+
+// --- Print, Stream and USB CDC -----------------------------------------------
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+public:
+  virtual ~Print() = default;
+
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t *buf, size_t len) {
+    size_t n = 0;
+    while (len--)
+      n += write(*buf++);
+    return n;
+  }
+
+  size_t write(const char *str) {
+    return str ? write(reinterpret_cast<const uint8_t *>(str), strlen(str)) : 0;
+  }
+
+  size_t write(const char *buf, const size_t len) {
+    return write(reinterpret_cast<const uint8_t *>(buf), len);
+  }
+
+  virtual void flush() {}
+
+  size_t print(const char *str) { return write(str); }
+  size_t print(const String &str) { return write(str.c_str()); }
+  size_t print(const char c) { return write(static_cast<uint8_t>(c)); }
+
+  template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char>, int> = 0>
+  size_t print(const T v, const int base = DEC) {
+    char buf[32];
+    if (base == HEX)
+      snprintf(buf, sizeof(buf), "%llx", static_cast<unsigned long long>(v));
+    else if constexpr (std::is_signed_v<T>)
+      snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(v));
+    else
+      snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(v));
+    return write(buf);
+  }
+
+  size_t print(const double v, const int digits = 2) {
+    return print(String(v, digits));
+  }
+
+  template<typename T>
+  size_t println(const T &v) {
+    return print(v) + println();
+  }
+
+  size_t println() { return write("\r\n"); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    char    buf[256];
+    va_list args;
+    va_start(args, format);
+    const int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return n > 0 ? write(reinterpret_cast<const uint8_t *>(buf), std::min<size_t>(n, sizeof(buf) - 1)) : 0;
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read()      = 0;
+  virtual int peek()      = 0;
+};
+
+/**
+ * USB CDC, output goes to stdout with --cdc and is dropped otherwise.
+ * Nothing is ever received.
+ */
+class USBSerial final : public Stream {
+public:
+  void begin(uint32_t = 0) {}
+  void end() {}
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t len) override;
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+  explicit operator bool() const { return true; }
+};
+
+extern USBSerial Serial;
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_ARDUINO_H
@@ -0,0 +1,6 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_FREERTOS_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_FREERTOS_H
+
+#include "./STM32FreeRTOS.h"
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_FREERTOS_H
@@ -0,0 +1,41 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_SPI_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_SPI_H
+
+#include "./Arduino.h"
+
+#define SPI_MODE0 0x00
+#define SPI_MODE3 0x03
+#define MSBFIRST  1
+
+struct SPISettings {
+  SPISettings() = default;
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+/**
+ * Host stand-in for the SPI bus. The simulated sensors never touch it,
+ * transfers read back 0xFF like an empty bus.
+ */
+class SPIClass {
+public:
+  void setMOSI(uint32_t) {}
+  void setMISO(uint32_t) {}
+  void setSCLK(uint32_t) {}
+  void setSSEL(uint32_t) {}
+
+  void begin() {}
+  void end() {}
+
+  void beginTransaction(const SPISettings &) {}
+  void endTransaction() {}
+
+  uint8_t transfer(uint8_t) { return 0xFF; }
+
+  void transfer(void *buf, const size_t len) {
+    memset(buf, 0xFF, len);
+  }
+};
+
+extern SPIClass SPI;
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_SPI_H
@@ -0,0 +1,152 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_STM32FREERTOS_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_STM32FREERTOS_H
+
+/**
+ * Host stand-in for STM32duino FreeRTOS: the FreeRTOS types and macros
+ * hal_rtos.h needs, and the CMSIS-RTOS2 calls it makes, implemented on host
+ * threads and the virtual clock in sim_kernel.cpp.
+ *
+ * Semantics follow the FreeRTOS port where the firmware can tell: 1 kHz
+ * tick, fixed priorities, FIFO among equal priorities, a woken higher
+ * priority thread runs at once, osDelayUntil() to a past tick returns
+ * immediately. There is no time slicing and no priority inheritance.
+ */
+#include <cstddef>
+#include <cstdint>
+
+// --- FreeRTOS ----------------------------------------------------------------
+
+using TickType_t  = uint32_t;
+using BaseType_t  = long;
+using UBaseType_t = unsigned long;
+
+#define configTICK_RATE_HZ ((TickType_t) 1000)
+#define portMAX_DELAY      ((TickType_t) 0xFFFFFFFFul)
+#define pdTRUE             ((BaseType_t) 1)
+#define pdFALSE            ((BaseType_t) 0)
+#define pdMS_TO_TICKS(ms)  ((TickType_t) (ms))
+
+// Only one thread runs at a time, a critical section is a no-op
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+// --- CMSIS-RTOS2 -------------------------------------------------------------
+
+using osThreadId_t       = void *;
+using osMutexId_t        = void *;
+using osSemaphoreId_t    = void *;
+using osMessageQueueId_t = void *;
+using osThreadFunc_t     = void (*)(void *);
+
+enum osStatus_t : int32_t {
+  osOK                 = 0,
+  osError              = -1,
+  osErrorTimeout       = -2,
+  osErrorResource      = -3,
+  osErrorParameter     = -4,
+  osErrorNoMemory      = -5,
+  osErrorISR           = -6,
+  osStatusReserved     = 0x7FFFFFFF
+};
+
+enum osPriority_t : int32_t {
+  osPriorityNone         = 0,
+  osPriorityIdle         = 1,
+  osPriorityLow          = 8,
+  osPriorityBelowNormal  = 16,
+  osPriorityNormal       = 24,
+  osPriorityAboveNormal  = 32,
+  osPriorityHigh         = 40,
+  osPriorityRealtime     = 48,
+  osPriorityISR          = 56,
+  osPriorityError        = -1
+};
+
+enum osKernelState_t : int32_t {
+  osKernelInactive = 0,
+  osKernelReady    = 1,
+  osKernelRunning  = 2
+};
+
+constexpr uint32_t osWaitForever = 0xFFFFFFFFu;
+
+constexpr uint32_t osFlagsWaitAny      = 0x00000000u;
+constexpr uint32_t osFlagsWaitAll      = 0x00000001u;
+constexpr uint32_t osFlagsNoClear      = 0x00000002u;
+constexpr uint32_t osFlagsError        = 0x80000000u;
+constexpr uint32_t osFlagsErrorTimeout = 0xFFFFFFFEu;
+
+constexpr uint32_t osMutexRecursive = 0x00000001u;
+
+struct osThreadAttr_t {
+  const char  *name;
+  uint32_t     attr_bits;
+  void        *cb_mem;
+  uint32_t     cb_size;
+  void        *stack_mem;
+  uint32_t     stack_size;
+  osPriority_t priority;
+  uint32_t     tz_module;
+  uint32_t     reserved;
+};
+
+struct osMutexAttr_t {
+  const char *name;
+  uint32_t    attr_bits;
+  void       *cb_mem;
+  uint32_t    cb_size;
+};
+
+struct osSemaphoreAttr_t {
+  const char *name;
+  uint32_t    attr_bits;
+  void       *cb_mem;
+  uint32_t    cb_size;
+};
+
+struct osMessageQueueAttr_t {
+  const char *name;
+  uint32_t    attr_bits;
+  void       *cb_mem;
+  uint32_t    cb_size;
+  void       *mq_mem;
+  uint32_t    mq_size;
+};
+
+osStatus_t      osKernelInitialize();
+osStatus_t      osKernelStart();
+osKernelState_t osKernelGetState();
+uint32_t        osKernelGetTickCount();
+uint32_t        osKernelGetTickFreq();
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr);
+osThreadId_t osThreadGetId();
+const char  *osThreadGetName(osThreadId_t thread_id);
+uint32_t     osThreadGetStackSpace(osThreadId_t thread_id);
+osStatus_t   osThreadYield();
+osStatus_t   osThreadSuspend(osThreadId_t thread_id);
+osStatus_t   osThreadResume(osThreadId_t thread_id);
+osStatus_t   osThreadTerminate(osThreadId_t thread_id);
+[[noreturn]] void osThreadExit();
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags);
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+osStatus_t osDelay(uint32_t ticks);
+osStatus_t osDelayUntil(uint32_t ticks);
+
+osMutexId_t osMutexNew(const osMutexAttr_t *attr);
+osStatus_t  osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout);
+osStatus_t  osMutexRelease(osMutexId_t mutex_id);
+
+osSemaphoreId_t osSemaphoreNew(uint32_t max_count, uint32_t initial_count, const osSemaphoreAttr_t *attr);
+osStatus_t      osSemaphoreAcquire(osSemaphoreId_t semaphore_id, uint32_t timeout);
+osStatus_t      osSemaphoreRelease(osSemaphoreId_t semaphore_id);
+uint32_t        osSemaphoreGetCount(osSemaphoreId_t semaphore_id);
+
+osMessageQueueId_t osMessageQueueNew(uint32_t msg_count, uint32_t msg_size, const osMessageQueueAttr_t *attr);
+osStatus_t         osMessageQueuePut(osMessageQueueId_t mq_id, const void *msg_ptr, uint8_t msg_prio, uint32_t timeout);
+osStatus_t         osMessageQueueGet(osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *msg_prio, uint32_t timeout);
+uint32_t           osMessageQueueGetCount(osMessageQueueId_t mq_id);
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_STM32FREERTOS_H
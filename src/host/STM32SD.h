@@ -0,0 +1,52 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_STM32SD_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_STM32SD_H
+
+/**
+ * Host stand-in for STM32SD: the card is the directory sim::options().sd_dir.
+ */
+#include "./Arduino.h"
+#include "./ff.h"
+
+#define FILE_READ  FA_READ
+#define FILE_WRITE (FA_READ | FA_WRITE | FA_OPEN_ALWAYS)
+
+class File final : public Stream {
+public:
+  FIL *_fil = nullptr;
+
+  File() = default;
+
+  explicit operator bool() const { return _fil != nullptr; }
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t len) override;
+
+  int read() override;
+  int read(void *buf, size_t len);
+  int available() override;
+  int peek() override;
+  void flush() override;
+
+  bool     seek(uint32_t pos);
+  uint32_t position() const;
+  uint32_t size() const;
+  void     close();
+};
+
+class SDClass {
+public:
+  void setDx(uint32_t, uint32_t, uint32_t, uint32_t) {}
+  void setCMD(uint32_t) {}
+  void setCK(uint32_t) {}
+
+  bool begin(uint32_t = 0, uint32_t = 0);
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool mkdir(const char *path);
+  File open(const char *path, uint8_t mode = FILE_READ);
+};
+
+extern SDClass SD;
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_STM32SD_H
@@ -0,0 +1,84 @@
+#ifndef STM32SERVO_H
+#define STM32SERVO_H
+
+/**
+ * Host stand-in for lib/STM32Servo: same interface, no timer. The flight
+ * model reads the pulse widths back through sim::servo_pulse().
+ */
+#include "./Arduino.h"
+
+constexpr uint32_t SERVO_MIN_PULSE_WIDTH     = 544;
+constexpr uint32_t SERVO_MAX_PULSE_WIDTH     = 2400;
+constexpr uint32_t SERVO_CEN_PULSE_WIDTH     = (SERVO_MIN_PULSE_WIDTH + SERVO_MAX_PULSE_WIDTH) / 2;
+constexpr uint32_t SERVO_DEFAULT_PULSE_WIDTH = 1500;
+
+constexpr uint32_t SERVO_MAX_PER_TIMER = 10;
+
+namespace detail {
+  struct servo_t {
+    uint32_t pin{};
+    bool     active{};
+    uint16_t pulse_us{SERVO_DEFAULT_PULSE_WIDTH};
+    uint16_t attach_us{SERVO_DEFAULT_PULSE_WIDTH};
+    uint32_t min_pulse{};
+    uint32_t max_pulse{};
+
+    void writeMicroseconds(uint16_t us) {
+      if (us < min_pulse) us = min_pulse;
+      if (us > max_pulse) us = max_pulse;
+      pulse_us = us;
+    }
+
+    void write(float deg) {
+      if (deg < 0.f) deg = 0.f;
+      if (deg > 180.f) deg = 180.f;
+      const float span = static_cast<float>(max_pulse - min_pulse);
+      pulse_us         = static_cast<uint16_t>(
+        std::lround(static_cast<float>(min_pulse) + (deg / 180.f) * span));
+    }
+  };
+}  // namespace detail
+
+class STM32ServoList {
+  detail::servo_t servos_[SERVO_MAX_PER_TIMER]{};
+  size_t          size_{0};
+
+public:
+  static inline STM32ServoList *s_active_ = nullptr;
+
+  explicit STM32ServoList(TIM_TypeDef *) {
+    s_active_ = this;
+  }
+
+  bool attach(const uint32_t pin,
+              const uint32_t min_pulse = SERVO_MIN_PULSE_WIDTH,
+              const uint32_t max_pulse = SERVO_MAX_PULSE_WIDTH,
+              const uint32_t value     = SERVO_CEN_PULSE_WIDTH) {
+    if (size_ >= SERVO_MAX_PER_TIMER)
+      return false;
+    detail::servo_t &s = servos_[size_++];
+    s.pin              = pin;
+    s.min_pulse        = min_pulse;
+    s.max_pulse        = max_pulse;
+    s.active           = true;
+    s.writeMicroseconds(static_cast<uint16_t>(value));
+    s.attach_us = s.pulse_us;
+    return true;
+  }
+
+  void enable(const size_t channel) {
+    if (channel < size_) servos_[channel].active = true;
+  }
+
+  void disable(const size_t channel) {
+    if (channel < size_) servos_[channel].active = false;
+  }
+
+  detail::servo_t &operator[](const size_t index) {
+    return servos_[index];
+  }
+
+  [[nodiscard]] size_t size() const { return size_; }
+};
+
+#endif  // STM32SERVO_H
@@ -0,0 +1,203 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIMSENSORS_H
+#define ROCKET_AVIONICS_TEMPLATE_SIMSENSORS_H
+
+/**
+ * Sensors for the host simulation, sampled from the sensor source in sim.h.
+ * Same axes and units as the hardware drivers in UserSensors.h.
+ */
+#include <LibAvionics.h>
+#include <UserSensorRegs.h>
+#include <cmath>
+#include "./sim.h"
+
+/**
+ * ADXL372 FIFO stand-in: read() yields every 6400 Hz set since the last
+ * one, quantized to the device's codes, through the driver's stream.
+ * int1 gets an edge when watermark_sets are buffered, like FIFO_RDY.
+ * Faults injected under name (sim::sensor_fault) apply to begin() and read().
+ */
+class IMU_Sim final : public SensorIMU {
+protected:
+  adxl372::stream_t<> stream;
+  adxl372::code_t     sets[adxl372::FIFO_SETS]{};
+  adxl372::code_t     held{};
+  uint64_t            last_ns   = 0;
+  uint64_t            sample_ns = adxl372::SAMPLE_NS;  // On the device's oscillator
+  const char         *name;
+  uint32_t            int1;
+  uint16_t            watermark_sets;
+
+  // FIFO_RDY rises once the sets after the last one read reach the watermark
+  void arm_watermark() const {
+    const uint64_t at_ns = last_ns + watermark_sets * sample_ns;
+    sim::gpio_edge_at(int1, (at_ns + 999) / 1000);
+  }
+
+public:
+  IMU_Sim(const char *name, const uint32_t decimation, const uint32_t int1, const uint16_t watermark_sets = 32)
+      : stream(decimation), name(name), int1(int1), watermark_sets(watermark_sets) {
+  }
+
+  bool begin() override {
+    if (sim::sensor_fault(name) == sim::Fault::FAIL)
+      return false;
+
+    sample_ns = static_cast<uint64_t>(adxl372::SAMPLE_NS / (1. + sim::options().sensor_clock_ppm * 1e-6));
+    last_ns   = sim::now_us() * 1000;
+    arm_watermark();
+    return true;
+  }
+
+  bool read(Data &out) override {
+    // Sets completed since the last read, the rest carries over; a failing device loses them
+    const sim::Fault fault   = sim::sensor_fault(name);
+    const uint64_t   now_ns  = sim::now_us() * 1000;
+    const uint64_t   due     = (now_ns - last_ns) / sample_ns;
+    const bool       overrun = due > adxl372::FIFO_SETS;
+    const size_t     n       = fault == sim::Fault::FAIL ? 0 : overrun ? adxl372::FIFO_SETS : static_cast<size_t>(due);
+    last_ns += due * sample_ns;
+
+    // A stuck device repeats its last set
+    for (size_t i = 0; i < n; ++i) {
+      if (fault != sim::Fault::STUCK) {
+        const sim::acc_t a = sim::imu_acc_g();
+        held               = {adxl372::code_of(a.x), adxl372::code_of(a.y), adxl372::code_of(a.z)};
+      }
+      sets[i] = held;
+    }
+    stream.push(sets, n, micros(), overrun);
+    arm_watermark();
+    if (n == 0)
+      return false;
+
+    if (fault == sim::Fault::RANGE) {
+      out = {NAN, NAN, NAN, 0., 0., 0.};
+      return true;
+    }
+
+    // out keeps the last decimated sample until the decimator yields the next
+    if (Sample latest; stream.newest(latest))
+      out = {latest.acc_x, latest.acc_y, latest.acc_z, 0., 0., 0.};
+    return true;
+  }
+
+  size_t raw_samples(const Sample *&first) override {
+    return stream.raw(first);
+  }
+
+  size_t decimated_samples(const Sample *&first) override {
+    return stream.decimated(first);
+  }
+};
+
+/**
+ * BMP581 stand-in, int gets an edge at each conversion of its ODR. Faults
+ * as IMU_Sim.
+ */
+class Altimeter_Sim final : public SensorAltimeter {
+protected:
+  const char *name;
+  uint32_t    int_pin;
+
+public:
+  Altimeter_Sim(const char *name, const uint32_t int_pin) : name(name), int_pin(int_pin) {
+  }
+
+  bool begin() override {
+    if (sim::sensor_fault(name) == sim::Fault::FAIL)
+      return false;
+
+    const auto period_us = static_cast<uint64_t>(1e6 / bmp581::ODR_HZ / (1. + sim::options().sensor_clock_ppm * 1e-6));
+    sim::gpio_edge_at(int_pin, sim::now_us() + period_us, period_us);
+    return true;
+  }
+
+  bool read(Data &out) override {
+    switch (sim::sensor_fault(name)) {
+      case sim::Fault::FAIL:
+        return false;
+      case sim::Fault::STUCK:
+        return true;
+      case sim::Fault::RANGE:
+        out = {0., NAN};
+        return true;
+      default:
+        break;
+    }
+
+    out.pressure_hpa = sim::altimeter_pressure_hpa();
+    out.altitude_m   = altitude_m(out.pressure_hpa);
+    return true;
+  }
+};
+
+/**
+ * u-blox receiver stand-in: a NAV-PVT every nav_ms into uart, as the DMA
+ * would take one in, from an edge on rx_pin; read() parses it with the
+ * driver's receiver. A failing receiver sends nothing, a stuck one repeats
+ * its last frame, one out of range sends a latitude past the pole.
+ */
+class GNSS_Sim final : public SensorGNSS {
+protected:
+  ubx::receiver_t rx;
+  const char     *name;
+  uint32_t        rx_pin;
+  uint16_t        nav_ms;
+  uint8_t         frame[ubx::OVERHEAD + ubx::nav_pvt_t::LEN]{};
+  size_t          frame_len = 0;
+
+  void send() {
+    const sim::Fault fault = sim::sensor_fault(name);
+    if (fault == sim::Fault::FAIL)
+      return;
+
+    if (fault != sim::Fault::STUCK || frame_len == 0) {
+      const sim::gnss_t fix    = sim::gnss_fix();
+      const uint64_t    now_ms = sim::now_us() / 1000;
+      ubx::nav_pvt_t    pvt{};
+      pvt.set_time(static_cast<uint32_t>(sim::options().gnss_utc_s + static_cast<double>(now_ms / 1000)),
+                   static_cast<uint32_t>(now_ms % 1000));
+      if (fix.fix) {
+        pvt.fix_type   = ubx::nav_pvt_t::FIX_3D;
+        pvt.flags      = ubx::nav_pvt_t::FLAGS_FIX_OK;
+        pvt.lat        = static_cast<int32_t>(std::lround(fix.latitude * 1e7));
+        pvt.lon        = static_cast<int32_t>(std::lround(fix.longitude * 1e7));
+        pvt.h_msl_mm   = static_cast<int32_t>(std::lround(fix.altitude_msl_m * 1e3));
+        pvt.height_mm  = pvt.h_msl_mm;
+        pvt.h_acc_mm   = static_cast<uint32_t>(sim::options().gnss_noise_m * 1e3);
+        pvt.v_acc_mm   = pvt.h_acc_mm * 3 / 2;
+        pvt.vel_d_mm_s = static_cast<int32_t>(std::lround(fix.vel_down_mps * 1e3));
+      }
+      pvt.num_sv = fix.satellites;
+      if (fault == sim::Fault::RANGE)
+        pvt.lat = 95 * 10'000'000;
+      frame_len = pvt.encode(frame, sizeof(frame));
+    }
+    rx.uart().feed(frame, frame_len);
+  }
+
+public:
+  GNSS_Sim(const char *name, hal::uart::rx_t &uart, const uint32_t rx_pin, const uint16_t nav_ms)
+      : rx(uart), name(name), rx_pin(rx_pin), nav_ms(nav_ms) {
+  }
+
+  bool begin() override {
+    if (sim::sensor_fault(name) == sim::Fault::FAIL)
+      return false;
+
+    const uint64_t period_us = nav_ms * 1000ull;
+    attachInterrupt(rx_pin, [this]() -> void { send(); }, RISING);
+    sim::gpio_edge_at(rx_pin, sim::now_us() + period_us, period_us);
+    return true;
+  }
+
+  bool read(Data &out) override {
+    return rx.read(out);
+  }
+
+  [[nodiscard]] ubx::receiver_t &receiver() {
+    return rx;
+  }
+};
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIMSENSORS_H
@@ -0,0 +1,30 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_WIRE_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_WIRE_H
+
+#include "./Arduino.h"
+
+/**
+ * Host stand-in for the I2C bus, no device ever answers.
+ */
+class TwoWire {
+public:
+  void setSDA(uint32_t) {}
+  void setSCL(uint32_t) {}
+  void begin() {}
+  void setClock(uint32_t) {}
+
+  void   beginTransmission(uint8_t) {}
+  size_t write(uint8_t) { return 1; }
+
+  uint8_t endTransmission(bool = true) {
+    return 2;  // NACK on address
+  }
+
+  uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+  int     available() { return 0; }
+  int     read() { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_WIRE_H
@@ -0,0 +1,32 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_DISKIO_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_DISKIO_H
+
+/**
+ * Host stand-in for the FatFs low level driver: the raw card is a sparse
+ * image file <sd_dir>.img of sim::options().card_bytes. It is separate from
+ * the FAT files in <sd_dir>, which is enough for the raw log region.
+ */
+#include "./ff.h"
+
+using DSTATUS = BYTE;
+
+enum DRESULT {
+  RES_OK = 0,
+  RES_ERROR,
+  RES_WRPRT,
+  RES_NOTRDY,
+  RES_PARERR
+};
+
+#define CTRL_SYNC        0
+#define GET_SECTOR_COUNT 1
+#define GET_SECTOR_SIZE  2
+#define GET_BLOCK_SIZE   3
+
+DSTATUS disk_initialize(BYTE pdrv);
+DSTATUS disk_status(BYTE pdrv);
+DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count);
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count);
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff);
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_DISKIO_H
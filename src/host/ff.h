@@ -0,0 +1,60 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_FF_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_FF_H
+
+/**
+ * Host stand-in for the FatFs calls the firmware makes, on files under
+ * sim::options().sd_dir. Paths are relative to the card root.
+ */
+#include <cstdint>
+
+using BYTE    = uint8_t;
+using WORD    = uint16_t;
+using DWORD   = uint32_t;
+using UINT    = unsigned int;
+using LBA_t   = DWORD;
+using FSIZE_t = DWORD;
+
+#define FF_USE_EXPAND 1
+
+enum FRESULT {
+  FR_OK = 0,
+  FR_DISK_ERR,
+  FR_INT_ERR,
+  FR_NOT_READY,
+  FR_NO_FILE,
+  FR_NO_PATH,
+  FR_INVALID_NAME,
+  FR_DENIED,
+  FR_EXIST,
+  FR_INVALID_OBJECT
+};
+
+#define FA_READ          0x01
+#define FA_WRITE         0x02
+#define FA_OPEN_EXISTING 0x00
+#define FA_CREATE_NEW    0x04
+#define FA_CREATE_ALWAYS 0x08
+#define FA_OPEN_ALWAYS   0x10
+#define FA_OPEN_APPEND   0x30
+
+struct FIL {
+  int     fd   = -1;
+  FSIZE_t fptr = 0;
+  BYTE    flag = 0;
+};
+
+FRESULT f_open(FIL *fp, const char *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_truncate(FIL *fp);
+FRESULT f_sync(FIL *fp);
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, BYTE opt);
+FSIZE_t f_size(const FIL *fp);
+
+inline FSIZE_t f_tell(const FIL *fp) {
+  return fp->fptr;
+}
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_FF_H
@@ -0,0 +1,157 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_SIM_H
+#define ROCKET_AVIONICS_TEMPLATE_SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Host simulation of the flight computer.
+ *
+ * The headers next to this one stand in for the Arduino core, STM32duino
+ * FreeRTOS (CMSIS-RTOS2), STM32SD/FatFs and STM32Servo, so src/main builds
+ * and runs unchanged on Linux:
+ *   - every RTOS thread is a host thread, but only one runs at a time and
+ *     the highest priority ready one is picked, like the kernel does;
+ *   - time is virtual: it only moves when every thread is blocked, straight
+ *     to the next wake-up, so code runs in zero simulated time and the whole
+ *     flight runs as fast as the host can switch threads;
+ *   - the SD card is a directory, the raw block device an image file;
+ *   - sensors are sampled from a 1-D flight model that deploys the drogue
+ *     when the firmware moves the deployment servo.
+ */
+namespace sim {
+  enum class Fault : uint8_t {
+    NONE = 0,
+    FAIL,   // Reads and begin() fail
+    STUCK,  // Reads repeat the last reading
+    RANGE,  // Reads return garbage out of the device's range
+  };
+
+  // A sensor misbehaving over [from_s, to_s) of simulated time
+  struct fault_t {
+    std::string sensor;  // As the firmware names it: imu0, altimeter0, ...
+    Fault       kind;
+    double      from_s;
+    double      to_s;
+  };
+
+  struct options_t {
+    double      duration_s = 120.0;     // Simulated time before exiting
+    std::string sd_dir     = "sim_sd";  // SD card root, created if missing
+    uint64_t    card_bytes = 4ull << 30;  // Raw block device size (sparse image <sd_dir>.img)
+    bool        cdc        = false;     // Echo USB CDC output to stdout
+    uint32_t    seed       = 1;
+
+    // Flight model
+    double ground_msl_m    = 100.0;  // Pad altitude
+    double pad_s           = 10.0;   // Time on the pad before ignition
+    double burn_s          = 0.8;    // Motor burn time
+    double thrust_g        = 15.0;   // Thrust acceleration, g (gravity not included)
+    double drag_k          = 0.001;  // Quadratic drag, 1/m (a = -k v |v|)
+    double drogue_vel      = 17.5;   // Descent rate under drogue, m/s
+    double main_vel        = 6.0;    // Descent rate under main, m/s
+    double main_alt_m      = 150.0;  // Main opens at this height above the pad
+    double imu_noise_g     = 0.02;   // Accelerometer noise, 1 sigma
+    double baro_noise_hpa  = 0.02;   // Pressure noise, 1 sigma
+    double pad_lat_deg     = 13.7;   // Pad position, the flight goes straight up from it
+    double pad_lon_deg     = 100.5;
+    double gnss_noise_m    = 2.0;         // GNSS position noise, 1 sigma
+    double gnss_utc_s      = 1767225600;  // UTC at simulated time 0 (2026-01-01)
+
+    // Sensor oscillators run fast by this against the MCU clock, so data-ready edges drift across the RTOS ticks
+    double sensor_clock_ppm = 2000.0;
+
+    // --fault=<sensor>:<fail|stuck|range>:<from s>:<to s>, repeatable
+    std::vector<fault_t> faults;
+  };
+
+  options_t &options();
+
+  /**
+   * Parse --name=value arguments into options().
+   *
+   * @return False on an unknown argument (usage printed)
+   */
+  bool parse_args(int argc, char **argv);
+
+  // --- Virtual clock ---------------------------------------------------------
+
+  uint64_t now_us();
+
+  /**
+   * Busy wait: move the clock forward without giving up the CPU.
+   */
+  void advance_us(uint64_t us);
+
+  // --- Kernel ----------------------------------------------------------------
+
+  [[nodiscard]] bool kernel_running();
+
+  /**
+   * Called by the kernel when the simulated duration is over, or on deadlock.
+   * Runs the at_finish() hooks, prints a summary and exits the process.
+   */
+  [[noreturn]] void finish(int code);
+
+  void at_finish(void (*hook)());
+
+  struct kernel_stats_t {
+    uint64_t switches;
+    size_t   threads;
+  };
+
+  kernel_stats_t kernel_stats();
+
+  // --- Sensor source ---------------------------------------------------------
+  // Sampled at the virtual clock by the sensors in SimSensors.h. The flight
+  // model (sim_flight.cpp) defines these, a log replay can define its own.
+
+  struct acc_t {
+    double x, y, z;  // g
+  };
+
+  acc_t imu_acc_g();
+
+  double altimeter_pressure_hpa();
+
+  struct gnss_t {
+    bool    fix;
+    double  latitude, longitude;  // deg
+    double  altitude_msl_m;
+    double  vel_down_mps;
+    uint8_t satellites;
+  };
+
+  gnss_t gnss_fix();
+
+  /**
+   * Fault injected into sensor at the current time, from options().faults
+   */
+  Fault sensor_fault(const char *sensor);
+
+  // --- Peripherals -----------------------------------------------------------
+
+  /**
+   * Servo channel pulse as last written, and the one it was attached with.
+   *
+   * @return False if no such channel
+   */
+  bool servo_pulse(size_t channel, uint16_t &pulse_us, uint16_t &attach_us, uint16_t &min_us, uint16_t &max_us);
+
+  /**
+   * Raise an edge on a GPIO at t_us, then every period_us if that is not 0,
+   * replacing whatever was pending on the pin. The kernel runs the handler
+   * attachInterrupt() gave the pin like an interrupt: once the clock reaches
+   * t_us, at the next kernel call, before any thread is picked.
+   */
+  void gpio_edge_at(uint32_t pin, uint64_t t_us, uint64_t period_us = 0);
+
+  /**
+   * Run the pin's attached handler, called by the kernel for a due edge.
+   */
+  void gpio_isr(uint32_t pin);
+}  // namespace sim
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_SIM_H
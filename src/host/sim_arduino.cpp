@@ -0,0 +1,223 @@
+/**
+ * Arduino core globals, simulation options and process exit.
+ */
+#include "./Arduino.h"
+#include "./SPI.h"
+#include "./STM32FreeRTOS.h"
+#include "./STM32Servo.h"
+#include "./Wire.h"
+#include <chrono>
+#include <vector>
+
+USBSerial Serial;
+SPIClass  SPI;
+TwoWire   Wire;
+
+namespace {
+  uint8_t             pin_state[SIM_NUM_PINS]{};
+  callback_function_t pin_isr[SIM_NUM_PINS];
+
+  std::vector<void (*)()> &finish_hooks() {
+    static std::vector<void (*)()> hooks;
+    return hooks;
+  }
+
+  const auto wall_start = std::chrono::steady_clock::now();
+}  // namespace
+
+size_t USBSerial::write(const uint8_t *buf, const size_t len) {
+  if (sim::options().cdc)
+    fwrite(buf, 1, len, stdout);
+  return len;
+}
+
+void pinMode(uint32_t, uint32_t) {}
+
+void digitalWrite(const uint32_t pin, const uint32_t value) {
+  if (pin < SIM_NUM_PINS)
+    pin_state[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(const uint32_t pin) {
+  return pin < SIM_NUM_PINS ? pin_state[pin] : LOW;
+}
+
+void attachInterrupt(const uint32_t pin, callback_function_t callback, uint32_t) {
+  if (pin < SIM_NUM_PINS)
+    pin_isr[pin] = std::move(callback);
+}
+
+void detachInterrupt(const uint32_t pin) {
+  if (pin < SIM_NUM_PINS)
+    pin_isr[pin] = nullptr;
+}
+
+void sim::gpio_isr(const uint32_t pin) {
+  if (pin < SIM_NUM_PINS && pin_isr[pin])
+    pin_isr[pin]();
+}
+
+uint32_t analogRead(const uint32_t pin) {
+  switch (pin) {
+    case AVREF:
+      return 3300;  // mV
+    case ATEMP:
+      return 35;  // degrees C
+    default:
+      return 0;
+  }
+}
+
+void delay(const uint32_t ms) {
+  if (sim::kernel_running())
+    osDelay(ms);
+  else
+    sim::advance_us(static_cast<uint64_t>(ms) * 1000u);
+}
+
+sim::options_t &sim::options() {
+  static options_t opts;
+  return opts;
+}
+
+namespace {
+  // <sensor>:<kind>:<from s>:<to s>
+  bool parse_fault(const char *spec, std::vector<sim::fault_t> &faults) {
+    char   sensor[32], kind[16];
+    double from_s, to_s;
+    if (sscanf(spec, "%31[^:]:%15[^:]:%lf:%lf", sensor, kind, &from_s, &to_s) != 4)
+      return false;
+
+    sim::Fault fault;
+    if (strcmp(kind, "fail") == 0)
+      fault = sim::Fault::FAIL;
+    else if (strcmp(kind, "stuck") == 0)
+      fault = sim::Fault::STUCK;
+    else if (strcmp(kind, "range") == 0)
+      fault = sim::Fault::RANGE;
+    else
+      return false;
+
+    faults.push_back({sensor, fault, from_s, to_s});
+    return true;
+  }
+}  // namespace
+
+bool sim::parse_args(const int argc, char **argv) {
+  options_t &o = options();
+
+  struct double_arg_t {
+    const char *name;
+    double     *value;
+  };
+
+  const double_arg_t doubles[] = {
+    {"--duration=", &o.duration_s},
+    {"--ground-msl=", &o.ground_msl_m},
+    {"--pad=", &o.pad_s},
+    {"--burn=", &o.burn_s},
+    {"--thrust=", &o.thrust_g},
+    {"--drag=", &o.drag_k},
+    {"--drogue-vel=", &o.drogue_vel},
+    {"--main-vel=", &o.main_vel},
+    {"--main-alt=", &o.main_alt_m},
+    {"--imu-noise=", &o.imu_noise_g},
+    {"--baro-noise=", &o.baro_noise_hpa},
+    {"--pad-lat=", &o.pad_lat_deg},
+    {"--pad-lon=", &o.pad_lon_deg},
+    {"--gnss-noise=", &o.gnss_noise_m},
+    {"--sensor-ppm=", &o.sensor_clock_ppm},
+  };
+
+  for (int i = 1; i < argc; ++i) {
+    const char *arg     = argv[i];
+    bool        matched = false;
+
+    for (const double_arg_t &d : doubles) {
+      const size_t n = strlen(d.name);
+      if (strncmp(arg, d.name, n) == 0) {
+        *d.value = strtod(arg + n, nullptr);
+        matched  = true;
+        break;
+      }
+    }
+
+    if (matched)
+      continue;
+
+    if (strncmp(arg, "--sd=", 5) == 0) {
+      o.sd_dir = arg + 5;
+    } else if (strncmp(arg, "--card-bytes=", 13) == 0) {
+      o.card_bytes = strtoull(arg + 13, nullptr, 0);
+    } else if (strncmp(arg, "--seed=", 7) == 0) {
+      o.seed = static_cast<uint32_t>(strtoul(arg + 7, nullptr, 0));
+    } else if (strcmp(arg, "--cdc") == 0) {
+      o.cdc = true;
+    } else if (strncmp(arg, "--fault=", 8) == 0 && parse_fault(arg + 8, o.faults)) {
+      continue;
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--duration=s] [--sd=dir] [--card-bytes=n] [--seed=n] [--cdc]\n"
+              "          [--ground-msl=m] [--pad=s] [--burn=s] [--thrust=g] [--drag=k]\n"
+              "          [--drogue-vel=m/s] [--main-vel=m/s] [--main-alt=m]\n"
+              "          [--imu-noise=g] [--baro-noise=hPa] [--sensor-ppm=ppm]\n"
+              "          [--pad-lat=deg] [--pad-lon=deg] [--gnss-noise=m]\n"
+              "          [--fault=sensor:fail|stuck|range:from_s:to_s ...]\n",
+              argv[0]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+sim::Fault sim::sensor_fault(const char *sensor) {
+  const double t_s = static_cast<double>(now_us()) * 1e-6;
+  for (const fault_t &f : options().faults)
+    if (t_s >= f.from_s && t_s < f.to_s && f.sensor == sensor)
+      return f.kind;
+  return Fault::NONE;
+}
+
+void sim::at_finish(void (*hook)()) {
+  finish_hooks().push_back(hook);
+}
+
+void sim::finish(const int code) {
+  for (void (*hook)() : finish_hooks())
+    hook();
+
+  const double sim_s  = static_cast<double>(now_us()) * 1e-6;
+  const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  const auto   stats  = kernel_stats();
+
+  fflush(stdout);
+  fprintf(stderr,
+          "[sim] %s after %.3f s simulated in %.3f s wall (x%.0f), %zu threads, %llu switches\n",
+          code == 0 ? "finished" : "deadlocked",
+          sim_s,
+          wall_s,
+          wall_s > 0. ? sim_s / wall_s : 0.,
+          stats.threads,
+          static_cast<unsigned long long>(stats.switches));
+  fflush(stderr);
+
+  // The RTOS threads are parked inside the kernel, don't run destructors
+  std::_Exit(code);
+}
+
+bool sim::servo_pulse(const size_t channel,
+                      uint16_t    &pulse_us,
+                      uint16_t    &attach_us,
+                      uint16_t    &min_us,
+                      uint16_t    &max_us) {
+  STM32ServoList *servos = STM32ServoList::s_active_;
+  if (!servos || channel >= servos->size())
+    return false;
+  const detail::servo_t &s = (*servos)[channel];
+  pulse_us                 = s.pulse_us;
+  attach_us                = s.attach_us;
+  min_us                   = static_cast<uint16_t>(s.min_pulse);
+  max_us                   = static_cast<uint16_t>(s.max_pulse);
+  return true;
+}
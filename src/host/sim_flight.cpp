@@ -0,0 +1,161 @@
+/**
+ * 1-D flight model behind the simulated sensors.
+ *
+ * Pad, boost at constant thrust, coast with quadratic drag, then descent at
+ * the drogue rate once the firmware moves servo channel 0 away from where it
+ * was attached, and at the main rate below options().main_alt_m. It is
+ * stepped lazily up to the virtual clock whenever a sensor is read.
+ */
+#include "./sim.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace sim {
+  namespace {
+    constexpr double   G       = 9.80665;
+    constexpr uint64_t STEP_US = 1000;
+    constexpr double   STEP_S  = static_cast<double>(STEP_US) * 1e-6;
+    constexpr double   TAU_S   = 1.0;  // Time constant to reach a parachute's descent rate
+
+    enum class Phase : uint8_t {
+      PAD,
+      BOOST,
+      COAST,
+      DROGUE,
+      MAIN,
+      LANDED
+    };
+
+    struct model_t {
+      Phase    phase = Phase::PAD;
+      double   h     = 0.;  // m above the pad
+      double   v     = 0.;  // m/s, up
+      double   a     = 0.;  // m/s^2, up
+      uint64_t t_us  = 0;
+      uint64_t ignition_us = static_cast<uint64_t>(options().pad_s * 1e6);
+
+      std::mt19937                     rng{options().seed};
+      std::normal_distribution<double> normal{0., 1.};
+
+      // Apart, so that GNSS fixes leave the IMU and barometer noise as it was
+      std::mt19937                     gnss_rng{options().seed + 1};
+      std::normal_distribution<double> gnss_normal{0., 1.};
+    };
+
+    model_t &model() {
+      static model_t m;
+      return m;
+    }
+
+    void event(const model_t &m, const char *what) {
+      fprintf(stderr, "[sim] T%+8.3f s  %-9s h=%8.1f m  v=%7.1f m/s\n",
+              (static_cast<double>(m.t_us) - static_cast<double>(m.ignition_us)) * 1e-6,
+              what, m.h, m.v);
+    }
+
+    // True once the firmware has moved the drogue servo far enough from its attach position
+    bool drogue_released() {
+      uint16_t pulse, attach, min, max;
+      if (!servo_pulse(0, pulse, attach, min, max) || max <= min)
+        return false;
+      return std::abs(static_cast<int>(pulse) - static_cast<int>(attach)) * 4 > static_cast<int>(max - min);
+    }
+
+    void step(model_t &m) {
+      const options_t &o = options();
+
+      switch (m.phase) {
+        case Phase::PAD:
+          m.a = 0.;
+          if (m.t_us >= m.ignition_us) {
+            m.phase = Phase::BOOST;
+            event(m, "liftoff");
+          }
+          break;
+
+        case Phase::BOOST:
+          m.a = o.thrust_g * G - G - o.drag_k * m.v * std::abs(m.v);
+          if (static_cast<double>(m.t_us - m.ignition_us) * 1e-6 >= o.burn_s) {
+            m.phase = Phase::COAST;
+            event(m, "burnout");
+          }
+          break;
+
+        case Phase::COAST:
+          m.a = -G - o.drag_k * m.v * std::abs(m.v);
+          break;
+
+        case Phase::DROGUE:
+          m.a = (-o.drogue_vel - m.v) / TAU_S;
+          if (m.h <= o.main_alt_m) {
+            m.phase = Phase::MAIN;
+            event(m, "main");
+          }
+          break;
+
+        case Phase::MAIN:
+          m.a = (-o.main_vel - m.v) / TAU_S;
+          break;
+
+        case Phase::LANDED:
+          return;
+      }
+
+      if ((m.phase == Phase::BOOST || m.phase == Phase::COAST) && drogue_released()) {
+        m.phase = Phase::DROGUE;
+        event(m, "drogue");
+      }
+
+      const double v_prev = m.v;
+      m.v += m.a * STEP_S;
+      m.h += 0.5 * (v_prev + m.v) * STEP_S;
+
+      if (v_prev > 0. && m.v <= 0.)
+        event(m, "apogee");
+
+      if (m.phase != Phase::PAD && m.h <= 0. && m.v < 0.) {
+        event(m, "touchdown");
+        m.phase = Phase::LANDED;
+        m.h = m.v = m.a = 0.;
+      }
+    }
+
+    model_t &advance() {
+      model_t &m = model();
+      for (const uint64_t now = now_us(); m.t_us + STEP_US <= now; m.t_us += STEP_US)
+        step(m);
+      return m;
+    }
+  }  // namespace
+
+  acc_t imu_acc_g() {
+    model_t &m = advance();
+    return {0., 0., (m.a + G) / G + options().imu_noise_g * m.normal(m.rng)};
+  }
+
+  double altimeter_pressure_hpa() {
+    model_t &m = advance();
+    return 1013.25 * std::pow(1. - 2.25577e-5 * (options().ground_msl_m + m.h), 5.25588) +
+           options().baro_noise_hpa * m.normal(m.rng);
+  }
+
+  gnss_t gnss_fix() {
+    constexpr double M_PER_DEG = 111'320.;
+
+    model_t         &m = advance();
+    const options_t &o = options();
+    const double     n = o.gnss_noise_m * m.gnss_normal(m.gnss_rng);
+    const double     e = o.gnss_noise_m * m.gnss_normal(m.gnss_rng);
+    const double     u = 1.5 * o.gnss_noise_m * m.gnss_normal(m.gnss_rng);
+    return {
+      true,
+      o.pad_lat_deg + n / M_PER_DEG,
+      o.pad_lon_deg + e / (M_PER_DEG * std::cos(o.pad_lat_deg * M_PI / 180.)),
+      o.ground_msl_m + m.h + u,
+      -m.v,
+      12,
+    };
+  }
+}  // namespace sim
@@ -0,0 +1,687 @@
+/**
+ * CMSIS-RTOS2 on host threads and a virtual clock, see STM32FreeRTOS.h.
+ *
+ * Every thread waits on its own condition variable until it is `current`.
+ * A thread that blocks picks the next one itself (schedule()), hands it the
+ * baton and waits. When nothing is ready the clock jumps to the earliest
+ * timeout. All kernel state is guarded by one mutex; user code runs outside
+ * it, but only ever on the current thread.
+ *
+ * GPIO edges (sim::gpio_edge_at) stand in for interrupts. A due edge runs
+ * its handler inside schedule(), under the mutex and ahead of the pick, so
+ * a task the handler notifies competes for the CPU like after a real ISR.
+ */
+#include "./STM32FreeRTOS.h"
+#include "./sim.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+extern "C" void ra_trace_task_switched_in(void *tcb);
+
+namespace {
+  enum class State : uint8_t {
+    READY,
+    BLOCKED,
+    SUSPENDED,
+    TERMINATED
+  };
+
+  // Host stack per thread; the target stack size is only used for reporting
+  constexpr size_t  host_stack_size = 256u * 1024u;
+  constexpr uint8_t stack_paint     = 0xA5;
+
+  struct tcb_t {
+    std::string    name;
+    osThreadFunc_t func       = nullptr;
+    void          *arg        = nullptr;
+    osPriority_t   priority   = osPriorityNormal;
+    uint32_t       stack_size = 0;  // Bytes, as requested
+    uint8_t       *stack      = nullptr;
+
+    State    state     = State::READY;
+    uint64_t ready_seq = 0;  // FIFO order among equal priorities
+
+    // Blocking
+    const void *wait_on   = nullptr;
+    bool        timed     = false;
+    bool        timed_out = false;
+    uint64_t    wake_us   = 0;
+
+    // Thread flags
+    uint32_t flags        = 0;
+    uint32_t wait_flags   = 0;
+    uint32_t wait_options = 0;
+
+    std::condition_variable cv;
+  };
+
+  struct mutex_cb_t {
+    tcb_t   *owner     = nullptr;
+    uint32_t count     = 0;
+    bool     recursive = false;
+  };
+
+  struct semaphore_cb_t {
+    uint32_t count = 0;
+    uint32_t max   = 0;
+  };
+
+  struct queue_cb_t {
+    uint32_t                          capacity = 0;
+    uint32_t                          msg_size = 0;
+    std::deque<std::vector<uint8_t>> msgs;
+    char                              getters = 0;  // Wait keys
+    char                              putters = 0;
+  };
+
+  struct edge_t {
+    uint32_t pin;
+    uint64_t at_us;
+    uint64_t period_us;  // 0: once
+  };
+
+  struct kernel_t {
+    std::mutex            lock;
+    tcb_t                 main_ctx;  // setup() before osKernelStart()
+    tcb_t                *current = &main_ctx;
+    std::vector<tcb_t *>  threads;
+    std::atomic<uint64_t> now{0};
+    uint64_t              seq      = 0;
+    uint64_t              switches = 0;
+    osKernelState_t       state    = osKernelInactive;
+    std::vector<edge_t>   edges;
+    bool                  in_isr = false;  // An edge handler runs, the mutex is already held
+  };
+
+  // Constructed on first use, the firmware creates mutexes during static init
+  kernel_t &kernel() {
+    static kernel_t *k = new kernel_t();
+    return *k;
+  }
+
+  using lock_t = std::unique_lock<std::mutex>;
+
+  uint64_t end_us() {
+    return static_cast<uint64_t>(sim::options().duration_s * 1e6);
+  }
+
+  uint64_t tick_start_us(const uint64_t now) {
+    return now - now % 1000u;
+  }
+
+  void make_ready(tcb_t *t) {
+    kernel_t &k  = kernel();
+    t->state     = State::READY;
+    t->wait_on   = nullptr;
+    t->timed     = false;
+    t->ready_seq = ++k.seq;
+  }
+
+  tcb_t *pick_ready() {
+    tcb_t *best = nullptr;
+    for (tcb_t *t : kernel().threads) {
+      if (t->state != State::READY)
+        continue;
+      if (!best || t->priority > best->priority ||
+          (t->priority == best->priority && t->ready_seq < best->ready_seq))
+        best = t;
+    }
+    return best;
+  }
+
+  // Timeouts that are due, also after a busy wait moved the clock
+  void release_timeouts(const uint64_t now) {
+    for (tcb_t *t : kernel().threads) {
+      if (t->state == State::BLOCKED && t->timed && t->wake_us <= now) {
+        make_ready(t);
+        t->timed_out = true;
+      }
+    }
+  }
+
+  // Edge handlers that are due, in time order
+  void raise_edges(const uint64_t now) {
+    kernel_t &k = kernel();
+    for (;;) {
+      edge_t *due = nullptr;
+      for (edge_t &e : k.edges)
+        if (e.at_us <= now && (!due || e.at_us < due->at_us))
+          due = &e;
+      if (!due)
+        return;
+
+      const uint32_t pin = due->pin;
+      if (due->period_us)
+        due->at_us += due->period_us;
+      else
+        k.edges.erase(k.edges.begin() + (due - k.edges.data()));
+
+      k.in_isr = true;
+      sim::gpio_isr(pin);
+      k.in_isr = false;
+    }
+  }
+
+  /**
+   * Next thread to run, moving the clock to the earliest timeout or edge if none is ready.
+   */
+  tcb_t *schedule() {
+    kernel_t &k = kernel();
+    for (;;) {
+      raise_edges(k.now);
+      release_timeouts(k.now);
+      if (tcb_t *t = pick_ready())
+        return t;
+
+      uint64_t wake = UINT64_MAX;
+      for (const tcb_t *t : k.threads)
+        if (t->state == State::BLOCKED && t->timed && t->wake_us < wake)
+          wake = t->wake_us;
+      for (const edge_t &e : k.edges)
+        if (e.at_us < wake)
+          wake = e.at_us;
+
+      if (wake == UINT64_MAX) {
+        fprintf(stderr, "[sim] Deadlock: every thread is blocked without a timeout\n");
+        sim::finish(1);
+      }
+      if (wake >= end_us()) {
+        k.now = end_us();
+        sim::finish(0);
+      }
+
+      // Idle until then
+      if (k.current != nullptr) {
+        ra_trace_task_switched_in(nullptr);
+        k.current = nullptr;
+      }
+      k.now = wake;
+    }
+  }
+
+  /**
+   * Give the CPU to whoever should run now; returns once the caller runs again.
+   */
+  void reschedule(lock_t &l) {
+    kernel_t &k    = kernel();
+    tcb_t    *self = k.current;
+    tcb_t    *next = schedule();
+    if (next == k.current)
+      return;
+
+    k.current = next;
+    ++k.switches;
+    ra_trace_task_switched_in(next);
+    next->cv.notify_one();
+
+    if (!self)
+      self = &k.main_ctx;  // Only reachable from osKernelStart()
+    self->cv.wait(l, [&] { return k.current == self; });
+  }
+
+  /**
+   * Block the current thread on `key` until woken or `timeout` ticks pass.
+   *
+   * @return False on timeout
+   */
+  bool block(lock_t &l, const void *key, const uint32_t timeout) {
+    kernel_t &k    = kernel();
+    tcb_t    *self = k.current;
+    self->state    = State::BLOCKED;
+    self->wait_on  = key;
+    self->timed    = timeout != osWaitForever;
+    self->wake_us  = tick_start_us(k.now) + static_cast<uint64_t>(timeout) * 1000u;
+    self->timed_out = false;
+    reschedule(l);
+    return !self->timed_out;
+  }
+
+  /**
+   * Highest priority thread blocked on `key`, ties go to the oldest thread.
+   */
+  tcb_t *first_waiter(const void *key) {
+    tcb_t *best = nullptr;
+    for (tcb_t *t : kernel().threads) {
+      if (t->state != State::BLOCKED || t->wait_on != key)
+        continue;
+      if (!best || t->priority > best->priority)
+        best = t;
+    }
+    return best;
+  }
+
+  // A woken thread of higher priority preempts the caller
+  void preempt(lock_t &l, const tcb_t *woken) {
+    const tcb_t *self = kernel().current;
+    if (self && woken->priority > self->priority)
+      reschedule(l);
+  }
+
+  void *thread_entry(void *arg) {
+    auto     *t = static_cast<tcb_t *>(arg);
+    kernel_t &k = kernel();
+    {
+      lock_t l(k.lock);
+      t->cv.wait(l, [&] { return k.current == t; });
+    }
+    t->func(t->arg);
+    osThreadExit();
+  }
+
+  bool flags_satisfied(const tcb_t *t) {
+    if (t->wait_options & osFlagsWaitAll)
+      return (t->flags & t->wait_flags) == t->wait_flags;
+    return (t->flags & t->wait_flags) != 0;
+  }
+
+  // Set flags on t, true if that ends its wait
+  bool set_flags(tcb_t *t, const uint32_t flags) {
+    t->flags |= flags;
+    if (t->state == State::BLOCKED && t->wait_on == &t->flags && flags_satisfied(t)) {
+      make_ready(t);
+      return true;
+    }
+    return false;
+  }
+
+  uint32_t take_flags(tcb_t *t) {
+    const uint32_t result = t->flags;
+    if (!(t->wait_options & osFlagsNoClear))
+      t->flags &= ~t->wait_flags;
+    return result;
+  }
+}  // namespace
+
+// --- Simulation interface ------------------------------------------------------
+
+uint64_t sim::now_us() {
+  return kernel().now.load(std::memory_order_relaxed);
+}
+
+void sim::advance_us(const uint64_t us) {
+  kernel().now += us;
+}
+
+void sim::gpio_edge_at(const uint32_t pin, const uint64_t t_us, const uint64_t period_us) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  for (edge_t &e : k.edges) {
+    if (e.pin == pin) {
+      e = {pin, t_us, period_us};
+      return;
+    }
+  }
+  k.edges.push_back({pin, t_us, period_us});
+}
+
+bool sim::kernel_running() {
+  return kernel().state == osKernelRunning;
+}
+
+sim::kernel_stats_t sim::kernel_stats() {
+  return {kernel().switches, kernel().threads.size()};
+}
+
+// --- Kernel ----------------------------------------------------------------------
+
+osStatus_t osKernelInitialize() {
+  kernel().state = osKernelReady;
+  return osOK;
+}
+
+osStatus_t osKernelStart() {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  k.state                = osKernelRunning;
+  k.main_ctx.state       = State::TERMINATED;
+  k.current              = nullptr;
+  reschedule(l);
+  return osError;  // Unreachable, the simulation exits from a thread
+}
+
+osKernelState_t osKernelGetState() {
+  return kernel().state;
+}
+
+uint32_t osKernelGetTickCount() {
+  return static_cast<uint32_t>(sim::now_us() / 1000u);
+}
+
+uint32_t osKernelGetTickFreq() {
+  return configTICK_RATE_HZ;
+}
+
+// --- Threads ---------------------------------------------------------------------
+
+osThreadId_t osThreadNew(const osThreadFunc_t func, void *argument, const osThreadAttr_t *attr) {
+  auto *t       = new tcb_t();
+  t->func       = func;
+  t->arg        = argument;
+  t->name       = attr && attr->name ? attr->name : "thread";
+  t->priority   = attr && attr->priority != osPriorityNone ? attr->priority : osPriorityNormal;
+  t->stack_size = attr && attr->stack_size ? attr->stack_size : 4096u;
+  t->stack      = new uint8_t[host_stack_size];
+  memset(t->stack, stack_paint, host_stack_size);
+
+  kernel_t &k = kernel();
+  {
+    lock_t l(k.lock);
+    make_ready(t);
+    k.threads.push_back(t);
+  }
+
+  pthread_attr_t pattr;
+  pthread_attr_init(&pattr);
+  pthread_attr_setstack(&pattr, t->stack, host_stack_size);
+  pthread_t handle;
+  const int rc = pthread_create(&handle, &pattr, thread_entry, t);
+  pthread_attr_destroy(&pattr);
+  if (rc != 0) {
+    lock_t l(k.lock);
+    t->state = State::TERMINATED;
+    return nullptr;
+  }
+  pthread_detach(handle);
+
+  if (k.state == osKernelRunning) {
+    lock_t l(k.lock);
+    preempt(l, t);
+  }
+  return t;
+}
+
+osThreadId_t osThreadGetId() {
+  tcb_t *t = kernel().current;
+  return t == &kernel().main_ctx ? nullptr : t;
+}
+
+const char *osThreadGetName(const osThreadId_t thread_id) {
+  return thread_id ? static_cast<tcb_t *>(thread_id)->name.c_str() : nullptr;
+}
+
+/**
+ * Untouched bytes of the requested stack size, from the host stack's
+ * high-water mark. Host frames are larger than Cortex-M7 ones, so this only
+ * shows trends.
+ */
+uint32_t osThreadGetStackSpace(const osThreadId_t thread_id) {
+  if (!thread_id)
+    return 0;
+  const auto *t     = static_cast<const tcb_t *>(thread_id);
+  size_t      clean = 0;
+  while (clean < host_stack_size && t->stack[clean] == stack_paint)
+    ++clean;
+  const size_t used = host_stack_size - clean;
+  return used < t->stack_size ? static_cast<uint32_t>(t->stack_size - used) : 0u;
+}
+
+osStatus_t osThreadYield() {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  k.current->ready_seq = ++k.seq;
+  reschedule(l);
+  return osOK;
+}
+
+osStatus_t osThreadSuspend(const osThreadId_t thread_id) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *t = static_cast<tcb_t *>(thread_id);
+  if (!t || t->state == State::TERMINATED)
+    return osErrorResource;
+  t->state = State::SUSPENDED;
+  if (t == k.current)
+    reschedule(l);
+  return osOK;
+}
+
+osStatus_t osThreadResume(const osThreadId_t thread_id) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *t = static_cast<tcb_t *>(thread_id);
+  if (!t || t->state != State::SUSPENDED)
+    return osErrorResource;
+  make_ready(t);
+  preempt(l, t);
+  return osOK;
+}
+
+osStatus_t osThreadTerminate(const osThreadId_t thread_id) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *t = static_cast<tcb_t *>(thread_id);
+  if (!t || t->state == State::TERMINATED)
+    return osErrorResource;
+  t->state = State::TERMINATED;
+  if (t == k.current)
+    reschedule(l);  // Never comes back
+  return osOK;
+}
+
+void osThreadExit() {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  k.current->state = State::TERMINATED;
+  reschedule(l);
+  for (;;) {}  // Never scheduled again
+}
+
+uint32_t osThreadFlagsSet(const osThreadId_t thread_id, const uint32_t flags) {
+  kernel_t &k = kernel();
+  auto     *t = static_cast<tcb_t *>(thread_id);
+  if (!t)
+    return osFlagsError;
+
+  // From an edge handler: schedule() picks next
+  if (k.in_isr) {
+    set_flags(t, flags);
+    return t->flags;
+  }
+
+  lock_t l(k.lock);
+  const bool     woken  = set_flags(t, flags);
+  const uint32_t result = t->flags;
+  if (woken)
+    preempt(l, t);
+  return result;
+}
+
+uint32_t osThreadFlagsWait(const uint32_t flags, const uint32_t options, const uint32_t timeout) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  tcb_t    *self    = k.current;
+  self->wait_flags   = flags;
+  self->wait_options = options;
+  if (flags_satisfied(self))
+    return take_flags(self);
+  if (timeout == 0)
+    return osFlagsErrorTimeout;
+  if (!block(l, &self->flags, timeout))
+    return osFlagsErrorTimeout;
+  return take_flags(self);
+}
+
+osStatus_t osDelay(const uint32_t ticks) {
+  if (ticks == 0)
+    return osThreadYield();
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  block(l, nullptr, ticks);
+  return osOK;
+}
+
+osStatus_t osDelayUntil(const uint32_t ticks) {
+  const uint32_t delay = ticks - osKernelGetTickCount();
+  if (delay == 0 || (delay >> 31) != 0)
+    return osErrorParameter;  // Already past, as the FreeRTOS port does
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  block(l, nullptr, delay);
+  return osOK;
+}
+
+// --- Mutexes -----------------------------------------------------------------------
+
+osMutexId_t osMutexNew(const osMutexAttr_t *attr) {
+  auto *m      = new mutex_cb_t();
+  m->recursive = attr && (attr->attr_bits & osMutexRecursive);
+  return m;
+}
+
+osStatus_t osMutexAcquire(const osMutexId_t mutex_id, const uint32_t timeout) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *m = static_cast<mutex_cb_t *>(mutex_id);
+  if (!m)
+    return osErrorParameter;
+
+  if (!m->owner) {
+    m->owner = k.current;
+    m->count = 1;
+    return osOK;
+  }
+  if (m->owner == k.current) {
+    if (!m->recursive)
+      return osErrorResource;
+    ++m->count;
+    return osOK;
+  }
+  if (timeout == 0)
+    return osErrorResource;
+  return block(l, m, timeout) ? osOK : osErrorTimeout;  // Ownership is handed over by release
+}
+
+osStatus_t osMutexRelease(const osMutexId_t mutex_id) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *m = static_cast<mutex_cb_t *>(mutex_id);
+  if (!m || m->owner != k.current)
+    return osErrorResource;
+  if (--m->count)
+    return osOK;
+
+  if (tcb_t *w = first_waiter(m)) {
+    m->owner = w;
+    m->count = 1;
+    make_ready(w);
+    preempt(l, w);
+  } else {
+    m->owner = nullptr;
+  }
+  return osOK;
+}
+
+// --- Semaphores --------------------------------------------------------------------
+
+osSemaphoreId_t osSemaphoreNew(const uint32_t max_count, const uint32_t initial_count, const osSemaphoreAttr_t *) {
+  auto *s  = new semaphore_cb_t();
+  s->max   = max_count;
+  s->count = initial_count;
+  return s;
+}
+
+osStatus_t osSemaphoreAcquire(const osSemaphoreId_t semaphore_id, const uint32_t timeout) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *s = static_cast<semaphore_cb_t *>(semaphore_id);
+  if (!s)
+    return osErrorParameter;
+  if (s->count) {
+    --s->count;
+    return osOK;
+  }
+  if (timeout == 0)
+    return osErrorResource;
+  return block(l, s, timeout) ? osOK : osErrorTimeout;  // Token is handed over by release
+}
+
+osStatus_t osSemaphoreRelease(const osSemaphoreId_t semaphore_id) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *s = static_cast<semaphore_cb_t *>(semaphore_id);
+  if (!s)
+    return osErrorParameter;
+  if (tcb_t *w = first_waiter(s)) {
+    make_ready(w);
+    preempt(l, w);
+    return osOK;
+  }
+  if (s->count >= s->max)
+    return osErrorResource;
+  ++s->count;
+  return osOK;
+}
+
+uint32_t osSemaphoreGetCount(const osSemaphoreId_t semaphore_id) {
+  const auto *s = static_cast<const semaphore_cb_t *>(semaphore_id);
+  return s ? s->count : 0;
+}
+
+// --- Message queues ----------------------------------------------------------------
+
+osMessageQueueId_t osMessageQueueNew(const uint32_t msg_count, const uint32_t msg_size, const osMessageQueueAttr_t *) {
+  auto *q     = new queue_cb_t();
+  q->capacity = msg_count;
+  q->msg_size = msg_size;
+  return q;
+}
+
+osStatus_t osMessageQueuePut(const osMessageQueueId_t mq_id, const void *msg_ptr, uint8_t, const uint32_t timeout) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *q = static_cast<queue_cb_t *>(mq_id);
+  if (!q || !msg_ptr)
+    return osErrorParameter;
+
+  while (q->msgs.size() >= q->capacity) {
+    if (timeout == 0)
+      return osErrorResource;
+    if (!block(l, &q->putters, timeout))
+      return osErrorTimeout;
+  }
+
+  const auto *bytes = static_cast<const uint8_t *>(msg_ptr);
+  q->msgs.emplace_back(bytes, bytes + q->msg_size);
+  if (tcb_t *w = first_waiter(&q->getters)) {
+    make_ready(w);
+    preempt(l, w);
+  }
+  return osOK;
+}
+
+osStatus_t osMessageQueueGet(const osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *msg_prio, const uint32_t timeout) {
+  kernel_t &k = kernel();
+  lock_t    l(k.lock);
+  auto     *q = static_cast<queue_cb_t *>(mq_id);
+  if (!q || !msg_ptr)
+    return osErrorParameter;
+
+  while (q->msgs.empty()) {
+    if (timeout == 0)
+      return osErrorResource;
+    if (!block(l, &q->getters, timeout))
+      return osErrorTimeout;
+  }
+
+  memcpy(msg_ptr, q->msgs.front().data(), q->msg_size);
+  q->msgs.pop_front();
+  if (msg_prio)
+    *msg_prio = 0;
+  if (tcb_t *w = first_waiter(&q->putters)) {
+    make_ready(w);
+    preempt(l, w);
+  }
+  return osOK;
+}
+
+uint32_t osMessageQueueGetCount(const osMessageQueueId_t mq_id) {
+  const auto *q = static_cast<const queue_cb_t *>(mq_id);
+  return q ? static_cast<uint32_t>(q->msgs.size()) : 0;
+}
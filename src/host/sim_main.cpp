@@ -0,0 +1,18 @@
+/**
+ * Process entry for the host simulation: the firmware's setup() starts the
+ * kernel, which only returns through sim::finish().
+ */
+#include "./sim.h"
+
+void setup();
+void loop();
+
+int main(int argc, char **argv) {
+  if (!sim::parse_args(argc, argv))
+    return 2;
+
+  setup();
+
+  for (;;)
+    loop();
+}
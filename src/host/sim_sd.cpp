@@ -0,0 +1,237 @@
+/**
+ * SD card stand-in: FatFs calls on plain files, the raw block device on an
+ * image file, and the STM32SD File/SD classes on top of the FatFs calls.
+ */
+#include "./STM32SD.h"
+#include "./diskio.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SDClass SD;
+
+namespace {
+  std::string host_path(const char *path) {
+    while (*path == '/')
+      ++path;
+    return sim::options().sd_dir + "/" + path;
+  }
+
+  off_t file_size(const int fd) {
+    struct stat st {};
+    return fstat(fd, &st) == 0 ? st.st_size : 0;
+  }
+
+  int image_fd = -1;
+
+  int image() {
+    if (image_fd < 0) {
+      const std::string path = sim::options().sd_dir + ".img";
+      image_fd               = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+      if (image_fd >= 0 && static_cast<uint64_t>(file_size(image_fd)) != sim::options().card_bytes)
+        ftruncate(image_fd, static_cast<off_t>(sim::options().card_bytes));  // Sparse
+    }
+    return image_fd;
+  }
+}  // namespace
+
+// --- FatFs -----------------------------------------------------------------------
+
+FRESULT f_open(FIL *fp, const char *path, const BYTE mode) {
+  int flags = (mode & FA_WRITE) ? ((mode & FA_READ) ? O_RDWR : O_WRONLY) : O_RDONLY;
+  if (mode & FA_CREATE_ALWAYS)
+    flags |= O_CREAT | O_TRUNC;
+  else if (mode & FA_CREATE_NEW)
+    flags |= O_CREAT | O_EXCL;
+  else if (mode & FA_OPEN_ALWAYS)
+    flags |= O_CREAT;
+
+  fp->fd = ::open(host_path(path).c_str(), flags, 0644);
+  if (fp->fd < 0)
+    return errno == ENOENT ? FR_NO_FILE : (errno == EEXIST ? FR_EXIST : FR_DENIED);
+  fp->flag = mode;
+  fp->fptr = (mode & FA_OPEN_APPEND) == FA_OPEN_APPEND ? static_cast<FSIZE_t>(file_size(fp->fd)) : 0;
+  return FR_OK;
+}
+
+FRESULT f_close(FIL *fp) {
+  if (fp->fd < 0)
+    return FR_INVALID_OBJECT;
+  ::close(fp->fd);
+  fp->fd = -1;
+  return FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, const UINT btr, UINT *br) {
+  const ssize_t n = pread(fp->fd, buff, btr, fp->fptr);
+  if (n < 0)
+    return FR_DISK_ERR;
+  fp->fptr += static_cast<FSIZE_t>(n);
+  *br = static_cast<UINT>(n);
+  return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, const UINT btw, UINT *bw) {
+  if (!(fp->flag & FA_WRITE))
+    return FR_DENIED;
+  const ssize_t n = pwrite(fp->fd, buff, btw, fp->fptr);
+  if (n < 0)
+    return FR_DISK_ERR;
+  fp->fptr += static_cast<FSIZE_t>(n);
+  *bw = static_cast<UINT>(n);
+  return FR_OK;
+}
+
+// Seeking past the end of a writable file extends it, as FatFs does
+FRESULT f_lseek(FIL *fp, const FSIZE_t ofs) {
+  if (ofs > f_size(fp) && (fp->flag & FA_WRITE) && ftruncate(fp->fd, ofs) != 0)
+    return FR_DISK_ERR;
+  fp->fptr = ofs <= f_size(fp) ? ofs : f_size(fp);
+  return FR_OK;
+}
+
+FRESULT f_truncate(FIL *fp) {
+  return ftruncate(fp->fd, fp->fptr) == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_sync(FIL *fp) {
+  return fp->fd >= 0 ? FR_OK : FR_INVALID_OBJECT;
+}
+
+FRESULT f_expand(FIL *fp, const FSIZE_t fsz, BYTE) {
+  if (f_size(fp) != 0)
+    return FR_DENIED;
+  return ftruncate(fp->fd, fsz) == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+FSIZE_t f_size(const FIL *fp) {
+  return static_cast<FSIZE_t>(file_size(fp->fd));
+}
+
+// --- Low level driver --------------------------------------------------------------
+
+DSTATUS disk_initialize(BYTE) {
+  return image() >= 0 ? 0 : 1;
+}
+
+DSTATUS disk_status(BYTE) {
+  return image() >= 0 ? 0 : 1;
+}
+
+DRESULT disk_read(BYTE, BYTE *buff, const LBA_t sector, const UINT count) {
+  const size_t len = static_cast<size_t>(count) * 512u;
+  return image() >= 0 && pread(image(), buff, len, static_cast<off_t>(sector) * 512) == static_cast<ssize_t>(len)
+           ? RES_OK
+           : RES_ERROR;
+}
+
+DRESULT disk_write(BYTE, const BYTE *buff, const LBA_t sector, const UINT count) {
+  const size_t len = static_cast<size_t>(count) * 512u;
+  return image() >= 0 && pwrite(image(), buff, len, static_cast<off_t>(sector) * 512) == static_cast<ssize_t>(len)
+           ? RES_OK
+           : RES_ERROR;
+}
+
+DRESULT disk_ioctl(BYTE, const BYTE cmd, void *buff) {
+  switch (cmd) {
+    case CTRL_SYNC:
+      return RES_OK;
+    case GET_SECTOR_COUNT:
+      *static_cast<LBA_t *>(buff) = static_cast<LBA_t>(sim::options().card_bytes / 512u);
+      return RES_OK;
+    case GET_SECTOR_SIZE:
+      *static_cast<WORD *>(buff) = 512;
+      return RES_OK;
+    case GET_BLOCK_SIZE:
+      *static_cast<DWORD *>(buff) = 1;
+      return RES_OK;
+    default:
+      return RES_PARERR;
+  }
+}
+
+// --- STM32SD -----------------------------------------------------------------------
+
+size_t File::write(const uint8_t *buf, const size_t len) {
+  UINT n = 0;
+  return _fil && f_write(_fil, buf, static_cast<UINT>(len), &n) == FR_OK ? n : 0;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::read(void *buf, const size_t len) {
+  UINT n = 0;
+  return _fil && f_read(_fil, buf, static_cast<UINT>(len), &n) == FR_OK ? static_cast<int>(n) : -1;
+}
+
+int File::available() {
+  return _fil ? static_cast<int>(f_size(_fil) - f_tell(_fil)) : 0;
+}
+
+int File::peek() {
+  if (!_fil)
+    return -1;
+  const FSIZE_t pos = f_tell(_fil);
+  const int     c   = read();
+  f_lseek(_fil, pos);
+  return c;
+}
+
+void File::flush() {
+  if (_fil)
+    f_sync(_fil);
+}
+
+bool File::seek(const uint32_t pos) {
+  return _fil && f_lseek(_fil, pos) == FR_OK;
+}
+
+uint32_t File::position() const {
+  return _fil ? f_tell(_fil) : 0;
+}
+
+uint32_t File::size() const {
+  return _fil ? f_size(_fil) : 0;
+}
+
+void File::close() {
+  if (!_fil)
+    return;
+  f_close(_fil);
+  delete _fil;
+  _fil = nullptr;
+}
+
+bool SDClass::begin(uint32_t, uint32_t) {
+  ::mkdir(sim::options().sd_dir.c_str(), 0755);
+  struct stat st {};
+  return stat(sim::options().sd_dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool SDClass::exists(const char *path) {
+  struct stat st {};
+  return stat(host_path(path).c_str(), &st) == 0;
+}
+
+bool SDClass::remove(const char *path) {
+  return ::unlink(host_path(path).c_str()) == 0;
+}
+
+bool SDClass::mkdir(const char *path) {
+  return ::mkdir(host_path(path).c_str(), 0755) == 0;
+}
+
+File SDClass::open(const char *path, const uint8_t mode) {
+  File file;
+  file._fil = new FIL();
+  if (f_open(file._fil, path, mode) != FR_OK) {
+    delete file._fil;
+    file._fil = nullptr;
+  }
+  return file;
+}
@@ -0,0 +1,49 @@
+/**
+ * Host check of the float ISA76 kernel against the double formula.
+ *
+ * Usage: isa76_check [qnh_hpa ...]
+ *
+ * Runs altitude_msl_from_pressure_fast on every float pressure from 300 to
+ * 1100 hPa (about 16M values) for each QNH (default 950, 1013.25 and 1050 hPa)
+ * and prints the largest deviation from altitude_msl_from_pressure. Exits 1
+ * if it exceeds isa76::fast::MAX_ERROR_M.
+ */
+#include <ISA76.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(const int argc, char **argv) {
+  std::vector<double> qnhs;
+  for (int i = 1; i < argc; ++i)
+    qnhs.push_back(strtod(argv[i], nullptr));
+  if (qnhs.empty())
+    qnhs = {950.0, 1013.25, 1050.0};
+
+  constexpr float P_MIN = 300.0f;
+  constexpr float P_MAX = 1100.0f;
+
+  bool failed = false;
+  for (const double qnh_hpa : qnhs) {
+    const isa76::qnh_t qnh(qnh_hpa * 100.0);
+
+    double max_error = 0.0, max_at = P_MIN;
+    size_t count     = 0;
+    for (float p = P_MIN; p <= P_MAX; p = std::nextafter(p, P_MAX + 1.0f), ++count) {
+      const double exact = altitude_msl_from_pressure(p, qnh_hpa);
+      const double error = std::abs(static_cast<double>(altitude_msl_from_pressure_fast(p, qnh)) - exact);
+      if (error > max_error) {
+        max_error = error;
+        max_at    = p;
+      }
+    }
+
+    const bool ok = max_error <= isa76::fast::MAX_ERROR_M;
+    printf("QNH %8.2f hPa: %zu pressures, max error %.4f m at %.4f hPa%s\n", qnh_hpa, count, max_error, max_at,
+           ok ? "" : " (over the bound)");
+    failed |= !ok;
+  }
+
+  printf("bound %.4f m: %s\n", static_cast<double>(isa76::fast::MAX_ERROR_M), failed ? "FAILED" : "ok");
+  return failed ? 1 : 0;
+}
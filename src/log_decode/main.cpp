@@ -0,0 +1,66 @@
+/**
+ * Host-side log decoder, turns any flight log into CSV with a column header.
+ *
+ * Usage: log_decode <log file> [out.csv]
+ *
+ * Accepts the SD card files (CSV or BIN, preallocated or not) and the files
+ * written by raw_extract, see LogReader.h for the formats.
+ *
+ * Annotation lines ("#PROF,..." and the like) are dropped from the output.
+ */
+#include <LogReader.h>
+#include <cstdio>
+
+int main(const int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <log file> [out.csv]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  if (!log_reader::read_file(argv[1], data)) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  FILE *out = argc > 2 ? fopen(argv[2], "wb") : stdout;
+  if (!out) {
+    fprintf(stderr, "Cannot create %s\n", argv[2]);
+    return 1;
+  }
+
+  log_reader::stats_t stats;
+  std::string         error;
+
+  const bool ok = log_reader::decode(
+    data,
+    [&](const log_reader::info_t &info) -> void {
+      if (info.format == log_reader::Format::LEGACY_CSV) {
+        fprintf(stderr, "Legacy CSV log, %zu columns\n", log_reader::split(info.column_line, ',').size());
+      } else {
+        const log_reader::layout_t &layout = info.layout;
+        if (!info.hash_ok)
+          fprintf(stderr, "Warning: schema hash mismatch (header %08x, computed %08x)\n", layout.hash, layout.compute_hash());
+        fprintf(stderr, "%s %s log, schema %08x (%s), %zu columns\n", layout.tag.c_str(),
+                info.format == log_reader::Format::SCHEMA_CSV ? "CSV" : "binary",
+                layout.hash, info.current ? "current" : "other", layout.columns.size());
+      }
+      fprintf(out, "%s\n", info.column_line.c_str());
+    },
+    [&](const char *line, const size_t len) -> void {
+      fwrite(line, 1, len, out);
+      fputc('\n', out);
+    },
+    stats, error);
+
+  if (out != stdout)
+    fclose(out);
+
+  if (!ok) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  fprintf(stderr, "%zu records, %zu annotations, %zu bytes/lines skipped\n", stats.records, stats.notes, stats.errors);
+  return 0;
+}
@@ -4,10 +4,15 @@
 #include <LibAvionics.h>      // Base Avionics Library and Utilities
 #include "SystemFunctions.h"  // Function Declarations
 #include "custom_kalman.h"    // Kalman Quick Table
+#include "LogRecord.h"        // Log Schema
 
 #if __has_include("STM32FreeRTOS.h")
 #  define USE_FREERTOS 1
 #  include "hal_rtos.h"
+#  include "hal_profiler.h"
+#  include "hal_spi.h"
+#  include "hal_drdy.h"
+#  include "hal_uart.h"
 #endif
 
 #include <STM32SD.h>
@@ -17,7 +22,11 @@
 /* BEGIN INCLUDE USER'S IMPLEMENTATIONS */
 #include "UserConfig.h"
 #include "UserPins.h"     // User's Pins Mapping
-#include "UserSensors.h"  // User's Hardware Implementations
+#if RA_SIM
+#  include <SimSensors.h>  // Host Simulation Sensors
+#else
+#  include "UserSensors.h"  // User's Hardware Implementations
+#endif
 #include "UserFSM.h"      // User's FSM States
 /* END INCLUDE USER'S IMPLEMENTATIONS */
 
@@ -29,23 +38,47 @@
 /* END USER PRIVATE TYPEDEFS, INCLUDES AND MACROS */
 
 /* BEGIN SENSOR INSTANCES */
-SensorIMU *imu[RA_NUM_IMU] = {
-  new IMU_ADXL372(SPI, USER_GPIO_ADXL372_NSS),  // IMU #1
-};
-SensorAltimeter *altimeter[RA_NUM_ALTIMETER] = {
-  new Altimeter_BMP581(USER_GPIO_BMP581_NSS),  // Altimeter #1
-};
-SensorGNSS *gnss[RA_NUM_GNSS] = {
-  nullptr,  // GNSS #1 (No GNSS)
-};
+#if RA_SIM
+IMU_Sim       imu0("imu0", RA_IMU_DECIMATION, USER_GPIO_ADXL372_INT1,
+                   RA_INTERVAL_IMU_READING * adxl372::ODR_HZ / 1000);  // IMU #1 (Flight model)
+Altimeter_Sim altimeter0("altimeter0", USER_GPIO_BMP581_INT);          // Altimeter #1 (Flight model)
+GNSS_Sim      gnss0("gnss0", hal::uart::usart2, USER_GPIO_GNSS_RX, RA_INTERVAL_GNSS_READING);  // GNSS #1 (Flight model)
+#else
+IMU_ADXL372      imu0(SPI, hal::spi::spi1, USER_GPIO_ADXL372_NSS, RA_IMU_DECIMATION,
+                      RA_INTERVAL_IMU_READING * adxl372::ODR_HZ / 1000);  // IMU #1
+Altimeter_BMP581 altimeter0(SPI, hal::spi::spi1, USER_GPIO_BMP581_NSS);   // Altimeter #1
+GNSS_UBX         gnss0(hal::uart::usart2, RA_GNSS_BAUD, RA_INTERVAL_GNSS_READING);  // GNSS #1
+#endif
+
+// Sensors by concrete type, one per RA_NUM_* slot in slot order
+sensors::registry_t imu(imu0);
+sensors::registry_t altimeter(altimeter0);
+sensors::registry_t gnss(gnss0);
+
+static_assert(decltype(imu)::size == RA_NUM_IMU, "One IMU per RA_NUM_IMU slot");
+static_assert(decltype(altimeter)::size == RA_NUM_ALTIMETER, "One altimeter per RA_NUM_ALTIMETER slot");
+static_assert(decltype(gnss)::size == RA_NUM_GNSS, "One GNSS per RA_NUM_GNSS slot");
+
+// Data-ready lines of IMU #1 and altimeter #1, the reading tasks wait on these
+hal::drdy::line_t drdy_imu("imu0");
+hal::drdy::line_t drdy_altimeter("altimeter0");
 /* END SENSOR INSTANCES */
 
 /* BEGIN SENSOR STATUSES */
 struct SensorsHealth {
-  SensorStatus imu[RA_NUM_IMU]{};
-  SensorStatus altimeter[RA_NUM_ALTIMETER]{};
-  SensorStatus gnss[RA_NUM_GNSS]{};
+  sensors::health_t imu[RA_NUM_IMU];
+  sensors::health_t altimeter[RA_NUM_ALTIMETER];
+  sensors::health_t gnss[RA_NUM_GNSS];
 } sensors_health;
+
+// Not const: the replay swaps in its own thresholds before UserSetupSensors()
+sensors::health_policy_t sensors_policy = {
+  .max_read_failures = RA_SENSOR_MAX_READ_FAILURES,
+  .max_range_faults  = RA_SENSOR_MAX_RANGE_FAULTS,
+  .stuck_ms          = RA_SENSOR_STUCK_TIMEOUT,
+  .retry_ms          = RA_SENSOR_RETRY_INTERVAL,
+  .probation_reads   = RA_SENSOR_PROBATION,
+};
 /* END SENSOR STATUSES */
 
 /* BEGIN PERSISTENT STATE */
@@ -62,33 +95,155 @@ struct DataMemory {
   SensorIMU::Data       imu[RA_NUM_IMU];
   SensorAltimeter::Data altimeter[RA_NUM_ALTIMETER];
   SensorGNSS::Data      gnss[RA_NUM_GNSS];
+
+  // Median of the healthy sensors' last readings, and how many voted (none: kept as it was)
+  SensorIMU::Data       imu_voted;
+  SensorAltimeter::Data altimeter_voted;
+  size_t                imu_votes;
+  size_t                altimeter_votes;
 } data;
-String sd_buf;
+
+// Every raw IMU sample in time order, for consumers faster than the decimated stream
+using ImuRawRing = storage::log_ring_t<SensorIMU::Sample, RA_IMU_RAW_BACKLOG>;
+
+ImuRawRing imu_raw_ring[RA_NUM_IMU];
 /* END DATA MEMORY */
 
+/* BEGIN LOG RING */
+using LogFrame = storage::log_frame_t<RA_LOG_FRAME_SIZE>;
+using LogRing  = storage::log_ring_t<LogFrame, RA_LOG_RING_CAPACITY>;
+
+static_assert(decltype(LogSchema)::record_size <= LogFrame::max_size, "Binary record does not fit a log frame");
+
+LogRing           log_ring;
+LogRing::cursor_t log_cursor_sd(log_ring, RA_LOG_BACKLOG_SD);
+LogRing::cursor_t log_cursor_cdc(log_ring, RA_LOG_BACKLOG_CDC);
+LogRing::cursor_t log_cursor_raw(log_ring, RA_LOG_BACKLOG_RAW);
+/* END LOG RING */
+
 /* BEGIN SD CARD */
-FsUtil fs_sd;
+FsUtil<RA_SDLOGGER_CACHE_SECTORS>                   fs_sd;
+storage::sd_block_device_t                          sd_raw;
+storage::raw::writer_t<storage::sd_block_device_t> raw_log(sd_raw);
 /* END SD CARD */
 
 /* BEGIN FILTERS */
-xcore::vdt<FILTER_ORDER - 1> vdt(static_cast<double>(RA_INTERVAL_FSM_EVAL) * 0.001);
-Filter1T                     filter_acc;
-Filter1T                     filter_alt;
+using Estimator = estimator_t<RA_ESTIMATOR_FLOAT, RA_ESTIMATOR_STEADY_STATE>;
+
+Estimator::vdt     vdt(static_cast<double>(RA_INTERVAL_FSM_EVAL) * 0.001);
+Estimator::filter1 filter_acc;
+Estimator::filter1 filter_alt;
+uint32_t           filter_interval = 0;  // ms, F of both filters
+
+// F for FSM intervals of 0 .. 4x nominal in whole ms, vdt beyond (Q is each filter's own constant)
+constexpr kalman::discretization_table_t<Estimator::scalar, FILTER_ORDER - 1, 4 * RA_INTERVAL_FSM_EVAL + 1>
+  fsm_table(/*step*/ 0.001, /*q*/ 0.);
 /* END FILTERS */
 
+/* BEGIN FUSED ESTIMATOR */
+using FusedSample = timed_sample_t<Estimator::scalar>;
+using FusedRing   = storage::log_ring_t<FusedSample, 16>;
+using Estimate    = estimate_t<Estimator::scalar>;
+
+FusedRing                        fused_imu;  // Vertical acceleration, m/s^2
+FusedRing                        fused_alt;  // Altitude, m
+FusedRing::cursor_t              fused_cursor_imu(fused_imu);
+FusedRing::cursor_t              fused_cursor_alt(fused_alt);
+FilterFused<Estimator::scalar>   filter_fused;
+storage::log_ring_t<Estimate, 4> estimate_ring;
+osThreadId_t                     estimator_thread = nullptr;
+
+/**
+ * Latest filtered altitude, velocity and acceleration: the fused estimator's
+ * snapshot, or filter_alt and filter_acc as they are
+ */
+Estimate ReadEstimate();
+/* END FUSED ESTIMATOR */
+
 /* BEGIN ACTUATORS */
 STM32ServoList servos(TIMER_SERVO);
 float          pos_a = RA_SERVO_A_LOCK;
 float          pos_b = 90;
 /* END ACTUATORS */
 
+/* BEGIN PROFILER */
+hal::rtos::prof::profiler_t<> profiler;
+
+hal::rtos::loop_stats_t loop_imu("CB_ReadIMU");
+hal::rtos::loop_stats_t loop_altimeter("CB_ReadAltimeter");
+hal::rtos::loop_stats_t loop_gnss("CB_ReadGNSS");
+hal::rtos::loop_stats_t loop_fsm("CB_EvalFSM");
+hal::rtos::loop_stats_t loop_construct("CB_ConstructData");
+hal::rtos::loop_stats_t loop_sdlogger("CB_SDLogger");
+hal::rtos::loop_stats_t loop_rawlogger("CB_RawLogger");
+/* END PROFILER */
+
+/* BEGIN EVENT TRACE */
+trace::event_t    trace_events[RA_TRACE_CAPACITY];
+uint8_t           trace_id_imu;
+uint8_t           trace_id_altimeter;
+uint8_t           trace_id_raw;
+std::atomic<bool> trace_dump_request{false};
+bool              trace_dumped = false;
+/* END EVENT TRACE */
+
 /* BEGIN USER PRIVATE VARIABLES */
-hal::rtos::mutex_t mtx_sdio;
-hal::rtos::mutex_t mtx_spi;
+hal::rtos::mutex_t mtx_sdio("mtx_sdio");
 hal::rtos::mutex_t mtx_cdc;
 /* END USER PRIVATE VARIABLES */
 
 /* BEGIN USER PRIVATE FUNCTIONS */
+/**
+ * Write the event trace to a new TRACE<n>.BIN, caller holds mtx_sdio.
+ */
+void DumpTrace() {
+  static FsUtil<> fs_trace;
+  fs_trace.find_file_name("TRACE", "BIN");
+  fs_trace.open_one<FsMode::WRITE>();
+  hal::trace::dump([&](const void *buf, const size_t len) -> void {
+    fs_trace.append(buf, len);
+  });
+  fs_trace.close_one();
+}
+
+/**
+ * Readings a working sensor can give, anything else counts against its
+ * health (NaN fails every comparison)
+ */
+bool Plausible(const SensorIMU::Data &d) {
+  return std::abs(d.acc_x) <= RA_IMU_RANGE_G && std::abs(d.acc_y) <= RA_IMU_RANGE_G &&
+         std::abs(d.acc_z) <= RA_IMU_RANGE_G;
+}
+
+bool Plausible(const SensorAltimeter::Data &d) {
+  return d.pressure_hpa >= RA_ALTIMETER_MIN_HPA && d.pressure_hpa <= RA_ALTIMETER_MAX_HPA &&
+         std::isfinite(d.altitude_m);
+}
+
+bool Plausible(const SensorGNSS::Data &d) {
+  return std::abs(d.latitude) <= 90.0 && std::abs(d.longitude) <= 180.0;
+}
+
+/**
+ * A #HEALTH annotation for each sensor whose status changed since seen,
+ * from the log ring's producer
+ */
+template<size_t N>
+void ReportHealth(const char *kind, const sensors::health_t (&health)[N], uint32_t (&seen)[N]) {
+  for (size_t i = 0; i < N; ++i) {
+    const uint32_t events = health[i].events();
+    if (events == seen[i])
+      continue;
+    seen[i] = events;
+
+    LogFrame &note = log_ring.begin_write();
+    note.clear();
+    note.annotation = true;
+    note.size       = static_cast<uint16_t>(health[i].write(reinterpret_cast<char *>(note.data), LogFrame::max_size, kind, i, millis()));
+    log_ring.commit();
+  }
+}
+
 uint32_t LoggerInterval() {
   switch (fsm.state()) {
     case UserState::STARTUP:
@@ -140,67 +295,117 @@ void UserSetupSPI() {
   SPI.setSCLK(USER_GPIO_SPI1_SCK);
   SPI.begin();
 }
+
+void UserSetupFilters() {
+  SetFilterInterval(RA_INTERVAL_FSM_EVAL);
+
+  // Steady-state gains for the predicts between samples, here rather than in the sensor loops
+  solve_gains(filter_acc, RA_INTERVAL_IMU_READING / RA_INTERVAL_FSM_EVAL);
+  solve_gains(filter_alt, RA_INTERVAL_ALTIMETER_READING / RA_INTERVAL_FSM_EVAL);
+}
+
+void UserSetupSensors() {
+  imu.begin(sensors_health.imu, sensors_policy, millis());
+  altimeter.begin(sensors_health.altimeter, sensors_policy, millis());
+
+  // Data-ready edges are stamped for #AGE even while polling, and a sensor restarted later gets its edges
+  if (sensors_health.imu[0].status() != SensorStatus::SENSOR_NO)
+    drdy_imu.attach(USER_GPIO_ADXL372_INT1);
+  if (sensors_health.altimeter[0].status() != SensorStatus::SENSOR_NO)
+    drdy_altimeter.attach(USER_GPIO_BMP581_INT);
+
+  // Sensor reads go through the DMA bus from here on, SPIClass only configured the devices
+  if (!hal::spi::begin_spi1()) {
+    for (sensors::health_t &health : sensors_health.imu)
+      if (health.status() == SensorStatus::SENSOR_OK)
+        health.demote(sensors::Fault::BEGIN, millis());
+    for (sensors::health_t &health : sensors_health.altimeter)
+      if (health.status() == SensorStatus::SENSOR_OK)
+        health.demote(sensors::Fault::BEGIN, millis());
+  }
+
+  // The receiver starts at its factory baud rate, gnss.begin() moves it to RA_GNSS_BAUD
+  hal::uart::begin_usart2(ubx::BAUD_DEFAULT);
+  gnss.begin(sensors_health.gnss, sensors_policy, millis());
+}
 /* END USER SETUP */
 
 /* BEGIN USER THREADS */
 void CB_ReadIMU(void *) {
-  hal::rtos::interval_loop(RA_INTERVAL_IMU_READING, [&]() -> void {
-    mtx_spi.exec(ReadIMU);
-
-    const double &ax = data.imu[0].acc_x;
-    const double &ay = data.imu[0].acc_y;
-    const double &az = data.imu[0].acc_z;
-
-    // Total acceleration
-    acc = std::sqrt(std::abs(ax * ax) + std::abs(ay * ay) + std::abs(az * az));
+  const auto body = [&](const bool polled) -> void {
+    // No bus lock, hal::spi::spi1 queues the two sensors' bursts
+    {
+      hal::trace::scope_t scope(hal::trace::Event::SENSOR_BEGIN, trace_id_imu);
+      ReadIMU();
+    }
+    drdy_imu.sampled(hal::micros(), polled);
 
-    // Compensate for gravity
-    acc = acc - 1.0;
+    ProcessIMU();
+  };
 
-    // Update KF with measurement
-    filter_acc.kf.update({acc});
-  });
+  if constexpr (RA_SENSOR_DRDY_ENABLED) {
+    drdy_imu.claim();
+    hal::rtos::event_loop(RA_INTERVAL_IMU_READING, RA_SENSOR_DRDY_TIMEOUT * RA_INTERVAL_IMU_READING, loop_imu,
+                          [&](const bool notified) -> void { body(!notified); });
+  } else {
+    hal::rtos::interval_loop(RA_INTERVAL_IMU_READING, loop_imu, [&]() -> void { body(true); });
+  }
 }
 
 void CB_ReadAltimeter(void *) {
-  hal::rtos::interval_loop(RA_INTERVAL_ALTIMETER_READING, [&]() -> void {
-    mtx_spi.exec(ReadAltimeter);
+  const auto body = [&](const bool polled) -> void {
+    {
+      hal::trace::scope_t scope(hal::trace::Event::SENSOR_BEGIN, trace_id_altimeter);
+      ReadAltimeter();
+    }
+    drdy_altimeter.sampled(hal::micros(), polled);
 
-    // Update KF with measurement
-    filter_alt.kf.update({data.altimeter[0].altitude_m});
+    ProcessAltimeter();
+  };
 
-    // Update altitude above ground
-    alt_agl = data.altimeter[0].altitude_m - alt_ref;
+  if constexpr (RA_SENSOR_DRDY_ENABLED) {
+    drdy_altimeter.claim();
+    hal::rtos::event_loop(RA_INTERVAL_ALTIMETER_READING, RA_SENSOR_DRDY_TIMEOUT * RA_INTERVAL_ALTIMETER_READING,
+                          loop_altimeter, [&](const bool notified) -> void { body(!notified); });
+  } else {
+    hal::rtos::interval_loop(RA_INTERVAL_ALTIMETER_READING, loop_altimeter, [&]() -> void { body(true); });
+  }
+}
 
-    // Update apogee
-    if (alt_agl > apogee_raw)
-      apogee_raw = alt_agl;
-  });
+void CB_ReadGNSS(void *) {
+  // Woken by the UART's idle line after each NAV-PVT; the timeout only polls a silent receiver
+  hal::uart::usart2.claim();
+  hal::rtos::event_loop(RA_INTERVAL_GNSS_READING, RA_SENSOR_DRDY_TIMEOUT * RA_INTERVAL_GNSS_READING, loop_gnss,
+                        [&](bool) -> void { ReadGNSS(); });
 }
 
-void CB_EvalFSM(void *) {
-  uint32_t true_interval;
-  hal::rtos::interval_loop(RA_INTERVAL_FSM_EVAL, true_interval, [&]() -> void {
-    const uint32_t delta_interval = true_interval < RA_INTERVAL_FSM_EVAL
-                                      ? RA_INTERVAL_FSM_EVAL - true_interval
-                                      : true_interval - RA_INTERVAL_FSM_EVAL;
-
-    if (true_interval != 0 &&                             // Excluding the first run
-        delta_interval > RA_JITTER_TOLERANCE_FSM_EVAL) {  // If tick jitter is too much
-      // Update dt for KF
-      vdt.update_dt(static_cast<double>(true_interval) * 0.001);
-
-      // Regenerate F with the new dt
-      filter_acc.F = vdt.generate_F();
-      filter_alt.F = vdt.generate_F();
-    }
+void CB_Estimator(void *) {
+  for (;;) {
+    // Woken by each measurement, the timeout only bounds a missed notification
+    hal::rtos::wait_notification(2 * RA_INTERVAL_IMU_READING);
+    RunEstimator();
+  }
+}
 
+void CB_EvalFSM(void *) {
+  hal::rtos::interval_loop(RA_INTERVAL_FSM_EVAL, loop_fsm, [&]() -> void {
     // Predict states to "now"
-    filter_acc.kf.predict();
-    filter_alt.kf.predict();
+    PredictFilters((loop_fsm.last_period_us() + 500u) / 1000u);
 
     // FSM with predicted states
     EvalFSM();
+
+    // Keep the trace window around this state for the post-flight dump
+    if constexpr (RA_TRACE_ENABLED) {
+      if (fsm.state() == RA_TRACE_TRIGGER_STATE)
+        hal::trace::trigger(RA_TRACE_POST_TRIGGER);
+    }
+  });
+}
+
+void CB_SensorRecovery(void *) {
+  hal::rtos::interval_loop(RA_SENSOR_RETRY_INTERVAL, [&]() -> void {
+    RecoverSensors();
   });
 }
 
@@ -211,39 +416,140 @@ void CB_AutoZeroAlt(void *) {
 }
 
 void CB_ConstructData(void *) {
-  hal::rtos::interval_loop(RA_INTERVAL_CONSTRUCT, [&]() -> void {
-    sd_buf = "";
-    csv_stream_lf(sd_buf)
-      << "MFC"
-      << seq_no++
-      << millis()
-      << state_string(fsm.state())
-
-      << data.imu[0].acc_x
-      << data.imu[0].acc_y
-      << data.imu[0].acc_z
-      << acc
-      << filter_acc.kf.state()  // ACC
-
-      << filter_alt.kf.state_vector()[1]  // VEL
-      << filter_alt.kf.state_vector()[0]  // POS
-      << data.altimeter[0].altitude_m
-      << data.altimeter[0].pressure_hpa
-      << alt_agl
-      << alt_ref
-      << apogee_raw
-
-      << pos_a  // Servo A
-      << ReadCPUTemp()
-      //
-      ;
+  hal::rtos::interval_loop(RA_INTERVAL_CONSTRUCT, loop_construct, [&]() -> void {
+    LogFrame &frame = log_ring.begin_write();
+    frame.clear();
+
+    const Estimate estimate = ReadEstimate();
+
+    LogRecord record;
+    record.seq_no       = seq_no++;
+    record.timestamp_ms = millis();
+    record.state        = static_cast<uint8_t>(fsm.state());
+
+    record.acc_x    = data.imu_voted.acc_x;
+    record.acc_y    = data.imu_voted.acc_y;
+    record.acc_z    = data.imu_voted.acc_z;
+    record.acc      = acc;
+    record.acc_filt = estimate.acc;
+
+    record.vel_filt     = estimate.vel;
+    record.pos_filt     = estimate.alt;
+    record.altitude_m   = data.altimeter_voted.altitude_m;
+    record.pressure_hpa = data.altimeter_voted.pressure_hpa;
+    record.alt_agl      = alt_agl;
+    record.alt_ref      = alt_ref;
+    record.apogee       = apogee_raw;
+
+    record.servo_a  = pos_a;
+    record.cpu_temp = ReadCPUTemp();
+
+    if constexpr (RA_LOG_BINARY)
+      frame.size = static_cast<uint16_t>(LogSchema.encode_binary(record, frame.data));
+    else
+      frame.size = static_cast<uint16_t>(LogSchema.encode_csv(record, reinterpret_cast<char *>(frame.data), LogFrame::max_size));
+
+    log_ring.commit();
+
+    // The ring has a single producer, so reports go out from here
+    static uint32_t health_seen_imu[RA_NUM_IMU]             = {};
+    static uint32_t health_seen_altimeter[RA_NUM_ALTIMETER] = {};
+    static uint32_t health_seen_gnss[RA_NUM_GNSS]           = {};
+    ReportHealth("imu", sensors_health.imu, health_seen_imu);
+    ReportHealth("altimeter", sensors_health.altimeter, health_seen_altimeter);
+    ReportHealth("gnss", sensors_health.gnss, health_seen_gnss);
+
+    if constexpr (RA_LOOP_STATS_ENABLED) {
+      // Timing of each loop over the state just left
+      static UserState stats_state = fsm.state();
+      if (fsm.state() != stats_state) {
+        stats_state = fsm.state();
+        for (size_t i = 0; i < hal::rtos::loops::num_loops; ++i) {
+          LogFrame &note = log_ring.begin_write();
+          note.clear();
+          note.annotation = true;
+          note.size       = static_cast<uint16_t>(
+            hal::rtos::loops::table[i]->write(reinterpret_cast<char *>(note.data), LogFrame::max_size, millis()));
+          log_ring.commit();
+          hal::rtos::loops::table[i]->reset();
+        }
+
+        // Sensor bus over the same span
+        LogFrame &note = log_ring.begin_write();
+        note.clear();
+        note.annotation = true;
+        note.size       = static_cast<uint16_t>(
+          hal::spi::spi1.stats().write(reinterpret_cast<char *>(note.data), LogFrame::max_size, "SPI1", millis()));
+        log_ring.commit();
+        hal::spi::spi1.reset_stats();
+
+        // GNSS stream and fix latency over the same span
+        LogFrame &gnss_note = log_ring.begin_write();
+        gnss_note.clear();
+        gnss_note.annotation = true;
+        gnss_note.size       = static_cast<uint16_t>(
+          gnss0.receiver().write(reinterpret_cast<char *>(gnss_note.data), LogFrame::max_size, "gnss0", millis()));
+        log_ring.commit();
+        gnss0.receiver().reset();
+
+        // Sample age over the same span
+        for (hal::drdy::line_t *line : {&drdy_imu, &drdy_altimeter}) {
+          LogFrame &age = log_ring.begin_write();
+          age.clear();
+          age.annotation = true;
+          age.size       = static_cast<uint16_t>(line->write(reinterpret_cast<char *>(age.data), LogFrame::max_size, millis()));
+          log_ring.commit();
+          line->reset();
+        }
+      }
+    }
+
+    if constexpr (RA_PROFILER_ENABLED) {
+      profiler.drain([&](const char *line, const size_t len) -> void {
+        LogFrame &note = log_ring.begin_write();
+        note.clear();
+        note.annotation = true;
+        note.append(line, len);
+        log_ring.commit();
+      });
+    }
   });
 }
 
 void CB_SDLogger(void *) {
-  hal::rtos::interval_loop(LoggerInterval(), LoggerInterval, [&]() -> void {
+  static LogFrame frame;
+  hal::rtos::interval_loop(LoggerInterval(), LoggerInterval, loop_sdlogger, [&]() -> void {
+    mtx_sdio.exec([&]() -> void {
+      if (LoggerInterval() == RA_SDLOGGER_INTERVAL_REALTIME) {
+        // Drain everything produced since the last tick
+        while (log_cursor_sd.pop(frame))
+          fs_sd.append(frame.data, frame.size);
+      } else {
+        // Decimate records to the logger interval, annotations are always kept
+        static LogFrame latest;
+        bool            have_latest = false;
+        while (log_cursor_sd.pop(frame)) {
+          if (frame.annotation) {
+            fs_sd.append(frame.data, frame.size);
+          } else {
+            latest      = frame;
+            have_latest = true;
+          }
+        }
+        if (have_latest)
+          fs_sd.append(latest.data, latest.size);
+      }
+    });
+  });
+}
+
+void CB_RawLogger(void *) {
+  static LogFrame frame;
+  hal::rtos::interval_loop(RA_SDLOGGER_INTERVAL_REALTIME, loop_rawlogger, [&]() -> void {
     mtx_sdio.exec([&]() -> void {
-      fs_sd.file() << sd_buf;
+      hal::trace::scope_t scope(hal::trace::Event::STORAGE_BEGIN, trace_id_raw, static_cast<uint16_t>(log_cursor_raw.lag()));
+      while (log_cursor_raw.pop(frame))
+        raw_log.append(frame.data, frame.size);
     });
   });
 }
@@ -251,19 +557,50 @@ void CB_SDLogger(void *) {
 void CB_SDSave(void *) {
   hal::rtos::interval_loop(1000ul, [&]() -> void {
     mtx_sdio.exec([&]() -> void {
-      fs_sd.file().flush();
+      if constexpr (RA_RAW_LOG_ENABLED)
+        raw_log.sync();
+
+      // Cut the preallocated file down to size once on the ground
+      if (fs_sd.preallocated() &&
+          (fsm.state() == UserState::LANDED || fsm.state() == UserState::RECOVERED_SAFE))
+        fs_sd.truncate_one();
+
+      fs_sd.flush_one();
+
+      if constexpr (RA_TRACE_ENABLED) {
+        const bool landed = fsm.state() == UserState::LANDED || fsm.state() == UserState::RECOVERED_SAFE;
+        if (trace_dump_request.exchange(false)) {
+          DumpTrace();  // On request, the landing dump still follows
+        } else if (landed && !trace_dumped) {
+          DumpTrace();
+          trace_dumped = true;
+        }
+      }
     });
   });
 }
 
 void CB_DebugLogger(void *) {
+  static LogFrame frame;
   hal::rtos::interval_loop(100ul, [&]() -> void {
     mtx_cdc.exec([&]() -> void {
-      Serial.print(sd_buf);
+      while (log_cursor_cdc.pop(frame))
+        Serial.write(frame.data, frame.size);
+
+      // 'T' dumps the event trace to the card
+      while (Serial.available())
+        if (Serial.read() == 'T')
+          trace_dump_request = true;
     });
   });
 }
 
+void CB_Profiler(void *) {
+  hal::rtos::interval_loop(RA_PROFILER_INTERVAL, [&]() -> void {
+    profiler.update(millis(), LogFrame::max_size);
+  });
+}
+
 void CB_RetainDeployment(void *) {
   hal::rtos::interval_loop(15ul, [&]() -> void {
     RetainDeployment();
@@ -275,8 +612,12 @@ void CB_RetainDeployment(void *) {
 void UserThreads() {
   hal::rtos::scheduler.create(CB_EvalFSM, {.name = "CB_EvalFSM", .stack_size = 8192, .priority = osPriorityRealtime});
 
+  if constexpr (RA_ESTIMATOR_FUSED)
+    estimator_thread = hal::rtos::scheduler.create(CB_Estimator, {.name = "CB_Estimator", .stack_size = 4096, .priority = osPriorityHigh});
+
   hal::rtos::scheduler.create(CB_ReadIMU, {.name = "CB_ReadIMU", .stack_size = 8192, .priority = osPriorityHigh});
   hal::rtos::scheduler.create(CB_ReadAltimeter, {.name = "CB_ReadAltimeter", .stack_size = 8192, .priority = osPriorityHigh});
+  hal::rtos::scheduler.create(CB_ReadGNSS, {.name = "CB_ReadGNSS", .stack_size = 4096, .priority = osPriorityAboveNormal});
 
   if constexpr (RA_RETAIN_DEPLOYMENT_ENABLED)
     hal::rtos::scheduler.create(CB_RetainDeployment, {.name = "CB_RetainDeployment", .stack_size = 4096, .priority = osPriorityHigh});
@@ -287,21 +628,67 @@ void UserThreads() {
   hal::rtos::scheduler.create(CB_ConstructData, {.name = "CB_ConstructData", .stack_size = 8192, .priority = osPriorityNormal});
   hal::rtos::scheduler.create(CB_SDLogger, {.name = "CB_SDLogger", .stack_size = 8192, .priority = osPriorityNormal});
 
+  if constexpr (RA_RAW_LOG_ENABLED)
+    hal::rtos::scheduler.create(CB_RawLogger, {.name = "CB_RawLogger", .stack_size = 8192, .priority = osPriorityNormal});
+
   if constexpr (RA_USB_DEBUG_ENABLED)
     hal::rtos::scheduler.create(CB_DebugLogger, {.name = "CB_DebugLogger", .stack_size = 8192, .priority = osPriorityBelowNormal});
 
   hal::rtos::scheduler.create(CB_SDSave, {.name = "CB_SDSave", .stack_size = 8192, .priority = osPriorityLow});
+  hal::rtos::scheduler.create(CB_SensorRecovery, {.name = "CB_SensorRecovery", .stack_size = 4096, .priority = osPriorityLow});
+
+  if constexpr (RA_PROFILER_ENABLED)
+    hal::rtos::scheduler.create(CB_Profiler, {.name = "CB_Profiler", .stack_size = 2048, .priority = osPriorityLow});
 }
 
 void setup() {
+  /* BEGIN EVENT TRACE SETUP */
+  if constexpr (RA_TRACE_ENABLED) {
+    hal::trace::init(trace_events);
+    trace_id_imu       = hal::trace::add_name(hal::trace::Kind::SENSOR, "imu0");
+    trace_id_altimeter = hal::trace::add_name(hal::trace::Kind::SENSOR, "altimeter0");
+    trace_id_raw       = hal::trace::add_name(hal::trace::Kind::STORAGE, "raw_log");
+    fs_sd.trace_as("sd_file");
+  }
+  /* END EVENT TRACE SETUP */
+
   /* BEGIN STORAGES SETUP */
   SD.setDx(USER_GPIO_SDIO_DAT0, USER_GPIO_SDIO_DAT1, USER_GPIO_SDIO_DAT2, USER_GPIO_SDIO_DAT3);
   SD.setCMD(USER_GPIO_SDIO_CMD);
   SD.setCK(USER_GPIO_SDIO_CK);
   SD.begin();
+  fs_sd.recover_last(RA_FILE_NAME, RA_FILE_EXT);
   fs_sd.find_file_name(RA_FILE_NAME, RA_FILE_EXT);
   fs_sd.open_one<FsMode::WRITE>();
-  sd_buf.reserve(1024);
+  if constexpr (RA_SDLOGGER_PREALLOCATE_SIZE > 0)
+    fs_sd.preallocate(RA_SDLOGGER_PREALLOCATE_SIZE);
+
+  static char log_header[1024];
+  const size_t log_header_len = LogSchema.write_header(log_header, sizeof(log_header), !RA_LOG_BINARY);
+  fs_sd.append(log_header, log_header_len);
+
+  if constexpr (RA_RAW_LOG_ENABLED) {
+    const uint32_t raw_start = RA_RAW_LOG_START_LBA
+                                 ? RA_RAW_LOG_START_LBA
+                                 : sd_raw.block_count() - RA_RAW_LOG_BLOCKS;
+    const bool raw_free = storage::raw::region_is_free(sd_raw, raw_start, RA_RAW_LOG_BLOCKS);
+    if (raw_free)
+      raw_log.begin(raw_start, RA_RAW_LOG_BLOCKS,
+                    RA_LOG_BINARY ? storage::raw::Format::BINARY : storage::raw::Format::CSV,
+                    RA_FILE_NAME, millis());
+    raw_log.append(log_header, log_header_len);
+
+    // #RAWLOG,<ms>,<flight, REFUSED (overlaps a partition or past the card's end) or FAILED>,<start>,<blocks>
+    char                   raw_note[96];
+    fast_fmt::csv_writer_t csv(raw_note, sizeof(raw_note));
+    csv << "#RAWLOG" << millis();
+    if (raw_log.is_open())
+      csv << raw_log.flight_no();
+    else
+      csv << (raw_free ? "FAILED" : "REFUSED");
+    csv << raw_start << RA_RAW_LOG_BLOCKS;
+    fs_sd.append(raw_note, csv.finish());
+  }
   /* END STORAGES SETUP */
 
   /* BEGIN GPIO AND INTERFACES SETUP */
@@ -314,44 +701,17 @@ void setup() {
   /* END GPIO AND INTERFACES SETUP */
 
   /* BEGIN FILTERS SETUP */
-  filter_alt.F = vdt.generate_F();
-  filter_acc.F = vdt.generate_F();
+  UserSetupFilters();
   /* END FILTERS SETUP */
 
   /* BEGIN SENSORS SETUP */
-  // IMU
-  for (size_t i = 0; i < RA_NUM_IMU; ++i) {
-    if (!imu[i])
-      sensors_health.imu[i] = SensorStatus::SENSOR_NO;
-    else if (imu[i]->begin())
-      sensors_health.imu[i] = SensorStatus::SENSOR_OK;
-    else
-      sensors_health.imu[i] = SensorStatus::SENSOR_ERR;
-  }
-
-  // Altimeter
-  for (size_t i = 0; i < RA_NUM_ALTIMETER; ++i) {
-    if (!altimeter[i])
-      sensors_health.altimeter[i] = SensorStatus::SENSOR_NO;
-    else if (altimeter[i]->begin())
-      sensors_health.altimeter[i] = SensorStatus::SENSOR_OK;
-    else
-      sensors_health.altimeter[i] = SensorStatus::SENSOR_ERR;
-  }
-
-  // GNSS
-  for (size_t i = 0; i < RA_NUM_GNSS; ++i) {
-    if (!gnss[i])
-      sensors_health.gnss[i] = SensorStatus::SENSOR_NO;
-    else if (gnss[i]->begin())
-      sensors_health.gnss[i] = SensorStatus::SENSOR_OK;
-    else
-      sensors_health.gnss[i] = SensorStatus::SENSOR_ERR;
-  }
-
+  UserSetupSensors();
   /* END SENSORS SETUP */
 
   /* BEGIN SYSTEM/KERNEL SETUP */
+  if constexpr (RA_PROFILER_ENABLED)
+    hal::enable_cycle_counter();
+
   hal::rtos::scheduler.initialize();
   UserThreads();
   hal::rtos::scheduler.start();
@@ -359,10 +719,12 @@ void setup() {
 }
 
 void EvalFSM() {
-  static uint32_t                                            state_millis_start   = 0;
-  static uint32_t                                            state_millis_elapsed = 0;
-  static xcore::sampler_t<2048, double>                      sampler;
-  static xcore::sampler_t<RA_MAIN_OVERSPEED_SAMPLES, double> sampler_overspeed;
+  static uint32_t                                                       state_millis_start   = 0;
+  static uint32_t                                                       state_millis_elapsed = 0;
+  static xcore::sampler_t<2048, Estimator::scalar>                      sampler;
+  static xcore::sampler_t<RA_MAIN_OVERSPEED_SAMPLES, Estimator::scalar> sampler_overspeed;
+
+  const Estimate estimate = ReadEstimate();
 
   switch (fsm.state()) {
     case UserState::STARTUP: {
@@ -408,7 +770,7 @@ void EvalFSM() {
       }
 
       // sampler.add_sample(acc);  // Use raw acceleration, unfiltered
-      sampler.add_sample(filter_acc.kf.state());  // Use filtered acceleration
+      sampler.add_sample(estimate.acc);  // Use filtered acceleration
 
       if (sampler.is_sampled() &&
           sampler.over_by_under<double>() > RA_TRUE_TO_FALSE_RATIO) {
@@ -430,7 +792,7 @@ void EvalFSM() {
       }
 
       // sampler.add_sample(acc);  // Use raw acceleration, unfiltered
-      sampler.add_sample(filter_acc.kf.state());  // Use filtered acceleration
+      sampler.add_sample(estimate.acc);  // Use filtered acceleration
       state_millis_elapsed = millis() - state_millis_start;
 
       if (state_millis_elapsed >= RA_TIME_TO_BURNOUT_MAX ||
@@ -450,7 +812,7 @@ void EvalFSM() {
         state_millis_start = millis();
       }
 
-      const double vel = filter_alt.kf.state_vector()[1];
+      const double vel = estimate.vel;
       sampler.add_sample(std::abs(vel));
       state_millis_elapsed = millis() - state_millis_start;
 
@@ -481,7 +843,7 @@ void EvalFSM() {
       }
 
       sampler.add_sample(alt_agl);
-      const double vel = filter_alt.kf.state_vector()[1];
+      const double vel = estimate.vel;
       sampler_overspeed.add_sample(std::abs(vel));
       state_millis_elapsed = millis() - state_millis_start;
 
@@ -515,7 +877,7 @@ void EvalFSM() {
         sampler.set_threshold(RA_LANDED_VEL, /*recount*/ false);
       }
 
-      const double vel = filter_alt.kf.state_vector()[1];
+      const double vel = estimate.vel;
       sampler.add_sample(std::abs(vel));
 
       if (sampler.is_sampled() &&
@@ -538,39 +900,156 @@ void EvalFSM() {
 }
 
 void ReadIMU() {
-  for (size_t i = 0; i < RA_NUM_IMU; ++i) {
-    if (sensors_health.imu[i] != SensorStatus::SENSOR_OK ||
-        !imu[i]->read())
-      continue;
-    data.imu[i].acc_x = imu[i]->acc_x();
-    data.imu[i].acc_y = imu[i]->acc_y();
-    data.imu[i].acc_z = imu[i]->acc_z();
-    data.imu[i].gyr_x = imu[i]->gyr_x();
-    data.imu[i].gyr_y = imu[i]->gyr_y();
-    data.imu[i].gyr_z = imu[i]->gyr_z();
-  }
+  const uint32_t now = millis();
+  imu.for_each([now](auto &sensor, const size_t i) -> void {
+    sensors::health_t &health = sensors_health.imu[i];
+    if (health.status() != SensorStatus::SENSOR_OK)
+      return;  // Demoted, the recovery task has it
+
+    const SensorIMU::Data last = data.imu[i];
+    const bool            ok   = sensor.read(data.imu[i]);
+    health.read(ok, ok && Plausible(data.imu[i]), data.imu[i] != last, now);
+    if (!ok)
+      return;
+
+    const SensorIMU::Sample *raw;
+    for (size_t k = 0, n = sensor.raw_samples(raw); k < n; ++k)
+      imu_raw_ring[i].push(raw[k]);
+  });
+
+  using Data     = SensorIMU::Data;
+  data.imu_votes = sensors::vote(data.imu, sensors_health.imu, data.imu_voted, &Data::acc_x, &Data::acc_y,
+                                 &Data::acc_z, &Data::gyr_x, &Data::gyr_y, &Data::gyr_z);
 }
 
 void ReadAltimeter() {
-  for (size_t i = 0; i < RA_NUM_ALTIMETER; ++i) {
-    if (sensors_health.altimeter[i] != SensorStatus::SENSOR_OK ||
-        !altimeter[i]->read())
-      continue;
-    data.altimeter[i].pressure_hpa = altimeter[i]->pressure_hpa();
-    data.altimeter[i].altitude_m   = altimeter[i]->altitude_m();
-  }
+  const uint32_t now = millis();
+  altimeter.for_each([now](auto &sensor, const size_t i) -> void {
+    sensors::health_t &health = sensors_health.altimeter[i];
+    if (health.status() != SensorStatus::SENSOR_OK)
+      return;
+
+    const SensorAltimeter::Data last = data.altimeter[i];
+    const bool                  ok   = sensor.read(data.altimeter[i]);
+    health.read(ok, ok && Plausible(data.altimeter[i]), data.altimeter[i] != last, now);
+  });
+
+  using Data           = SensorAltimeter::Data;
+  data.altimeter_votes = sensors::vote(data.altimeter, sensors_health.altimeter, data.altimeter_voted,
+                                       &Data::pressure_hpa, &Data::altitude_m);
 }
 
 void ReadGNSS() {
-  for (size_t i = 0; i < RA_NUM_GNSS; ++i) {
-    if (sensors_health.gnss[i] != SensorStatus::SENSOR_OK ||
-        !gnss[i]->read())
-      continue;
-    data.gnss[i].timestamp_epoch = gnss[i]->timestamp_epoch();
-    data.gnss[i].siv             = gnss[i]->siv();
-    data.gnss[i].latitude        = gnss[i]->latitude();
-    data.gnss[i].longitude       = gnss[i]->longitude();
-    data.gnss[i].altitude_msl    = gnss[i]->altitude_msl();
+  const uint32_t now = millis();
+  gnss.for_each([now](auto &sensor, const size_t i) -> void {
+    sensors::health_t &health = sensors_health.gnss[i];
+    if (health.status() != SensorStatus::SENSOR_OK)
+      return;
+
+    // A new solution counts as a change even where the position holds still, read() fails on repeats
+    const bool ok = sensor.read(data.gnss[i]);
+    health.read(ok, ok && Plausible(data.gnss[i]), ok, now);
+  });
+}
+
+void ProcessIMU() {
+  if (data.imu_votes == 0)
+    return;  // No healthy IMU, the filters coast on their prediction
+
+  const double &ax = data.imu_voted.acc_x;
+  const double &ay = data.imu_voted.acc_y;
+  const double &az = data.imu_voted.acc_z;
+
+  // Total acceleration
+  acc = std::sqrt(std::abs(ax * ax) + std::abs(ay * ay) + std::abs(az * az));
+
+  // Compensate for gravity
+  acc = acc - 1.0;
+
+  if constexpr (RA_ESTIMATOR_FUSED) {
+    // Along the up axis the sign survives coasting and descent, unlike the magnitude
+    const auto vertical = [](const double x, const double y, const double z) -> Estimator::scalar {
+      const double up = RA_IMU_UP_AXIS == 0 ? x : (RA_IMU_UP_AXIS == 1 ? y : z);
+      return static_cast<Estimator::scalar>((up - 1.0) * isa76::g0);
+    };
+
+    // Each decimated sample at its own time, from the first IMU in the vote (streams of
+    // different clocks do not line up sample by sample), or the vote as of now for drivers without a FIFO
+    const SensorIMU::Sample *dec = nullptr;
+    size_t                   n   = 0;
+    imu.for_each([&](auto &sensor, const size_t i) -> void {
+      if (!dec && sensors_health.imu[i].voting())
+        n = sensor.decimated_samples(dec);
+    });
+    if (n) {
+      for (size_t k = 0; k < n; ++k)
+        fused_imu.push({dec[k].t_us, vertical(dec[k].acc_x, dec[k].acc_y, dec[k].acc_z)});
+    } else {
+      fused_imu.push({micros(), vertical(ax, ay, az)});
+    }
+    hal::rtos::notify(estimator_thread);
+    return;
+  }
+
+  // Update KF with measurement
+  filter_acc.kf.update({acc});
+}
+
+void ProcessAltimeter() {
+  if (data.altimeter_votes == 0)
+    return;  // No healthy altimeter
+
+  const double altitude_m = data.altimeter_voted.altitude_m;
+  if constexpr (RA_ESTIMATOR_FUSED) {
+    fused_alt.push({micros(), static_cast<Estimator::scalar>(altitude_m)});
+    hal::rtos::notify(estimator_thread);
+  } else {
+    // Update KF with measurement
+    filter_alt.kf.update({altitude_m});
+  }
+
+  // Update altitude above ground
+  alt_agl = altitude_m - alt_ref;
+
+  // Update apogee
+  if (alt_agl > apogee_raw)
+    apogee_raw = alt_agl;
+}
+
+void PredictFilters(const uint32_t true_interval) {
+  if constexpr (RA_ESTIMATOR_FUSED)
+    return;  // The estimator task predicts to each measurement
+
+  const uint32_t delta_interval = true_interval < RA_INTERVAL_FSM_EVAL
+                                    ? RA_INTERVAL_FSM_EVAL - true_interval
+                                    : true_interval - RA_INTERVAL_FSM_EVAL;
+
+  // Measured interval if tick jitter is too much, else back to nominal (also on the first run)
+  const uint32_t interval = true_interval != 0 && delta_interval > RA_JITTER_TOLERANCE_FSM_EVAL
+                              ? true_interval
+                              : RA_INTERVAL_FSM_EVAL;
+  if (interval != filter_interval)
+    SetFilterInterval(interval);
+
+  filter_acc.kf.predict();
+  filter_alt.kf.predict();
+}
+
+void SetFilterInterval(const uint32_t interval) {
+  filter_interval = interval;
+
+  if (interval < fsm_table.size) {
+    // Element-wise, the xcore filters have their own matrix type
+    const auto &F = fsm_table[interval].F;
+    for (size_t i = 0; i < FILTER_ORDER; ++i)
+      for (size_t j = 0; j < FILTER_ORDER; ++j) {
+        filter_acc.F[i][j] = F[i][j];
+        filter_alt.F[i][j] = F[i][j];
+      }
+  } else {
+    vdt.update_dt(static_cast<double>(interval) * 0.001);
+    filter_acc.F = vdt.generate_F();
+    filter_alt.F = vdt.generate_F();
   }
 }
 
@@ -595,19 +1074,26 @@ void RetainDeployment() {
   servos[0].write(pos_a);
 }
 
+void RecoverSensors() {
+  const uint32_t now = millis();
+  imu.restart(sensors_health.imu, sensors_policy, now);
+  altimeter.restart(sensors_health.altimeter, sensors_policy, now);
+  gnss.restart(sensors_health.gnss, sensors_policy, now);
+}
+
 void AutoZeroAlt() {
-  static xcore::sampler_t<RA_AUTOZERO_SAMPLES, double> sampler;
+  static xcore::sampler_t<RA_AUTOZERO_SAMPLES, Estimator::scalar> sampler;
   sampler.set_threshold(RA_AUTOZERO_VEL, /*recount*/ false);
 
   switch (fsm.state()) {
     case UserState::IDLE_SAFE:
     case UserState::ARMED:
     case UserState::PAD_PREOP: {
-      const double vel = filter_alt.kf.state_vector()[1];
+      const double vel = ReadEstimate().vel;
       sampler.add_sample(std::abs(vel));
       if (sampler.is_sampled()) {
-        if (sampler.under_by_over<double>() > 3.0)  // 75%
-          alt_ref = data.altimeter[0].altitude_m;
+        if (sampler.under_by_over<double>() > 3.0 && data.altimeter_votes > 0)  // 75%
+          alt_ref = data.altimeter_voted.altitude_m;
         sampler.reset();
       }
       break;
@@ -616,3 +1102,48 @@ void AutoZeroAlt() {
       break;
   }
 }
+
+void RunEstimator() {
+  FusedSample imu_sample{}, alt_sample{};
+  bool        have_imu = false, have_alt = false, fused = false;
+
+  // Merge both queues in timestamp order, the producers stamp on the same clock
+  for (;;) {
+    if (!have_imu)
+      have_imu = fused_cursor_imu.pop(imu_sample);
+    if (!have_alt)
+      have_alt = fused_cursor_alt.pop(alt_sample);
+    if (!have_imu && !have_alt)
+      break;
+
+    if (have_alt && (!have_imu || static_cast<int32_t>(alt_sample.t_us - imu_sample.t_us) <= 0)) {
+      filter_fused.predict_to(alt_sample.t_us);
+      filter_fused.update_altitude(alt_sample.value);
+      have_alt = false;
+    } else {
+      filter_fused.predict_to(imu_sample.t_us);
+      filter_fused.update_acceleration(imu_sample.value);
+      have_imu = false;
+    }
+    fused = true;
+  }
+
+  if (!fused)
+    return;
+
+  const auto &x = filter_fused.kf.state_vector();
+  estimate_ring.push({filter_fused.t_us, x[0], x[1], static_cast<Estimator::scalar>(x[2] / isa76::g0)});
+}
+
+Estimate ReadEstimate() {
+  Estimate estimate{};
+  if constexpr (RA_ESTIMATOR_FUSED) {
+    estimate_ring.latest(estimate);
+  } else {
+    estimate.t_us = micros();
+    estimate.alt  = filter_alt.kf.state_vector()[0];
+    estimate.vel  = filter_alt.kf.state_vector()[1];
+    estimate.acc  = filter_acc.kf.state();
+  }
+  return estimate;
+}
@@ -0,0 +1,55 @@
+#ifndef ROCKET_AVIONICS_TEMPLATE_FILE_BLOCK_DEVICE_H
+#define ROCKET_AVIONICS_TEMPLATE_FILE_BLOCK_DEVICE_H
+
+#include <RawLog.h>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * Block device backed by a card image or a raw device node (/dev/sdX),
+ * the host stand-in for storage::sd_block_device_t.
+ */
+class file_block_device_t {
+  FILE    *fp_     = nullptr;
+  uint32_t blocks_ = 0;
+
+public:
+  explicit file_block_device_t(const char *path, const bool writable = false) {
+    fp_ = fopen(path, writable ? "r+b" : "rb");
+    if (!fp_)
+      return;
+    fseeko(fp_, 0, SEEK_END);
+    blocks_ = static_cast<uint32_t>(ftello(fp_) / storage::raw::block_size);
+  }
+
+  file_block_device_t(const file_block_device_t &) = delete;
+
+  ~file_block_device_t() {
+    if (fp_)
+      fclose(fp_);
+  }
+
+  [[nodiscard]] bool is_open() const {
+    return fp_ != nullptr;
+  }
+
+  bool read(const uint32_t lba, uint8_t *dst, const uint32_t count) {
+    if (!fp_ || lba + count > blocks_)
+      return false;
+    fseeko(fp_, static_cast<off_t>(lba) * storage::raw::block_size, SEEK_SET);
+    return fread(dst, storage::raw::block_size, count, fp_) == count;
+  }
+
+  bool write(const uint32_t lba, const uint8_t *src, const uint32_t count) {
+    if (!fp_ || lba + count > blocks_)
+      return false;
+    fseeko(fp_, static_cast<off_t>(lba) * storage::raw::block_size, SEEK_SET);
+    return fwrite(src, storage::raw::block_size, count, fp_) == count;
+  }
+
+  [[nodiscard]] uint32_t block_count() const {
+    return blocks_;
+  }
+};
+
+#endif  //ROCKET_AVIONICS_TEMPLATE_FILE_BLOCK_DEVICE_H
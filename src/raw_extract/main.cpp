@@ -0,0 +1,74 @@
+/**
+ * Host-side extractor for the raw block log (see lib/LibAvionics/RawLog.h).
+ *
+ * Usage: raw_extract <card image | /dev/sdX> <start_lba> <blocks> [out_dir]
+ *
+ * start_lba = 0 takes the last <blocks> blocks of the card, same as
+ * RA_RAW_LOG_START_LBA on the target. Every flight in the region is written to
+ * <out_dir>/<name>RAW<flight>.<CSV|BIN>.
+ */
+#include "./file_block_device.h"
+#include <cstdlib>
+#include <string>
+
+int main(const int argc, char **argv) {
+  if (argc < 4) {
+    fprintf(stderr, "Usage: %s <image> <start_lba> <blocks> [out_dir]\n", argv[0]);
+    return 2;
+  }
+
+  file_block_device_t dev(argv[1]);
+  if (!dev.is_open()) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  const uint32_t    blocks  = static_cast<uint32_t>(strtoul(argv[3], nullptr, 0));
+  uint32_t          start   = static_cast<uint32_t>(strtoul(argv[2], nullptr, 0));
+  const std::string out_dir = argc > 4 ? argv[4] : ".";
+
+  if (start == 0) {
+    if (blocks > dev.block_count()) {
+      fprintf(stderr, "Region larger than the device (%u blocks)\n", dev.block_count());
+      return 1;
+    }
+    start = dev.block_count() - blocks;
+  }
+
+  storage::raw::reader_t<file_block_device_t> reader(dev, start, blocks);
+
+  uint8_t  payload[storage::raw::block_size];
+  uint32_t flights = 0;
+
+  reader.for_each_flight([&](const auto &flight) {
+    const auto &sb  = flight.sb;
+    const char *ext = sb.format == static_cast<uint8_t>(storage::raw::Format::BINARY) ? "BIN" : "CSV";
+
+    char name[sizeof(sb.name) + 1] = {};
+    memcpy(name, sb.name, sizeof(sb.name));
+
+    const std::string path = out_dir + "/" + name + "RAW" + std::to_string(sb.flight_no) + "." + ext;
+    FILE             *out  = fopen(path.c_str(), "wb");
+    if (!out) {
+      fprintf(stderr, "Cannot create %s\n", path.c_str());
+      return;
+    }
+
+    uint64_t bytes = 0;
+    for (uint32_t seq = 0; seq < flight.data_blocks; ++seq) {
+      const size_t n = reader.payload(flight, seq, payload);
+      fwrite(payload, 1, n, out);
+      bytes += n;
+    }
+    fclose(out);
+    ++flights;
+
+    printf("flight %u: lba %u, %u blocks (%u at last sync), %llu bytes, %u syncs -> %s\n",
+           sb.flight_no, sb.lba, flight.data_blocks, sb.data_blocks,
+           static_cast<unsigned long long>(bytes), sb.sync_count, path.c_str());
+  });
+
+  if (!flights)
+    printf("No flights found in blocks %u..%u\n", start, start + blocks - 1);
+  return 0;
+}
@@ -0,0 +1,283 @@
+/**
+ * Host round trip of the raw block log (lib/LibAvionics/RawLog.h) through a
+ * card image, the way the target writes it and raw_extract reads it back.
+ *
+ * Usage: rawlog_check [image]
+ *
+ * On a fresh image (default rawlog_check.img, removed afterwards):
+ *   - region_is_free() against an MBR whose partition ends short of the
+ *     region, one that covers it, and no MBR;
+ *   - three flights of CSV-like lines, synced every few lines: the reader
+ *     walks the superblock chain and gets every line back, in order;
+ *   - the power cut: the third flight's card stops taking writes after n
+ *     blocks, for n across several batches, so most cuts land inside a
+ *     multi-block write. Every line written whole before the cut (a sync or
+ *     a full batch) is recovered, what comes back is an exact prefix of what
+ *     was appended, the first two flights are untouched, and the next boot
+ *     opens flight 4 right after the recovered end of flight 3.
+ * Exits 1 on any failure.
+ */
+#include "../raw_extract/file_block_device.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+  using storage::raw::block_payload;
+  using storage::raw::block_size;
+
+  constexpr uint32_t CARD_BLOCKS     = 4096;  // 2 MiB
+  constexpr uint32_t PARTITION_START = 2048;
+  constexpr uint32_t REGION_BLOCKS   = 1024;
+  constexpr uint32_t REGION_START    = CARD_BLOCKS - REGION_BLOCKS;
+  constexpr size_t   BATCH           = 16;  // writer_t's default
+  constexpr uint32_t SYNC_EVERY      = 40;  // Lines, about a second of records
+  constexpr uint32_t FLIGHT_LINES[]  = {1500, 700, 2500};
+
+  /**
+   * Passes writes through until `budget` blocks have been written; the write
+   * that crosses it stores the blocks that fit and fails, as a card does when
+   * power goes mid-transfer. Every write after that fails.
+   */
+  class cut_device_t {
+    file_block_device_t *dev_;
+    uint32_t             budget_;
+    bool                 torn_ = false;  // The cut kept part of a multi-block write
+
+  public:
+    cut_device_t(file_block_device_t &dev, const uint32_t budget) : dev_(&dev), budget_(budget) {}
+
+    bool read(const uint32_t lba, uint8_t *dst, const uint32_t count) {
+      return dev_->read(lba, dst, count);
+    }
+
+    bool write(const uint32_t lba, const uint8_t *src, const uint32_t count) {
+      if (count <= budget_) {
+        budget_ -= count;
+        return dev_->write(lba, src, count);
+      }
+      if (budget_) {
+        dev_->write(lba, src, budget_);
+        torn_ = true;
+      }
+      budget_ = 0;
+      return false;
+    }
+
+    [[nodiscard]] uint32_t block_count() const {
+      return dev_->block_count();
+    }
+
+    [[nodiscard]] bool cut() const {
+      return budget_ == 0;
+    }
+
+    [[nodiscard]] bool torn() const {
+      return torn_;
+    }
+  };
+
+  // Line k of a flight, of varying length like the CSV records
+  std::string make_line(const uint32_t flight, const uint32_t k) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%u,%u,%u,%.3f,%.*s\n", flight, k, k * 5, k * 0.125, static_cast<int>(k % 41),
+             "0123456789abcdefghijklmnopqrstuvwxyzABCDE");
+    return buf;
+  }
+
+  bool make_image(const char *path, const uint32_t partition_blocks) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+      return false;
+    std::vector<uint8_t> zero(static_cast<size_t>(CARD_BLOCKS) * block_size);
+    if (partition_blocks) {
+      // One FAT32 (LBA) partition, the usual card layout
+      uint8_t       *e   = zero.data() + 446;
+      const uint32_t v[] = {PARTITION_START, partition_blocks};
+      e[4]               = 0x0C;
+      memcpy(e + 8, v, sizeof(v));
+      zero[510] = 0x55;
+      zero[511] = 0xAA;
+    }
+    const bool ok = fwrite(zero.data(), 1, zero.size(), f) == zero.size();
+    return fclose(f) == 0 && ok;
+  }
+
+  bool check_region(const char *path) {
+    struct case_t {
+      const char *name;
+      uint32_t    partition;
+      bool        expected;
+    };
+    const case_t cases[] = {
+      {"partition short of the region", REGION_START - PARTITION_START, true},
+      {"partition over the whole card", CARD_BLOCKS - PARTITION_START, false},
+      {"no MBR", 0, true},
+    };
+
+    bool ok = true;
+    for (const case_t &c : cases) {
+      if (!make_image(path, c.partition)) {
+        printf("%s: cannot create\n", path);
+        return false;
+      }
+      file_block_device_t dev(path);
+      const bool          free = storage::raw::region_is_free(dev, REGION_START, REGION_BLOCKS);
+      printf("region_is_free, %s: %s%s\n", c.name, free ? "free" : "refused", free == c.expected ? "" : "  FAILED");
+      ok &= free == c.expected;
+    }
+    return ok;
+  }
+
+  struct written_t {
+    std::string data;     // Everything the writer took
+    size_t      durable;  // Bytes on the card before any cut: the last sync or full batch
+    bool        cut;
+  };
+
+  // Flight `flight` of `lines` lines on dev, opened, appended and synced the way CB_RawLogger does
+  template<typename Device>
+  written_t write_flight(Device &dev, const uint32_t flight, const uint32_t lines) {
+    storage::raw::writer_t<Device, BATCH> writer(dev);
+    written_t                             w{{}, 0, false};
+    if (!writer.begin(REGION_START, REGION_BLOCKS, storage::raw::Format::CSV, "RAWCHECK_", flight * 1000)) {
+      w.cut = true;
+      return w;
+    }
+
+    for (uint32_t k = 0; k < lines && writer.is_open(); ++k) {
+      const std::string line = make_line(flight, k);
+      w.data.append(line, 0, writer.append(line.data(), line.size()));  // Up to the failed write
+      if (!writer.is_open())
+        break;
+      w.durable = std::max<size_t>(w.durable, writer.blocks_written() * block_payload);
+      if ((k + 1) % SYNC_EVERY == 0 || k + 1 == lines) {
+        if (!writer.sync())
+          break;
+        w.durable = w.data.size();
+      }
+    }
+    w.cut = !writer.is_open() || w.durable < w.data.size();
+    return w;
+  }
+
+  struct recovered_t {
+    storage::raw::superblock_t sb;
+    uint32_t                   data_blocks;
+    std::string                data;
+  };
+
+  std::vector<recovered_t> read_flights(file_block_device_t &dev) {
+    storage::raw::reader_t<file_block_device_t> reader(dev, REGION_START, REGION_BLOCKS);
+    std::vector<recovered_t>                    out;
+    uint8_t                                     payload[block_size];
+    reader.for_each_flight([&](const auto &flight) {
+      recovered_t r{flight.sb, flight.data_blocks, {}};
+      for (uint32_t seq = 0; seq < flight.data_blocks; ++seq)
+        r.data.append(reinterpret_cast<const char *>(payload), reader.payload(flight, seq, payload));
+      out.push_back(r);
+    });
+    return out;
+  }
+
+  // Whole lines in data
+  size_t count_lines(const std::string &data, const size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len && i < data.size(); ++i)
+      n += data[i] == '\n';
+    return n;
+  }
+
+  bool check_flights(const char *path) {
+    if (!make_image(path, REGION_START - PARTITION_START))
+      return false;
+
+    std::vector<std::string> sent;
+    {
+      file_block_device_t dev(path, true);
+      for (uint32_t i = 0; i < 3; ++i)
+        sent.push_back(write_flight(dev, i + 1, FLIGHT_LINES[i]).data);
+    }
+
+    file_block_device_t dev(path);
+    const auto          flights = read_flights(dev);
+    bool                ok      = flights.size() == sent.size();
+    uint32_t            lba     = REGION_START;
+    for (size_t i = 0; i < flights.size() && i < sent.size(); ++i) {
+      const recovered_t &f = flights[i];
+      const bool chained   = f.sb.flight_no == i + 1 && f.sb.lba == lba && f.data_blocks >= f.sb.data_blocks &&
+                             f.sb.payload_bytes == sent[i].size();
+      const bool same      = f.data == sent[i];
+      printf("flight %u: lba %u, %u blocks, %zu/%zu lines%s\n", f.sb.flight_no, f.sb.lba, f.data_blocks,
+             count_lines(f.data, f.data.size()), count_lines(sent[i], sent[i].size()),
+             chained && same ? "" : "  FAILED");
+      ok &= chained && same;
+      lba += 1 + f.data_blocks;
+    }
+    return ok;
+  }
+
+  bool check_power_cut(const char *path) {
+    // Past the blocks flight 3 writes in all, lines under 80 bytes, rewrites at each sync included
+    const uint32_t syncs   = (FLIGHT_LINES[2] + SYNC_EVERY - 1) / SYNC_EVERY;
+    const uint32_t max_cut = static_cast<uint32_t>(FLIGHT_LINES[2] * 80 / block_payload) + syncs * (BATCH + 1);
+
+    size_t cuts = 0, mid_batch = 0, failed = 0;
+    for (uint32_t budget = 1; budget < max_cut; budget += 7) {
+      if (!make_image(path, REGION_START - PARTITION_START))
+        return false;
+
+      std::vector<std::string> sent;
+      written_t                third{};
+      {
+        file_block_device_t dev(path, true);
+        for (uint32_t i = 0; i < 2; ++i)
+          sent.push_back(write_flight(dev, i + 1, FLIGHT_LINES[i]).data);
+        cut_device_t cut(dev, budget);
+        third = write_flight(cut, 3, FLIGHT_LINES[2]);
+        if (!cut.cut())
+          continue;  // Flight 3 ended before the budget
+        mid_batch += cut.torn();
+      }
+      ++cuts;
+
+      // Next boot: a new flight opened after what is left of flight 3
+      {
+        file_block_device_t dev(path, true);
+        write_flight(dev, 4, 10);
+      }
+
+      file_block_device_t dev(path);
+      const auto          flights = read_flights(dev);
+      bool                ok      = flights.size() == 4;
+      for (size_t i = 0; ok && i < 2; ++i)
+        ok &= flights[i].data == sent[i];
+      if (ok) {
+        const recovered_t &f3 = flights[2];
+        ok &= f3.sb.flight_no == 3 && f3.data.size() >= third.durable &&
+              third.data.compare(0, f3.data.size(), f3.data) == 0 &&
+              count_lines(f3.data, f3.data.size()) >= count_lines(third.data, third.durable);
+        ok &= flights[3].sb.flight_no == 4 && flights[3].sb.lba == f3.sb.lba + 1 + f3.data_blocks;
+      }
+      if (!ok) {
+        printf("cut after %u blocks: %zu flights, flight 3 %zu bytes back of %zu durable  FAILED\n", budget,
+               flights.size(), flights.size() > 2 ? flights[2].data.size() : size_t{0}, third.durable);
+        ++failed;
+      }
+    }
+    printf("power cuts: %zu, %zu of them inside a batch, %zu failed\n", cuts, mid_batch, failed);
+    return cuts > 0 && failed == 0;
+  }
+}  // namespace
+
+int main(const int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "rawlog_check.img";
+
+  bool ok = check_region(path);
+  ok &= check_flights(path);
+  ok &= check_power_cut(path);
+  remove(path);
+
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
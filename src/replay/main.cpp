@@ -0,0 +1,506 @@
+/**
+ * Flight log replay through the firmware's own estimator and FSM.
+ *
+ * Usage: replay [--out=filters.csv] [--check] [--tolerance=ms] <log file>
+ *
+ * Links src/main against the host stand-ins, but never starts the kernel:
+ * the thread bodies (ReadIMU/ProcessIMU, ReadAltimeter/ProcessAltimeter,
+ * PredictFilters/EvalFSM, RecoverSensors, AutoZeroAlt, and RunEstimator
+ * after each sample with RA_ESTIMATOR_FUSED) are called directly on the
+ * virtual clock at their UserConfig.h intervals, so no time is spent
+ * switching threads. On a tick where several are due they run in thread priority
+ * order, EvalFSM first.
+ *
+ * The log (any format LogReader.h accepts) is the sensor source: each read
+ * returns the last record at or before the clock, which starts at the first
+ * record's timestamp so millis() matches the log. Leading records with no
+ * pressure, logged before the sensors had data, are left out. The sensor
+ * health monitor runs with stuck and range demotion off: held records
+ * repeat exactly where the live sensor's noise never does.
+ *
+ * Reports every state transition next to the logged one and the replay
+ * throughput. The estimator inputs of the run (predicts and the acc/altitude
+ * updates, in order) are then fed again through the xcore filters and each
+ * Kalman.h filter (dense r_iae, packed r_iae, steady-state) in double and
+ * float: deviation from dense double and time per FSM tick side by side,
+ * plus the steady-state filters' share of ticks on the constant gain. Which
+ * of them flew is set by UserConfig.h's RA_ESTIMATOR_FLOAT and
+ * RA_ESTIMATOR_STEADY_STATE.
+ *
+ * --out writes the filter outputs at each record's time, --check exits 1 if
+ * a logged transition is missed or falls more than --tolerance (default
+ * 500 ms) outside the records it was logged between.
+ */
+#include <Arduino.h>
+#include <LogReader.h>
+#include <Sensors.h>
+#include "SystemFunctions.h"
+#include "UserConfig.h"
+#include "UserFSM.h"
+#include "custom_kalman.h"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <numeric>
+
+using Estimator = estimator_t<RA_ESTIMATOR_FLOAT, RA_ESTIMATOR_STEADY_STATE>;
+
+constexpr const char *ESTIMATOR_NAME = RA_ESTIMATOR_FUSED          ? (RA_ESTIMATOR_FLOAT ? "fused float" : "fused double")
+                                       : RA_ESTIMATOR_STEADY_STATE ? (RA_ESTIMATOR_FLOAT ? "steady float" : "steady double")
+                                                                   : (RA_ESTIMATOR_FLOAT ? "packed float" : "xcore double");
+
+extern UserFSM            fsm;
+extern Estimator::filter1 filter_acc;
+extern Estimator::filter1 filter_alt;
+extern double             acc;
+extern double             alt_ref;
+extern double             alt_agl;
+extern double             apogee_raw;
+
+extern sensors::health_policy_t sensors_policy;
+
+extern estimate_t<Estimator::scalar> ReadEstimate();
+
+namespace {
+  struct sample_t {
+    uint32_t    t_ms;
+    const char *state;  // Logged state label
+    double      acc_x, acc_y, acc_z;
+    double      pressure_hpa;
+  };
+
+  struct transition_t {
+    uint32_t    t_ms;
+    const char *state;
+    uint32_t    since_ms;  // Logged: previous record, the change happened in (since_ms, t_ms]
+  };
+
+  // Distance from a replayed transition time to a logged transition's window
+  uint32_t miss_ms(const uint32_t t_ms, const transition_t &logged) {
+    if (t_ms < logged.since_ms)
+      return logged.since_ms - t_ms;
+    return t_ms > logged.t_ms ? t_ms - logged.t_ms : 0;
+  }
+
+  std::vector<sample_t> samples;
+  size_t                cursor     = 0;  // Last sample at or before the clock
+  size_t                pre_sensor = 0;  // Leading records logged before the sensors had data
+
+  std::deque<std::string> labels;  // Owns the logged state labels, stable addresses
+
+  const char *intern(const std::string &label) {
+    for (const auto &l : labels)
+      if (l == label)
+        return l.c_str();
+    return labels.emplace_back(label).c_str();
+  }
+
+  bool load(const char *path, log_reader::info_t &info, log_reader::stats_t &stats) {
+    std::vector<uint8_t> data;
+    if (!log_reader::read_file(path, data)) {
+      fprintf(stderr, "Cannot open %s\n", path);
+      return false;
+    }
+
+    int         col_t = -1, col_state = -1, col_ax = -1, col_ay = -1, col_az = -1, col_p = -1;
+    std::string error;
+
+    const bool ok = log_reader::decode(
+      data,
+      [&](const log_reader::info_t &header) -> void {
+        info             = header;
+        const auto names = log_reader::split(header.column_line, ',');
+        for (int i = 0; i < static_cast<int>(names.size()); ++i) {
+          const std::string &n = names[i];
+          col_t                = n == "timestamp_ms" ? i : col_t;
+          col_state            = n == "state" ? i : col_state;
+          col_ax               = n == "acc_x" ? i : col_ax;
+          col_ay               = n == "acc_y" ? i : col_ay;
+          col_az               = n == "acc_z" ? i : col_az;
+          col_p                = n == "pressure_hpa" ? i : col_p;
+        }
+      },
+      [&](const char *line, size_t) -> void {
+        if (col_t < 0 || col_state < 0 || col_ax < 0 || col_ay < 0 || col_az < 0 || col_p < 0)
+          return;
+        const auto fields = log_reader::split(line, ',');
+        sample_t   s{};
+        s.t_ms         = static_cast<uint32_t>(strtoul(fields[col_t].c_str(), nullptr, 10));
+        s.state        = intern(fields[col_state]);
+        s.acc_x        = strtod(fields[col_ax].c_str(), nullptr);
+        s.acc_y        = strtod(fields[col_ay].c_str(), nullptr);
+        s.acc_z        = strtod(fields[col_az].c_str(), nullptr);
+        s.pressure_hpa = strtod(fields[col_p].c_str(), nullptr);
+        if (samples.empty() && s.pressure_hpa == 0.) {  // The firmware's all-zero record before the first reading
+          ++pre_sensor;
+          return;
+        }
+        if (samples.empty() || s.t_ms >= samples.back().t_ms)  // Drop records that go back in time
+          samples.push_back(s);
+      },
+      stats, error);
+
+    if (!ok) {
+      fprintf(stderr, "%s: %s\n", path, error.c_str());
+      return false;
+    }
+    if (col_t < 0 || col_state < 0 || col_ax < 0 || col_ay < 0 || col_az < 0 || col_p < 0) {
+      fprintf(stderr, "%s: needs timestamp_ms, state, acc_x/y/z and pressure_hpa columns\n", path);
+      return false;
+    }
+    if (samples.empty()) {
+      fprintf(stderr, "%s: no records\n", path);
+      return false;
+    }
+    return true;
+  }
+
+  enum class Input : uint8_t {
+    PREDICT,
+    ACC,
+    ALT
+  };
+
+  struct input_t {
+    Input  kind;
+    double z;
+  };
+
+  std::vector<input_t> inputs;  // Estimator inputs in the order the firmware applied them
+
+  // A filter pair fed from inputs, F fixed at the nominal FSM interval like the replay
+  template<typename Filter, typename Vdt>
+  struct shadow_t {
+    Vdt    vdt{static_cast<double>(RA_INTERVAL_FSM_EVAL) * 0.001};
+    Filter acc_f, alt_f;
+
+    shadow_t() {
+      acc_f.F = vdt.generate_F();
+      alt_f.F = vdt.generate_F();
+      solve_gains(acc_f, RA_INTERVAL_IMU_READING / RA_INTERVAL_FSM_EVAL);
+      solve_gains(alt_f, RA_INTERVAL_ALTIMETER_READING / RA_INTERVAL_FSM_EVAL);
+    }
+
+    void feed(const input_t &in) {
+      switch (in.kind) {
+        case Input::PREDICT:
+          acc_f.kf.predict();
+          alt_f.kf.predict();
+          break;
+        case Input::ACC:
+          acc_f.kf.update({in.z});
+          break;
+        case Input::ALT:
+          alt_f.kf.update({in.z});
+          break;
+      }
+    }
+
+    // acc_filt, vel_filt, pos_filt
+    [[nodiscard]] double output(const size_t i) const {
+      return i == 0 ? static_cast<double>(acc_f.kf.state()) : static_cast<double>(alt_f.kf.state_vector()[2 - i]);
+    }
+  };
+
+  using XcoreDouble  = shadow_t<Filter1T, xcore::vdt<FILTER_ORDER - 1>>;
+  using KalmanDouble = shadow_t<Filter1S<double>, kalman::vdt_t<double, FILTER_ORDER - 1>>;
+  using KalmanFloat  = shadow_t<Filter1S<float>, kalman::vdt_t<float, FILTER_ORDER - 1>>;
+  using PackedDouble = shadow_t<Filter1P<double>, kalman::vdt_t<double, FILTER_ORDER - 1>>;
+  using PackedFloat  = shadow_t<Filter1P<float>, kalman::vdt_t<float, FILTER_ORDER - 1>>;
+  using SteadyDouble = shadow_t<Filter1SS<double>, kalman::vdt_t<double, FILTER_ORDER - 1>>;
+  using SteadyFloat  = shadow_t<Filter1SS<float>, kalman::vdt_t<float, FILTER_ORDER - 1>>;
+
+  template<typename Shadow>
+  constexpr bool has_fallback = requires(Shadow &s) { s.acc_f.kf.steady(); };
+
+  struct deviation_t {
+    double max[3]{};
+    double sum_sq[3]{};
+    size_t ticks = 0;
+
+    // Steady-state filters only, acc and alt filter together
+    size_t   steady_ticks = 0;
+    uint32_t fallbacks    = 0;
+
+    [[nodiscard]] double rms(const size_t i) const {
+      return ticks ? std::sqrt(sum_sq[i] / static_cast<double>(ticks)) : 0.;
+    }
+  };
+
+  // Deviation of Shadow's outputs from Kalman.h double after every predict
+  template<typename Shadow>
+  deviation_t deviation() {
+    auto ref = std::make_unique<KalmanDouble>();
+    auto cmp = std::make_unique<Shadow>();
+
+    deviation_t d;
+    for (const auto &in : inputs) {
+      ref->feed(in);
+      cmp->feed(in);
+      if (in.kind != Input::PREDICT)
+        continue;
+      for (size_t i = 0; i < 3; ++i) {
+        const double e = std::abs(cmp->output(i) - ref->output(i));
+        d.max[i]       = e > d.max[i] ? e : d.max[i];
+        d.sum_sq[i] += e * e;
+      }
+      ++d.ticks;
+      if constexpr (has_fallback<Shadow>)
+        d.steady_ticks += cmp->acc_f.kf.steady() + cmp->alt_f.kf.steady();
+    }
+    if constexpr (has_fallback<Shadow>)
+      d.fallbacks = cmp->acc_f.kf.fallbacks() + cmp->alt_f.kf.fallbacks();
+    return d;
+  }
+
+  volatile double sink;
+
+  // Best of three passes over all inputs, per FSM tick
+  template<typename Shadow>
+  double ns_per_tick(const size_t ticks) {
+    double best = 0;
+    for (int pass = 0; pass < 3; ++pass) {
+      auto       shadow = std::make_unique<Shadow>();
+      const auto t0     = std::chrono::steady_clock::now();
+      for (const auto &in : inputs)
+        shadow->feed(in);
+      const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+      sink            = shadow->output(2);
+      best            = pass == 0 || ns < best ? ns : best;
+    }
+    return ticks ? best / static_cast<double>(ticks) : 0.;
+  }
+
+  template<typename Shadow>
+  void print_estimator(const char *name, const size_t ticks) {
+    const deviation_t d = deviation<Shadow>();
+    printf("  %-16s %8.1f %11.3g %11.3g %11.3g %11.3g %11.3g %11.3g", name, ns_per_tick<Shadow>(ticks),
+           d.max[0], d.rms(0), d.max[1], d.rms(1), d.max[2], d.rms(2));
+    if constexpr (has_fallback<Shadow>)
+      printf("  steady %.1f%%, %u fallbacks", d.ticks ? 50. * static_cast<double>(d.steady_ticks) / static_cast<double>(d.ticks) : 0.,
+             d.fallbacks);
+    printf("\n");
+  }
+
+  const char *format_name(const log_reader::info_t &info) {
+    switch (info.format) {
+      case log_reader::Format::SCHEMA_CSV:
+        return info.current ? "CSV, current schema" : "CSV, other schema";
+      case log_reader::Format::SCHEMA_BINARY:
+        return info.current ? "binary, current schema" : "binary, other schema";
+      case log_reader::Format::LEGACY_CSV:
+      default:
+        return "legacy CSV";
+    }
+  }
+}  // namespace
+
+sim::acc_t sim::imu_acc_g() {
+  const sample_t &s = samples[cursor];
+  return {s.acc_x, s.acc_y, s.acc_z};
+}
+
+double sim::altimeter_pressure_hpa() {
+  return samples[cursor].pressure_hpa;
+}
+
+// The estimator does not use GNSS: the receiver replays as one without a fix
+sim::gnss_t sim::gnss_fix() {
+  return {};
+}
+
+int main(const int argc, char **argv) {
+  const char *path      = nullptr;
+  const char *out_path  = nullptr;
+  bool        check     = false;
+  bool        usage     = false;
+  uint32_t    tolerance = 500;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--out=", 6) == 0)
+      out_path = argv[i] + 6;
+    else if (strcmp(argv[i], "--check") == 0)
+      check = true;
+    else if (strncmp(argv[i], "--tolerance=", 12) == 0)
+      tolerance = static_cast<uint32_t>(strtoul(argv[i] + 12, nullptr, 10));
+    else if (argv[i][0] != '-' && !path)
+      path = argv[i];
+    else
+      usage = true;
+  }
+
+  if (!path || usage) {
+    fprintf(stderr, "Usage: %s [--out=filters.csv] [--check] [--tolerance=ms] <log file>\n", argv[0]);
+    return 2;
+  }
+
+  log_reader::info_t  info;
+  log_reader::stats_t stats;
+  if (!load(path, info, stats))
+    return 1;
+
+  FILE *out = nullptr;
+  if (out_path) {
+    out = fopen(out_path, "wb");
+    if (!out) {
+      fprintf(stderr, "Cannot create %s\n", out_path);
+      return 1;
+    }
+    fputs("timestamp_ms,log_state,state,acc,acc_filt,vel_filt,pos_filt,alt_agl,alt_ref,apogee\n", out);
+  }
+
+  // Logged transitions, including the first state
+  std::vector<transition_t> logged;
+  for (size_t i = 0; i < samples.size(); ++i)
+    if (logged.empty() || strcmp(logged.back().state, samples[i].state) != 0)
+      logged.push_back({samples[i].t_ms, samples[i].state, samples[i ? i - 1 : 0].t_ms});
+
+  /* BEGIN REPLAY SETUP */
+  // Logged values are rounded and held between records, the pad and the
+  // ground repeat exactly; only read failures demote here
+  sensors_policy.max_range_faults = UINT32_MAX;
+  sensors_policy.stuck_ms         = UINT32_MAX;
+
+  UserSetupActuator();
+  UserSetupFilters();
+  UserSetupSensors();
+  /* END REPLAY SETUP */
+
+  constexpr uint32_t step_ms = std::gcd(std::gcd(RA_INTERVAL_FSM_EVAL, RA_INTERVAL_IMU_READING),
+                                        std::gcd(std::gcd(RA_INTERVAL_ALTIMETER_READING, RA_INTERVAL_AUTOZERO),
+                                                 RA_SENSOR_RETRY_INTERVAL));
+
+  const uint32_t t_begin = samples.front().t_ms;
+  const uint32_t t_end   = samples.back().t_ms;
+
+  std::vector<transition_t> replayed;
+  UserState                 last_state = fsm.state();
+  size_t                    next_out   = 0;
+  uint64_t                  ticks      = 0;
+
+  sim::advance_us(static_cast<uint64_t>(t_begin) * 1000u);
+
+  const auto wall_start = std::chrono::steady_clock::now();
+
+  for (uint32_t t = t_begin; t <= t_end; t += step_ms) {
+    if (t > t_begin)
+      sim::advance_us(static_cast<uint64_t>(step_ms) * 1000u);
+    while (cursor + 1 < samples.size() && samples[cursor + 1].t_ms <= t)
+      ++cursor;
+
+    const uint32_t elapsed = t - t_begin;
+
+    if (elapsed % RA_INTERVAL_FSM_EVAL == 0) {
+      PredictFilters(RA_INTERVAL_FSM_EVAL);
+      inputs.push_back({Input::PREDICT, 0.});
+      EvalFSM();
+      ++ticks;
+
+      if (fsm.state() != last_state || replayed.empty()) {
+        last_state = fsm.state();
+        replayed.push_back({t, state_string(last_state), t});
+      }
+    }
+
+    if (elapsed % RA_INTERVAL_IMU_READING == 0) {
+      ReadIMU();
+      ProcessIMU();
+      if constexpr (RA_ESTIMATOR_FUSED)
+        RunEstimator();
+      inputs.push_back({Input::ACC, acc});
+    }
+
+    if (elapsed % RA_INTERVAL_ALTIMETER_READING == 0) {
+      ReadAltimeter();
+      ProcessAltimeter();
+      if constexpr (RA_ESTIMATOR_FUSED)
+        RunEstimator();
+      inputs.push_back({Input::ALT, alt_agl + alt_ref});  // altitude_m
+    }
+
+    if (elapsed % RA_SENSOR_RETRY_INTERVAL == 0)
+      RecoverSensors();
+
+    if constexpr (RA_AUTO_ZERO_ALT_ENABLED) {
+      if (elapsed % RA_INTERVAL_AUTOZERO == 0)
+        AutoZeroAlt();
+    }
+
+    for (; out && next_out <= cursor; ++next_out) {
+      const auto estimate = ReadEstimate();
+      fprintf(out, "%u,%s,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+              samples[next_out].t_ms, samples[next_out].state, state_string(fsm.state()),
+              acc, static_cast<double>(estimate.acc), static_cast<double>(estimate.vel), static_cast<double>(estimate.alt),
+              alt_agl, alt_ref, apogee_raw);
+    }
+  }
+
+  const double wall_s   = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  const double flight_s = static_cast<double>(t_end - t_begin) * 1e-3;
+
+  if (out)
+    fclose(out);
+
+  printf("%s: %s, %zu records (%zu annotations, %zu skipped, %zu before sensor data), %.3f..%.3f s\n", path,
+         format_name(info), stats.records, stats.notes, stats.errors, pre_sensor, t_begin * 1e-3, t_end * 1e-3);
+  printf("  %-10s %12s %12s %9s\n", "state", "replay ms", "log ms", "delta ms");
+
+  // Pair each replayed transition with the first logged one into the same state
+  bool   failed   = false;
+  size_t searched = 0;
+  for (const auto &r : replayed) {
+    const transition_t *match = nullptr;
+    for (size_t i = searched; i < logged.size() && !match; ++i) {
+      if (strcmp(logged[i].state, r.state) == 0) {
+        match    = &logged[i];
+        searched = i + 1;
+      }
+    }
+    if (match)
+      printf("  %-10s %12u %12u %+9d\n", r.state, r.t_ms, match->t_ms,
+             static_cast<int>(r.t_ms) - static_cast<int>(match->t_ms));
+    else
+      printf("  %-10s %12u %12s %9s\n", r.state, r.t_ms, "-", "-");
+  }
+
+  // Logged transitions the replay never made, or made too far off
+  for (size_t i = 1; i < logged.size(); ++i) {
+    const transition_t *match = nullptr;
+    for (const auto &r : replayed)
+      if (strcmp(r.state, logged[i].state) == 0 && (!match || miss_ms(r.t_ms, logged[i]) < miss_ms(match->t_ms, logged[i])))
+        match = &r;
+    if (!match) {
+      printf("  missed %s at %u ms\n", logged[i].state, logged[i].t_ms);
+      failed = true;
+    } else if (miss_ms(match->t_ms, logged[i]) > tolerance) {
+      printf("  %s off by %u ms from the logged (%u, %u] ms\n", logged[i].state, miss_ms(match->t_ms, logged[i]),
+             logged[i].since_ms, logged[i].t_ms);
+      failed = true;
+    }
+  }
+
+  printf("  apogee (raw AGL) %.2f m, final %s\n", apogee_raw, state_string(fsm.state()));
+  printf("  %zu records, %llu FSM ticks in %.4f s wall: %.0f records/s, %.0f ticks/s, x%.0f real time\n",
+         samples.size(), static_cast<unsigned long long>(ticks), wall_s,
+         wall_s > 0. ? static_cast<double>(samples.size()) / wall_s : 0.,
+         wall_s > 0. ? static_cast<double>(ticks) / wall_s : 0.,
+         wall_s > 0. ? flight_s / wall_s : 0.);
+
+  printf("  estimator %s, inputs fed again, deviation from dense double after each of %llu predicts:\n",
+         ESTIMATOR_NAME, static_cast<unsigned long long>(ticks));
+  printf("  %-16s %8s %11s %11s %11s %11s %11s %11s\n", "filter", "ns/tick", "acc max", "acc rms",
+         "vel max", "vel rms", "pos max", "pos rms");
+  print_estimator<XcoreDouble>("xcore double", ticks);
+  print_estimator<KalmanDouble>("dense double", ticks);
+  print_estimator<KalmanFloat>("dense float", ticks);
+  print_estimator<PackedDouble>("packed double", ticks);
+  print_estimator<PackedFloat>("packed float", ticks);
+  print_estimator<SteadyDouble>("steady double", ticks);
+  print_estimator<SteadyFloat>("steady float", ticks);
+
+  if (check && failed) {
+    printf("  CHECK FAILED (tolerance %u ms)\n", tolerance);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,35 @@
+#include <Arduino.h>
+#include "hal_profiler.h"
+
+namespace hal::rtos::prof {
+  volatile uint32_t cycles[mon::MAX_MON + 1] = {};
+
+  namespace {
+    uint32_t last_cycle = 0;
+    size_t   current    = IDLE;
+  }  // namespace
+}  // namespace hal::rtos::prof
+
+/**
+ * traceTASK_SWITCHED_IN hook, runs inside the kernel with interrupts masked.
+ * Feeds both the CPU profiler and the event trace.
+ */
+extern "C" void ra_trace_task_switched_in(void *tcb) {
+  using namespace hal::rtos;
+
+  const uint32_t now = hal::cycles();
+  prof::cycles[prof::current] = prof::cycles[prof::current] + (now - prof::last_cycle);
+  prof::last_cycle = now;
+
+  size_t slot = prof::IDLE;
+  for (size_t i = 0; i < mon::num_handles; ++i) {
+    if (mon::handles[i] == tcb) {
+      slot = i;
+      break;
+    }
+  }
+  prof::current = slot;
+
+  hal::trace::record(hal::trace::Event::TASK_SWITCH,
+                     slot == prof::IDLE ? ::trace::IDLE_TASK : static_cast<uint8_t>(slot));
+}
@@ -0,0 +1,348 @@
+/**
+ * Host check of the sensor register bursts against mock SPI devices.
+ *
+ * Usage: spi_check [log ...]
+ *
+ * Attaches an ADXL372 and a BMP581 register map to hal::spi::spi1 and reads
+ * them through the same adxl372/bmp581 readers the drivers use, the two
+ * devices' bursts interleaved on the bus. Without arguments the maps sweep
+ * every ADXL372 code and 300..1250 hPa, -40..85 C; with logs they replay the
+ * logged acc_x/y/z and pressure_hpa, one record per read. Every decoded
+ * value must be within one LSB of what the map was loaded with.
+ *
+ * Then, for each decimation ratio, a mock ADXL372 FIFO runs at 6400 Hz on a
+ * clock 0.5% off the host's and is drained by fifo_reader_t and stream_t on
+ * 5 ms ticks with jitter, across the 32 bit microsecond wrap and through one
+ * overrun. Every raw sample must arrive in order and within 250 us of its
+ * true time, the decimated stream must be timestamped as closely, and a tone
+ * 10 Hz above the output rate must be rejected rather than aliased. Bus load
+ * is reported at the SPI1 clock, and the bursts must all have fit the DMA
+ * pool. Exits 1 on any mismatch.
+ */
+#include <LogReader.h>
+#include <UserPins.h>
+#include <UserSensorRegs.h>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+  struct frame_t {
+    adxl372::sample_t acc;
+    bmp581::sample_t  baro;
+  };
+
+  std::vector<frame_t> frames;
+  size_t               next_acc  = 0;
+  size_t               next_baro = 0;
+
+  // Each data burst loads the next frame, like a device with a fresh sample per read
+  void on_read_acc(hal::spi::mock_device_t &dev, const uint8_t reg, void *) {
+    if (reg == adxl372::REG_XDATA_H && next_acc < frames.size())
+      adxl372::encode(frames[next_acc++].acc, dev.regs + reg);
+  }
+
+  void on_read_baro(hal::spi::mock_device_t &dev, const uint8_t reg, void *) {
+    if (reg == bmp581::REG_TEMP_DATA_XLSB && next_baro < frames.size())
+      bmp581::encode(frames[next_baro++].baro, dev.regs + reg);
+  }
+
+  void synthetic() {
+    for (int code = -2048; code < 2048; ++code) {
+      const double g = code * adxl372::G_PER_LSB;
+      const double t = -40.0 + 125.0 * (code + 2048) / 4096.0;
+      const double p = 30000.0 + 95000.0 * (code + 2048) / 4096.0;
+      frames.push_back({{g, -g, code % 7 * adxl372::G_PER_LSB}, {t, p}});
+    }
+  }
+
+  bool load(const char *path) {
+    std::vector<uint8_t> data;
+    if (!log_reader::read_file(path, data)) {
+      fprintf(stderr, "Cannot open %s\n", path);
+      return false;
+    }
+
+    int                 col_ax = -1, col_ay = -1, col_az = -1, col_p = -1;
+    log_reader::stats_t stats;
+    std::string         error;
+
+    const bool ok = log_reader::decode(
+      data,
+      [&](const log_reader::info_t &header) -> void {
+        const auto names = log_reader::split(header.column_line, ',');
+        for (int i = 0; i < static_cast<int>(names.size()); ++i) {
+          const std::string &n = names[i];
+          col_ax               = n == "acc_x" ? i : col_ax;
+          col_ay               = n == "acc_y" ? i : col_ay;
+          col_az               = n == "acc_z" ? i : col_az;
+          col_p                = n == "pressure_hpa" ? i : col_p;
+        }
+      },
+      [&](const char *line, size_t) -> void {
+        if (col_ax < 0 || col_ay < 0 || col_az < 0 || col_p < 0)
+          return;
+        const auto fields = log_reader::split(line, ',');
+        frame_t    f{};
+        f.acc.x            = strtod(fields[col_ax].c_str(), nullptr);
+        f.acc.y            = strtod(fields[col_ay].c_str(), nullptr);
+        f.acc.z            = strtod(fields[col_az].c_str(), nullptr);
+        f.baro.pressure_pa = strtod(fields[col_p].c_str(), nullptr) * 100.0;  // hPa -> Pa
+        f.baro.temperature_c = 25.0;
+        frames.push_back(f);
+      },
+      stats, error);
+
+    if (!ok) {
+      fprintf(stderr, "%s: %s\n", path, error.c_str());
+      return false;
+    }
+    if (col_ax < 0 || col_ay < 0 || col_az < 0 || col_p < 0) {
+      fprintf(stderr, "%s: needs acc_x/y/z and pressure_hpa columns\n", path);
+      return false;
+    }
+    printf("%s: %zu records\n", path, stats.records);
+    return true;
+  }
+
+  // Saturated like the 12 bit output
+  double clamp_g(const double g) {
+    return std::fmin(std::fmax(g, -2048 * adxl372::G_PER_LSB), 2047 * adxl372::G_PER_LSB);
+  }
+
+  constexpr double SPI1_HZ = 183.33e6 / 32;  // src/spi_dma.cpp
+
+  /**
+   * ADXL372 FIFO in stream mode: sets enter at the device's ODR, a full FIFO
+   * drops its oldest entries one by one (so sets tear) and flags an overrun.
+   * X carries a tone, Y is a constant, Z counts samples.
+   */
+  struct mock_fifo_t {
+    double               t0_s;
+    double               period_s;
+    double               tone_hz;
+    uint64_t             produced = 0;
+    std::deque<uint16_t> entries;
+    bool                 overrun = false;
+    uint8_t              pending = 0;  // Byte of the entry being clocked out
+    uint16_t             current = 0;
+
+    static constexpr int16_t Y_CODE = 10;  // 1 g
+    static constexpr int16_t Z_BASE = -2000;
+
+    [[nodiscard]] double time_of(const uint64_t k) const {
+      return t0_s + static_cast<double>(k) * period_s;
+    }
+
+    [[nodiscard]] int16_t x_code(const uint64_t k) const {
+      return static_cast<int16_t>(std::lround(1000.0 * std::sin(2.0 * M_PI * tone_hz * (time_of(k) - t0_s))));
+    }
+
+    void advance_to(const double t_s) {
+      while (time_of(produced) <= t_s) {
+        const uint64_t k = produced++;
+        for (const uint16_t e : {adxl372::fifo_entry(x_code(k), true), adxl372::fifo_entry(Y_CODE, false),
+                                 adxl372::fifo_entry(static_cast<int16_t>(Z_BASE + static_cast<int64_t>(k % 4000)), false)}) {
+          if (entries.size() == adxl372::FIFO_ENTRIES) {
+            entries.pop_front();
+            overrun = true;
+          }
+          entries.push_back(e);
+        }
+      }
+    }
+
+    static void on_read(hal::spi::mock_device_t &dev, const uint8_t reg, void *ctx) {
+      auto &f = *static_cast<mock_fifo_t *>(ctx);
+      if (reg != adxl372::REG_STATUS)
+        return;
+      const size_t n = f.entries.size();
+      dev.regs[adxl372::REG_STATUS]     = (n ? adxl372::STATUS_FIFO_RDY : 0) | (f.overrun ? adxl372::STATUS_FIFO_OVR : 0);
+      dev.regs[adxl372::REG_STATUS + 2] = static_cast<uint8_t>(n >> 8);
+      dev.regs[adxl372::REG_STATUS + 3] = static_cast<uint8_t>(n);
+      f.overrun                         = false;
+    }
+
+    static uint8_t pop(hal::spi::mock_device_t &, void *ctx) {
+      auto &f = *static_cast<mock_fifo_t *>(ctx);
+      if (f.pending == 0) {
+        f.current = f.entries.empty() ? 0 : f.entries.front();
+        if (!f.entries.empty())
+          f.entries.pop_front();
+      }
+      const uint8_t b = f.pending == 0 ? static_cast<uint8_t>(f.current >> 8) : static_cast<uint8_t>(f.current);
+      f.pending       = f.pending ^ 1u;
+      return b;
+    }
+  };
+
+  /**
+   * Drain a mock FIFO through the driver's reader and stream at one ratio.
+   *
+   * @return Number of failed checks
+   */
+  size_t check_fifo(const uint32_t ratio) {
+    constexpr double TICK_S      = 0.005;
+    constexpr double RUN_S       = 0.6;                // Z counts about 3900 samples without wrapping
+    constexpr double START_S     = 4294.967296 - 0.3;  // micros() wraps mid-run
+    constexpr double SKIP_AT_S   = 0.4;                // Reads stop for 40 ms: overrun
+    constexpr double SKIP_S      = 0.04;
+    constexpr double TOLERANCE_S = 250e-6;
+
+    mock_fifo_t fifo{START_S, 1.0 / (adxl372::ODR_HZ * 1.005), adxl372::ODR_HZ * 1.005 / ratio + 10.0};
+
+    hal::spi::bus_t         bus;
+    hal::spi::mock_device_t dev(USER_GPIO_ADXL372_NSS, adxl372::CMD);
+    dev.on_read  = mock_fifo_t::on_read;
+    dev.fifo_pop = mock_fifo_t::pop;
+    dev.fifo_reg = adxl372::REG_FIFO_DATA;
+    dev.ctx      = &fifo;
+    bus.attach(dev);
+
+    adxl372::fifo_reader_t reader(USER_GPIO_ADXL372_NSS);
+    adxl372::stream_t<>    stream(ratio);
+    adxl372::code_t        sets[adxl372::FIFO_SETS];
+
+    std::mt19937                           rng(ratio);
+    std::uniform_real_distribution<double> jitter(0.0, 300e-6);
+
+    size_t   failures = 0, raw_count = 0, dec_count = 0, overruns = 0, resyncs = 0;
+    double   max_raw_s = 0.0, max_dec_s = 0.0, max_alias_g = 0.0;
+    int64_t  last_z    = INT64_MIN;
+    uint32_t last_t_us = 0;
+
+    const auto time_error = [&](const uint32_t t_us, const double true_s) -> double {
+      const auto truth = static_cast<uint32_t>(static_cast<uint64_t>(std::llround(true_s * 1e6)));
+      return std::fabs(static_cast<double>(static_cast<int32_t>(t_us - truth))) * 1e-6;
+    };
+
+    for (double t = TICK_S; t < RUN_S; t += TICK_S) {
+      if (t >= SKIP_AT_S && t < SKIP_AT_S + SKIP_S)
+        continue;
+      const double t_read = START_S + t + jitter(rng);
+      fifo.advance_to(t_read);
+
+      bool         overrun = false;
+      const size_t n       = reader.read(bus, sets, overrun);
+      const auto   t_us    = static_cast<uint32_t>(static_cast<uint64_t>(std::llround(t_read * 1e6)));
+      stream.push(sets, n, t_us, overrun);
+      overruns += overrun;
+
+      const SensorIMU::Sample *raw;
+      for (size_t k = 0, m = stream.raw(raw); k < m; ++k, ++raw_count) {
+        // Z identifies the sample, X must be the tone of that sample
+        const int64_t z = std::lround(raw[k].acc_z / adxl372::G_PER_LSB) - mock_fifo_t::Z_BASE;
+        const int16_t x = static_cast<int16_t>(std::lround(raw[k].acc_x / adxl372::G_PER_LSB));
+        resyncs += z != last_z + 1 && last_z != INT64_MIN;
+        if (z <= last_z || x != fifo.x_code(z) || (raw_count && static_cast<int32_t>(raw[k].t_us - last_t_us) <= 0)) {
+          if (++failures <= 5)
+            fprintf(stderr, "R=%u: raw sample %lld out of order or wrong\n", ratio, static_cast<long long>(z));
+        }
+        max_raw_s = std::fmax(max_raw_s, time_error(raw[k].t_us, fifo.time_of(z)));
+        last_z    = z;
+        last_t_us = raw[k].t_us;
+      }
+
+      // A linear Z averages to its window centre: that sample's time is the decimated one's
+      const SensorIMU::Sample *dec;
+      for (size_t k = 0, m = stream.decimated(dec); k < m; ++k, ++dec_count) {
+        const double centre = dec[k].acc_z / adxl372::G_PER_LSB - mock_fifo_t::Z_BASE;
+        max_dec_s           = std::fmax(max_dec_s, time_error(dec[k].t_us, fifo.time_of(0) + centre * fifo.period_s));
+        max_alias_g         = std::fmax(max_alias_g, std::fabs(dec[k].acc_x));
+        if (std::fabs(dec[k].acc_y - mock_fifo_t::Y_CODE * adxl372::G_PER_LSB) > 1e-4) {
+          if (++failures <= 5)
+            fprintf(stderr, "R=%u: constant decimated to %.4f g\n", ratio, dec[k].acc_y);
+        }
+      }
+    }
+
+    // One overrun and its resync; everything else must have arrived
+    const size_t produced = fifo.produced - fifo.entries.size() / 3;
+    const bool   lost_ok  = overruns == 1 && resyncs == 1 && raw_count + 2 * adxl372::FIFO_SETS >= produced;
+    const double amp_g    = 1000.0 * adxl372::G_PER_LSB;
+    failures += !lost_ok;
+    failures += max_raw_s > TOLERANCE_S;
+    failures += max_dec_s > TOLERANCE_S;
+    failures += max_alias_g > 0.02 * amp_g;
+
+    const double bus_load = bus.stats().bytes * 8.0 / SPI1_HZ / (RUN_S - SKIP_S);
+    printf("R=%2u (%4.0f Hz): %zu raw, %zu decimated, %zu overrun; max time error raw %3.0f us, decimated %3.0f us; "
+           "alias %.2f%% of %.0f g; bus %.2f%% (%u bytes/s)\n",
+           ratio, adxl372::ODR_HZ / static_cast<double>(ratio), raw_count, dec_count, overruns, max_raw_s * 1e6,
+           max_dec_s * 1e6, max_alias_g / amp_g * 100.0, amp_g, bus_load * 100.0,
+           static_cast<unsigned>(bus.stats().bytes / (RUN_S - SKIP_S)));
+    return failures;
+  }
+}  // namespace
+
+int main(const int argc, char **argv) {
+  for (int i = 1; i < argc; ++i)
+    if (!load(argv[i]))
+      return 1;
+  if (argc == 1)
+    synthetic();
+
+  hal::spi::mock_device_t dev_acc(USER_GPIO_ADXL372_NSS, adxl372::CMD);
+  hal::spi::mock_device_t dev_baro(USER_GPIO_BMP581_NSS, bmp581::CMD);
+  dev_acc.on_read  = on_read_acc;
+  dev_baro.on_read = on_read_baro;
+
+  auto &bus = hal::spi::spi1;
+  bus.attach(dev_acc);
+  bus.attach(dev_baro);
+  hal::spi::begin_spi1();
+
+  adxl372::reader_t imu(USER_GPIO_ADXL372_NSS);
+  bmp581::reader_t  baro(USER_GPIO_BMP581_NSS);
+
+  size_t failures  = 0;
+  double max_acc_g = 0.0, max_p_pa = 0.0, max_t_c = 0.0;
+  for (size_t i = 0; i < frames.size(); ++i) {
+    adxl372::sample_t a{};
+    bmp581::sample_t  b{};
+    if (!imu.read(bus, a) || !baro.read(bus, b)) {
+      fprintf(stderr, "frame %zu: transfer failed\n", i);
+      return 1;
+    }
+
+    const frame_t &f     = frames[i];
+    const double   err_a = std::fmax(std::fabs(a.x - clamp_g(f.acc.x)),
+                                     std::fmax(std::fabs(a.y - clamp_g(f.acc.y)), std::fabs(a.z - clamp_g(f.acc.z))));
+    const double   err_p = std::fabs(b.pressure_pa - f.baro.pressure_pa);
+    const double   err_t = std::fabs(b.temperature_c - f.baro.temperature_c);
+    max_acc_g            = std::fmax(max_acc_g, err_a);
+    max_p_pa             = std::fmax(max_p_pa, err_p);
+    max_t_c              = std::fmax(max_t_c, err_t);
+
+    if (err_a > adxl372::G_PER_LSB || err_p > 1.0 / 64 || err_t > 1.0 / 65536) {
+      if (++failures <= 10)
+        fprintf(stderr, "frame %zu: acc %.2f/%.2f/%.2f g read %.2f/%.2f/%.2f g, %.4f Pa read %.4f Pa\n", i, f.acc.x,
+                f.acc.y, f.acc.z, a.x, a.y, a.z, f.baro.pressure_pa, b.pressure_pa);
+    }
+  }
+
+  // Nothing on a chip select reads back as an empty bus
+  hal::spi::burst_t<2> floating(USER_GPIO_LED, hal::spi::ReadCmd::MSB_SET, 0x00);
+  bus.transfer(floating);
+  const bool empty_ok = floating.data()[0] == 0xFF && floating.data()[1] == 0xFF;
+  if (!empty_ok)
+    ++failures;
+
+  printf("%zu frames, %u transfers: max error acc %.4f g, pressure %.5f Pa, temperature %.6f C; empty bus %s\n",
+         frames.size(), static_cast<unsigned>(bus.stats().transfers), max_acc_g, max_p_pa, max_t_c,
+         empty_ok ? "ok" : "wrong");
+
+  for (const uint32_t ratio : {32u, 16u, 8u, 6u})
+    failures += check_fifo(ratio);
+
+  // Every burst's buffers came from the DMA pool, none from the heap
+  const hal::dma::pool_t &pool = hal::dma::pool();
+  printf("DMA pool: %zu of %zu bytes, %zu past its end\n", pool.used(), hal::dma::POOL_SIZE, pool.exhausted());
+  if (pool.exhausted())
+    ++failures;
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+#if !RA_SIM
+#  include <Arduino.h>
+#  include "hal_spi.h"
+
+/**
+ * SPI1 on DMA1 streams 0 (RX) and 1 (TX). SPI1 runs from PLL1Q (183 MHz):
+ * /32 gives 5.7 MHz, the rate SPIClass picks for the drivers' 10 MHz.
+ */
+bool hal::spi::begin_spi1() {
+  return spi1.begin({
+    .instance   = SPI1,
+    .rx_stream  = DMA1_Stream0,
+    .tx_stream  = DMA1_Stream1,
+    .rx_request = DMA_REQUEST_SPI1_RX,
+    .tx_request = DMA_REQUEST_SPI1_TX,
+    .rx_irq     = DMA1_Stream0_IRQn,
+    .tx_irq     = DMA1_Stream1_IRQn,
+    .spi_irq    = SPI1_IRQn,
+    .prescaler  = SPI_BAUDRATEPRESCALER_32,
+  });
+}
+
+extern "C" {
+void DMA1_Stream0_IRQHandler() {
+  HAL_DMA_IRQHandler(&hal::spi::spi1.dma_rx);
+}
+
+void DMA1_Stream1_IRQHandler() {
+  HAL_DMA_IRQHandler(&hal::spi::spi1.dma_tx);
+}
+
+void SPI1_IRQHandler() {
+  HAL_SPI_IRQHandler(&hal::spi::spi1.spi);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+  if (hspi == &hal::spi::spi1.spi)
+    hal::spi::spi1.finish(/*ok*/ true);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+  if (hspi == &hal::spi::spi1.spi)
+    hal::spi::spi1.finish(/*ok*/ false);
+}
+}
+#endif
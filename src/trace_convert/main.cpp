@@ -0,0 +1,254 @@
+/**
+ * Host-side event trace converter, turns a TRACE<n>.BIN dump into Chrome
+ * trace JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * Usage: trace_convert <TRACE.BIN> [out.json]
+ *
+ * Rows:
+ *   - one per task, slices between context switches (idle included)
+ *   - one per mutex, "wait" and "hold" slices
+ *   - one per sensor and storage sink, BEGIN..END slices
+ *   - "fsm", one slice per state, plus the trigger and marks as instants
+ *
+ * Time is in microseconds from the oldest event in the dump.
+ */
+#include <TraceEvent.h>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+  constexpr uint32_t TID_IDLE    = 100;
+  constexpr uint32_t TID_MUTEX   = 200;
+  constexpr uint32_t TID_SENSOR  = 300;
+  constexpr uint32_t TID_STORAGE = 400;
+  constexpr uint32_t TID_FSM     = 500;
+
+  constexpr const char *state_names[] = {
+    "STARTUP", "IDLE_SAFE", "ARMED", "PAD_PREOP", "POWERED", "COASTING", "DROGUE_DEPLOY",
+    "DROGUE_DESCEND", "MAIN_DEPLOY", "MAIN_DESCEND", "LANDED", "RECOVERED_SAFE",
+  };
+
+  struct writer_t {
+    FILE *out;
+    bool  first = true;
+
+    void begin_event() {
+      fputs(first ? "\n  " : ",\n  ", out);
+      first = false;
+    }
+
+    void slice(const std::string &name, const uint32_t tid, const double ts, const double dur) {
+      begin_event();
+      fprintf(out, R"({"name":"%s","ph":"X","pid":1,"tid":%u,"ts":%.3f,"dur":%.3f})", name.c_str(), tid, ts, dur);
+    }
+
+    void instant(const std::string &name, const uint32_t tid, const double ts) {
+      begin_event();
+      fprintf(out, R"({"name":"%s","ph":"i","s":"g","pid":1,"tid":%u,"ts":%.3f})", name.c_str(), tid, ts);
+    }
+
+    void thread_name(const uint32_t tid, const std::string &name) {
+      begin_event();
+      fprintf(out, R"({"name":"thread_name","ph":"M","pid":1,"tid":%u,"args":{"name":"%s"}})", tid, name.c_str());
+      begin_event();
+      fprintf(out, R"({"name":"thread_sort_index","ph":"M","pid":1,"tid":%u,"args":{"sort_index":%u}})", tid, tid);
+    }
+  };
+
+  // Open slice per row, closed by the next event on that row
+  struct open_t {
+    std::string name;
+    double      ts;
+  };
+
+  std::string state_name(const uint16_t state) {
+    if (state < sizeof(state_names) / sizeof(state_names[0]))
+      return state_names[state];
+    return "STATE_" + std::to_string(state);
+  }
+
+  bool read_file(const char *path, std::vector<uint8_t> &data) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+      return false;
+    uint8_t buf[65536];
+    size_t  n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+      data.insert(data.end(), buf, buf + n);
+    fclose(fp);
+    return true;
+  }
+}  // namespace
+
+int main(const int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <TRACE.BIN> [out.json]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  if (!read_file(argv[1], data)) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  trace::dump_header_t header;
+  if (data.size() < sizeof(header)) {
+    fprintf(stderr, "File too short\n");
+    return 1;
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  if (memcmp(header.magic, trace::dump_header_t::MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != trace::dump_header_t::VERSION) {
+    fprintf(stderr, "Not a version %u trace dump\n", trace::dump_header_t::VERSION);
+    return 1;
+  }
+
+  const size_t names_at  = sizeof(header);
+  const size_t events_at = names_at + header.num_names * sizeof(trace::name_t);
+  if (data.size() < events_at + static_cast<size_t>(header.num_events) * sizeof(trace::event_t)) {
+    fprintf(stderr, "Truncated dump: %u names, %u events expected\n", header.num_names, header.num_events);
+    return 1;
+  }
+
+  std::map<std::pair<trace::Kind, uint8_t>, std::string> names;
+  for (uint32_t i = 0; i < header.num_names; ++i) {
+    trace::name_t n;
+    memcpy(&n, data.data() + names_at + i * sizeof(n), sizeof(n));
+    n.name[sizeof(n.name) - 1] = '\0';
+    names[{n.kind, n.id}]      = n.name;
+  }
+
+  const auto name_of = [&](const trace::Kind kind, const uint8_t id, const char *fallback) {
+    const auto it = names.find({kind, id});
+    return it != names.end() ? it->second : fallback + std::to_string(id);
+  };
+
+  FILE *out = argc > 2 ? fopen(argv[2], "wb") : stdout;
+  if (!out) {
+    fprintf(stderr, "Cannot create %s\n", argv[2]);
+    return 1;
+  }
+
+  writer_t w{out};
+  fputs(R"({"displayTimeUnit":"ms","traceEvents":[)", out);
+
+  const double us_per_cycle = header.cpu_hz ? 1e6 / header.cpu_hz : 1.0;
+
+  std::map<uint32_t, open_t> open;  // By row
+  std::map<uint32_t, bool>   rows;  // Rows seen, for the metadata
+
+  const auto close = [&](const uint32_t tid, const double ts) {
+    const auto it = open.find(tid);
+    if (it == open.end())
+      return;
+    w.slice(it->second.name, tid, it->second.ts, ts - it->second.ts);
+    open.erase(it);
+  };
+
+  const auto start = [&](const uint32_t tid, const std::string &name, const double ts) {
+    close(tid, ts);
+    open[tid] = {name, ts};
+    rows[tid] = true;
+  };
+
+  uint64_t cycles    = 0;
+  uint32_t last_raw  = 0;
+  uint32_t task_tid  = 0;  // Row of the running task, 0 before the first switch
+  size_t   unmatched = 0;
+
+  for (uint32_t i = 0; i < header.num_events; ++i) {
+    trace::event_t e;
+    memcpy(&e, data.data() + events_at + i * sizeof(e), sizeof(e));
+
+    // 32-bit counter wraps every ~7.8 s at 550 MHz; events are much denser than that
+    if (i > 0)
+      cycles += static_cast<uint32_t>(e.cycles - last_raw);
+    last_raw        = e.cycles;
+    const double ts = static_cast<double>(cycles) * us_per_cycle;
+
+    switch (e.type) {
+      case trace::Event::TASK_SWITCH: {
+        if (task_tid)
+          close(task_tid, ts);
+        task_tid = e.id == trace::IDLE_TASK ? TID_IDLE : e.id + 1u;
+        start(task_tid, e.id == trace::IDLE_TASK ? "idle" : name_of(trace::Kind::TASK, e.id, "task"), ts);
+        break;
+      }
+      case trace::Event::MUTEX_WAIT:
+        start(TID_MUTEX + e.id, "wait", ts);
+        break;
+      case trace::Event::MUTEX_LOCK:
+        start(TID_MUTEX + e.id, "hold", ts);
+        break;
+      case trace::Event::MUTEX_UNLOCK:
+        if (!open.count(TID_MUTEX + e.id))
+          ++unmatched;
+        close(TID_MUTEX + e.id, ts);
+        break;
+      case trace::Event::SENSOR_BEGIN:
+        start(TID_SENSOR + e.id, "read", ts);
+        break;
+      case trace::Event::STORAGE_BEGIN:
+        start(TID_STORAGE + e.id, "write " + std::to_string(e.arg), ts);
+        break;
+      case trace::Event::SENSOR_END:
+      case trace::Event::STORAGE_END: {
+        const uint32_t tid = (e.type == trace::Event::SENSOR_END ? TID_SENSOR : TID_STORAGE) + e.id;
+        if (!open.count(tid))
+          ++unmatched;
+        close(tid, ts);
+        break;
+      }
+      case trace::Event::FSM_STATE:
+        start(TID_FSM, state_name(e.arg), ts);
+        break;
+      case trace::Event::TRIGGER:
+        w.instant("TRIGGER", TID_FSM, ts);
+        rows[TID_FSM] = true;
+        break;
+      case trace::Event::MARK:
+        w.instant(name_of(trace::Kind::MARK, e.id, "mark") + " " + std::to_string(e.arg), TID_FSM, ts);
+        rows[TID_FSM] = true;
+        break;
+      default:
+        ++unmatched;
+        break;
+    }
+  }
+
+  // Close what is still running at the end of the dump
+  const double end_ts = static_cast<double>(cycles) * us_per_cycle;
+  while (!open.empty())
+    close(open.begin()->first, end_ts);
+
+  for (const auto &[tid, _] : rows) {
+    std::string name;
+    if (tid == TID_IDLE)
+      name = "idle";
+    else if (tid == TID_FSM)
+      name = "fsm";
+    else if (tid >= TID_STORAGE)
+      name = "storage " + name_of(trace::Kind::STORAGE, tid - TID_STORAGE, "sink");
+    else if (tid >= TID_SENSOR)
+      name = "sensor " + name_of(trace::Kind::SENSOR, tid - TID_SENSOR, "sensor");
+    else if (tid >= TID_MUTEX)
+      name = "mutex " + name_of(trace::Kind::MUTEX, tid - TID_MUTEX, "mutex");
+    else
+      name = "task " + name_of(trace::Kind::TASK, tid - 1, "task");
+    w.thread_name(tid, name);
+  }
+
+  fputs("\n]}\n", out);
+  if (out != stdout)
+    fclose(out);
+
+  fprintf(stderr, "%u events (%u recorded in total), %.3f ms, trigger %s, %zu unmatched\n", header.num_events,
+          header.total_events, end_ts / 1000.0,
+          header.trigger_index != UINT32_MAX ? ("at event " + std::to_string(header.trigger_index)).c_str() : "none",
+          unmatched);
+  return 0;
+}
@@ -0,0 +1,43 @@
+#if !RA_SIM
+#  include <Arduino.h>
+#  include "UserPins.h"
+#  include "hal_uart.h"
+
+/**
+ * USART2 (the GNSS receiver) RX on DMA1 stream 2. HAL_UART_MODULE_ONLY
+ * keeps the core's HardwareSerial and its USART interrupt handlers out.
+ */
+bool hal::uart::begin_usart2(const uint32_t baud) {
+  __HAL_RCC_USART2_CLK_ENABLE();
+  return usart2.begin({
+                        .instance   = USART2,
+                        .rx_stream  = DMA1_Stream2,
+                        .rx_request = DMA_REQUEST_USART2_RX,
+                        .dma_irq    = DMA1_Stream2_IRQn,
+                        .uart_irq   = USART2_IRQn,
+                        .tx_pin     = USER_GPIO_GNSS_TX,
+                        .rx_pin     = USER_GPIO_GNSS_RX,
+                      },
+                      baud);
+}
+
+extern "C" {
+void DMA1_Stream2_IRQHandler() {
+  HAL_DMA_IRQHandler(&hal::uart::usart2.dma_rx);
+}
+
+void USART2_IRQHandler() {
+  HAL_UART_IRQHandler(&hal::uart::usart2.uart);
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, const uint16_t size) {
+  if (huart == &hal::uart::usart2.uart)
+    hal::uart::usart2.event(size);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+  if (huart == &hal::uart::usart2.uart)
+    hal::uart::usart2.error();
+}
+}
+#endif
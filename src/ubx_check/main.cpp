@@ -0,0 +1,247 @@
+/**
+ * Host check of the UBX parser (lib/LibAvionics/UBX.h) on captured or
+ * synthesized receiver output.
+ *
+ * Usage: ubx_check [capture.ubx ...]
+ *
+ * Without arguments: a minute of 25 Hz NAV-PVT mixed with NMEA sentences,
+ * ACKs, corrupted and truncated frames and false syncs, fed through a
+ * 4096-byte ring in random chunks the way the DMA publishes it. Checks that
+ * every intact NAV-PVT comes out once, in order and decoded right, that
+ * nothing else does, and the counts; then times the parser per byte. Exits
+ * 1 on any failure.
+ *
+ * With arguments: each file, a raw capture of the receiver's UART (u-center
+ * .ubx, or a logic analyser dump), goes through the same ring; prints the
+ * frame counts and the solution rate found.
+ */
+#include <UBX.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+  constexpr size_t   RING_SIZE = 4096;
+  constexpr uint32_t RATE_HZ   = 25;
+  constexpr uint32_t SECONDS   = 60;
+  constexpr uint32_t UTC_START = 1767225600;  // 2026-01-01
+
+  struct ring_t {
+    uint8_t  buf[RING_SIZE] = {};
+    uint32_t head           = 0;
+  };
+
+  // Feed src through ring in chunks of up to max_chunk, as far as the parser has read, parsing after each
+  template<typename Func>
+  void feed(const std::vector<uint8_t> &src, ubx::parser_t &parser, std::mt19937 &rng, const size_t max_chunk,
+            Func &&on_frame) {
+    ring_t                                ring;
+    std::uniform_int_distribution<size_t> chunk(1, max_chunk);
+    for (size_t i = 0; i < src.size();) {
+      const size_t room = RING_SIZE - (ring.head - parser.need());
+      size_t       n    = std::min({chunk(rng), room, src.size() - i});
+      for (; n; --n)
+        ring.buf[ring.head++ % RING_SIZE] = src[i++];
+      parser.parse(ring.buf, ring.head, on_frame);
+    }
+  }
+
+  ubx::nav_pvt_t make_pvt(const uint32_t k) {
+    ubx::nav_pvt_t pvt{};
+    pvt.set_time(UTC_START + k / RATE_HZ, k % RATE_HZ * (1000 / RATE_HZ));
+    pvt.fix_type   = k < RATE_HZ ? ubx::nav_pvt_t::FIX_NONE : ubx::nav_pvt_t::FIX_3D;
+    pvt.flags      = k < RATE_HZ ? 0 : ubx::nav_pvt_t::FLAGS_FIX_OK;
+    pvt.num_sv     = static_cast<uint8_t>(4 + k % 20);
+    pvt.lat        = 137'000'000 + static_cast<int32_t>(k * 13);
+    pvt.lon        = 1'005'000'000 - static_cast<int32_t>(k * 7);
+    pvt.h_msl_mm   = 100'000 + static_cast<int32_t>(k * 250);
+    pvt.height_mm  = pvt.h_msl_mm + 28'000;
+    pvt.vel_d_mm_s = -static_cast<int32_t>(k % 500);
+    return pvt;
+  }
+
+  void append_nmea(std::vector<uint8_t> &out, const uint32_t k) {
+    char body[96];
+    snprintf(body, sizeof(body), "GNGGA,%06u.00,1342.0000,N,10030.0000,E,1,%02u,0.9,100.0,M,-28.0,M,,", k % 240000,
+             4 + k % 20);
+    uint8_t ck = 0;
+    for (const char *c = body; *c; ++c)
+      ck ^= static_cast<uint8_t>(*c);
+    char line[128];
+    const int n = snprintf(line, sizeof(line), "$%s*%02X\r\n", body, ck);
+    out.insert(out.end(), line, line + n);
+  }
+
+  void append_frame(std::vector<uint8_t> &out, const uint8_t *frame, const size_t len) {
+    out.insert(out.end(), frame, frame + len);
+  }
+
+  struct stream_t {
+    std::vector<uint8_t>  bytes;
+    std::vector<uint32_t> intact;  // Index k of each NAV-PVT sent whole, in order
+    uint32_t              acks = 0;
+  };
+
+  /**
+   * k-th solution every 1/RATE_HZ; around it, as a receiver left with NMEA
+   * on and a noisy line would give: NMEA, ACKs, every 37th NAV-PVT with a
+   * flipped bit, every 53rd cut short, false syncs with lengths past the
+   * limit.
+   */
+  stream_t synthesize() {
+    stream_t     s;
+    std::mt19937 rng(7);
+    uint8_t      frame[ubx::OVERHEAD + ubx::nav_pvt_t::LEN];
+
+    for (uint32_t k = 0; k < RATE_HZ * SECONDS; ++k) {
+      if (k % 5 == 0)
+        append_nmea(s.bytes, k);
+
+      const size_t len = make_pvt(k).encode(frame, sizeof(frame));
+      if (k % 37 == 11) {
+        frame[ubx::HEADER_LEN + rng() % ubx::nav_pvt_t::LEN] ^= static_cast<uint8_t>(1u << rng() % 8);
+        append_frame(s.bytes, frame, len);
+      } else if (k % 53 == 17) {
+        append_frame(s.bytes, frame, ubx::HEADER_LEN + rng() % ubx::nav_pvt_t::LEN);
+      } else {
+        append_frame(s.bytes, frame, len);
+        s.intact.push_back(k);
+      }
+
+      if (k % 50 == 3) {
+        uint8_t       ack[ubx::OVERHEAD + 2];
+        ubx::writer_t w(ack, sizeof(ack), ubx::CLASS_ACK, ubx::ID_ACK_ACK);
+        append_frame(s.bytes, ack, w.u1(ubx::CLASS_CFG).u1(ubx::ID_CFG_VALSET).finish());
+        ++s.acks;
+      }
+
+      if (k % 29 == 5) {
+        const uint8_t false_sync[] = {ubx::SYNC_1, ubx::SYNC_2, 0x01, 0x07, 0xFF, 0x7F, 0x00};
+        append_frame(s.bytes, false_sync, sizeof(false_sync));
+      }
+    }
+    return s;
+  }
+
+  bool same(const ubx::nav_pvt_t &a, const ubx::nav_pvt_t &b) {
+    return a.itow_ms == b.itow_ms && a.year == b.year && a.month == b.month && a.day == b.day && a.hour == b.hour &&
+           a.min == b.min && a.sec == b.sec && a.nano_ns == b.nano_ns && a.fix_type == b.fix_type &&
+           a.flags == b.flags && a.num_sv == b.num_sv && a.lat == b.lat && a.lon == b.lon &&
+           a.h_msl_mm == b.h_msl_mm && a.height_mm == b.height_mm && a.vel_d_mm_s == b.vel_d_mm_s;
+  }
+
+  bool check_stream() {
+    const stream_t s      = synthesize();
+    bool           failed = false;
+
+    // Chunks from a byte at a time up to half the ring, the DMA's half-transfer event
+    for (const size_t max_chunk : {size_t{1}, size_t{64}, RING_SIZE / 2}) {
+      ubx::parser_t parser;
+      std::mt19937  rng(static_cast<uint32_t>(max_chunk));
+      size_t        next = 0, wrong = 0, acks = 0, other = 0;
+
+      feed(s.bytes, parser, rng, max_chunk, [&](const ubx::frame_t &frame) -> void {
+        if (frame.is(ubx::CLASS_ACK, ubx::ID_ACK_ACK)) {
+          ++acks;
+          return;
+        }
+        ubx::nav_pvt_t pvt{};
+        if (!pvt.decode(frame)) {
+          ++other;
+          return;
+        }
+        const ubx::nav_pvt_t expected = make_pvt(next < s.intact.size() ? s.intact[next] : 0);
+        wrong += next >= s.intact.size() || !same(pvt, expected) ||
+                 pvt.unix_time() != UTC_START + s.intact[next] / RATE_HZ ||
+                 pvt.fix_ok() != (s.intact[next] >= RATE_HZ);
+        ++next;
+      });
+
+      const ubx::parser_stats_t &st = parser.stats();
+      const bool ok = next == s.intact.size() && wrong == 0 && acks == s.acks && other == 0 &&
+                      st.frames == s.intact.size() + s.acks && st.checksum_errors > 0;
+      printf("chunks up to %4zu: %zu/%zu NAV-PVT (%zu wrong), %zu/%u ACK, %u frames, %u checksum errors, "
+             "%u bytes skipped%s\n",
+             max_chunk, next, s.intact.size(), wrong, acks, s.acks, st.frames, st.checksum_errors, st.skipped,
+             ok ? "" : "  FAILED");
+      failed |= !ok;
+    }
+    return !failed;
+  }
+
+  void time_parser() {
+    constexpr size_t ROUNDS = 20;
+
+    const stream_t                           s = synthesize();
+    static uint8_t                           ring[1u << 20];
+    volatile uint32_t                        sink = 0;
+    std::chrono::duration<double, std::nano> elapsed{0};
+    for (size_t r = 0; r < ROUNDS; ++r) {
+      memcpy(ring, s.bytes.data(), s.bytes.size());
+      ubx::parser_t parser;
+      const auto    start = std::chrono::steady_clock::now();
+      parser.parse(ring, static_cast<uint32_t>(s.bytes.size()), [&](const ubx::frame_t &frame) -> void {
+        ubx::nav_pvt_t pvt{};
+        if (pvt.decode(frame))
+          sink = sink + static_cast<uint32_t>(pvt.lat);
+      });
+      elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    const double ns_byte = elapsed.count() / static_cast<double>(ROUNDS * s.bytes.size());
+    const double per_pvt = ns_byte * static_cast<double>(ubx::OVERHEAD + ubx::nav_pvt_t::LEN);
+    printf("parser: %.2f ns/byte, %.0f ns per NAV-PVT, %.4f%% of a core at %u Hz\n", ns_byte, per_pvt,
+           per_pvt * RATE_HZ * 1e-7, RATE_HZ);
+  }
+
+  bool check_capture(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+      printf("%s: cannot open\n", path);
+      return false;
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t              buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;)
+      bytes.insert(bytes.end(), buf, buf + n);
+    fclose(f);
+
+    ubx::parser_t parser;
+    std::mt19937  rng(1);
+    uint32_t      nav_pvt = 0, fixes = 0, first_itow = 0, last_itow = 0;
+    feed(bytes, parser, rng, RING_SIZE / 2, [&](const ubx::frame_t &frame) -> void {
+      ubx::nav_pvt_t pvt{};
+      if (!pvt.decode(frame))
+        return;
+      if (nav_pvt++ == 0)
+        first_itow = pvt.itow_ms;
+      last_itow = pvt.itow_ms;
+      fixes += pvt.fix_ok();
+    });
+
+    const ubx::parser_stats_t &st   = parser.stats();
+    const double               span = (last_itow - first_itow) * 1e-3;
+    printf("%s: %zu bytes, %u frames, %u checksum errors, %u bytes skipped, %u NAV-PVT (%u fixes), %.1f Hz\n", path,
+           bytes.size(), st.frames, st.checksum_errors, st.skipped, nav_pvt, fixes,
+           span > 0. ? (nav_pvt - 1) / span : 0.);
+    return true;
+  }
+}  // namespace
+
+int main(const int argc, char **argv) {
+  if (argc > 1) {
+    bool ok = true;
+    for (int i = 1; i < argc; ++i)
+      ok &= check_capture(argv[i]);
+    return ok ? 0 : 1;
+  }
+
+  const bool ok = check_stream();
+  time_parser();
+
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
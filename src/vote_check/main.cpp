@@ -0,0 +1,210 @@
+/**
+ * Host check of sensor health monitoring and voting (sensors:: in Sensors.h).
+ *
+ * Usage: vote_check
+ *
+ * Three mock altimeters read at 10 Hz for 60 s of virtual time, with a
+ * recovery pass every retry interval as CB_SensorRecovery does. One sticks,
+ * one stops answering and one reads out of range, at different times. Checks
+ * that the voted pressure stays on the truth throughout, that each faulty
+ * sensor is demoted within its policy limit, and that it votes again within a
+ * retry and its probation of the fault's end; restarts while the fault lasts
+ * are demoted again. Then times vote() on IMU data for 1, 3 and 5 sensors.
+ * Exits 1 on any failure.
+ */
+#include <Sensors.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+  // As the UserConfig.h defaults
+  constexpr sensors::health_policy_t policy = {
+    .max_read_failures = 20,
+    .max_range_faults  = 5,
+    .stuck_ms          = 1000,
+    .retry_ms          = 500,
+    .probation_reads   = 10,
+  };
+
+  constexpr uint32_t READ_MS   = 100;
+  constexpr uint32_t END_MS    = 60'000;
+  constexpr double   MAX_ERROR = 0.05;  // hPa, voted pressure off the truth
+
+  enum class Mode { OK, FAIL, STUCK, RANGE };
+
+  struct fault_t {
+    Mode     mode;
+    uint32_t from_ms;
+    uint32_t to_ms;
+  };
+
+  double truth_hpa(const uint32_t ms) {
+    return 1000.0 - 0.5 * std::sin(static_cast<double>(ms) * 1e-4);
+  }
+
+  class Altimeter_Mock final : public SensorAltimeter {
+    fault_t  fault_;
+    uint32_t now_ms_ = 0;
+    double   offset_;
+
+    [[nodiscard]] Mode mode() const {
+      return now_ms_ >= fault_.from_ms && now_ms_ < fault_.to_ms ? fault_.mode : Mode::OK;
+    }
+
+  public:
+    Altimeter_Mock(const fault_t fault, const double offset) : fault_(fault), offset_(offset) {}
+
+    void tick(const uint32_t now_ms) {
+      now_ms_ = now_ms;
+    }
+
+    bool begin() override {
+      return mode() != Mode::FAIL;
+    }
+
+    bool read(Data &out) override {
+      switch (mode()) {
+        case Mode::FAIL:
+          return false;
+        case Mode::STUCK:
+          return true;
+        case Mode::RANGE:
+          out = {0., NAN};
+          return true;
+        case Mode::OK:
+        default:
+          out.pressure_hpa = truth_hpa(now_ms_) + offset_;
+          out.altitude_m   = altitude_m(out.pressure_hpa);
+          return true;
+      }
+    }
+  };
+
+  bool plausible(const SensorAltimeter::Data &d) {
+    return d.pressure_hpa >= 300.0 && d.pressure_hpa <= 1250.0 && std::isfinite(d.altitude_m);
+  }
+
+  // Bound on the time from a fault's start to the demotion, ms
+  uint32_t demote_limit(const Mode mode) {
+    switch (mode) {
+      case Mode::FAIL:
+        return policy.max_read_failures * READ_MS;
+      case Mode::RANGE:
+        return policy.max_range_faults * READ_MS;
+      case Mode::STUCK:
+        return policy.stuck_ms + 2 * READ_MS;
+      case Mode::OK:
+      default:
+        return 0;
+    }
+  }
+
+  // Bound on the time from a fault's end to voting again: a retry, then probation
+  constexpr uint32_t return_limit() {
+    return policy.retry_ms + (policy.probation_reads + 1) * READ_MS;
+  }
+
+  bool check_faults() {
+    constexpr size_t N = 3;
+
+    const fault_t faults[N] = {
+      {Mode::STUCK, 10'000, 20'000},
+      {Mode::FAIL, 15'000, 18'000},
+      {Mode::RANGE, 40'000, 42'000},
+    };
+    Altimeter_Mock alt0(faults[0], -0.01), alt1(faults[1], 0.), alt2(faults[2], 0.01);
+
+    sensors::registry_t   altimeter(alt0, alt1, alt2);
+    sensors::health_t     health[N];
+    SensorAltimeter::Data in[N]         = {};
+    SensorAltimeter::Data voted         = {};
+    uint32_t              demoted_ms[N] = {};
+    sensors::Fault        demoted_by[N] = {};
+    uint32_t              back_ms[N]    = {};
+    double                max_error     = 0.;
+    bool                  failed        = false;
+
+    altimeter.begin(health, policy, 0);
+    for (uint32_t now = 0; now < END_MS; now += READ_MS) {
+      altimeter.for_each([&](auto &sensor, const size_t i) -> void {
+        sensor.tick(now);
+        if (health[i].status() != SensorStatus::SENSOR_OK)
+          return;
+        const SensorAltimeter::Data last = in[i];
+        const bool                  ok   = sensor.read(in[i]);
+        health[i].read(ok, ok && plausible(in[i]), in[i] != last, now);
+      });
+
+      if (sensors::vote(in, health, voted, &SensorAltimeter::Data::pressure_hpa,
+                        &SensorAltimeter::Data::altitude_m) == 0) {
+        printf("%6u ms: no sensor voted\n", now);
+        failed = true;
+      } else {
+        max_error = std::max(max_error, std::abs(voted.pressure_hpa - truth_hpa(now)));
+      }
+
+      if (now % policy.retry_ms == 0)
+        altimeter.restart(health, policy, now);
+
+      for (size_t i = 0; i < N; ++i) {
+        if (!demoted_ms[i] && health[i].status() == SensorStatus::SENSOR_ERR) {
+          demoted_ms[i] = now;
+          demoted_by[i] = health[i].fault();
+        }
+        if (demoted_ms[i] && !back_ms[i] && health[i].voting())
+          back_ms[i] = now;
+      }
+    }
+
+    for (size_t i = 0; i < N; ++i) {
+      const fault_t &f        = faults[i];
+      const bool     in_time  = demoted_ms[i] >= f.from_ms && demoted_ms[i] - f.from_ms <= demote_limit(f.mode);
+      const bool     returned = back_ms[i] >= f.to_ms && back_ms[i] - f.to_ms <= return_limit() && health[i].voting();
+      printf("altimeter%zu: %s %u-%u ms, demoted at %u (%s), votes again at %u (%s), %u demotions, %u restarts\n",
+             i, sensors::printable_fault(demoted_by[i]), f.from_ms, f.to_ms, demoted_ms[i], in_time ? "ok" : "late",
+             back_ms[i], returned ? "ok" : "late", health[i].demotions(), health[i].restarts());
+      failed |= !in_time || !returned;
+    }
+
+    const bool accurate = max_error <= MAX_ERROR;
+    printf("voted pressure: max error %.4f hPa%s\n", max_error, accurate ? "" : " (over the bound)");
+    return !failed && accurate;
+  }
+
+  template<size_t N>
+  double vote_ns() {
+    constexpr size_t ROUNDS = 1'000'000;
+    using Data              = SensorIMU::Data;
+
+    sensors::health_t health[N];
+    Data              in[N];
+    for (size_t i = 0; i < N; ++i) {
+      health[i].begun(policy, true, 0);
+      health[i].read(true, true, true, 0);
+      in[i] = {0.1 * i, 0.2, 1.0 + 0.01 * i, 0., 0., 0.};
+    }
+
+    Data            out   = {};
+    volatile double sink  = 0.;
+    const auto      start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < ROUNDS; ++r) {
+      in[r % N].acc_x = static_cast<double>(r & 0xFF);
+      sensors::vote(in, health, out, &Data::acc_x, &Data::acc_y, &Data::acc_z, &Data::gyr_x, &Data::gyr_y,
+                    &Data::gyr_z);
+      sink = sink + out.acc_x;
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ROUNDS;
+  }
+}  // namespace
+
+int main() {
+  const bool ok = check_faults();
+
+  printf("vote of 6 fields: %.1f ns for 1 sensor, %.1f ns for 3, %.1f ns for 5\n", vote_ns<1>(), vote_ns<3>(),
+         vote_ns<5>());
+
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}